@@ -0,0 +1,25 @@
+#! /usr/bin/env Rscript
+
+plot_binom_on_hist <- function(counts, p) {
+    k = seq(from = min(counts), to = max(counts), by = 1)
+    n = sum(counts)
+    binom_probs = dbinom(k, n, p)
+    hist(counts, freq = F)
+    lines(k, binom_probs, type = 'l')
+}
+
+counts = c(49952, 49986, 50187, 49875)
+number_of_topologies = length(counts)
+binomial_prob = 1.0 / number_of_topologies
+topology = seq(from = 1, to = number_of_topologies, by = 1)
+d = data.frame(topology = topology, count = counts)
+
+pdf("3-leaf-general-tree-test-topo-vs-count.pdf")
+plot(x = d$topology, y = d$count, ylim = c(0, max(counts)))
+dev.off()
+
+pdf("3-leaf-general-tree-test-count-distribution.pdf")
+plot_binom_on_hist(counts = counts, p = binomial_prob)
+dev.off()
+
+chisq.test(counts)
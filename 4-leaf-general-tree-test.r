@@ -0,0 +1,26 @@
+#! /usr/bin/env Rscript
+
+plot_binom_on_hist <- function(counts, p) {
+    k = seq(from = min(counts), to = max(counts), by = 1)
+    n = sum(counts)
+    binom_probs = dbinom(k, n, p)
+    hist(counts, freq = F)
+    lines(k, binom_probs, type = 'l')
+}
+
+num_topologies_by_ndivs = c(1, 13, 15)
+counts = c(8739, 8480, 8549, 8788, 8563, 8535, 8618, 8459, 8585, 8602, 8755, 8715, 8665, 8539, 8565, 8667, 8744, 8596, 8745, 8678, 8616, 8771, 8533, 8709, 8533, 8535, 8406, 8676, 8634)
+number_of_topologies = length(counts)
+binomial_prob = 1.0 / number_of_topologies
+topology = seq(from = 1, to = number_of_topologies, by = 1)
+d = data.frame(topology = topology, count = counts)
+
+pdf("4-leaf-general-tree-test-topo-vs-count.pdf")
+plot(x = d$topology, y = d$count, ylim = c(0, max(counts)))
+dev.off()
+
+pdf("4-leaf-general-tree-test-count-distribution.pdf")
+plot_binom_on_hist(counts = counts, p = binomial_prob)
+dev.off()
+
+chisq.test(counts)
@@ -0,0 +1,26 @@
+#! /usr/bin/env Rscript
+
+plot_binom_on_hist <- function(counts, p) {
+    k = seq(from = min(counts), to = max(counts), by = 1)
+    n = sum(counts)
+    binom_probs = dbinom(k, n, p)
+    hist(counts, freq = F)
+    lines(k, binom_probs, type = 'l')
+}
+
+num_topologies_by_ndivs = c(1, 50, 180, 105)
+counts = c(3042, 2999, 3090, 2975, 2939, 3060, 2928, 2932, 2896, 2991, 2895, 2982, 2879, 2974, 3019, 2875, 3023, 3016, 2982, 3001, 2981, 2943, 3033, 2895, 3008, 2920, 2942, 2919, 2975, 2955, 2938, 3055, 2932, 2935, 2868, 2889, 2970, 2937, 3082, 2958, 3003, 2929, 2936, 2970, 2895, 2976, 3004, 2976, 3042, 2924, 2996, 3000, 2930, 2876, 2970, 2992, 3019, 2977, 3050, 2989, 2946, 2964, 3017, 3029, 3039, 2906, 2915, 2997, 2937, 3057, 3005, 3017, 3011, 3037, 2966, 3023, 2970, 2994, 2972, 2898, 2923, 3044, 2961, 3013, 2963, 2950, 3004, 2914, 2966, 2995, 3029, 2957, 2942, 2987, 3018, 3075, 2988, 2982, 3008, 2932, 2938, 2878, 2936, 2987, 3016, 2983, 3035, 2973, 2919, 2940, 2942, 2973, 3030, 2991, 2963, 3097, 3001, 3021, 2948, 3007, 2929, 3049, 2996, 3028, 3050, 2880, 3106, 2930, 2951, 2934, 3062, 3103, 3023, 2935, 2926, 3006, 2886, 3078, 3010, 2979, 3087, 2996, 2976, 2999, 3055, 3033, 2913, 2973, 2999, 3050, 2910, 2997, 3035, 3079, 3034, 2963, 2915, 3011, 3056, 3084, 2990, 3009, 2958, 2966, 2921, 2955, 2901, 2862, 2865, 2912, 2873, 3031, 3055, 3017, 2952, 2953, 2991, 3050, 3036, 2975, 3022, 2955, 2947, 3016, 2993, 2965, 2915, 3016, 3039, 2946, 2930, 2996, 3000, 2967, 2921, 3017, 2958, 2956, 2924, 3009, 2976, 2863, 3059, 2970, 2920, 2970, 3072, 3025, 2982, 2906, 3048, 3018, 3096, 3031, 2992, 2990, 2951, 2921, 3046, 2978, 3052, 2909, 3023, 3052, 2950, 2979, 2964, 2966, 2923, 2978, 2971, 2934, 2987, 2979, 2913, 3038, 3008, 2982, 3007, 2991, 2770, 2962, 2973, 2919, 2968, 3073, 3069, 3002, 3048, 2967, 2991, 3057, 2967, 2965, 2942, 3047, 2871, 2978, 3011, 3028, 2967, 2974, 3003, 2904, 2953, 2980, 2942, 3037, 3007, 2995, 2959, 3005, 2907, 2979, 2956, 2917, 2905, 2934, 2929, 2849, 2989, 2986, 2956, 3000, 2973, 2920, 2982, 2875, 2874, 2803, 2979, 3013, 2896, 2988, 2962, 3059, 3047, 2946, 2994, 2967, 2909, 2941, 2987, 3055, 3028, 2878, 2944, 2968, 2953, 2984, 3021, 2975, 2942, 2945, 2916, 2961, 3103, 3000, 2950, 2993, 3005, 3035, 2948, 2959, 3036, 2833, 2981, 2987, 2982, 3002, 2941, 2981, 2881, 2958, 2959, 2914)
+number_of_topologies = length(counts)
+binomial_prob = 1.0 / number_of_topologies
+topology = seq(from = 1, to = number_of_topologies, by = 1)
+d = data.frame(topology = topology, count = counts)
+
+pdf("5-leaf-general-tree-test-rj-auto-opt-topo-vs-count.pdf")
+plot(x = d$topology, y = d$count, ylim = c(0, max(counts)))
+dev.off()
+
+pdf("5-leaf-general-tree-test-rj-auto-opt-count-distribution.pdf")
+plot_binom_on_hist(counts = counts, p = binomial_prob)
+dev.off()
+
+chisq.test(counts)
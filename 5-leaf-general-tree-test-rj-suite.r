@@ -0,0 +1,26 @@
+#! /usr/bin/env Rscript
+
+plot_binom_on_hist <- function(counts, p) {
+    k = seq(from = min(counts), to = max(counts), by = 1)
+    n = sum(counts)
+    binom_probs = dbinom(k, n, p)
+    hist(counts, freq = F)
+    lines(k, binom_probs, type = 'l')
+}
+
+num_topologies_by_ndivs = c(1, 50, 180, 105)
+counts = c(2981, 3013, 2919, 2976, 2889, 2951, 2973, 2899, 3011, 2883, 2893, 2909, 2957, 2975, 2949, 2967, 2975, 3033, 2943, 2943, 2923, 2951, 2993, 2999, 2974, 2934, 2959, 2990, 2866, 2886, 3023, 3010, 3030, 2986, 2899, 2978, 2844, 2887, 2978, 2947, 2953, 2957, 3044, 2982, 2900, 2963, 3049, 3011, 3148, 2955, 2871, 2876, 2963, 2945, 2988, 3029, 3015, 2975, 3071, 2997, 2978, 3007, 2985, 2918, 3024, 3026, 2983, 3001, 2995, 2946, 2992, 3001, 2934, 3001, 2935, 2986, 3069, 2953, 2978, 3039, 3003, 2990, 2935, 2978, 2950, 2958, 2869, 3028, 3003, 2950, 2978, 2944, 2959, 2955, 2908, 2930, 2894, 2882, 2966, 2934, 2918, 3002, 2892, 3043, 2992, 3010, 3081, 2952, 2935, 2962, 2859, 2950, 2995, 3031, 2911, 2907, 2864, 2999, 2832, 3066, 2984, 2936, 2938, 2869, 2946, 2960, 2972, 2918, 3002, 2874, 2991, 3084, 3020, 2944, 3028, 2985, 3029, 2945, 2911, 2983, 2854, 3004, 2910, 3001, 2948, 3022, 2961, 2946, 3051, 3022, 2946, 3053, 3077, 2953, 2911, 2978, 2953, 3009, 2957, 3010, 3010, 3080, 2916, 2927, 2894, 2953, 2926, 2889, 2917, 2964, 2992, 2990, 3035, 2900, 2948, 3007, 2988, 3012, 3014, 2949, 2912, 3017, 2973, 3042, 3041, 3060, 3028, 2928, 3086, 3050, 3031, 3068, 2980, 3073, 3003, 2986, 3081, 2980, 2948, 3036, 2958, 2990, 2925, 3060, 2921, 2944, 2963, 2991, 2994, 2980, 3015, 3008, 3024, 3021, 2888, 2881, 2944, 2960, 2998, 2984, 2955, 2928, 3093, 3086, 2976, 3005, 2890, 3012, 2974, 2872, 2894, 2988, 2980, 2992, 2996, 2964, 3012, 3149, 2994, 2969, 2970, 3002, 2958, 2957, 3024, 2974, 2962, 2942, 2985, 2953, 3113, 2998, 3077, 3018, 2877, 3019, 2953, 2929, 2987, 3011, 3013, 2986, 2996, 2962, 3057, 2978, 2986, 2972, 2983, 2935, 3012, 3027, 3017, 2975, 2957, 2978, 3016, 2962, 2958, 2971, 2979, 3115, 3040, 3007, 2972, 2966, 2943, 3046, 3048, 2909, 2919, 2927, 2946, 2976, 2957, 2928, 3022, 3009, 2994, 3006, 2943, 3038, 2917, 2979, 2953, 2998, 2881, 2969, 3058, 3022, 3026, 2950, 2931, 3025, 2933, 2996, 2910, 3022, 3063, 2952, 2972, 3051, 2857, 3007, 3110, 2964, 2939, 2940, 2972, 3097, 2984, 2913, 2869, 2977, 3072, 3100)
+number_of_topologies = length(counts)
+binomial_prob = 1.0 / number_of_topologies
+topology = seq(from = 1, to = number_of_topologies, by = 1)
+d = data.frame(topology = topology, count = counts)
+
+pdf("5-leaf-general-tree-test-rj-suite-topo-vs-count.pdf")
+plot(x = d$topology, y = d$count, ylim = c(0, max(counts)))
+dev.off()
+
+pdf("5-leaf-general-tree-test-rj-suite-count-distribution.pdf")
+plot_binom_on_hist(counts = counts, p = binomial_prob)
+dev.off()
+
+chisq.test(counts)
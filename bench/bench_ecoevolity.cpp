@@ -0,0 +1,283 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <cstdio>
+
+#include "benchmark.hpp"
+
+#include "ecoevolity/matrix.hpp"
+#include "ecoevolity/likelihood.hpp"
+#include "ecoevolity/tree.hpp"
+#include "ecoevolity/rng.hpp"
+#include "ecoevolity/general_tree_settings.hpp"
+#include "ecoevolity/general_tree_operator_schedule.hpp"
+
+
+/**
+ * Build a random ultrametric population tree with `number_of_tips` leaves,
+ * each with `allele_count` sampled alleles. Leaves are indexed 0 to n-1 and
+ * internal nodes n to 2n-2, as expected by BasePopulationTree.
+ */
+std::shared_ptr<PopulationNode> get_random_population_tree(
+        RandomNumberGenerator & rng,
+        unsigned int number_of_tips,
+        unsigned int allele_count) {
+    std::vector< std::shared_ptr<PopulationNode> > nodes;
+    for (unsigned int i = 0; i < number_of_tips; ++i) {
+        std::shared_ptr<PopulationNode> leaf = std::make_shared<PopulationNode>(
+                i, "sp" + std::to_string(i + 1), 0.0, allele_count);
+        leaf->fix_node_height();
+        nodes.push_back(leaf);
+    }
+    unsigned int next_index = number_of_tips;
+    double height = 0.0;
+    while (nodes.size() > 1) {
+        height += rng.gamma(1.0, 0.01);
+        std::shared_ptr<PopulationNode> parent = std::make_shared<PopulationNode>(
+                next_index, "internal" + std::to_string(next_index), height);
+        ++next_index;
+        for (unsigned int c = 0; c < 2; ++c) {
+            unsigned int i = rng.uniform_int(0, nodes.size() - 1);
+            parent->add_child(nodes.at(i));
+            nodes.erase(nodes.begin() + i);
+        }
+        nodes.push_back(parent);
+    }
+    return nodes.at(0);
+}
+
+/**
+ * Population tree with a synthetic data set simulated on it with
+ * `simulate_biallelic_data_set`.
+ */
+BasePopulationTree get_tree_with_simulated_data(
+        RandomNumberGenerator & rng,
+        unsigned int number_of_tips,
+        unsigned int allele_count,
+        unsigned int number_of_sites) {
+    BasePopulationTree tree(
+            get_random_population_tree(rng, number_of_tips, allele_count),
+            number_of_sites,
+            1,      // length of loci
+            false); // validate data
+    tree.set_all_population_sizes(0.005);
+    BiallelicData data = tree.simulate_biallelic_data_set(rng, 1.0, false);
+    tree.set_data(data, false);
+    return tree;
+}
+
+std::vector<double> get_random_pattern_probs(
+        RandomNumberGenerator & rng,
+        unsigned int allele_count) {
+    std::vector<double> probs(((((allele_count + 1) * (allele_count + 2))/2) - 1), 0.0);
+    for (unsigned int i = 0; i < probs.size(); ++i) {
+        probs.at(i) = rng.uniform_real();
+    }
+    return probs;
+}
+
+
+void bm_cf_expmv(bench::State & state) {
+    const unsigned int allele_count = state.range(0);
+    RandomNumberGenerator rng(1);
+    MatrixExponentiator matrix_exponentiator;
+    QMatrix q(allele_count, 1.0, 1.0, 0.01);
+    std::vector<double> x = get_random_pattern_probs(rng, allele_count);
+    x.insert(x.begin(), 0.0);
+    while (state.keep_running()) {
+        std::vector<double> y = matrix_exponentiator.cf_expmvCOMPLEX(0.01, q, x);
+        bench::do_not_optimize(y);
+    }
+}
+
+void bm_merge_top_of_branch_partials(bench::State & state) {
+    const unsigned int allele_count = state.range(0);
+    RandomNumberGenerator rng(1);
+    const std::vector<double> probs1 = get_random_pattern_probs(rng, allele_count);
+    const std::vector<double> probs2 = get_random_pattern_probs(rng, allele_count);
+    std::vector<double> child1;
+    std::vector<double> child2;
+    std::vector<double> merged;
+    unsigned int merged_allele_count;
+    while (state.keep_running()) {
+        // The merge scales the child partials in place
+        child1 = probs1;
+        child2 = probs2;
+        merge_top_of_branch_partials(
+                allele_count,
+                allele_count,
+                child1,
+                child2,
+                merged_allele_count,
+                merged);
+        bench::do_not_optimize(merged);
+    }
+}
+
+void bm_get_log_likelihood(bench::State & state) {
+    const unsigned int number_of_tips = state.range(0);
+    const unsigned int allele_count = state.range(1);
+    const unsigned int number_of_sites = state.range(2);
+    const unsigned int nthreads = state.range(3);
+    RandomNumberGenerator rng(1);
+    BasePopulationTree tree = get_tree_with_simulated_data(rng,
+            number_of_tips,
+            allele_count,
+            number_of_sites);
+    const unsigned int npatterns = tree.get_data().get_number_of_patterns();
+    state.set_counter("patterns", npatterns);
+    state.set_items_processed_per_iteration(npatterns);
+    while (state.keep_running()) {
+        tree.make_dirty();
+        double lnl = tree.compute_log_likelihood(nthreads);
+        bench::do_not_optimize(lnl);
+    }
+}
+
+void bm_operator_schedule_generation(bench::State & state) {
+    const unsigned int number_of_tips = state.range(0);
+    const unsigned int nthreads = state.range(1);
+    RandomNumberGenerator rng(1);
+    BasePopulationTree data_tree = get_tree_with_simulated_data(rng,
+            number_of_tips,
+            2,      // allele count
+            1000);  // number of sites
+
+    // Go through a config file, as phycoeval does, so that the operator
+    // schedule and tree model match a real analysis. The data path in the
+    // config is relative to the directory of the config file.
+    std::string prefix = "bench-tmp-" + rng.random_string(10);
+    std::string data_path = prefix + "-data.yml";
+    std::string config_path = "./" + prefix + ".yml";
+    std::ofstream data_stream(data_path);
+    data_tree.get_data().write_yaml(data_stream);
+    data_stream.close();
+    std::ofstream config_stream(config_path);
+    config_stream << "---\n"
+                  << "data:\n"
+                  << "    ploidy: 2\n"
+                  << "    constant_sites_removed: false\n"
+                  << "    yaml_allele_counts:\n"
+                  << "        path: " << data_path << "\n"
+                  << "tree_model:\n"
+                  << "    tree_space: generalized\n"
+                  << "    starting_tree: random\n"
+                  << "    tree_prior:\n"
+                  << "        uniform_root_and_betas:\n"
+                  << "            parameters:\n"
+                  << "                root_height:\n"
+                  << "                    estimate: true\n"
+                  << "                    prior:\n"
+                  << "                        gamma_distribution:\n"
+                  << "                            shape: 10.0\n"
+                  << "                            mean: 0.05\n"
+                  << "                alpha_of_node_height_beta_prior:\n"
+                  << "                    value: 1.0\n"
+                  << "                    estimate: false\n"
+                  << "branch_parameters:\n"
+                  << "    population_size:\n"
+                  << "        equal_population_sizes: true\n"
+                  << "        value: 0.005\n"
+                  << "        estimate: true\n"
+                  << "        prior:\n"
+                  << "            gamma_distribution:\n"
+                  << "                shape: 20.0\n"
+                  << "                mean: 0.005\n"
+                  << "mutation_parameters:\n"
+                  << "    freq_1:\n"
+                  << "        value: 0.5\n"
+                  << "        estimate: false\n"
+                  << "    mutation_rate:\n"
+                  << "        value: 1.0\n"
+                  << "        estimate: false\n";
+    config_stream.close();
+    PopulationTreeSettings settings(config_path);
+    BasePopulationTree tree(settings, rng);
+    std::remove(data_path.c_str());
+    std::remove(config_path.c_str());
+
+    GeneralTreeOperatorSchedule<BasePopulationTree> operator_schedule(
+            settings.operator_settings, tree.get_leaf_node_count());
+    const unsigned int n_moves_per_generation = tree.get_leaf_node_count();
+    tree.make_dirty();
+    tree.compute_log_likelihood_and_prior(nthreads);
+    state.set_counter("moves_per_generation", n_moves_per_generation);
+
+    std::shared_ptr< GeneralTreeOperatorTemplate<BasePopulationTree> > op;
+    while (state.keep_running()) {
+        for (unsigned int move_count = 0;
+                move_count < n_moves_per_generation;
+                ++move_count) {
+            op = operator_schedule.draw_operator(rng);
+            op->operate_with_helpers(rng, &tree, nthreads, 1, 1);
+        }
+    }
+}
+
+
+std::vector<long> get_thread_counts() {
+#ifdef BUILD_WITH_THREADS
+    return {1, 2, 4};
+#else
+    return {1};
+#endif
+}
+
+int main(int argc, char * argv[]) {
+    bench::Runner runner;
+
+    std::vector< std::vector<long> > allele_count_args;
+    for (long n : {2, 4, 8, 16, 32, 64}) {
+        allele_count_args.push_back({n});
+    }
+    runner.add("cf_expmvCOMPLEX", bm_cf_expmv, allele_count_args);
+    runner.add("merge_top_of_branch_partials", bm_merge_top_of_branch_partials,
+            allele_count_args);
+
+    // Arguments: number of tips, alleles per tip, number of sites, threads
+    std::vector< std::vector<long> > likelihood_args;
+    for (long ntips : {4, 8, 16}) {
+        for (long nalleles : {2, 4}) {
+            for (long nsites : {100, 1000}) {
+                for (long nthreads : get_thread_counts()) {
+                    likelihood_args.push_back({ntips, nalleles, nsites, nthreads});
+                }
+            }
+        }
+    }
+    runner.add("get_log_likelihood", bm_get_log_likelihood, likelihood_args);
+
+    // Arguments: number of tips, threads
+    std::vector< std::vector<long> > generation_args;
+    for (long ntips : {4, 8}) {
+        for (long nthreads : get_thread_counts()) {
+            generation_args.push_back({ntips, nthreads});
+        }
+    }
+    runner.add("operator_schedule_generation", bm_operator_schedule_generation,
+            generation_args);
+
+    try {
+        return runner.main(argc, argv);
+    }
+    catch (std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,400 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_BENCHMARK_HPP
+#define ECOEVOLITY_BENCHMARK_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <ctime>
+#include <regex>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+#include "ecoevolity/error.hpp"
+#include "ecoevolity/assert.hpp"
+#include "ecoevolity/string_util.hpp"
+
+/**
+ * A small, dependency-free microbenchmark harness.
+ *
+ * Benchmarks are registered with a name and a set of argument lists; each
+ * argument list is run as a separate benchmark named
+ * "<name>/<arg1>/<arg2>/...". Results are written to the console and,
+ * optionally, to a JSON file using the same layout as Google Benchmark
+ * ("context" and "benchmarks" sections), so that existing tools for
+ * comparing Google Benchmark output also work on these results.
+ */
+namespace bench {
+
+/**
+ * Prevent the compiler from optimizing away a computed value.
+ */
+template<typename T>
+inline void do_not_optimize(const T & value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+class State {
+    protected:
+        std::vector<long> arguments_;
+        unsigned long max_iterations_;
+        unsigned long iterations_ = 0;
+        bool started_ = false;
+        bool paused_ = false;
+        std::chrono::steady_clock::time_point real_start_;
+        std::clock_t cpu_start_ = 0;
+        double real_seconds_ = 0.0;
+        double cpu_seconds_ = 0.0;
+        std::map<std::string, double> counters_;
+        double items_processed_ = 0.0;
+
+        void start_timer_() {
+            this->real_start_ = std::chrono::steady_clock::now();
+            this->cpu_start_ = std::clock();
+        }
+        void stop_timer_() {
+            std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - this->real_start_;
+            this->real_seconds_ += elapsed.count();
+            this->cpu_seconds_ += (double)(std::clock() - this->cpu_start_) / CLOCKS_PER_SEC;
+        }
+
+    public:
+        State(const std::vector<long> & arguments,
+                unsigned long max_iterations)
+            : arguments_(arguments),
+              max_iterations_(max_iterations) { }
+
+        /**
+         * Returns true while there are iterations left to run. Timing starts
+         * with the first call and stops when this returns false, so setup
+         * before the loop is not timed.
+         */
+        bool keep_running() {
+            if (! this->started_) {
+                this->started_ = true;
+                this->start_timer_();
+            }
+            if (this->iterations_ < this->max_iterations_) {
+                ++this->iterations_;
+                return true;
+            }
+            if (! this->paused_) {
+                this->stop_timer_();
+            }
+            return false;
+        }
+
+        void pause_timing() {
+            ECOEVOLITY_ASSERT(! this->paused_);
+            this->stop_timer_();
+            this->paused_ = true;
+        }
+        void resume_timing() {
+            ECOEVOLITY_ASSERT(this->paused_);
+            this->paused_ = false;
+            this->start_timer_();
+        }
+
+        long range(unsigned int index) const {
+            return this->arguments_.at(index);
+        }
+        unsigned long get_iterations() const {
+            return this->iterations_;
+        }
+        double get_real_seconds() const {
+            return this->real_seconds_;
+        }
+        double get_cpu_seconds() const {
+            return this->cpu_seconds_;
+        }
+
+        /**
+         * Number of items (e.g., site patterns) processed per iteration;
+         * reported as items_per_second.
+         */
+        void set_items_processed_per_iteration(double n) {
+            this->items_processed_ = n;
+        }
+        double get_items_processed_per_iteration() const {
+            return this->items_processed_;
+        }
+
+        /**
+         * User counters are reported as-is in the results.
+         */
+        void set_counter(const std::string & name, double value) {
+            this->counters_[name] = value;
+        }
+        const std::map<std::string, double> & get_counters() const {
+            return this->counters_;
+        }
+};
+
+typedef std::function<void(State &)> BenchmarkFunction;
+
+class Result {
+    public:
+        std::string name;
+        unsigned long iterations = 0;
+        double real_time = 0.0;
+        double cpu_time = 0.0;
+        double items_per_second = 0.0;
+        std::map<std::string, double> counters;
+};
+
+class Benchmark {
+    public:
+        std::string name;
+        BenchmarkFunction function;
+        std::vector< std::vector<long> > argument_sets;
+
+        std::string get_run_name(const std::vector<long> & arguments) const {
+            std::ostringstream s;
+            s << this->name;
+            for (auto a : arguments) {
+                s << "/" << a;
+            }
+            return s.str();
+        }
+};
+
+class Runner {
+    protected:
+        std::vector<Benchmark> benchmarks_;
+        double min_time_ = 0.5;
+        unsigned long max_iterations_ = 1000000000;
+
+        Result run_(const Benchmark & benchmark,
+                const std::vector<long> & arguments) const {
+            // Grow the number of iterations until the timed loop runs for at
+            // least min_time seconds
+            unsigned long iterations = 1;
+            while (true) {
+                State state(arguments, iterations);
+                benchmark.function(state);
+                double seconds = state.get_real_seconds();
+                if ((seconds >= this->min_time_) ||
+                        (iterations >= this->max_iterations_)) {
+                    Result r;
+                    r.name = benchmark.get_run_name(arguments);
+                    r.iterations = state.get_iterations();
+                    r.real_time = (seconds / r.iterations) * 1e9;
+                    r.cpu_time = (state.get_cpu_seconds() / r.iterations) * 1e9;
+                    if ((state.get_items_processed_per_iteration() > 0.0) && (seconds > 0.0)) {
+                        r.items_per_second = (state.get_items_processed_per_iteration() *
+                                r.iterations) / seconds;
+                    }
+                    r.counters = state.get_counters();
+                    return r;
+                }
+                double multiplier = 10.0;
+                if (seconds > 0.0) {
+                    multiplier = std::min(10.0,
+                            std::max(1.5, (1.4 * this->min_time_) / seconds));
+                }
+                iterations = (unsigned long)std::ceil(iterations * multiplier);
+            }
+        }
+
+        static std::string escape_json_(const std::string & s) {
+            std::ostringstream out;
+            for (auto c : s) {
+                if ((c == '"') || (c == '\\')) {
+                    out << '\\';
+                }
+                out << c;
+            }
+            return out.str();
+        }
+
+    public:
+        void add(const std::string & name,
+                BenchmarkFunction function,
+                const std::vector< std::vector<long> > & argument_sets) {
+            Benchmark b;
+            b.name = name;
+            b.function = function;
+            b.argument_sets = argument_sets;
+            if (b.argument_sets.empty()) {
+                b.argument_sets.push_back(std::vector<long>());
+            }
+            this->benchmarks_.push_back(b);
+        }
+
+        void set_min_time(double seconds) {
+            this->min_time_ = seconds;
+        }
+
+        std::vector<std::string> get_run_names() const {
+            std::vector<std::string> names;
+            for (auto const & b : this->benchmarks_) {
+                for (auto const & args : b.argument_sets) {
+                    names.push_back(b.get_run_name(args));
+                }
+            }
+            return names;
+        }
+
+        std::vector<Result> run(const std::string & filter,
+                std::ostream & console) const {
+            std::regex pattern(filter);
+            std::vector<Result> results;
+            console << std::left << std::setw(56) << "Benchmark"
+                    << std::right << std::setw(16) << "Time (ns)"
+                    << std::setw(16) << "CPU (ns)"
+                    << std::setw(14) << "Iterations" << "\n"
+                    << std::string(102, '-') << "\n";
+            for (auto const & b : this->benchmarks_) {
+                for (auto const & args : b.argument_sets) {
+                    std::string run_name = b.get_run_name(args);
+                    if (! std::regex_search(run_name, pattern)) {
+                        continue;
+                    }
+                    Result r = this->run_(b, args);
+                    console << std::left << std::setw(56) << r.name
+                            << std::right << std::setw(16) << std::fixed << std::setprecision(0) << r.real_time
+                            << std::setw(16) << r.cpu_time
+                            << std::setw(14) << r.iterations;
+                    if (r.items_per_second > 0.0) {
+                        console << "  items/s=" << std::setprecision(1) << r.items_per_second;
+                    }
+                    for (auto const & c : r.counters) {
+                        console << "  " << c.first << "=" << std::setprecision(0) << c.second;
+                    }
+                    console << std::endl;
+                    results.push_back(r);
+                }
+            }
+            return results;
+        }
+
+        void write_json(std::ostream & out,
+                const std::vector<Result> & results,
+                const std::string & executable) const {
+            std::time_t now = std::time(nullptr);
+            char date[64];
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+            out << std::setprecision(12);
+            out << "{\n"
+                << "  \"context\": {\n"
+                << "    \"date\": \"" << date << "\",\n"
+                << "    \"executable\": \"" << escape_json_(executable) << "\",\n"
+                << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+                << "    \"library_build_type\": \"release\",\n"
+#else
+                << "    \"library_build_type\": \"debug\",\n"
+#endif
+#ifdef BUILD_WITH_THREADS
+                << "    \"built_with_threads\": true\n"
+#else
+                << "    \"built_with_threads\": false\n"
+#endif
+                << "  },\n"
+                << "  \"benchmarks\": [";
+            for (unsigned int i = 0; i < results.size(); ++i) {
+                const Result & r = results.at(i);
+                out << ((i > 0) ? ",\n" : "\n")
+                    << "    {\n"
+                    << "      \"name\": \"" << escape_json_(r.name) << "\",\n"
+                    << "      \"run_name\": \"" << escape_json_(r.name) << "\",\n"
+                    << "      \"run_type\": \"iteration\",\n"
+                    << "      \"iterations\": " << r.iterations << ",\n"
+                    << "      \"real_time\": " << r.real_time << ",\n"
+                    << "      \"cpu_time\": " << r.cpu_time << ",\n"
+                    << "      \"time_unit\": \"ns\"";
+                if (r.items_per_second > 0.0) {
+                    out << ",\n      \"items_per_second\": " << r.items_per_second;
+                }
+                for (auto const & c : r.counters) {
+                    out << ",\n      \"" << escape_json_(c.first) << "\": " << c.second;
+                }
+                out << "\n    }";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        /**
+         * Parse Google-Benchmark-style command-line flags and run:
+         *     --benchmark_filter=<regex>
+         *     --benchmark_min_time=<seconds>
+         *     --benchmark_out=<path to JSON output>
+         *     --benchmark_list_tests
+         */
+        int main(int argc, char * argv[]) {
+            std::string filter = ".";
+            std::string out_path = "";
+            bool list_only = false;
+            for (int i = 1; i < argc; ++i) {
+                std::string arg = argv[i];
+                std::vector<std::string> key_value = string_util::split(arg, '=');
+                if (key_value.at(0) == "--benchmark_filter" && key_value.size() == 2) {
+                    filter = key_value.at(1);
+                }
+                else if (key_value.at(0) == "--benchmark_min_time" && key_value.size() == 2) {
+                    this->set_min_time(std::stod(key_value.at(1)));
+                }
+                else if (key_value.at(0) == "--benchmark_out" && key_value.size() == 2) {
+                    out_path = key_value.at(1);
+                }
+                else if (arg == "--benchmark_list_tests") {
+                    list_only = true;
+                }
+                else {
+                    std::cerr << "ERROR: unrecognized argument: " << arg << "\n"
+                              << "Usage: " << argv[0]
+                              << " [--benchmark_filter=<regex>]"
+                              << " [--benchmark_min_time=<seconds>]"
+                              << " [--benchmark_out=<path>]"
+                              << " [--benchmark_list_tests]\n";
+                    return 1;
+                }
+            }
+            if (list_only) {
+                for (auto const & name : this->get_run_names()) {
+                    std::cout << name << "\n";
+                }
+                return 0;
+            }
+            std::vector<Result> results = this->run(filter, std::cout);
+            if (! out_path.empty()) {
+                std::ofstream out(out_path);
+                if (! out.is_open()) {
+                    throw EcoevolityError("Could not open benchmark output file: " + out_path);
+                }
+                this->write_json(out, results, argv[0]);
+                std::cout << "\nResults written to: " << out_path << "\n";
+            }
+            return 0;
+        }
+};
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,76 @@
+#! /usr/bin/env python3
+
+"""
+Compare the JSON output of bench_ecoevolity (or any Google-Benchmark-style
+JSON file) to a baseline, and exit with a non-zero status if any benchmark
+is slower than the baseline by more than the threshold.
+"""
+
+import sys
+import json
+import argparse
+
+
+def read_results(path):
+    with open(path, "r") as stream:
+        results = json.load(stream)
+    times = {}
+    for b in results.get("benchmarks", []):
+        if b.get("run_type", "iteration") != "iteration":
+            continue
+        times[b["name"]] = float(b["real_time"])
+    return times
+
+
+def main(argv = sys.argv[1:]):
+    parser = argparse.ArgumentParser(description = __doc__)
+    parser.add_argument("baseline_path",
+            help = "Path to baseline benchmark JSON file.")
+    parser.add_argument("results_path",
+            help = "Path to new benchmark JSON file.")
+    parser.add_argument("-t", "--threshold",
+            type = float,
+            default = 0.1,
+            help = ("Maximum allowed proportional increase in run time "
+                    "(default: 0.1)."))
+    args = parser.parse_args(argv)
+
+    baseline = read_results(args.baseline_path)
+    results = read_results(args.results_path)
+
+    regressions = []
+    name_width = max([len(n) for n in results] + [9])
+    sys.stdout.write("{0:<{w}}  {1:>14}  {2:>14}  {3:>8}\n".format(
+            "Benchmark", "Baseline (ns)", "New (ns)", "Ratio", w = name_width))
+    for name in sorted(results):
+        new_time = results[name]
+        if name not in baseline:
+            sys.stdout.write("{0:<{w}}  {1:>14}  {2:>14.0f}  {3:>8}\n".format(
+                    name, "-", new_time, "new", w = name_width))
+            continue
+        old_time = baseline[name]
+        ratio = new_time / old_time
+        flag = ""
+        if ratio > (1.0 + args.threshold):
+            flag = "  SLOWER"
+            regressions.append(name)
+        elif ratio < (1.0 - args.threshold):
+            flag = "  faster"
+        sys.stdout.write("{0:<{w}}  {1:>14.0f}  {2:>14.0f}  {3:>8.3f}{4}\n".format(
+                name, old_time, new_time, ratio, flag, w = name_width))
+    for name in sorted(set(baseline) - set(results)):
+        sys.stdout.write("{0:<{w}}  {1:>14.0f}  {2:>14}  {3:>8}\n".format(
+                name, baseline[name], "-", "missing", w = name_width))
+
+    if regressions:
+        sys.stderr.write("\n{0} benchmark(s) slower than baseline by more "
+                "than {1:.0f}%:\n".format(len(regressions),
+                        args.threshold * 100.0))
+        for name in regressions:
+            sys.stderr.write("    {0}\n".format(name))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,250 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_ASYNC_LOG_WRITER_HPP
+#define ECOEVOLITY_ASYNC_LOG_WRITER_HPP
+
+#include <iostream>
+#include <streambuf>
+#include <vector>
+#include <deque>
+#include <chrono>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+#include "assert.hpp"
+#include "error.hpp"
+
+
+/**
+ * A stream buffer that collects log output in memory and hands full buffers
+ * to a background thread that writes them to another stream.
+ *
+ * Output is collected in a preallocated buffer of `buffer_size` bytes. When
+ * it is full, it is queued for the writer thread and filling continues in a
+ * free buffer. At most `max_queued_buffers` buffers are queued; if the writer
+ * falls that far behind, the logging thread waits for it.
+ *
+ * Flushes (e.g., from std::endl) only hand off a partially filled buffer if
+ * none has been handed off in the last `flush_interval`, so that log files
+ * still grow while a chain runs, without a write for every sample.
+ *
+ * Without threads, buffers are written when they are handed off.
+ */
+class AsyncLogBuffer : public std::streambuf {
+    protected:
+        std::ostream & out_;
+        std::size_t buffer_size_;
+        std::chrono::steady_clock::duration flush_interval_;
+        std::chrono::steady_clock::time_point last_hand_off_;
+        std::vector<char> buffer_;
+        bool closed_ = false;
+
+#ifdef BUILD_WITH_THREADS
+        std::deque< std::vector<char> > full_buffers_;
+        std::vector< std::vector<char> > free_buffers_;
+        std::mutex mutex_;
+        std::condition_variable buffer_queued_;
+        std::condition_variable buffer_freed_;
+        std::thread writer_;
+        bool stopping_ = false;
+        bool write_failed_ = false;
+
+        void write_buffers_() {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            while (true) {
+                this->buffer_queued_.wait(lock, [this]() {
+                        return (this->stopping_ || (! this->full_buffers_.empty()));
+                });
+                if (this->full_buffers_.empty()) {
+                    return;
+                }
+                std::vector<char> buffer = std::move(this->full_buffers_.front());
+                this->full_buffers_.pop_front();
+                lock.unlock();
+                this->out_.write(buffer.data(), buffer.size());
+                this->out_.flush();
+                bool failed = (! this->out_.good());
+                lock.lock();
+                if (failed) {
+                    this->write_failed_ = true;
+                }
+                this->free_buffers_.push_back(std::move(buffer));
+                this->buffer_freed_.notify_one();
+            }
+        }
+#endif
+
+        void reset_put_area_() {
+            this->buffer_.resize(this->buffer_size_);
+            this->setp(this->buffer_.data(),
+                    this->buffer_.data() + this->buffer_.size());
+        }
+
+        void hand_off_() {
+            this->last_hand_off_ = std::chrono::steady_clock::now();
+            std::size_t size = this->pptr() - this->pbase();
+            if (size < 1) {
+                return;
+            }
+            this->buffer_.resize(size);
+#ifdef BUILD_WITH_THREADS
+            {
+                std::unique_lock<std::mutex> lock(this->mutex_);
+                this->buffer_freed_.wait(lock, [this]() {
+                        return (! this->free_buffers_.empty());
+                });
+                if (this->write_failed_) {
+                    throw EcoevolityError("Could not write to log file");
+                }
+                this->full_buffers_.push_back(std::move(this->buffer_));
+                this->buffer_ = std::move(this->free_buffers_.back());
+                this->free_buffers_.pop_back();
+            }
+            this->buffer_queued_.notify_one();
+#else
+            this->out_.write(this->buffer_.data(), this->buffer_.size());
+            this->out_.flush();
+            if (! this->out_.good()) {
+                throw EcoevolityError("Could not write to log file");
+            }
+#endif
+            this->reset_put_area_();
+        }
+
+        int_type overflow(int_type c) {
+            if (this->closed_) {
+                return traits_type::eof();
+            }
+            this->hand_off_();
+            if (! traits_type::eq_int_type(c, traits_type::eof())) {
+                *this->pptr() = traits_type::to_char_type(c);
+                this->pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() {
+            if (this->closed_) {
+                return 0;
+            }
+            if ((std::chrono::steady_clock::now() - this->last_hand_off_) >=
+                    this->flush_interval_) {
+                this->hand_off_();
+            }
+            return 0;
+        }
+
+    public:
+        AsyncLogBuffer(std::ostream & out,
+                std::size_t buffer_size = 1 << 16,
+                unsigned int max_queued_buffers = 4,
+                std::chrono::steady_clock::duration flush_interval =
+                        std::chrono::seconds(1))
+                : out_(out),
+                  buffer_size_(buffer_size),
+                  flush_interval_(flush_interval),
+                  last_hand_off_(std::chrono::steady_clock::now()) {
+            ECOEVOLITY_ASSERT(buffer_size > 0);
+            ECOEVOLITY_ASSERT(max_queued_buffers > 0);
+            this->buffer_.reserve(buffer_size);
+            this->reset_put_area_();
+#ifdef BUILD_WITH_THREADS
+            for (unsigned int i = 0; i < max_queued_buffers; ++i) {
+                this->free_buffers_.push_back(std::vector<char>());
+                this->free_buffers_.back().reserve(buffer_size);
+            }
+            this->writer_ = std::thread(&AsyncLogBuffer::write_buffers_, this);
+#endif
+        }
+
+        AsyncLogBuffer(const AsyncLogBuffer &) = delete;
+        AsyncLogBuffer & operator=(const AsyncLogBuffer &) = delete;
+
+        ~AsyncLogBuffer() {
+            try {
+                this->close();
+            }
+            catch (...) { }
+        }
+
+        /**
+         * Hands off the output collected so far and waits until everything
+         * has been written to the stream. Nothing more can be logged.
+         */
+        void close() {
+            if (this->closed_) {
+                return;
+            }
+            bool hand_off_failed = false;
+            try {
+                this->hand_off_();
+            }
+            catch (...) {
+                hand_off_failed = true;
+            }
+            this->closed_ = true;
+            this->setp(nullptr, nullptr);
+#ifdef BUILD_WITH_THREADS
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->stopping_ = true;
+            }
+            this->buffer_queued_.notify_one();
+            this->writer_.join();
+            if (this->write_failed_) {
+                hand_off_failed = true;
+            }
+#endif
+            if (hand_off_failed) {
+                throw EcoevolityError("Could not write to log file");
+            }
+        }
+};
+
+
+/**
+ * An output stream that logs to another stream through an AsyncLogBuffer.
+ * The formatting state (e.g., precision) of the other stream is copied.
+ * `close` should be called before the other stream is closed.
+ */
+class AsyncLogStream : public std::ostream {
+    protected:
+        AsyncLogBuffer buffer_;
+
+    public:
+        AsyncLogStream(std::ostream & out,
+                std::size_t buffer_size = 1 << 16,
+                unsigned int max_queued_buffers = 4)
+                : std::ostream(nullptr),
+                  buffer_(out, buffer_size, max_queued_buffers) {
+            this->rdbuf(&this->buffer_);
+            this->copyfmt(out);
+        }
+
+        void close() {
+            this->buffer_.close();
+        }
+};
+
+#endif
@@ -58,6 +58,21 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
         std::shared_ptr<PositiveRealParameter> stored_height_ = std::make_shared<PositiveRealParameter>(0.0);
         bool is_dirty_ = true;
 
+        // Incremented whenever a child is added to or removed from this node
+        // or any of its descendants (or the index of one of them changes),
+        // so that compiled views of a tree (e.g., FlatTree) know when to
+        // recompile from the version of its root.
+        unsigned long topology_version_ = 0;
+
+        void record_topology_change_() {
+            ++this->topology_version_;
+            std::shared_ptr<DerivedNodeT> ancestor = this->parent_.lock();
+            while (ancestor) {
+                ++ancestor->topology_version_;
+                ancestor = ancestor->parent_.lock();
+            }
+        }
+
         void add_ln_relative_node_height_prior_density(
                 double& density,
                 std::vector< std::shared_ptr<PositiveRealParameter> >& parameters) const {
@@ -132,6 +147,10 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
         /*     return new DerivedNodeT(static_cast<DerivedNodeT const &>(* this)); */
         /* } */
 
+        unsigned long get_topology_version() const {
+            return this->topology_version_;
+        }
+
         bool operator< (const DerivedNodeT & other) const {
             return this->get_height() < other.get_height();
         }
@@ -194,6 +213,15 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
         virtual void extract_data_from_node_comments(
                 const std::map<std::string, std::string> & comment_map) { }
 
+        /**
+         * Method to populate non-height related data (e.g., pop size) from
+         * a map of parameter values (the inverse of get_parameter_map).
+         * Nothing to do for BaseNode, but this is intended for derived classes
+         * to override
+         */
+        virtual void extract_data_from_parameter_map(
+                const std::map<std::string, double> & parameter_map) { }
+
         unsigned int degree() const {
             unsigned int d = children_.size();
             if (this->has_parent()) {
@@ -404,6 +432,7 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
             }
             if (! this->is_child(node)) {
                 this->children_.push_back(node);
+                this->record_topology_change_();
             }
             if (! node->is_parent(this->shared_from_this())) {
                 node->add_parent(this->shared_from_this());
@@ -419,6 +448,7 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
                 if (this->children_.at(i) == node) {
                     this->children_.at(i).reset();
                     this->children_.erase(this->children_.begin() + i);
+                    this->record_topology_change_();
                     node->remove_parent();
                 }
             }
@@ -432,6 +462,7 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
             std::shared_ptr<DerivedNodeT> c = this->children_.at(index);
             this->children_.at(index).reset();
             this->children_.erase(this->children_.begin() + index);
+            this->record_topology_change_();
             c->remove_parent();
             this->make_dirty();
             return c;
@@ -465,6 +496,10 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
         std::shared_ptr<PositiveRealParameter> get_height_parameter() const {
             return this->height_;
         }
+        // Raw pointer access for hot loops (avoids bumping the reference count)
+        const PositiveRealParameter * get_height_parameter_pointer() const {
+            return this->height_.get();
+        }
 
         void update_height(double height) {
             this->height_->update_value(height);
@@ -604,7 +639,10 @@ class BaseNode : public std::enable_shared_from_this<DerivedNodeT> {
             return this->index_;
         }
         void set_index(int i) {
-            this->index_ = i;
+            if (this->index_ != i) {
+                this->index_ = i;
+                this->record_topology_change_();
+            }
         }
         const std::string& get_label() const {
             return this->label_;
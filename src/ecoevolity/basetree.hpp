@@ -23,18 +23,25 @@
 #include <ncl/nxsmultiformat.h>
 
 #include "split.hpp"
+#include "newick.hpp"
+#include "flattree.hpp"
+#include "cost_counters.hpp"
+#include "compressed_stream.hpp"
+#include "generalized_tree_counts.hpp"
 #include "parameter.hpp"
 #include "probability.hpp"
 #include "error.hpp"
 #include "assert.hpp"
 
 class PopSizeScaler;
+class PopSizeMultipleTryScaler;
 class GlobalHeightSizeMixer;
 template<class TreeType> class GlobalNodeHeightDirichletOperator;
 
 template<class NodeType>
 class BaseTree {
         friend class PopSizeScaler;
+        friend class PopSizeMultipleTryScaler;
         friend class GlobalHeightSizeMixer;
         template<class TreeType>
         friend class GlobalNodeHeightDirichletOperator;
@@ -61,9 +68,17 @@ class BaseTree {
         bool ignore_data_ = false;
         unsigned int number_of_likelihood_calculations_ = 0;
 
+        // The cost of evaluating the states of this tree (see
+        // OperatorStatsTimer); likelihoods are computed in const methods
+        mutable ModelCostCounters cost_counters_;
+
         std::vector< std::shared_ptr<NodeType> > pre_ordered_nodes_;
         std::vector< std::shared_ptr<NodeType> > level_ordered_nodes_;
 
+        // Compiled post-order view of the tree used by the likelihood and
+        // prior calculations; see update_flat_tree
+        FlatTree<NodeType> flat_tree_;
+
         // The case where a singleton polytomy is mapped to the height we are
         // splitting; we have to handle this a little differently.
         // Because there is only one node mapped to the height, we have to make
@@ -211,7 +226,7 @@ class BaseTree {
 
         void build_from_path_(const std::string & path,
                 const std::string & ncl_file_format) {
-            std::ifstream in_stream;
+            InputFileStream in_stream;
             in_stream.open(path);
             if (! in_stream.is_open()) {
                 throw EcoevolityParsingError(
@@ -467,7 +482,24 @@ class BaseTree {
             ECOEVOLITY_ASSERT(ncl_node->GetFirstChild());
             std::map<std::string, std::string> comment_map;
             this->parse_node_comments_(ncl_node, comment_map);
-            double height;
+            double height = 0.0;
+            if (! using_height_comments) {
+                // Need to get height from edge lengths
+                height = this->get_simple_node_height_(ncl_node);
+            }
+            return this->create_internal_node_(comment_map,
+                    height,
+                    indices_to_heights,
+                    using_height_comments,
+                    internal_index);
+        }
+
+        std::shared_ptr<NodeType> create_internal_node_(
+                std::map<std::string, std::string> & comment_map,
+                double height,
+                std::map<unsigned int, std::shared_ptr<PositiveRealParameter> > & indices_to_heights,
+                const bool using_height_comments,
+                const unsigned int internal_index) {
             unsigned int height_index;
             if (using_height_comments) {
                 std::stringstream h_converter(comment_map["height"]);
@@ -481,10 +513,6 @@ class BaseTree {
                             i_converter.str() + "\'");
                 }
             }
-            else {
-                // Need to get height from edge lengths
-                height = this->get_simple_node_height_(ncl_node);
-            }
             std::shared_ptr<NodeType> node = std::make_shared<NodeType>(
                     internal_index,
                     height);
@@ -509,6 +537,102 @@ class BaseTree {
             return node;
         }
         
+        /**
+         * Build the tree from a tree parsed by newick::parse_tree. Nodes are
+         * created the same way as when building from an NCL tree
+         * description: leaf indices follow the sorted order of the leaf
+         * labels, and internal nodes are indexed in pre-order after the
+         * leaves.
+         */
+        void build_from_parsed_tree_(
+                const newick::ParsedTree & parsed_tree,
+                double ultrametricity_tolerance = 1e-6) {
+            const std::vector<newick::ParsedNode> & parsed_nodes = parsed_tree.nodes;
+            ECOEVOLITY_ASSERT(parsed_nodes.size() > 0);
+            if (parsed_nodes.at(0).is_leaf()) {
+                throw EcoevolityError("Input tree has a single leaf");
+            }
+
+            // Depth of each node from the root and heights from the edge
+            // lengths (following first children, as done for NCL trees)
+            std::vector<double> depths(parsed_nodes.size(), 0.0);
+            std::vector<double> edge_heights(parsed_nodes.size(), 0.0);
+            std::vector<std::string> leaf_labels;
+            for (unsigned int i = 1; i < parsed_nodes.size(); ++i) {
+                depths.at(i) = depths.at(parsed_nodes.at(i).parent) +
+                        parsed_nodes.at(i).length;
+            }
+            double max_leaf_depth = -1.0;
+            double min_leaf_depth = std::numeric_limits<double>::max();
+            for (int i = parsed_nodes.size() - 1; i >= 0; --i) {
+                const newick::ParsedNode & parsed_node = parsed_nodes.at(i);
+                if (parsed_node.is_leaf()) {
+                    leaf_labels.push_back(parsed_node.label);
+                    max_leaf_depth = std::max(max_leaf_depth, depths.at(i));
+                    min_leaf_depth = std::min(min_leaf_depth, depths.at(i));
+                }
+                else {
+                    unsigned int first_child = parsed_node.children.at(0);
+                    edge_heights.at(i) = edge_heights.at(first_child) +
+                        parsed_nodes.at(first_child).length;
+                }
+            }
+            // Equivalent to checking that, for every pair of leaves, both
+            // are equidistant from their MRCA
+            if ((max_leaf_depth - min_leaf_depth) >
+                    (max_leaf_depth * ultrametricity_tolerance)) {
+                throw EcoevolityError("Input tree not ultrametric");
+            }
+
+            // Sort labels to ensure we always give the same label the same
+            // leaf node index
+            std::sort(leaf_labels.begin(), leaf_labels.end());
+            std::unordered_map<std::string, int> leaf_label_to_index_map;
+            leaf_label_to_index_map.reserve(leaf_labels.size());
+            for (unsigned int i = 0; i < leaf_labels.size(); ++i) {
+                if (leaf_label_to_index_map.count(leaf_labels.at(i)) > 0) {
+                    throw EcoevolityError("Leaf label \'" + leaf_labels.at(i) +
+                            "\' appears more than once in input tree");
+                }
+                leaf_label_to_index_map[leaf_labels.at(i)] = i;
+            }
+
+            bool using_height_comments = false;
+            if (parsed_nodes.at(0).comment_map.count("height_index") > 0) {
+                using_height_comments = true;
+            }
+            std::map<unsigned int, std::shared_ptr<PositiveRealParameter> > indices_to_heights;
+            int next_internal_index = leaf_labels.size();
+            std::vector< std::shared_ptr<NodeType> > nodes;
+            nodes.reserve(parsed_nodes.size());
+            for (unsigned int i = 0; i < parsed_nodes.size(); ++i) {
+                const newick::ParsedNode & parsed_node = parsed_nodes.at(i);
+                std::map<std::string, std::string> comment_map = parsed_node.comment_map;
+                std::shared_ptr<NodeType> node;
+                if (parsed_node.is_leaf()) {
+                    node = std::make_shared<NodeType>(
+                            leaf_label_to_index_map.at(parsed_node.label),
+                            parsed_node.label,
+                            0.0);
+                    node->fix_node_height();
+                    node->extract_data_from_node_comments(comment_map);
+                }
+                else {
+                    node = this->create_internal_node_(comment_map,
+                            edge_heights.at(i),
+                            indices_to_heights,
+                            using_height_comments,
+                            next_internal_index);
+                    ++next_internal_index;
+                }
+                if (parsed_node.parent > -1) {
+                    nodes.at(parsed_node.parent)->add_child(node);
+                }
+                nodes.push_back(node);
+            }
+            this->set_root(nodes.at(0));
+        }
+
         double get_simple_node_height_(const NxsSimpleNode * node) {
             double height = 0.0;
             NxsSimpleNode * child = node->GetFirstChild();
@@ -561,6 +685,16 @@ class BaseTree {
             }
         }
 
+        BaseTree(const newick::ParsedTree & parsed_tree,
+                const double ultrametricity_tolerance = 1e-6,
+                const double multiplier = -1.0) {
+            this->build_from_parsed_tree_(parsed_tree,
+                    ultrametricity_tolerance);
+            if (multiplier > 0.0) {
+                this->scale_tree(multiplier);
+            }
+        }
+
         typedef std::shared_ptr<NodeType> NodePtr;
 
         virtual double get_ln_prob_of_drawing_node_state(
@@ -585,6 +719,24 @@ class BaseTree {
             this->root_->make_all_clean();
         }
 
+        /**
+         * Bring the compiled post-order view of the tree up to date. The view
+         * is only recompiled if the topology has changed since the last
+         * update; otherwise only the node heights are refreshed.
+         */
+        void update_flat_tree() {
+            this->flat_tree_.update(*this->root_);
+        }
+
+        /**
+         * Get the compiled post-order view of the tree, as of the last call
+         * to update_flat_tree.
+         */
+        const FlatTree<NodeType>& get_flat_tree() const {
+            ECOEVOLITY_ASSERT(this->flat_tree_.is_compiled_from(*this->root_));
+            return this->flat_tree_;
+        }
+
         void refresh_pre_ordered_nodes() {
             this->root_->pre_order(this->pre_ordered_nodes_);
         }
@@ -1645,6 +1797,7 @@ class BaseTree {
         }
 
         virtual void set_root(std::shared_ptr<NodeType> root) {
+            this->flat_tree_.clear();
             this->root_ = root;
             this->vet_tree();
             this->update_node_heights();
@@ -1861,6 +2014,19 @@ class BaseTree {
             return 0.0;
         }
 
+        /**
+         * Like compute_log_likelihood, except the calculation can stop as
+         * soon as the log likelihood is known to be less than
+         * `minimum_log_likelihood`, in which case the value set is an upper
+         * bound that is less than the minimum. By default, the whole
+         * likelihood is computed.
+         */
+        virtual double compute_log_likelihood_with_minimum(
+                double minimum_log_likelihood,
+                unsigned int nthreads = 1) {
+            return this->compute_log_likelihood(nthreads);
+        }
+
         void set_log_likelihood_value(double value) {
             this->log_likelihood_.set_value(value);
         }
@@ -1874,6 +2040,7 @@ class BaseTree {
         virtual double compute_log_prior_density() {
             double d = 0.0;
             d += this->compute_log_prior_density_of_parameters_of_beta_prior_on_node_heights();
+            this->update_flat_tree();
             d += this->compute_log_prior_density_of_node_heights();
             d += this->compute_relative_log_prior_density_of_topology();
             d += this->get_derived_class_component_of_log_prior_density();
@@ -1925,10 +2092,18 @@ class BaseTree {
             //     double internal_node_height_prior_density = -std::log(root_height);
             //     d += internal_node_height_prior_density * (this->get_number_of_node_heights() - 1);
             // The conditional uniform solution (uniform(0, youngest parent)):
+            std::vector<double> youngest_parent_heights;
+            this->get_flat_tree().get_youngest_parent_heights(
+                    this->node_heights_,
+                    youngest_parent_heights);
             for (unsigned int i = 0; i < this->get_number_of_node_heights() - 1; ++i) {
                 ///////////////////////////////////////////////////////////////
                 // Prior on the absolute ages of non-root internal nodes
-                double youngest_parent_height = this->get_height_of_youngest_parent(i);
+                double youngest_parent_height = youngest_parent_heights.at(i);
+                if (std::isinf(youngest_parent_height)) {
+                    throw EcoevolityError(
+                            "compute_log_prior_density_of_node_heights(): no nodes mapped to height");
+                }
                 // d -= std::log(youngest_parent_height);
                 d += BetaDistribution::get_scaled_ln_pdf(this->get_height(i),
                         this->alpha_of_node_height_beta_prior_->get_value(),
@@ -1949,11 +2124,16 @@ class BaseTree {
         double get_log_prior_density_value() const {
             return this->log_prior_density_.get_value();
         }
+
+        ModelCost get_model_cost() const {
+            return this->cost_counters_.get_cost();
+        }
         double get_stored_log_prior_density_value() const {
             return this->log_prior_density_.get_stored_value();
         }
 
         void store_state() {
+            StoreRestoreTimer timer(this->cost_counters_);
             this->store_likelihood();
             this->store_prior_density();
             this->store_parameters();
@@ -1991,6 +2171,7 @@ class BaseTree {
         // Derived classes can override this
         virtual void store_derived_class_parameters() { }
         void restore_state() {
+            StoreRestoreTimer timer(this->cost_counters_);
             this->restore_likelihood();
             this->restore_prior_density();
             this->restore_parameters();
@@ -2024,6 +2205,7 @@ class BaseTree {
             this->root_->restore_all_parameter_pointers();
         }
         virtual void restore_topology() {
+            this->flat_tree_.clear();
             this->root_ = this->stored_root_;
             this->update_internal_node_indices();
         }
@@ -2093,6 +2275,14 @@ class BaseTree {
                 const bool short_summary = false) const {
             throw EcoevolityError("log_state called from base BaseTree class");
         }
+        /**
+         * Get the values of the (full) state log in the order of the columns
+         * written by write_state_log_header; used for binary state logs.
+         */
+        virtual void get_state_log_values(std::vector<double> & values,
+                const unsigned int generation_index) const {
+            throw EcoevolityError("get_state_log_values called from base BaseTree class");
+        }
         virtual void log_nexus_tree(std::ostream& out,
                 const unsigned int generation_index,
                 const bool include_comments = true,
@@ -2147,6 +2337,85 @@ class BaseTree {
             this->refresh_ordered_nodes();
         }
 
+        /**
+         * Replaces the topology with the one built by `tree_events` (see
+         * TreeEventSequence), where the leaves of the tree are the lineages,
+         * in the order they appear in the current tree.
+         *
+         * The leaf and root nodes are kept, and new internal nodes are
+         * initialized as when they are split from a polytomy. The new node
+         * heights are evenly spaced placeholders below the root, so they
+         * should be drawn (e.g., with draw_from_prior) afterwards.
+         */
+        void set_topology_from_events(
+                RandomNumberGenerator & rng,
+                const TreeEventSequence & tree_events) {
+            const unsigned int number_of_leaves = this->get_leaf_node_count();
+            ECOEVOLITY_ASSERT(tree_events.size() > 0);
+            std::vector< std::shared_ptr<NodeType> > lineages;
+            lineages.reserve((2 * number_of_leaves) - 1);
+            for (auto node : this->pre_ordered_nodes_) {
+                if (node->is_leaf()) {
+                    lineages.push_back(node);
+                }
+            }
+            ECOEVOLITY_ASSERT(lineages.size() == number_of_leaves);
+            for (auto node : this->pre_ordered_nodes_) {
+                if (node->has_parent()) {
+                    node->remove_parent();
+                }
+            }
+            for (auto leaf : lineages) {
+                this->root_->add_child(leaf);
+            }
+            const double root_height = this->get_root_height();
+            for (unsigned int i = 0; i < (tree_events.size() - 1); ++i) {
+                std::shared_ptr<PositiveRealParameter> height_parameter =
+                        std::make_shared<PositiveRealParameter>(
+                                root_height * (i + 1) / tree_events.size());
+                for (auto & group : tree_events.at(i)) {
+                    std::vector< std::shared_ptr<NodeType> > children;
+                    children.reserve(group.size());
+                    for (auto lineage_index : group) {
+                        children.push_back(lineages.at(lineage_index));
+                    }
+                    lineages.push_back(this->root_->split_children_from_polytomy(
+                            rng,
+                            children,
+                            height_parameter,
+                            number_of_leaves));
+                }
+            }
+            ECOEVOLITY_ASSERT(tree_events.back().size() == 1);
+            ECOEVOLITY_ASSERT(tree_events.back().at(0).size() ==
+                    this->root_->get_number_of_children());
+            this->set_root(this->root_);
+        }
+
+        /**
+         * Replaces the topology with one drawn from the uniform distribution
+         * over generalized trees; `tree_counts` must be for the number of
+         * leaves of this tree. Node heights should be drawn afterwards.
+         */
+        void draw_generalized_topology_from_prior(
+                RandomNumberGenerator & rng,
+                const GeneralizedTreeCounts & tree_counts) {
+            ECOEVOLITY_ASSERT(tree_counts.get_number_of_leaves() ==
+                    this->get_leaf_node_count());
+            this->set_topology_from_events(rng, tree_counts.draw_tree(rng));
+        }
+
+        /**
+         * Replaces the topology with one drawn from the uniform distribution
+         * over bifurcating trees with unshared node heights. Node heights
+         * should be drawn afterwards.
+         */
+        void draw_bifurcating_topology_from_prior(
+                RandomNumberGenerator & rng) {
+            this->set_topology_from_events(rng,
+                    draw_random_bifurcating_tree(rng, this->get_leaf_node_count()));
+        }
+
         void store_nodes_by_height_index(
                 std::map<unsigned int, std::set< std::set<Split> > > & node_map,
                 const bool resize_splits = false) const {
@@ -2447,7 +2716,7 @@ inline void get_trees(
         const double ultrametricity_tolerance = 1e-6,
         const double multiplier = -1.0
         ) {
-    std::ifstream in_stream;
+    InputFileStream in_stream;
     in_stream.open(path);
     if (! in_stream.is_open()) {
         throw EcoevolityParsingError(
@@ -0,0 +1,704 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_BINLOG_HPP
+#define ECOEVOLITY_BINLOG_HPP
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ECOEVOLITY_BINLOG_USE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "string_util.hpp"
+#include "basetree.hpp"
+
+
+/**
+ * Compact binary state and tree logs.
+ *
+ * State logs:
+ *     magic ("ECOSTLOG"), byte-order mark, version, number of columns, column
+ *     labels; then one fixed-width record of doubles per sample. Because
+ *     every record has the same width, any column can be read straight out of
+ *     the memory-mapped file with a stride.
+ *
+ * Tree logs:
+ *     magic ("ECOTRLOG"), byte-order mark, version, leaf labels, and the
+ *     names of the node parameters (other than height and length); then a
+ *     sequence of records. A topology record ('T') is written the first time
+ *     a topology is sampled, and stores, for each node in pre-order, the
+ *     position of its parent, its leaf index (or -1) and its height index (or
+ *     -1). A sample record ('S') stores the generation, topology id, the
+ *     vector of node heights, and the node parameters in pre-order.
+ *
+ * All numbers are written in the native byte order; the byte-order mark lets
+ * readers refuse files written on a machine with a different byte order.
+ */
+namespace binlog {
+
+static const std::size_t MAGIC_LENGTH = 8;
+static const char STATE_LOG_MAGIC[] = "ECOSTLOG";
+static const char TREE_LOG_MAGIC[] = "ECOTRLOG";
+static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const std::uint32_t FORMAT_VERSION = 1;
+static const char TOPOLOGY_RECORD = 'T';
+static const char SAMPLE_RECORD = 'S';
+
+template <typename T>
+inline void write_value(std::ostream & out, const T & value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+inline void write_string(std::ostream & out, const std::string & s) {
+    write_value<std::uint32_t>(out, (std::uint32_t)s.size());
+    out.write(s.data(), s.size());
+}
+
+inline void write_preamble(std::ostream & out, const char * magic) {
+    out.write(magic, MAGIC_LENGTH);
+    write_value<std::uint32_t>(out, BYTE_ORDER_MARK);
+    write_value<std::uint32_t>(out, FORMAT_VERSION);
+}
+
+inline bool has_magic(const std::string & path, const char * magic) {
+    std::ifstream in_stream(path, std::ios::in | std::ios::binary);
+    if (! in_stream.is_open()) {
+        return false;
+    }
+    char buffer[MAGIC_LENGTH];
+    in_stream.read(buffer, MAGIC_LENGTH);
+    if ((std::size_t)in_stream.gcount() != MAGIC_LENGTH) {
+        return false;
+    }
+    return (std::memcmp(buffer, magic, MAGIC_LENGTH) == 0);
+}
+
+inline bool is_binary_state_log(const std::string & path) {
+    return has_magic(path, STATE_LOG_MAGIC);
+}
+
+inline bool is_binary_tree_log(const std::string & path) {
+    return has_magic(path, TREE_LOG_MAGIC);
+}
+
+
+/**
+ * Read-only view of a whole file.
+ *
+ * The file is memory-mapped where mmap is available, so that only the pages
+ * that are actually touched are read from disk; elsewhere the file is read
+ * into a buffer.
+ */
+class MappedFile {
+    protected:
+        std::string path_;
+        const char * data_ = nullptr;
+        std::size_t size_ = 0;
+        std::vector<char> buffer_;
+        void * map_ = nullptr;
+
+    public:
+        MappedFile(const std::string & path) : path_(path) {
+#ifdef ECOEVOLITY_BINLOG_USE_MMAP
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw EcoevolityParsingError(
+                        "Could not open binary log file",
+                        path);
+            }
+            off_t end = lseek(fd, 0, SEEK_END);
+            if (end < 0) {
+                close(fd);
+                throw EcoevolityParsingError(
+                        "Could not determine size of binary log file",
+                        path);
+            }
+            this->size_ = (std::size_t)end;
+            if (this->size_ > 0) {
+                this->map_ = mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (this->map_ == MAP_FAILED) {
+                    this->map_ = nullptr;
+                    close(fd);
+                    throw EcoevolityParsingError(
+                            "Could not memory-map binary log file",
+                            path);
+                }
+                madvise(this->map_, this->size_, MADV_SEQUENTIAL);
+                this->data_ = static_cast<const char *>(this->map_);
+            }
+            close(fd);
+#else
+            std::ifstream in_stream(path, std::ios::in | std::ios::binary);
+            if (! in_stream.is_open()) {
+                throw EcoevolityParsingError(
+                        "Could not open binary log file",
+                        path);
+            }
+            this->buffer_.assign(std::istreambuf_iterator<char>(in_stream),
+                    std::istreambuf_iterator<char>());
+            this->size_ = this->buffer_.size();
+            this->data_ = this->buffer_.data();
+#endif
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        ~MappedFile() {
+#ifdef ECOEVOLITY_BINLOG_USE_MMAP
+            if (this->map_) {
+                munmap(this->map_, this->size_);
+            }
+#endif
+        }
+
+        const char * data() const {
+            return this->data_;
+        }
+        std::size_t size() const {
+            return this->size_;
+        }
+        const std::string & get_path() const {
+            return this->path_;
+        }
+};
+
+
+/**
+ * Bounds-checked cursor over the bytes of a MappedFile.
+ */
+class ByteReader {
+    protected:
+        const MappedFile & file_;
+        std::size_t position_ = 0;
+
+        void check_(std::size_t nbytes) const {
+            if ((this->position_ + nbytes) > this->file_.size()) {
+                throw EcoevolityParsingError(
+                        "Unexpected end of binary log file",
+                        this->file_.get_path());
+            }
+        }
+
+    public:
+        ByteReader(const MappedFile & file, std::size_t position = 0)
+            : file_(file),
+              position_(position) { }
+
+        template <typename T>
+        T read() {
+            this->check_(sizeof(T));
+            T value;
+            std::memcpy(&value, this->file_.data() + this->position_, sizeof(T));
+            this->position_ += sizeof(T);
+            return value;
+        }
+
+        std::string read_string() {
+            std::uint32_t n = this->read<std::uint32_t>();
+            this->check_(n);
+            std::string s(this->file_.data() + this->position_, n);
+            this->position_ += n;
+            return s;
+        }
+
+        void skip(std::size_t nbytes) {
+            this->check_(nbytes);
+            this->position_ += nbytes;
+        }
+
+        void read_preamble(const char * magic) {
+            this->check_(MAGIC_LENGTH);
+            if (std::memcmp(this->file_.data() + this->position_, magic, MAGIC_LENGTH) != 0) {
+                throw EcoevolityParsingError(
+                        "Not a binary log file of the expected type",
+                        this->file_.get_path());
+            }
+            this->position_ += MAGIC_LENGTH;
+            if (this->read<std::uint32_t>() != BYTE_ORDER_MARK) {
+                throw EcoevolityParsingError(
+                        "Binary log file was written with a different byte order",
+                        this->file_.get_path());
+            }
+            std::uint32_t version = this->read<std::uint32_t>();
+            if (version != FORMAT_VERSION) {
+                std::ostringstream message;
+                message << "Unsupported binary log format version " << version;
+                throw EcoevolityParsingError(
+                        message.str(),
+                        this->file_.get_path());
+            }
+        }
+
+        std::size_t get_position() const {
+            return this->position_;
+        }
+        bool at_end() const {
+            return this->position_ >= this->file_.size();
+        }
+        bool has_bytes(std::size_t nbytes) const {
+            return (this->position_ + nbytes) <= this->file_.size();
+        }
+        std::size_t get_number_of_remaining_bytes() const {
+            return this->file_.size() - this->position_;
+        }
+};
+
+
+class StateLogWriter {
+    protected:
+        std::ostream & out_;
+        unsigned int number_of_columns_ = 0;
+
+    public:
+        StateLogWriter(std::ostream & out) : out_(out) { }
+
+        void write_header(const std::vector<std::string> & column_labels) {
+            this->number_of_columns_ = column_labels.size();
+            write_preamble(this->out_, STATE_LOG_MAGIC);
+            write_value<std::uint32_t>(this->out_, this->number_of_columns_);
+            for (auto const & label : column_labels) {
+                write_string(this->out_, label);
+            }
+        }
+
+        void write_row(const std::vector<double> & values) {
+            if (values.size() != this->number_of_columns_) {
+                std::ostringstream message;
+                message << "StateLogWriter::write_row(): Expecting "
+                        << this->number_of_columns_ << " values, but got "
+                        << values.size();
+                throw EcoevolityError(message.str());
+            }
+            this->out_.write(reinterpret_cast<const char *>(values.data()),
+                    values.size() * sizeof(double));
+        }
+
+        unsigned int get_number_of_columns() const {
+            return this->number_of_columns_;
+        }
+};
+
+
+class StateLogReader {
+    protected:
+        MappedFile file_;
+        std::vector<std::string> header_;
+        std::unordered_map<std::string, unsigned int> column_indices_;
+        std::size_t data_offset_ = 0;
+        std::size_t number_of_rows_ = 0;
+
+    public:
+        StateLogReader(const std::string & path) : file_(path) {
+            ByteReader reader(this->file_);
+            reader.read_preamble(STATE_LOG_MAGIC);
+            std::uint32_t ncols = reader.read<std::uint32_t>();
+            if (ncols < 1) {
+                throw EcoevolityParsingError(
+                        "Binary state log has no columns",
+                        path);
+            }
+            this->header_.reserve(ncols);
+            for (unsigned int i = 0; i < ncols; ++i) {
+                this->header_.push_back(reader.read_string());
+                this->column_indices_[this->header_.back()] = i;
+            }
+            this->data_offset_ = reader.get_position();
+            // A trailing partial record (e.g., from an interrupted run) is
+            // ignored
+            this->number_of_rows_ = reader.get_number_of_remaining_bytes() /
+                    (ncols * sizeof(double));
+        }
+
+        const std::vector<std::string> & get_header() const {
+            return this->header_;
+        }
+        unsigned int get_number_of_columns() const {
+            return this->header_.size();
+        }
+        std::size_t get_number_of_rows() const {
+            return this->number_of_rows_;
+        }
+        bool has_column(const std::string & column_label) const {
+            return (this->column_indices_.count(column_label) > 0);
+        }
+        unsigned int get_column_index(const std::string & column_label) const {
+            auto i = this->column_indices_.find(column_label);
+            if (i == this->column_indices_.end()) {
+                throw EcoevolitySpreadsheetError("binary state log has no column \'" +
+                        column_label + "\'");
+            }
+            return i->second;
+        }
+
+        double get_value(std::size_t row_index, unsigned int column_index) const {
+            ECOEVOLITY_ASSERT(row_index < this->number_of_rows_);
+            ECOEVOLITY_ASSERT(column_index < this->header_.size());
+            double value;
+            std::memcpy(&value,
+                    this->file_.data() + this->data_offset_ +
+                    ((row_index * this->header_.size()) + column_index) * sizeof(double),
+                    sizeof(double));
+            return value;
+        }
+
+        template <typename T>
+        void get_column(
+                const std::string & column_label,
+                std::vector<T> & target,
+                std::size_t offset = 0) const {
+            unsigned int column_index = this->get_column_index(column_label);
+            if (offset >= this->number_of_rows_) {
+                return;
+            }
+            target.reserve(target.size() + (this->number_of_rows_ - offset));
+            for (std::size_t row = offset; row < this->number_of_rows_; ++row) {
+                target.push_back(static_cast<T>(this->get_value(row, column_index)));
+            }
+        }
+
+        template <typename T>
+        std::vector<T> get_column(
+                const std::string & column_label,
+                std::size_t offset = 0) const {
+            std::vector<T> values;
+            this->get_column<T>(column_label, values, offset);
+            return values;
+        }
+};
+
+
+template<class TreeType>
+class TreeLogWriter {
+    protected:
+        std::ostream & out_;
+        std::unordered_map<std::string, std::uint32_t> topology_ids_;
+        std::vector<std::string> parameter_names_;
+        std::unordered_map<std::string, std::uint32_t> leaf_positions_;
+
+        void get_parameter_names_(
+                const std::map<std::string, double> & parameter_map,
+                std::vector<std::string> & names) const {
+            names.clear();
+            for (auto const & name_value : parameter_map) {
+                if ((name_value.first == "height") ||
+                        (name_value.first == "length")) {
+                    continue;
+                }
+                names.push_back(name_value.first);
+            }
+        }
+
+    public:
+        typedef typename TreeType::NodePtr NodePtr;
+
+        TreeLogWriter(std::ostream & out) : out_(out) { }
+
+        void write_header(const TreeType & tree) {
+            std::vector<std::string> leaf_labels = tree.get_leaf_labels();
+            std::sort(std::begin(leaf_labels), std::end(leaf_labels));
+            std::map<std::string, double> parameter_map;
+            tree.get_root().get_parameter_map(parameter_map);
+            this->get_parameter_names_(parameter_map, this->parameter_names_);
+
+            write_preamble(this->out_, TREE_LOG_MAGIC);
+            write_value<std::uint32_t>(this->out_, leaf_labels.size());
+            for (unsigned int i = 0; i < leaf_labels.size(); ++i) {
+                write_string(this->out_, leaf_labels.at(i));
+                this->leaf_positions_[leaf_labels.at(i)] = i;
+            }
+            write_value<std::uint32_t>(this->out_, this->parameter_names_.size());
+            for (auto const & name : this->parameter_names_) {
+                write_string(this->out_, name);
+            }
+        }
+
+        void log_tree(const TreeType & tree, unsigned int generation_index) {
+            std::vector<NodePtr> nodes;
+            tree.get_root_ptr()->pre_order(nodes);
+
+            // The topology key is the serialized topology record, so that
+            // topologies only need to be written once
+            std::ostringstream topology;
+            std::unordered_map<const void *, std::int32_t> node_positions;
+            node_positions.reserve(nodes.size());
+            for (unsigned int i = 0; i < nodes.size(); ++i) {
+                node_positions[nodes.at(i).get()] = i;
+                std::int32_t parent_position = -1;
+                if (nodes.at(i)->has_parent()) {
+                    parent_position = node_positions.at(nodes.at(i)->get_parent().get());
+                }
+                std::int32_t leaf_position = -1;
+                std::int32_t height_index = -1;
+                if (nodes.at(i)->is_leaf()) {
+                    leaf_position = this->leaf_positions_.at(nodes.at(i)->get_label());
+                }
+                else {
+                    height_index = tree.get_node_height_index(
+                            nodes.at(i)->get_height_parameter());
+                }
+                write_value<std::int32_t>(topology, parent_position);
+                write_value<std::int32_t>(topology, leaf_position);
+                write_value<std::int32_t>(topology, height_index);
+            }
+            std::string topology_key = topology.str();
+
+            std::uint32_t topology_id;
+            auto id_iter = this->topology_ids_.find(topology_key);
+            if (id_iter == this->topology_ids_.end()) {
+                topology_id = this->topology_ids_.size();
+                this->topology_ids_[topology_key] = topology_id;
+                this->out_.put(TOPOLOGY_RECORD);
+                write_value<std::uint32_t>(this->out_, topology_id);
+                write_value<std::uint32_t>(this->out_, nodes.size());
+                this->out_.write(topology_key.data(), topology_key.size());
+            }
+            else {
+                topology_id = id_iter->second;
+            }
+
+            this->out_.put(SAMPLE_RECORD);
+            write_value<std::uint32_t>(this->out_, generation_index);
+            write_value<std::uint32_t>(this->out_, topology_id);
+            std::uint32_t nheights = tree.get_number_of_node_heights();
+            write_value<std::uint32_t>(this->out_, nheights);
+            for (unsigned int i = 0; i < nheights; ++i) {
+                write_value<double>(this->out_, tree.get_height(i));
+            }
+            std::map<std::string, double> parameter_map;
+            for (auto const & node : nodes) {
+                parameter_map.clear();
+                node->get_parameter_map(parameter_map);
+                for (auto const & name : this->parameter_names_) {
+                    write_value<double>(this->out_, parameter_map.at(name));
+                }
+            }
+        }
+
+        unsigned int get_number_of_topologies() const {
+            return this->topology_ids_.size();
+        }
+};
+
+
+template<class NodeType>
+class TreeLogReader {
+    public:
+        typedef BaseTree<NodeType> tree_type;
+
+        struct NodeRecord {
+            std::int32_t parent_position;
+            std::int32_t leaf_position;
+            std::int32_t height_index;
+        };
+
+    protected:
+        MappedFile file_;
+        std::vector<std::string> leaf_labels_;
+        std::vector<std::string> parameter_names_;
+        std::vector< std::vector<NodeRecord> > topologies_;
+        std::vector<unsigned int> topology_number_of_heights_;
+        std::vector<std::size_t> sample_offsets_;
+        std::vector<unsigned int> sample_topology_ids_;
+        std::vector<unsigned int> sample_generations_;
+
+    public:
+        TreeLogReader(const std::string & path) : file_(path) {
+            ByteReader reader(this->file_);
+            reader.read_preamble(TREE_LOG_MAGIC);
+            std::uint32_t nleaves = reader.read<std::uint32_t>();
+            for (unsigned int i = 0; i < nleaves; ++i) {
+                this->leaf_labels_.push_back(reader.read_string());
+            }
+            std::uint32_t nparams = reader.read<std::uint32_t>();
+            for (unsigned int i = 0; i < nparams; ++i) {
+                this->parameter_names_.push_back(reader.read_string());
+            }
+
+            // Index the records. The length of each record is checked before
+            // it is parsed, so that a trailing partial record (e.g., from an
+            // interrupted run) is ignored rather than treated as corrupt
+            while (! reader.at_end()) {
+                char record_type = reader.read<char>();
+                if (record_type == TOPOLOGY_RECORD) {
+                    if (! reader.has_bytes(2 * sizeof(std::uint32_t))) {
+                        break;
+                    }
+                    std::uint32_t topology_id = reader.read<std::uint32_t>();
+                    if (topology_id != this->topologies_.size()) {
+                        throw EcoevolityParsingError(
+                                "Unexpected topology id in binary tree log",
+                                path);
+                    }
+                    std::uint32_t nnodes = reader.read<std::uint32_t>();
+                    if (! reader.has_bytes(nnodes * 3 * sizeof(std::int32_t))) {
+                        break;
+                    }
+                    std::vector<NodeRecord> topology(nnodes);
+                    int max_height_index = -1;
+                    for (unsigned int i = 0; i < nnodes; ++i) {
+                        topology.at(i).parent_position = reader.read<std::int32_t>();
+                        topology.at(i).leaf_position = reader.read<std::int32_t>();
+                        topology.at(i).height_index = reader.read<std::int32_t>();
+                        max_height_index = std::max(max_height_index,
+                                (int)topology.at(i).height_index);
+                    }
+                    this->topologies_.push_back(topology);
+                    this->topology_number_of_heights_.push_back(max_height_index + 1);
+                }
+                else if (record_type == SAMPLE_RECORD) {
+                    std::size_t offset = reader.get_position();
+                    if (! reader.has_bytes(3 * sizeof(std::uint32_t))) {
+                        break;
+                    }
+                    std::uint32_t generation = reader.read<std::uint32_t>();
+                    std::uint32_t topology_id = reader.read<std::uint32_t>();
+                    if (topology_id >= this->topologies_.size()) {
+                        throw EcoevolityParsingError(
+                                "Undefined topology id in binary tree log",
+                                path);
+                    }
+                    std::uint32_t nheights = reader.read<std::uint32_t>();
+                    std::size_t nbytes = (nheights +
+                            (this->topologies_.at(topology_id).size() *
+                             this->parameter_names_.size())) * sizeof(double);
+                    if (! reader.has_bytes(nbytes)) {
+                        break;
+                    }
+                    reader.skip(nbytes);
+                    this->sample_offsets_.push_back(offset);
+                    this->sample_topology_ids_.push_back(topology_id);
+                    this->sample_generations_.push_back(generation);
+                }
+                else {
+                    throw EcoevolityParsingError(
+                            "Unrecognized record in binary tree log",
+                            path);
+                }
+            }
+        }
+
+        unsigned int get_number_of_trees() const {
+            return this->sample_offsets_.size();
+        }
+        unsigned int get_number_of_topologies() const {
+            return this->topologies_.size();
+        }
+        unsigned int get_topology_index(unsigned int tree_index) const {
+            return this->sample_topology_ids_.at(tree_index);
+        }
+        unsigned int get_generation(unsigned int tree_index) const {
+            return this->sample_generations_.at(tree_index);
+        }
+        const std::vector<std::string> & get_leaf_labels() const {
+            return this->leaf_labels_;
+        }
+        const std::vector<std::string> & get_parameter_names() const {
+            return this->parameter_names_;
+        }
+
+        void get_heights(unsigned int tree_index,
+                std::vector<double> & heights) const {
+            ByteReader reader(this->file_, this->sample_offsets_.at(tree_index));
+            reader.skip(2 * sizeof(std::uint32_t));
+            std::uint32_t nheights = reader.read<std::uint32_t>();
+            heights.resize(nheights);
+            for (unsigned int i = 0; i < nheights; ++i) {
+                heights.at(i) = reader.read<double>();
+            }
+        }
+
+        /**
+         * Build the sampled tree. As with trees parsed from nexus files, leaf
+         * indices follow the sorted order of the leaf labels and internal
+         * nodes are indexed in pre-order after the leaves.
+         */
+        tree_type get_tree(unsigned int tree_index,
+                const double multiplier = -1.0) const {
+            unsigned int topology_id = this->sample_topology_ids_.at(tree_index);
+            const std::vector<NodeRecord> & topology = this->topologies_.at(topology_id);
+            ByteReader reader(this->file_, this->sample_offsets_.at(tree_index));
+            reader.skip(2 * sizeof(std::uint32_t));
+            std::uint32_t nheights = reader.read<std::uint32_t>();
+            if (nheights != this->topology_number_of_heights_.at(topology_id)) {
+                throw EcoevolityParsingError(
+                        "Number of heights does not match topology in binary tree log",
+                        this->file_.get_path());
+            }
+            std::vector< std::shared_ptr<PositiveRealParameter> > heights(nheights);
+            for (unsigned int i = 0; i < nheights; ++i) {
+                heights.at(i) = std::make_shared<PositiveRealParameter>(
+                        reader.read<double>());
+            }
+
+            std::vector< std::shared_ptr<NodeType> > nodes;
+            nodes.reserve(topology.size());
+            int next_internal_index = this->leaf_labels_.size();
+            std::map<std::string, double> parameter_map;
+            for (unsigned int i = 0; i < topology.size(); ++i) {
+                const NodeRecord & rec = topology.at(i);
+                std::shared_ptr<NodeType> node;
+                if (rec.leaf_position > -1) {
+                    // Leaf labels are written sorted, so the position is the
+                    // leaf index
+                    node = std::make_shared<NodeType>(
+                            rec.leaf_position,
+                            this->leaf_labels_.at(rec.leaf_position),
+                            0.0);
+                    node->fix_node_height();
+                }
+                else {
+                    node = std::make_shared<NodeType>(next_internal_index, 0.0);
+                    ++next_internal_index;
+                    node->set_height_parameter(heights.at(rec.height_index));
+                }
+                parameter_map.clear();
+                for (auto const & name : this->parameter_names_) {
+                    parameter_map[name] = reader.read<double>();
+                }
+                node->extract_data_from_parameter_map(parameter_map);
+                if (rec.parent_position > -1) {
+                    nodes.at(rec.parent_position)->add_child(node);
+                }
+                nodes.push_back(node);
+            }
+            tree_type tree(nodes.at(0));
+            if (multiplier > 0.0) {
+                tree.scale_tree(multiplier);
+            }
+            return tree;
+        }
+};
+
+} // namespace binlog
+
+#endif
@@ -19,6 +19,10 @@
 
 #include "collection.hpp"
 #include "operator.hpp"
+#include "binlog.hpp"
+#include "prior_sampling.hpp"
+#include "async_log_writer.hpp"
+#include "compressed_stream.hpp"
 
 void BaseComparisonPopulationTreeCollection::store_state() {
     this->log_likelihood_.store();
@@ -608,78 +612,73 @@ void BaseComparisonPopulationTreeCollection::add_height(
     }
 }
 
-void BaseComparisonPopulationTreeCollection::write_state_log_header(
-        std::ostream& out,
+void BaseComparisonPopulationTreeCollection::get_state_log_row(
+        StateLogRow & row,
+        unsigned int generation_index,
         bool short_summary) const {
-    out << "generation" << this->logging_delimiter_
-        << "ln_likelihood" << this->logging_delimiter_
-        << "ln_prior" << this->logging_delimiter_
-        << "number_of_events";
+    row.clear();
+    row.add_integer("generation", generation_index);
+    row.add("ln_likelihood", this->log_likelihood_.get_value());
+    row.add("ln_prior", this->log_prior_density_.get_value());
+    row.add_integer("number_of_events", this->get_number_of_events());
     if (this->model_prior_ == EcoevolityOptions::ModelPrior::pyp) {
-        out << this->logging_delimiter_ << "concentration"
-            << this->logging_delimiter_ << "discount";
+        row.add("concentration", this->get_concentration());
+        row.add("discount", this->get_discount());
     }
     else if (this->model_prior_ == EcoevolityOptions::ModelPrior::dpp) {
-        out << this->logging_delimiter_ << "concentration";
+        row.add("concentration", this->get_concentration());
     }
     else if (this->model_prior_ == EcoevolityOptions::ModelPrior::uniform) {
-        out << this->logging_delimiter_ << "split_weight";
+        row.add("split_weight", this->get_concentration());
     }
     else if (this->model_prior_ == EcoevolityOptions::ModelPrior::fixed) {
         // Nothing to report
     }
     if (short_summary) {
-        out << std::endl;
         return;
     }
+    std::vector<unsigned int> standardized_height_indices =
+            this->get_standardized_height_indices();
     for (unsigned int tree_idx = 0;
             tree_idx < this->trees_.size();
             ++tree_idx) {
-        out << this->logging_delimiter_;
-        this->trees_.at(tree_idx)->write_comparison_state_log_header(out,
-                true,
-                this->logging_delimiter_);
+        this->trees_.at(tree_idx)->add_comparison_state_columns(row,
+                standardized_height_indices.at(tree_idx));
     }
+}
+
+void BaseComparisonPopulationTreeCollection::write_state_log_header(
+        std::ostream& out,
+        bool short_summary) const {
+    StateLogRow row;
+    this->get_state_log_row(row, 0, short_summary);
+    row.write_names(out, this->logging_delimiter_);
     out << std::endl;
 }
 
 void BaseComparisonPopulationTreeCollection::log_state(std::ostream& out,
         unsigned int generation_index,
         bool short_summary) const {
-    out << generation_index << this->logging_delimiter_
-        << this->log_likelihood_.get_value() << this->logging_delimiter_
-        << this->log_prior_density_.get_value() << this->logging_delimiter_
-        << this->get_number_of_events();
-    if (this->model_prior_ == EcoevolityOptions::ModelPrior::pyp) {
-        out << this->logging_delimiter_ << this->get_concentration()
-            << this->logging_delimiter_ << this->get_discount();
-    }
-    else if (this->model_prior_ == EcoevolityOptions::ModelPrior::dpp) {
-        out << this->logging_delimiter_ << this->get_concentration();
-    }
-    else if (this->model_prior_ == EcoevolityOptions::ModelPrior::uniform) {
-        out << this->logging_delimiter_ << this->get_concentration();
-    }
-    else if (this->model_prior_ == EcoevolityOptions::ModelPrior::fixed) {
-        // Nothing to report
-    }
-    if (short_summary) {
-        out << std::endl;
-        return;
-    }
-    std::vector<unsigned int> standardized_height_indices =
-            this->get_standardized_height_indices();
-    for (unsigned int tree_idx = 0;
-            tree_idx < this->trees_.size();
-            ++tree_idx) {
-        out << this->logging_delimiter_;
-        this->trees_.at(tree_idx)->log_comparison_state(out,
-                standardized_height_indices.at(tree_idx),
-                this->logging_delimiter_);
-    }
+    StateLogRow row;
+    this->get_state_log_row(row, generation_index, short_summary);
+    row.write_values(out, this->logging_delimiter_);
     out << std::endl;
 }
 
+std::vector<std::string> BaseComparisonPopulationTreeCollection::get_state_log_header() const {
+    StateLogRow row;
+    this->get_state_log_row(row, 0);
+    return row.get_names();
+}
+
+void BaseComparisonPopulationTreeCollection::get_state_log_values(
+        std::vector<double> & values,
+        unsigned int generation_index) const {
+    StateLogRow row;
+    this->get_state_log_row(row, generation_index);
+    values = row.get_values();
+}
+
 void BaseComparisonPopulationTreeCollection::update_log_paths(
         unsigned int max_number_of_attempts) {
     if (! path::exists(this->get_state_log_path())) {
@@ -704,7 +703,11 @@ void BaseComparisonPopulationTreeCollection::increment_log_paths() {
     std::string new_suffix;
     int run_number;
 
-    prefix_ext = path::splitext(this->get_state_log_path());
+    // The run number precedes the extensions of the log and any compression
+    std::pair<std::string, std::string> path_compression_ext =
+            compressed_stream::split_compression_extension(
+                    this->get_state_log_path());
+    prefix_ext = path::splitext(path_compression_ext.first);
     path_elements = string_util::split(prefix_ext.first, '-');
     run_number = std::stoi(path_elements.back());
     path_elements.pop_back();
@@ -713,7 +716,8 @@ void BaseComparisonPopulationTreeCollection::increment_log_paths() {
     new_suffix = "-" + std::to_string(run_number) + prefix_ext.second;
 
     this->set_state_log_path(
-            string_util::join(path_elements, "-") + new_suffix);
+            string_util::join(path_elements, "-") + new_suffix +
+            path_compression_ext.second);
 
     prefix_ext = path::splitext(this->get_operator_log_path());
     path_elements = string_util::split(prefix_ext.first, '-');
@@ -727,7 +731,7 @@ void BaseComparisonPopulationTreeCollection::mcmc(
         unsigned int chain_length,
         unsigned int sample_frequency) {
 
-    std::ofstream state_log_stream;
+    OutputFileStream state_log_stream;
     std::ofstream operator_log_stream;
     this->update_log_paths();
     if (path::exists(this->get_state_log_path())) {
@@ -744,7 +748,19 @@ void BaseComparisonPopulationTreeCollection::mcmc(
                 << "\' already exists!\n";
         throw EcoevolityError(message.str());
     }
-    state_log_stream.open(this->get_state_log_path());
+    if (this->binary_state_log_) {
+        if (compressed_stream::get_compression(this->get_state_log_path()) !=
+                compressed_stream::Compression::none) {
+            throw EcoevolityError("Binary state logs cannot be compressed");
+        }
+        state_log_stream.open(this->get_state_log_path(),
+                std::ios::out | std::ios::binary);
+    }
+    else {
+        state_log_stream.open(this->get_state_log_path(),
+                std::ios::out,
+                this->get_number_of_threads());
+    }
     operator_log_stream.open(this->get_operator_log_path());
     
     if (! state_log_stream.is_open()) {
@@ -768,7 +784,29 @@ void BaseComparisonPopulationTreeCollection::mcmc(
     state_log_stream.precision(this->get_logging_precision());
     operator_log_stream.precision(this->get_logging_precision());
 
-    this->write_state_log_header(state_log_stream);
+    // Samples are formatted here, but written to the log files by a
+    // background thread (with threads), so the chain does not wait on them
+    AsyncLogStream state_log(state_log_stream);
+    AsyncLogStream operator_log(operator_log_stream);
+
+    binlog::StateLogWriter binary_state_log(state_log);
+    std::vector<double> state_values;
+    auto log_state_to_file = [&](unsigned int generation_index) {
+        if (this->binary_state_log_) {
+            this->get_state_log_values(state_values, generation_index);
+            binary_state_log.write_row(state_values);
+        }
+        else {
+            this->log_state(state_log, generation_index);
+        }
+    };
+
+    if (this->binary_state_log_) {
+        binary_state_log.write_header(this->get_state_log_header());
+    }
+    else {
+        this->write_state_log_header(state_log);
+    }
     this->write_state_log_header(std::cout, true);
 
     this->make_trees_dirty();
@@ -791,7 +829,7 @@ void BaseComparisonPopulationTreeCollection::mcmc(
                 <<   "#######################################################################\n";
         throw EcoevolityError(message.str());
     }
-    this->log_state(state_log_stream, 0);
+    log_state_to_file(0);
     this->log_state(std::cout, 0, true);
 
     unsigned int gen;
@@ -799,18 +837,23 @@ void BaseComparisonPopulationTreeCollection::mcmc(
     unsigned int gen_of_last_operator_log = 0;
     for (gen = 0; gen < chain_length; ++gen) {
         OperatorInterface& op = this->operator_schedule_.draw_operator(rng);
-        op.operate(rng, this, this->get_number_of_threads());
+        {
+            OperatorStatsTimer timer(op.get_stats(), *this);
+            op.operate(rng, this, this->get_number_of_threads());
+        }
 
         if ((gen + 1) % sample_frequency == 0) {
-            this->log_state(state_log_stream, gen + 1);
+            log_state_to_file(gen + 1);
             gen_of_last_state_log = gen;
             // Log every 10th sample to std out
             if ((gen + 1) % (sample_frequency * 10) == 0) {
                 this->log_state(std::cout, gen + 1, true);
                 // Log operator performance every 100 samples
                 if ((gen + 1) % (sample_frequency * 100) == 0) {
-                    operator_log_stream << "generation " << gen + 1 << ":\n";
-                    this->operator_schedule_.write_operator_rates(operator_log_stream);
+                    operator_log << "generation " << gen + 1 << ":\n";
+                    this->operator_schedule_.write_operator_rates(operator_log);
+                    operator_log << "operator costs:\n";
+                    this->operator_schedule_.write_operator_costs(operator_log);
                     gen_of_last_operator_log = gen;
                 }
             }
@@ -830,6 +873,8 @@ void BaseComparisonPopulationTreeCollection::mcmc(
                             << " is " << chain_ln_likelihood
                             << "; expected " << expected_ln_likelihood
                             << "; last operator " << op.get_name();
+                    state_log.close();
+                    operator_log.close();
                     state_log_stream.close();
                     operator_log_stream.close();
                     throw EcoevolityError(message.str());
@@ -839,20 +884,168 @@ void BaseComparisonPopulationTreeCollection::mcmc(
     }
     // Make sure last generation is reported
     if (gen > (gen_of_last_state_log + 1)) {
-        this->log_state(state_log_stream, gen + 1);
+        log_state_to_file(gen + 1);
         this->log_state(std::cout, gen + 1, true);
     }
     if (gen > (gen_of_last_operator_log + 1)) {
-        operator_log_stream << "generation " << gen + 1 << ":\n";
-        this->operator_schedule_.write_operator_rates(operator_log_stream);
+        operator_log << "generation " << gen + 1 << ":\n";
+        this->operator_schedule_.write_operator_rates(operator_log);
+        operator_log << "operator costs:\n";
+        this->operator_schedule_.write_operator_costs(operator_log);
     }
     std::cout << "\nOperator stats:\n";
     this->operator_schedule_.write_operator_rates(std::cout);
+    std::cout << "\nOperator costs:\n";
+    this->operator_schedule_.write_operator_costs(std::cout);
     std::cout << "\n";
+    state_log.close();
+    operator_log.close();
     state_log_stream.close();
     operator_log_stream.close();
 }
 
+void BaseComparisonPopulationTreeCollection::mcmc(
+        RandomNumberGenerator& rng,
+        unsigned int chain_length,
+        unsigned int sample_frequency,
+        std::vector< std::vector<double> > & samples) {
+    samples.clear();
+    samples.reserve((chain_length / sample_frequency) + 1);
+    std::vector<double> state_values;
+
+    this->make_trees_dirty();
+    this->compute_log_likelihood_and_prior(true);
+    if (this->get_log_likelihood() == -std::numeric_limits<double>::infinity()) {
+        throw EcoevolityError(
+                "The initial model state has a probability density of zero");
+    }
+    if (std::isnan(this->get_log_likelihood())) {
+        throw EcoevolityError(
+                "The initial model state has a NAN log likelihood");
+    }
+    this->get_state_log_values(state_values, 0);
+    samples.push_back(state_values);
+
+    for (unsigned int gen = 0; gen < chain_length; ++gen) {
+        OperatorInterface& op = this->operator_schedule_.draw_operator(rng);
+        {
+            OperatorStatsTimer timer(op.get_stats(), *this);
+            op.operate(rng, this, this->get_number_of_threads());
+        }
+        if ((gen + 1) % sample_frequency == 0) {
+            this->get_state_log_values(state_values, gen + 1);
+            samples.push_back(state_values);
+        }
+    }
+}
+
+void BaseComparisonPopulationTreeCollection::sample_prior_directly(
+        RandomNumberGenerator& rng,
+        unsigned int chain_length,
+        unsigned int sample_frequency,
+        const std::vector<BaseComparisonPopulationTreeCollection *> & helper_collections) {
+    std::vector<BaseComparisonPopulationTreeCollection *> collections {this};
+    collections.insert(collections.end(),
+            helper_collections.begin(),
+            helper_collections.end());
+    for (auto collection : collections) {
+        if (! collection->ignoring_data()) {
+            throw EcoevolityError(
+                    "The data must be ignored to sample directly from the prior");
+        }
+    }
+
+    OutputFileStream state_log_stream;
+    this->update_log_paths();
+    if (path::exists(this->get_state_log_path())) {
+        std::ostringstream message;
+        message << "ERROR: The parameter log file \'"
+                << this->get_state_log_path()
+                << "\' already exists!\n";
+        throw EcoevolityError(message.str());
+    }
+    if (this->binary_state_log_) {
+        if (compressed_stream::get_compression(this->get_state_log_path()) !=
+                compressed_stream::Compression::none) {
+            throw EcoevolityError("Binary state logs cannot be compressed");
+        }
+        state_log_stream.open(this->get_state_log_path(),
+                std::ios::out | std::ios::binary);
+    }
+    else {
+        state_log_stream.open(this->get_state_log_path(),
+                std::ios::out,
+                this->get_number_of_threads());
+    }
+    if (! state_log_stream.is_open()) {
+        std::ostringstream message;
+        message << "ERROR: Could not open parameter log file \'"
+                << this->get_state_log_path()
+                << "\'\n";
+        throw EcoevolityError(message.str());
+    }
+
+    std::cout << "State log path: " << this->get_state_log_path() << std::endl;
+
+    state_log_stream.precision(this->get_logging_precision());
+    AsyncLogStream state_log(state_log_stream);
+
+    binlog::StateLogWriter binary_state_log(state_log);
+    if (this->binary_state_log_) {
+        binary_state_log.write_header(this->get_state_log_header());
+    }
+    else {
+        this->write_state_log_header(state_log);
+    }
+
+    // The same samples as logged by MCMC, but without the final generation,
+    // which is only logged when it is not a multiple of the sample frequency
+    const unsigned int number_of_samples = (chain_length / sample_frequency) + 1;
+    const bool binary_log = this->binary_state_log_;
+    const unsigned int logging_precision = this->get_logging_precision();
+    auto draw_sample = [binary_log, logging_precision, sample_frequency](
+            RandomNumberGenerator & sample_rng,
+            BaseComparisonPopulationTreeCollection & collection,
+            unsigned int sample_index,
+            PriorSampleBuffer & buffer) {
+        collection.draw_from_prior(sample_rng);
+        collection.make_trees_dirty();
+        collection.compute_log_likelihood_and_prior(true);
+        if (binary_log) {
+            buffer.state_values.push_back(std::vector<double>());
+            collection.get_state_log_values(buffer.state_values.back(),
+                    sample_index * sample_frequency);
+        }
+        else {
+            buffer.state_log.precision(logging_precision);
+            collection.log_state(buffer.state_log,
+                    sample_index * sample_frequency);
+        }
+    };
+    auto write_buffer = [&](PriorSampleBuffer & buffer) {
+        if (binary_log) {
+            for (auto const & values : buffer.state_values) {
+                binary_state_log.write_row(values);
+            }
+        }
+        else {
+            state_log << buffer.state_log.str();
+        }
+        buffer.clear();
+    };
+
+    std::cout << "Drawing " << number_of_samples
+              << " independent samples from the prior with "
+              << collections.size() << " thread(s)..." << std::endl;
+    draw_prior_samples(rng,
+            collections,
+            number_of_samples,
+            draw_sample,
+            write_buffer);
+    state_log.close();
+    state_log_stream.close();
+}
+
 void BaseComparisonPopulationTreeCollection::write_summary(
         std::ostream& out,
         unsigned int indent_level) const {
@@ -53,6 +53,7 @@ class BaseComparisonPopulationTreeCollection {
         unsigned int number_of_threads_ = 1;
         unsigned int logging_precision_ = 18;
         std::string logging_delimiter_ = "\t";
+        bool binary_state_log_ = false;
         EcoevolityOptions::ModelPrior model_prior_;
 
         void add_height(
@@ -144,6 +145,12 @@ class BaseComparisonPopulationTreeCollection {
         void set_logging_delimiter(const std::string& delimiter) {
             this->logging_delimiter_ = delimiter;
         }
+        bool using_binary_state_log() const {
+            return this->binary_state_log_;
+        }
+        void use_binary_state_log(bool b = true) {
+            this->binary_state_log_ = b;
+        }
 
         std::shared_ptr<PopulationTree> get_tree(
                 unsigned int tree_index) const {
@@ -192,6 +199,17 @@ class BaseComparisonPopulationTreeCollection {
         double get_log_prior_density() const {
             return this->log_prior_density_.get_value();
         }
+
+        /**
+         * The cost of evaluating the states of the comparisons.
+         */
+        ModelCost get_model_cost() const {
+            ModelCost cost;
+            for (auto const & tree : this->trees_) {
+                cost += tree->get_model_cost();
+            }
+            return cost;
+        }
         double get_stored_log_prior_density() const {
             return this->log_prior_density_.get_stored_value();
         }
@@ -278,6 +296,12 @@ class BaseComparisonPopulationTreeCollection {
         void log_state(std::ostream& out,
                 unsigned int generation_index,
                 bool short_summary = false) const;
+        std::vector<std::string> get_state_log_header() const;
+        void get_state_log_values(std::vector<double> & values,
+                unsigned int generation_index) const;
+        void get_state_log_row(StateLogRow & row,
+                unsigned int generation_index,
+                bool short_summary = false) const;
 
         
         std::vector< std::shared_ptr<OperatorInterface> > get_time_operators() const {
@@ -302,6 +326,30 @@ class BaseComparisonPopulationTreeCollection {
                 unsigned int chain_length,
                 unsigned int sample_frequency);
 
+        /**
+         * Runs the chain without writing any logs or output. The state log
+         * values of the initial state and of every `sample_frequency`
+         * generations are stored in `samples`.
+         */
+        void mcmc(RandomNumberGenerator& rng,
+                unsigned int chain_length,
+                unsigned int sample_frequency,
+                std::vector< std::vector<double> > & samples);
+
+        /**
+         * Writes independent draws from the prior to the state log, in
+         * place of the samples that an MCMC chain of `chain_length`
+         * generations would log. The data must be ignored.
+         *
+         * `helper_collections` are separate copies of this collection (also
+         * ignoring the data) with which to draw samples in parallel threads.
+         */
+        void sample_prior_directly(RandomNumberGenerator& rng,
+                unsigned int chain_length,
+                unsigned int sample_frequency,
+                const std::vector<BaseComparisonPopulationTreeCollection *> & helper_collections =
+                        std::vector<BaseComparisonPopulationTreeCollection *>());
+
         void write_summary(
                 std::ostream& out,
                 unsigned int indent_level = 0) const;
@@ -0,0 +1,526 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_COMPRESSED_STREAM_HPP
+#define ECOEVOLITY_COMPRESSED_STREAM_HPP
+
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <memory>
+#include <vector>
+#include <deque>
+
+#ifdef BUILD_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef BUILD_WITH_THREADS
+#include <future>
+#include <chrono>
+#endif
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "path.hpp"
+
+
+namespace compressed_stream {
+
+/**
+ * Compression of a file, which is chosen by its extension: '.gz' for gzip,
+ * and '.zst' for zstd.
+ */
+enum class Compression {
+    none,
+    gzip,
+    zstd
+};
+
+inline Compression get_compression(const std::string & path) {
+    std::string ext = path::splitext(path).second;
+    if (ext == ".gz") {
+        return Compression::gzip;
+    }
+    if (ext == ".zst") {
+        return Compression::zstd;
+    }
+    return Compression::none;
+}
+
+/**
+ * Splits the path into the path without the compression extension and the
+ * compression extension (empty if the file is not compressed).
+ */
+inline std::pair<std::string, std::string> split_compression_extension(
+        const std::string & path) {
+    if (get_compression(path) == Compression::none) {
+        return std::pair<std::string, std::string>(path, "");
+    }
+    return path::splitext(path);
+}
+
+inline bool is_supported(Compression compression) {
+    if (compression == Compression::none) {
+        return true;
+    }
+#ifdef BUILD_WITH_ZLIB
+    if (compression == Compression::gzip) {
+        return true;
+    }
+#endif
+    return false;
+}
+
+inline void check_support(const std::string & path) {
+    Compression compression = get_compression(path);
+    if (is_supported(compression)) {
+        return;
+    }
+    if (compression == Compression::gzip) {
+        throw EcoevolityError("Cannot read or write gzip-compressed file \'" +
+                path + "\'; this build does not support gzip (zlib)");
+    }
+    throw EcoevolityError("Cannot read or write zstd-compressed file \'" +
+            path + "\'; this build does not support zstd");
+}
+
+#ifdef BUILD_WITH_ZLIB
+
+/**
+ * A stream buffer that compresses its output into gzip format.
+ *
+ * Output is collected in blocks of `block_size` bytes, and each block is
+ * compressed into a separate gzip member (a file of concatenated members is
+ * a valid gzip file). With threads, up to `number_of_threads` blocks are
+ * compressed at once, and written in order. The output does not depend on
+ * the number of threads.
+ *
+ * Flushes (e.g., from std::endl) only write blocks that have been compressed;
+ * they do not cut a block short.
+ */
+class GzipOutputBuffer : public std::streambuf {
+    protected:
+        std::streambuf & out_;
+        int level_;
+        std::size_t block_size_;
+        unsigned int number_of_threads_;
+        std::vector<char> buffer_;
+        bool closed_ = false;
+        bool wrote_member_ = false;
+        bool write_failed_ = false;
+#ifdef BUILD_WITH_THREADS
+        std::deque< std::future< std::vector<char> > > compressing_;
+#endif
+
+        static std::vector<char> compress_block_(
+                const std::vector<char> & block,
+                int level) {
+            z_stream zs;
+            zs.zalloc = Z_NULL;
+            zs.zfree = Z_NULL;
+            zs.opaque = Z_NULL;
+            // 16 is added to the window bits for a gzip header and trailer
+            if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw EcoevolityError("Could not initialize gzip compression");
+            }
+            std::vector<char> compressed(deflateBound(&zs, block.size()));
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+            zs.avail_in = block.size();
+            zs.next_out = reinterpret_cast<Bytef *>(compressed.data());
+            zs.avail_out = compressed.size();
+            int ret = deflate(&zs, Z_FINISH);
+            compressed.resize(zs.total_out);
+            deflateEnd(&zs);
+            if (ret != Z_STREAM_END) {
+                throw EcoevolityError("Could not compress gzip block");
+            }
+            return compressed;
+        }
+
+        void write_(const std::vector<char> & compressed) {
+            std::streamsize n = this->out_.sputn(compressed.data(), compressed.size());
+            if (n != (std::streamsize)compressed.size()) {
+                this->write_failed_ = true;
+                throw EcoevolityError("Could not write compressed output");
+            }
+            this->wrote_member_ = true;
+        }
+
+#ifdef BUILD_WITH_THREADS
+        void write_compressed_blocks_(bool waiting) {
+            while (! this->compressing_.empty()) {
+                if ((! waiting) && (this->compressing_.front().wait_for(
+                        std::chrono::seconds(0)) != std::future_status::ready)) {
+                    return;
+                }
+                std::vector<char> compressed = this->compressing_.front().get();
+                this->compressing_.pop_front();
+                this->write_(compressed);
+            }
+        }
+#endif
+
+        void reset_put_area_() {
+            this->buffer_.resize(this->block_size_);
+            this->setp(this->buffer_.data(),
+                    this->buffer_.data() + this->buffer_.size());
+        }
+
+        void hand_off_() {
+            std::size_t size = this->pptr() - this->pbase();
+            if (size < 1) {
+                return;
+            }
+            this->buffer_.resize(size);
+#ifdef BUILD_WITH_THREADS
+            if (this->number_of_threads_ > 1) {
+                while (this->compressing_.size() >= this->number_of_threads_) {
+                    std::vector<char> compressed = this->compressing_.front().get();
+                    this->compressing_.pop_front();
+                    this->write_(compressed);
+                }
+                int level = this->level_;
+                std::shared_ptr< std::vector<char> > block =
+                        std::make_shared< std::vector<char> >(std::move(this->buffer_));
+                this->compressing_.push_back(std::async(
+                        std::launch::async,
+                        [block, level]() {
+                            return compress_block_(*block, level);
+                        }));
+                this->buffer_ = std::vector<char>();
+                this->buffer_.reserve(this->block_size_);
+                this->reset_put_area_();
+                return;
+            }
+#endif
+            this->write_(compress_block_(this->buffer_, this->level_));
+            this->reset_put_area_();
+        }
+
+        int_type overflow(int_type c) {
+            if (this->closed_) {
+                return traits_type::eof();
+            }
+            this->hand_off_();
+            if (! traits_type::eq_int_type(c, traits_type::eof())) {
+                *this->pptr() = traits_type::to_char_type(c);
+                this->pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() {
+            if (this->closed_ || this->write_failed_) {
+                return (this->write_failed_ ? -1 : 0);
+            }
+#ifdef BUILD_WITH_THREADS
+            this->write_compressed_blocks_(false);
+#endif
+            return this->out_.pubsync();
+        }
+
+    public:
+        GzipOutputBuffer(std::streambuf & out,
+                unsigned int number_of_threads = 1,
+                int level = Z_DEFAULT_COMPRESSION,
+                std::size_t block_size = 1 << 20)
+                : out_(out),
+                  level_(level),
+                  block_size_(block_size),
+                  number_of_threads_(number_of_threads) {
+            ECOEVOLITY_ASSERT(block_size > 0);
+            if (this->number_of_threads_ < 1) {
+                this->number_of_threads_ = 1;
+            }
+            this->buffer_.reserve(block_size);
+            this->reset_put_area_();
+        }
+
+        GzipOutputBuffer(const GzipOutputBuffer &) = delete;
+        GzipOutputBuffer & operator=(const GzipOutputBuffer &) = delete;
+
+        ~GzipOutputBuffer() {
+            try {
+                this->close();
+            }
+            catch (...) { }
+        }
+
+        /**
+         * Compresses and writes everything collected so far. Nothing more
+         * can be written.
+         */
+        void close() {
+            if (this->closed_) {
+                return;
+            }
+            this->closed_ = true;
+            this->hand_off_();
+#ifdef BUILD_WITH_THREADS
+            this->write_compressed_blocks_(true);
+#endif
+            // An empty gzip member, so that an empty file is valid gzip
+            if (! this->wrote_member_) {
+                this->write_(compress_block_(std::vector<char>(), this->level_));
+            }
+            this->setp(nullptr, nullptr);
+            if (this->out_.pubsync() != 0) {
+                throw EcoevolityError("Could not write compressed output");
+            }
+        }
+};
+
+
+/**
+ * A stream buffer that reads a gzip-compressed file (or an uncompressed
+ * file, as is).
+ */
+class GzipInputBuffer : public std::streambuf {
+    protected:
+        gzFile file_ = nullptr;
+        std::vector<char> buffer_;
+
+        int_type underflow() {
+            if (this->gptr() < this->egptr()) {
+                return traits_type::to_int_type(*this->gptr());
+            }
+            if (! this->file_) {
+                return traits_type::eof();
+            }
+            int n = gzread(this->file_, this->buffer_.data(), this->buffer_.size());
+            if (n < 0) {
+                throw EcoevolityError("Could not decompress gzip input");
+            }
+            if (n == 0) {
+                return traits_type::eof();
+            }
+            this->setg(this->buffer_.data(),
+                    this->buffer_.data(),
+                    this->buffer_.data() + n);
+            return traits_type::to_int_type(*this->gptr());
+        }
+
+    public:
+        GzipInputBuffer(std::size_t buffer_size = 1 << 16)
+                : buffer_(buffer_size) {
+            ECOEVOLITY_ASSERT(buffer_size > 0);
+            this->setg(this->buffer_.data(),
+                    this->buffer_.data(),
+                    this->buffer_.data());
+        }
+
+        GzipInputBuffer(const GzipInputBuffer &) = delete;
+        GzipInputBuffer & operator=(const GzipInputBuffer &) = delete;
+
+        ~GzipInputBuffer() {
+            this->close();
+        }
+
+        bool open(const std::string & path) {
+            this->close();
+            this->file_ = gzopen(path.c_str(), "rb");
+            if (! this->file_) {
+                return false;
+            }
+            gzbuffer(this->file_, 1 << 17);
+            return true;
+        }
+
+        bool is_open() const {
+            return (this->file_ != nullptr);
+        }
+
+        void close() {
+            if (this->file_) {
+                gzclose(this->file_);
+                this->file_ = nullptr;
+            }
+            this->setg(this->buffer_.data(),
+                    this->buffer_.data(),
+                    this->buffer_.data());
+        }
+};
+
+#endif
+
+} // compressed_stream
+
+
+/**
+ * An output file stream that compresses its output if the path has the
+ * extension of a compression format (see compressed_stream::Compression).
+ * Otherwise, it is a plain file stream. With threads,
+ * `number_of_compression_threads` blocks are compressed at once.
+ */
+class OutputFileStream : public std::ostream {
+    protected:
+        std::filebuf file_buffer_;
+#ifdef BUILD_WITH_ZLIB
+        std::unique_ptr<compressed_stream::GzipOutputBuffer> gzip_buffer_;
+#endif
+
+    public:
+        OutputFileStream() : std::ostream(nullptr) {
+            this->rdbuf(&this->file_buffer_);
+        }
+        OutputFileStream(const std::string & path,
+                std::ios_base::openmode mode = std::ios_base::out,
+                unsigned int number_of_compression_threads = 1)
+                : std::ostream(nullptr) {
+            this->rdbuf(&this->file_buffer_);
+            this->open(path, mode, number_of_compression_threads);
+        }
+
+        OutputFileStream(const OutputFileStream &) = delete;
+        OutputFileStream & operator=(const OutputFileStream &) = delete;
+
+        ~OutputFileStream() {
+            this->close();
+        }
+
+        void open(const std::string & path,
+                std::ios_base::openmode mode = std::ios_base::out,
+                unsigned int number_of_compression_threads = 1) {
+            compressed_stream::check_support(path);
+            this->close();
+            compressed_stream::Compression compression =
+                    compressed_stream::get_compression(path);
+            if (compression != compressed_stream::Compression::none) {
+                mode |= std::ios_base::binary;
+            }
+            if (! this->file_buffer_.open(path, mode | std::ios_base::out)) {
+                this->setstate(std::ios_base::failbit);
+                return;
+            }
+            this->clear();
+#ifdef BUILD_WITH_ZLIB
+            if (compression == compressed_stream::Compression::gzip) {
+                this->gzip_buffer_.reset(new compressed_stream::GzipOutputBuffer(
+                        this->file_buffer_,
+                        number_of_compression_threads));
+                this->rdbuf(this->gzip_buffer_.get());
+            }
+#endif
+        }
+
+        bool is_open() const {
+            return this->file_buffer_.is_open();
+        }
+
+        void close() {
+            if (! this->is_open()) {
+                return;
+            }
+#ifdef BUILD_WITH_ZLIB
+            if (this->gzip_buffer_) {
+                bool compression_failed = false;
+                try {
+                    this->gzip_buffer_->close();
+                }
+                catch (...) {
+                    compression_failed = true;
+                }
+                // Setting the buffer clears the state, so it is set after
+                std::ios_base::iostate state = this->rdstate();
+                this->rdbuf(&this->file_buffer_);
+                this->setstate(state);
+                if (compression_failed) {
+                    this->setstate(std::ios_base::badbit);
+                }
+                this->gzip_buffer_.reset();
+            }
+#endif
+            if (! this->file_buffer_.close()) {
+                this->setstate(std::ios_base::failbit);
+            }
+        }
+};
+
+
+/**
+ * An input file stream that decompresses its input if the path has the
+ * extension of a compression format (see compressed_stream::Compression).
+ * Otherwise, it is a plain file stream.
+ */
+class InputFileStream : public std::istream {
+    protected:
+        std::filebuf file_buffer_;
+#ifdef BUILD_WITH_ZLIB
+        compressed_stream::GzipInputBuffer gzip_buffer_;
+#endif
+
+    public:
+        InputFileStream() : std::istream(nullptr) {
+            this->rdbuf(&this->file_buffer_);
+        }
+        InputFileStream(const std::string & path,
+                std::ios_base::openmode mode = std::ios_base::in)
+                : std::istream(nullptr) {
+            this->rdbuf(&this->file_buffer_);
+            this->open(path, mode);
+        }
+
+        InputFileStream(const InputFileStream &) = delete;
+        InputFileStream & operator=(const InputFileStream &) = delete;
+
+        void open(const std::string & path,
+                std::ios_base::openmode mode = std::ios_base::in) {
+            compressed_stream::check_support(path);
+            this->close();
+#ifdef BUILD_WITH_ZLIB
+            if (compressed_stream::get_compression(path) ==
+                    compressed_stream::Compression::gzip) {
+                if (! this->gzip_buffer_.open(path)) {
+                    this->setstate(std::ios_base::failbit);
+                    return;
+                }
+                this->clear();
+                this->rdbuf(&this->gzip_buffer_);
+                return;
+            }
+#endif
+            if (! this->file_buffer_.open(path, mode | std::ios_base::in)) {
+                this->setstate(std::ios_base::failbit);
+                return;
+            }
+            this->clear();
+            this->rdbuf(&this->file_buffer_);
+        }
+
+        bool is_open() const {
+#ifdef BUILD_WITH_ZLIB
+            if (this->gzip_buffer_.is_open()) {
+                return true;
+            }
+#endif
+            return this->file_buffer_.is_open();
+        }
+
+        void close() {
+#ifdef BUILD_WITH_ZLIB
+            this->gzip_buffer_.close();
+#endif
+            this->file_buffer_.close();
+            this->rdbuf(&this->file_buffer_);
+        }
+};
+
+#endif
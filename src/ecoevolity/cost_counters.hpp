@@ -0,0 +1,140 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_COST_COUNTERS_HPP
+#define ECOEVOLITY_COST_COUNTERS_HPP
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * A snapshot of the costs counted by ModelCostCounters.
+ */
+struct ModelCost {
+    unsigned long long likelihood_calls = 0;
+    unsigned long long patterns_evaluated = 0;
+    unsigned long long store_restore_nanoseconds = 0;
+
+    ModelCost & operator+=(const ModelCost & other) {
+        this->likelihood_calls += other.likelihood_calls;
+        this->patterns_evaluated += other.patterns_evaluated;
+        this->store_restore_nanoseconds += other.store_restore_nanoseconds;
+        return *this;
+    }
+    ModelCost & operator-=(const ModelCost & other) {
+        this->likelihood_calls -= other.likelihood_calls;
+        this->patterns_evaluated -= other.patterns_evaluated;
+        this->store_restore_nanoseconds -= other.store_restore_nanoseconds;
+        return *this;
+    }
+    ModelCost & operator/=(unsigned long long n) {
+        this->likelihood_calls /= n;
+        this->patterns_evaluated /= n;
+        this->store_restore_nanoseconds /= n;
+        return *this;
+    }
+};
+
+/**
+ * Counters of the expensive parts of evaluating the state of one model
+ * (e.g., a tree); each chain counts its own work, so chains run in parallel
+ * do not count each other's.
+ *
+ * The counters only ever increase; the cost of a piece of work (e.g., an MCMC
+ * move) is the difference between snapshots taken before and after it. They
+ * are atomic, because the likelihoods of a model's proposals can be computed
+ * in parallel. A copy of a model starts from the counts of the original, but
+ * counts separately.
+ */
+class ModelCostCounters {
+    protected:
+        std::atomic<unsigned long long> likelihood_calls_;
+        std::atomic<unsigned long long> patterns_evaluated_;
+        std::atomic<unsigned long long> store_restore_nanoseconds_;
+
+    public:
+        ModelCostCounters() :
+                likelihood_calls_(0),
+                patterns_evaluated_(0),
+                store_restore_nanoseconds_(0) { }
+        ModelCostCounters(const ModelCostCounters & other) :
+                likelihood_calls_(other.get_number_of_likelihood_calls()),
+                patterns_evaluated_(other.get_number_of_patterns_evaluated()),
+                store_restore_nanoseconds_(other.get_store_restore_nanoseconds()) { }
+        ModelCostCounters & operator=(const ModelCostCounters & other) {
+            this->likelihood_calls_.store(other.get_number_of_likelihood_calls(),
+                    std::memory_order_relaxed);
+            this->patterns_evaluated_.store(other.get_number_of_patterns_evaluated(),
+                    std::memory_order_relaxed);
+            this->store_restore_nanoseconds_.store(other.get_store_restore_nanoseconds(),
+                    std::memory_order_relaxed);
+            return *this;
+        }
+
+        void record_likelihood_call(unsigned int number_of_patterns) {
+            this->likelihood_calls_.fetch_add(1, std::memory_order_relaxed);
+            this->patterns_evaluated_.fetch_add(number_of_patterns,
+                    std::memory_order_relaxed);
+        }
+        void record_store_restore_time(
+                const std::chrono::steady_clock::duration & duration) {
+            this->store_restore_nanoseconds_.fetch_add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+                    std::memory_order_relaxed);
+        }
+
+        unsigned long long get_number_of_likelihood_calls() const {
+            return this->likelihood_calls_.load(std::memory_order_relaxed);
+        }
+        unsigned long long get_number_of_patterns_evaluated() const {
+            return this->patterns_evaluated_.load(std::memory_order_relaxed);
+        }
+        unsigned long long get_store_restore_nanoseconds() const {
+            return this->store_restore_nanoseconds_.load(std::memory_order_relaxed);
+        }
+
+        ModelCost get_cost() const {
+            ModelCost cost;
+            cost.likelihood_calls = this->get_number_of_likelihood_calls();
+            cost.patterns_evaluated = this->get_number_of_patterns_evaluated();
+            cost.store_restore_nanoseconds = this->get_store_restore_nanoseconds();
+            return cost;
+        }
+};
+
+/**
+ * Adds the time between its construction and destruction to the store/restore
+ * time of a ModelCostCounters instance.
+ */
+class StoreRestoreTimer {
+    protected:
+        ModelCostCounters & counters_;
+        std::chrono::steady_clock::time_point start_;
+
+    public:
+        StoreRestoreTimer(ModelCostCounters & counters) :
+                counters_(counters),
+                start_(std::chrono::steady_clock::now()) { }
+        ~StoreRestoreTimer() {
+            this->counters_.record_store_restore_time(
+                    std::chrono::steady_clock::now() - this->start_);
+        }
+};
+
+#endif
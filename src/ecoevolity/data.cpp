@@ -120,7 +120,7 @@ void BiallelicData::init_from_yaml_stream(
 void BiallelicData::init_from_yaml_path(
         const std::string& path,
         bool validate) {
-    std::ifstream in_stream;
+    InputFileStream in_stream;
     in_stream.open(path);
     if (! in_stream.is_open()) {
         throw EcoevolityYamlDataError(
@@ -340,7 +340,20 @@ void BiallelicData::init(
     }
 
     MultiFormatReader nexus_reader(-1, NxsReader::WARNINGS_TO_STDERR);
-    nexus_reader.ReadFilepath(this->path_.c_str(), MultiFormatReader::NEXUS_FORMAT);
+    if (compressed_stream::get_compression(this->path_) ==
+            compressed_stream::Compression::none) {
+        nexus_reader.ReadFilepath(this->path_.c_str(), MultiFormatReader::NEXUS_FORMAT);
+    }
+    else {
+        InputFileStream in_stream(this->path_);
+        if (! in_stream.is_open()) {
+            throw EcoevolityBiallelicDataError(
+                    "Could not open nexus data file",
+                    this->path_);
+        }
+        nexus_reader.ReadStream(in_stream, MultiFormatReader::NEXUS_FORMAT,
+                this->path_.c_str());
+    }
 
     unsigned int num_taxa_blocks = nexus_reader.GetNumTaxaBlocks();
     if (num_taxa_blocks < 1) {
@@ -37,6 +37,7 @@
 #include "debug.hpp"
 #include "assert.hpp"
 #include "error.hpp"
+#include "compressed_stream.hpp"
 
 /**
  * Class for storing biallelic site patterns.
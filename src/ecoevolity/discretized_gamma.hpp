@@ -24,14 +24,23 @@
 #include <sstream>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include "math_util.hpp"
 #include "parameter.hpp"
+#include "error.hpp"
 
+/**
+ * A gamma distribution discretized into categories of equal probability.
+ *
+ * Each category is represented by the mean (or median) value of the gamma
+ * distribution within it, so the mean of the categories is the mean of the
+ * distribution (when bin means are used).
+ */
 class DiscretizedGamma {
     protected:
-        PositiveRealParameter shape_(1.0, true);
-        PositiveRealParameter scale_(1.0, true);
+        PositiveRealParameter shape_ = PositiveRealParameter(1.0);
+        PositiveRealParameter scale_ = PositiveRealParameter(1.0);
         unsigned int num_categories_ = 4;
         std::vector<double> quantiles_;
         bool use_bin_median_ = false;
@@ -47,6 +56,11 @@ class DiscretizedGamma {
             double a = this->get_shape();
             double b = 1.0 / this->get_scale();
             int nCats = (int)this->get_num_categories();
+            this->quantiles_.assign(nCats, 0.0);
+            if (nCats == 1) {
+                this->quantiles_.at(0) = this->get_mean();
+                return;
+            }
             
             double factor = a / b * nCats;
 
@@ -72,7 +86,7 @@ class DiscretizedGamma {
                 /* calculate the cumulative values */
                 double lnGammaValue = std::lgamma(a + 1.0);
                 for (int i=0; i<nCats-1; i++) 
-                    this->quantiles_.at(i) = incomplete_gamma((*value)[i] * b, a + 1.0, lnGammaValue);
+                    this->quantiles_.at(i) = incomplete_gamma(this->quantiles_.at(i) * b, a + 1.0, lnGammaValue);
                 this->quantiles_.at(nCats-1) = 1.0;
                 /* calculate the relative values and rescale */
                 for (int i=nCats-1; i>0; i--){
@@ -84,6 +98,24 @@ class DiscretizedGamma {
         }
 
     public:
+        DiscretizedGamma() {
+            this->update();
+        }
+        DiscretizedGamma(double shape,
+                double scale,
+                unsigned int num_categories = 4,
+                bool use_bin_median = false) {
+            if (num_categories < 1) {
+                throw EcoevolityError(
+                        "DiscretizedGamma: number of categories must be positive");
+            }
+            this->shape_.set_value(shape);
+            this->scale_.set_value(scale);
+            this->num_categories_ = num_categories;
+            this->use_bin_median_ = use_bin_median;
+            this->update();
+        }
+
         double get_shape() const {
             return this->shape_.get_value();
         }
@@ -96,12 +128,15 @@ class DiscretizedGamma {
         unsigned int get_num_categories() const {
             return this->num_categories_;
         }
+        bool using_bin_median() const {
+            return this->use_bin_median_;
+        }
 
         void set_shape(double shape) {
             this->shape_.set_value(shape);
             this->update();
         }
-        void set_scale(double shape) {
+        void set_scale(double scale) {
             this->scale_.set_value(scale);
             this->update();
         }
@@ -136,14 +171,14 @@ class DiscretizedGamma {
 
         void set_shape_preserve_mean(double shape) {
             double mean = this->get_mean();
-            new_scale = mean / shape;
+            double new_scale = mean / shape;
             this->shape_.set_value(shape);
             this->scale_.set_value(new_scale);
             this->update();
         }
         void set_scale_preserve_mean(double scale) {
             double mean = this->get_mean();
-            new_shape = mean / scale;
+            double new_shape = mean / scale;
             this->shape_.set_value(new_shape);
             this->scale_.set_value(scale);
             this->update();
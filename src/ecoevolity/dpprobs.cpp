@@ -65,7 +65,32 @@ int dpprobs_main(int argc, char * argv[]) {
             .type("unsigned int")
             .dest("number_of_samples")
             .set_default("100000")
-            .help("Number of simulation samples. Default: 100000.");
+            .help("Number of simulation samples. Default: 100000. "
+                  "Simulations are only used if a beta prior on the discount "
+                  "is specified, or if the \'--monte-carlo\' option is used; "
+                  "otherwise the probabilities are calculated exactly.");
+    parser.add_option("--integration-points")
+            .action("store")
+            .type("unsigned int")
+            .dest("integration_points")
+            .set_default("1000")
+            .help("Number of equal-probability bins of the gamma prior on "
+                  "the concentration parameter used to integrate over it. "
+                  "Default: 1000.");
+    parser.add_option("--monte-carlo")
+            .action("store_true")
+            .dest("monte_carlo")
+            .help("Approximate the probabilities by simulation, even if they "
+                  "can be calculated exactly.");
+#ifdef BUILD_WITH_THREADS
+    parser.add_option("--nthreads")
+            .action("store")
+            .type("unsigned int")
+            .dest("nthreads")
+            .set_default("1")
+            .help("Number of threads to use for calculations or "
+                  "simulations. Default: 1 (no multithreading).");
+#endif
     parser.add_option("-p", "--parameter").choices({"concentration", "mean"})
             .dest("parameter")
             .set_default("mean")
@@ -230,6 +255,18 @@ int dpprobs_main(int argc, char * argv[]) {
                 "Number of samples must be 1 or greater");
     }
 
+    unsigned int npoints = options.get("integration_points");
+    if (npoints < 1) {
+        throw EcoevolityError(
+                "Number of integration points must be 1 or greater");
+    }
+
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = options.get("nthreads");
+#else
+    unsigned int nthreads = 1;
+#endif
+
     double concentration;
     double mean_ncats;
     const char* p = options.get("parameter");
@@ -291,8 +328,17 @@ int dpprobs_main(int argc, char * argv[]) {
     else {
         throw EcoevolityError("Unexpected model prior.");
     }
-    std::cerr << "Seed = " << seed << std::endl;
-    std::cerr << "Number of samples = " << nreps << std::endl;
+    // There is no closed form for the probabilities if the discount is
+    // beta distributed, so these have to be simulated
+    bool use_simulations = ((! discount_is_fixed) ||
+            options.get("monte_carlo"));
+    if (use_simulations) {
+        std::cerr << "Seed = " << seed << std::endl;
+        std::cerr << "Number of samples = " << nreps << std::endl;
+    }
+    else if (! concentration_is_fixed) {
+        std::cerr << "Number of integration points = " << npoints << std::endl;
+    }
     std::cerr << "Number of elements = " << number_of_elements << std::endl;
     if (concentration_is_fixed) {
         std::cerr << "Concentration = " << concentration << std::endl;
@@ -318,42 +364,74 @@ int dpprobs_main(int argc, char * argv[]) {
     time_t finish;
     time(&start);
 
-    unsigned int total = 0;
-    std::vector<unsigned int> elements (number_of_elements, 0);
-    std::map<unsigned int, unsigned int> number_of_categories_counts;
-    for (unsigned int i = 1; i <= number_of_elements; ++i) {
-        number_of_categories_counts[i] = 0;
-    }
-    unsigned int number_of_categories;
-    for (unsigned int i = 0; i < nreps; ++i) {
-        if (! concentration_is_fixed) {
-            concentration = rng.gamma(shape, scale);
-        }
-        if (! discount_is_fixed) {
-            discount = rng.beta(discount_alpha, discount_beta);
+    std::vector<long double> number_of_cat_probs;
+    if (use_simulations) {
+        auto simulate = [number_of_elements, concentration_is_fixed,
+                discount_is_fixed, concentration, discount, shape, scale,
+                discount_alpha, discount_beta](
+                        RandomNumberGenerator & r,
+                        std::vector<long double> & counts) {
+            std::vector<unsigned int> elements (number_of_elements, 0);
+            double c = concentration;
+            double d = discount;
+            if (! concentration_is_fixed) {
+                c = r.gamma(shape, scale);
+            }
+            if (! discount_is_fixed) {
+                d = r.beta(discount_alpha, discount_beta);
+            }
+            unsigned int ncats = r.pitman_yor_process(elements, c, d);
+            counts.at(ncats - 1) += 1.0;
+        };
+        std::vector<long double> counts = partition_probs::simulate_sums(
+                rng,
+                number_of_elements,
+                nreps,
+                simulate,
+                nthreads);
+        long double tally = 0.0;
+        long double total = 0.0;
+        for (unsigned int i = 0; i < number_of_elements; ++i) {
+            tally += counts.at(i);
+            total += counts.at(i) * (i + 1);
         }
-        number_of_categories = rng.pitman_yor_process(elements, concentration, discount);
-        ++number_of_categories_counts[number_of_categories];
-        total += number_of_categories;
-    }
+        ECOEVOLITY_ASSERT(tally == nreps);
 
-    double sample_mean_ncats = (double)total / (double)nreps;
-    std::cerr << "Sample mean number of categories = " << sample_mean_ncats << std::endl;
+        double sample_mean_ncats = (double)total / (double)nreps;
+        std::cerr << "Sample mean number of categories = " << sample_mean_ncats << std::endl;
 
-    unsigned int tally = 0;
-    for (auto const & kv: number_of_categories_counts) {
-        tally += kv.second;
+        number_of_cat_probs.assign(number_of_elements, 0.0);
+        for (unsigned int i = 0; i < number_of_elements; ++i) {
+            number_of_cat_probs.at(i) = counts.at(i) / (double)nreps;
+        }
+        std::cerr << "\nEstimated probabilities of the number of categories:\n";
+    }
+    else {
+        if (concentration_is_fixed) {
+            number_of_cat_probs = partition_probs::get_pyp_number_of_category_probs(
+                    number_of_elements,
+                    concentration,
+                    discount);
+        }
+        else {
+            number_of_cat_probs = partition_probs::get_pyp_number_of_category_probs(
+                    number_of_elements,
+                    concentration,
+                    discount,
+                    shape,
+                    scale,
+                    npoints,
+                    nthreads);
+        }
+        std::cerr << "\nProbabilities of the number of categories:\n";
     }
-    ECOEVOLITY_ASSERT(tally == nreps);
-
-    std::cerr << "\nEstimated probabilities of the number of categories:\n";
     std::cerr << string_util::banner('-') << "\n";
-    for (auto const & kv: number_of_categories_counts) {
+    for (unsigned int i = 0; i < number_of_elements; ++i) {
         std::cout << "p(ncats = "
-                  << std::setw(ncats_padding) << std::right << kv.first
+                  << std::setw(ncats_padding) << std::right << i + 1
                   << ") = "
-                  << std::setw(12) << std::left << kv.second / (double)nreps
-                  << " (n = " << stirling2_float(number_of_elements, kv.first)
+                  << std::setw(12) << std::left << number_of_cat_probs.at(i)
+                  << " (n = " << stirling2_float(number_of_elements, i + 1)
                   << ")\n";
     }
     std::cerr << string_util::banner('-') << "\n\n";
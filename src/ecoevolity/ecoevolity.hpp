@@ -29,6 +29,7 @@
 #include "error.hpp"
 #include "rng.hpp"
 #include "path.hpp"
+#include "compressed_stream.hpp"
 #include "settings.hpp"
 #include "collection.hpp"
 
@@ -72,6 +73,17 @@ int ecoevolity_main(int argc, char * argv[]) {
             .dest("ignore_data")
             .help("Ignore data to sample from the prior distribution. Default: "
                   "Use data to sample from the posterior distribution");
+    parser.add_option("--sample-prior-directly")
+            .action("store_true")
+            .dest("sample_prior_directly")
+            .help("Rather than using MCMC, draw independent samples directly "
+                  "from the prior distribution. The samples are written to "
+                  "the state log for the same generations as MCMC samples "
+                  "would be (every \'sample_frequency\' generations of "
+                  "\'chain_length\'). This implies \'--ignore-data\', "
+                  "and no operator log is written. With \'--nthreads\', "
+                  "the samples are drawn in parallel, with a random number "
+                  "generator for each thread seeded from the seed.");
 #ifdef BUILD_WITH_THREADS
     parser.add_option("--nthreads")
             .action("store")
@@ -81,7 +93,8 @@ int ecoevolity_main(int argc, char * argv[]) {
             .help("Number of threads to use for likelihood calculations. "
                   "Default: 1 (no multithreading). If you are using "
                   "the \'--ignore-data\' option, no likelihood calculations "
-                  "will be performed, and so no multithreading is used.");
+                  "will be performed, and so no multithreading is used, "
+                  "unless you are also using \'--sample-prior-directly\'.");
 #endif
     parser.add_option("--prefix")
             .action("store")
@@ -121,6 +134,30 @@ int ecoevolity_main(int argc, char * argv[]) {
                   "affected by this option, not alignments of standard "
                   "characters (i.e., 0, 1, 2)."
                 );
+    parser.add_option("--binary-logs")
+            .action("store_true")
+            .dest("binary_logs")
+            .help("Write the state log in a compact binary format rather "
+                  "than as text. The binary log is much faster for "
+                  "sumcoevolity to read. Default: Write a text log.");
+    parser.add_option("--compress-logs")
+            .action("store_true")
+            .dest("compress_logs")
+            .help("Write the state log compressed with gzip (with a '.gz' "
+                  "extension). Compressed logs are read by sumcoevolity "
+                  "as is. Cannot be used with "
+                  "'--binary-logs'. Default: Write an uncompressed log.");
+    parser.add_option("--operator-trace")
+            .action("store")
+            .dest("operator_trace")
+            .help("Path to which to write a trace of every operator call in "
+                  "the Chrome trace event (JSON) format, which can be viewed "
+                  "with chrome://tracing or Perfetto. The trace includes the "
+                  "run time of each call and the number of likelihood "
+                  "calculations it required. The file can be large for long "
+                  "chains. Default: No trace is written; the summed costs "
+                  "of each operator are always reported in the operator "
+                  "log.");
     parser.add_option("--dry-run")
             .action("store_true")
             .dest("dry_run")
@@ -142,9 +179,24 @@ int ecoevolity_main(int argc, char * argv[]) {
     std::cout << "Seed: " << seed << std::endl;
 
     const bool dry_run = options.get("dry_run");
+    const bool binary_logs = options.get("binary_logs");
+    const bool compress_logs = options.get("compress_logs");
+    if (binary_logs && compress_logs) {
+        throw EcoevolityError(
+                "The '--binary-logs' and '--compress-logs' options cannot be used together");
+    }
+    if (compress_logs && (! compressed_stream::is_supported(
+            compressed_stream::Compression::gzip))) {
+        throw EcoevolityError(
+                "Logs cannot be compressed; this build does not support gzip (zlib)");
+    }
 
-    const bool ignore_data = options.get("ignore_data");
-    if (ignore_data) {
+    const bool drawing_prior_samples = options.get("sample_prior_directly");
+    const bool ignore_data = (drawing_prior_samples || options.get("ignore_data"));
+    if (drawing_prior_samples) {
+        std::cout << "Ignoring data in order to sample directly from the prior distribution..." << std::endl;
+    }
+    else if (ignore_data) {
         std::cout << "Ignoring data in order to sample from the prior distribution..." << std::endl;
     }
     else {
@@ -204,27 +256,65 @@ int ecoevolity_main(int argc, char * argv[]) {
         std::string output_prefix = options.get("prefix").get_str();
         comparisons.add_log_prefix(output_prefix);
     }
+    if (compress_logs) {
+        comparisons.set_state_log_path(comparisons.get_state_log_path() + ".gz");
+    }
 
     std::cout << "\n" << string_util::banner('-') << "\n";
     comparisons.write_summary(std::cout);
     std::cout << string_util::banner('-') << "\n\n";
 
     comparisons.set_number_of_threads(nthreads);
+    comparisons.use_binary_state_log(binary_logs);
     std::cout << "Number of threads: " << comparisons.get_number_of_threads() << std::endl;
 
     if (dry_run) {
         return 0;
     }
 
+    std::shared_ptr<OperatorTraceWriter> operator_trace;
+    if (options.is_set_by_user("operator_trace")) {
+        std::string operator_trace_path = options.get("operator_trace").get_str();
+        if (path::exists(operator_trace_path)) {
+            throw EcoevolityError("ERROR: The operator trace file \'" +
+                    operator_trace_path + "\' already exists!");
+        }
+        operator_trace = std::make_shared<OperatorTraceWriter>(operator_trace_path);
+        comparisons.get_operator_schedule().set_operator_trace(operator_trace);
+        std::cout << "Operator trace path: " << operator_trace_path << std::endl;
+    }
+
     time_t start;
     time_t finish;
     time(&start);
 
-    std::cout << "Firing up MCMC..." << std::endl;
-    comparisons.mcmc(
-            rng,
-            settings.get_chain_length(),
-            settings.get_sample_frequency());
+    if (drawing_prior_samples) {
+        // Each thread draws samples with its own copy of the model
+        std::vector< std::shared_ptr<CollectionType> > helper_comparisons;
+        std::vector<BaseComparisonPopulationTreeCollection *> helpers;
+        for (unsigned int i = 1; i < nthreads; ++i) {
+            helper_comparisons.push_back(std::make_shared<CollectionType>(
+                    settings,
+                    rng,
+                    strict_on_constant_sites,
+                    strict_on_missing_sites,
+                    strict_on_triallelic_sites));
+            helper_comparisons.back()->ignore_data();
+            helpers.push_back(helper_comparisons.back().get());
+        }
+        comparisons.sample_prior_directly(
+                rng,
+                settings.get_chain_length(),
+                settings.get_sample_frequency(),
+                helpers);
+    }
+    else {
+        std::cout << "Firing up MCMC..." << std::endl;
+        comparisons.mcmc(
+                rng,
+                settings.get_chain_length(),
+                settings.get_sample_frequency());
+    }
 
     time(&finish);
     double duration = difftime(finish, start);
@@ -0,0 +1,236 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_FLATTREE_HPP
+#define ECOEVOLITY_FLATTREE_HPP
+
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include "parameter.hpp"
+#include "error.hpp"
+#include "assert.hpp"
+
+/**
+ * Index-based, post-order view of a tree of nodes.
+ *
+ * Nodes are stored in post-order (children before parents; the root is
+ * last), with parent and child relationships stored as indices into
+ * contiguous arrays. The structure is only recompiled when the topology of
+ * the underlying nodes changes (tracked by the topology version of the root)
+ * or the root changes; node heights are refreshed on every call to update.
+ *
+ * Once updated, a const FlatTree can be shared by multiple threads without
+ * touching the reference counts of the underlying nodes.
+ */
+template<class NodeType>
+class FlatTree {
+    protected:
+        const NodeType * root_ = nullptr;
+        unsigned long topology_version_ = 0;
+        std::vector<const NodeType *> nodes_;
+        std::vector<int> parent_indices_;
+        std::vector<unsigned int> child_offsets_;
+        std::vector<unsigned int> child_indices_;
+        std::vector<const PositiveRealParameter *> height_parameters_;
+        std::vector<double> heights_;
+
+        void add_node_(const NodeType * node, const int parent_index) {
+            // Nodes are added in pre-order; they are reversed into post-order
+            // once the whole tree has been visited
+            unsigned int index = this->nodes_.size();
+            this->nodes_.push_back(node);
+            this->parent_indices_.push_back(parent_index);
+            for (unsigned int i = node->get_number_of_children(); i > 0; --i) {
+                this->add_node_(&(*node->get_child(i - 1)), index);
+            }
+        }
+
+    public:
+        FlatTree() { }
+        FlatTree(const NodeType & root) {
+            this->compile(root);
+        }
+
+        void compile(const NodeType & root) {
+            this->root_ = &root;
+            this->topology_version_ = root.get_topology_version();
+            this->nodes_.clear();
+            this->parent_indices_.clear();
+            this->add_node_(this->root_, -1);
+
+            // Visiting children in reverse order in pre-order and reversing
+            // gives a post-order with children in their original order
+            const unsigned int n = this->nodes_.size();
+            std::vector<unsigned int> post_order_index(n);
+            for (unsigned int i = 0; i < n; ++i) {
+                post_order_index.at(i) = n - 1 - i;
+            }
+            std::vector<const NodeType *> nodes(this->nodes_.rbegin(), this->nodes_.rend());
+            std::vector<int> parent_indices(n, -1);
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->parent_indices_.at(i) > -1) {
+                    parent_indices.at(post_order_index.at(i)) =
+                            post_order_index.at(this->parent_indices_.at(i));
+                }
+            }
+            this->nodes_ = nodes;
+            this->parent_indices_ = parent_indices;
+
+            this->child_offsets_.assign(n + 1, 0);
+            this->child_indices_.clear();
+            for (unsigned int i = 0; i < n; ++i) {
+                this->child_offsets_.at(i + 1) = this->child_offsets_.at(i) +
+                        this->nodes_.at(i)->get_number_of_children();
+            }
+            this->child_indices_.resize(this->child_offsets_.at(n));
+            std::vector<unsigned int> next_child(this->child_offsets_.begin(),
+                    this->child_offsets_.end() - 1);
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->parent_indices_.at(i) > -1) {
+                    unsigned int p = this->parent_indices_.at(i);
+                    this->child_indices_.at(next_child.at(p)) = i;
+                    ++next_child.at(p);
+                }
+            }
+            this->height_parameters_.resize(n);
+            this->heights_.resize(n);
+            this->refresh();
+        }
+
+        /**
+         * Refresh node heights (and height parameter pointers, which can be
+         * reassigned without changing the topology) from the nodes.
+         */
+        void refresh() {
+            for (unsigned int i = 0; i < this->nodes_.size(); ++i) {
+                this->height_parameters_[i] = this->nodes_[i]->get_height_parameter_pointer();
+                this->heights_[i] = this->height_parameters_[i]->get_value();
+            }
+        }
+
+        /**
+         * Recompile if the root or the topology of the nodes has changed
+         * since the last compile, otherwise only refresh heights.
+         *
+         * Returns true if the flat tree was recompiled.
+         */
+        bool update(const NodeType & root) {
+            if (! this->is_compiled_from(root)) {
+                this->compile(root);
+                return true;
+            }
+            this->refresh();
+            return false;
+        }
+
+        /**
+         * Whether the flat tree was compiled from 'root' and its topology
+         * has not changed since.
+         */
+        bool is_compiled_from(const NodeType & root) const {
+            return ((this->root_ == &root) &&
+                    (this->topology_version_ == root.get_topology_version()));
+        }
+
+        /**
+         * Forget the compiled tree, so that the next update recompiles. This
+         * must be called before the root is replaced, because a new root can
+         * be allocated at the address of the old one.
+         */
+        void clear() {
+            this->root_ = nullptr;
+            this->topology_version_ = 0;
+            this->nodes_.clear();
+            this->parent_indices_.clear();
+            this->child_offsets_.clear();
+            this->child_indices_.clear();
+            this->height_parameters_.clear();
+            this->heights_.clear();
+        }
+
+        unsigned int get_number_of_nodes() const {
+            return this->nodes_.size();
+        }
+        unsigned int get_root_index() const {
+            ECOEVOLITY_ASSERT(this->nodes_.size() > 0);
+            return this->nodes_.size() - 1;
+        }
+        const NodeType * get_node(unsigned int node_index) const {
+            return this->nodes_[node_index];
+        }
+        int get_parent_index(unsigned int node_index) const {
+            return this->parent_indices_[node_index];
+        }
+        unsigned int get_number_of_children(unsigned int node_index) const {
+            return this->child_offsets_[node_index + 1] - this->child_offsets_[node_index];
+        }
+        unsigned int get_child_index(unsigned int node_index,
+                unsigned int child_number) const {
+            ECOEVOLITY_ASSERT(child_number < this->get_number_of_children(node_index));
+            return this->child_indices_[this->child_offsets_[node_index] + child_number];
+        }
+        bool is_leaf(unsigned int node_index) const {
+            return (this->child_offsets_[node_index + 1] == this->child_offsets_[node_index]);
+        }
+        double get_height(unsigned int node_index) const {
+            return this->heights_[node_index];
+        }
+        double get_length(unsigned int node_index) const {
+            if (this->parent_indices_[node_index] < 0) {
+                return 0.0;
+            }
+            return this->heights_[this->parent_indices_[node_index]] - this->heights_[node_index];
+        }
+        const PositiveRealParameter * get_height_parameter(unsigned int node_index) const {
+            return this->height_parameters_[node_index];
+        }
+        const std::vector<double>& get_heights() const {
+            return this->heights_;
+        }
+
+        /**
+         * For each of the height parameters, get the height of the youngest
+         * parent of the nodes mapped to it. Entries for parameters that are
+         * only mapped to the root are left at infinity.
+         */
+        void get_youngest_parent_heights(
+                const std::vector< std::shared_ptr<PositiveRealParameter> > & height_parameters,
+                std::vector<double> & youngest_parent_heights) const {
+            youngest_parent_heights.assign(height_parameters.size(),
+                    std::numeric_limits<double>::infinity());
+            for (unsigned int i = 0; i < this->nodes_.size(); ++i) {
+                if (this->parent_indices_[i] < 0) {
+                    continue;
+                }
+                for (unsigned int h = 0; h < height_parameters.size(); ++h) {
+                    if (height_parameters[h].get() == this->height_parameters_[i]) {
+                        double parent_height = this->heights_[this->parent_indices_[i]];
+                        if (parent_height < youngest_parent_heights[h]) {
+                            youngest_parent_heights[h] = parent_height;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+};
+
+#endif
@@ -31,11 +31,14 @@
 #include "rng.hpp"
 #include "assert.hpp"
 #include "math_util.hpp"
+#include "operator_stats.hpp"
 
 class BaseGeneralTreeOperatorTemplate {
     protected:
         double weight_ = 1.0;
         bool ignore_proposal_attempt_ = false;
+        bool rejecting_early_ = false;
+        OperatorStats stats_;
 
     public:
 		enum OperatorTypeEnum {
@@ -134,6 +137,37 @@ class BaseGeneralTreeOperatorTemplate {
         virtual std::string header_string() const = 0;
 
         virtual std::string to_string() const = 0;
+
+        /**
+         * Number of candidate states proposed per move; only multiple-try
+         * operators propose more than one.
+         */
+        virtual unsigned int get_number_of_tries() const {
+            return 1;
+        }
+        virtual void set_number_of_tries(unsigned int number_of_tries) {
+            throw EcoevolityError(this->get_name() +
+                    " is not a multiple-try operator; number_of_tries is not supported");
+        }
+
+        OperatorStats & get_stats() { return this->stats_; }
+        const OperatorStats & get_stats() const { return this->stats_; }
+
+        /**
+         * With early rejection, the uniform deviate for the Metropolis-Hastings
+         * test is drawn before the likelihood of the proposed state, so the
+         * likelihood calculation can stop as soon as it is too small for the
+         * move to be accepted. The chain is the same as without early
+         * rejection, except the operator is tuned by whether each move is
+         * accepted, because the acceptance probability of an early rejection
+         * is not known.
+         */
+        bool rejecting_early() const {
+            return this->rejecting_early_;
+        }
+        void set_early_rejection(bool rejecting_early) {
+            this->rejecting_early_ = rejecting_early;
+        }
 };
 
 template<class TreeType>
@@ -158,6 +192,35 @@ class GeneralTreeOperatorTemplate : public BaseGeneralTreeOperatorTemplate {
                 TreeType * tree,
                 unsigned int nthreads = 1) = 0;
 
+        /**
+         * @brief   Store the state of the tree and propose a new state; the
+         *          first half of perform_move.
+         *
+         * @return  Log of Hastings Ratio.
+         */
+        virtual double begin_move(RandomNumberGenerator& rng,
+                TreeType * tree,
+                unsigned int nthreads = 1) = 0;
+
+        /**
+         * @brief   Accept or reject the state proposed by begin_move, and
+         *          tune the operator; the second half of perform_move.
+         *
+         * If `state_is_restored` is true, the caller has already restored
+         * the state of the tree, so a rejected move is not restored again.
+         */
+        virtual void end_move(TreeType * tree,
+                double log_acceptance_probability,
+                bool accepted,
+                bool state_is_restored = false) = 0;
+
+        /**
+         * @brief   Forget the state proposed by begin_move, as if it had
+         *          never been proposed. The state of the tree must be
+         *          restored by the caller.
+         */
+        virtual void discard_move() = 0;
+
         /**
          * @brief   Propose a new state.
          *
@@ -206,12 +269,10 @@ class GeneralTreeOperatorInterface : public GeneralTreeOperatorTemplate<TreeType
                 RandomNumberGenerator& rng,
                 TreeType * tree,
                 unsigned int nthreads = 1) {
-            this->call_store_methods(tree);
-
             // std::cout << "lnl before move: " << tree->get_log_likelihood_value() << "\n";
             // std::cout << "Calling propose on " << this->get_name() << "\n";
         
-            double hastings_ratio = this->propose(rng, tree, nthreads);
+            double hastings_ratio = this->begin_move(rng, tree, nthreads);
 
             // Debug check for any negative branch lengths
             // std::string t = tree->to_parentheses(false);
@@ -224,20 +285,21 @@ class GeneralTreeOperatorInterface : public GeneralTreeOperatorTemplate<TreeType
             // reject before going any further and wasting computation on the
             // likelihood
             if (hastings_ratio == -std::numeric_limits<double>::infinity()) {
-                if (! this->ignore_proposal_attempt_) {
-                    this->reject();
-                }
-                this->call_restore_methods(tree);
-                tree->make_clean();
-                if (this->auto_optimizing() && (! this->ignore_proposal_attempt_)) {
-                    this->optimize(hastings_ratio);
-                }
                 // std::cout << "bad move; ignored: " << this->ignore_proposal_attempt_ << "\n";
-                this->ignore_proposal_attempt_ = false;
+                this->end_move(tree, hastings_ratio, false);
                 return;
             }
 
-            tree->compute_log_likelihood_and_prior(nthreads);
+            // The deviate is drawn before the likelihood is computed (which
+            // does not use the RNG), so that it can be used to reject early
+            double u = rng.uniform_real();
+            if (this->rejecting_early_) {
+                this->compute_log_likelihood_and_prior_for_early_rejection(
+                        tree, std::log(u), hastings_ratio, nthreads);
+            }
+            else {
+                tree->compute_log_likelihood_and_prior(nthreads);
+            }
 
             // std::cout << "lnl after comp: " << tree->get_log_likelihood_value() << "\n";
         
@@ -255,8 +317,70 @@ class GeneralTreeOperatorInterface : public GeneralTreeOperatorTemplate<TreeType
             // std::cout << "ln(prior ratio) = " << prior_ratio << "\n";
             // std::cout << "ln(hastings ratio) = " << hastings_ratio << "\n";
             // std::cout << "ln(p(accept)) = " << acceptance_probability << "\n";
-            double u = rng.uniform_real();
-            if (u < std::exp(acceptance_probability)) {
+            bool accepted = (u < std::exp(acceptance_probability));
+            if (this->rejecting_early_) {
+                acceptance_probability = accepted ? 0.0 :
+                        -std::numeric_limits<double>::infinity();
+            }
+            this->end_move(tree,
+                    acceptance_probability,
+                    accepted);
+            // std::cout << "lnl at end: " << tree->get_log_likelihood_value() << "\n";
+        }
+
+        /**
+         * Computes the prior of the proposed state, and then its likelihood
+         * only as far as needed to show that the move is rejected given
+         * `log_u`, the log of the uniform deviate. If the calculation stops
+         * early, the log likelihood is an upper bound that is small enough
+         * for the move to be rejected. If the prior of the proposed state is
+         * zero (or not a number), the move is rejected whatever its
+         * likelihood, so the likelihood is not computed at all.
+         */
+        void compute_log_likelihood_and_prior_for_early_rejection(
+                TreeType * tree,
+                double log_u,
+                double hastings_ratio,
+                unsigned int nthreads = 1) {
+            const double log_prior = tree->compute_log_prior_density();
+            if ((log_prior == -std::numeric_limits<double>::infinity()) ||
+                    std::isnan(log_prior)) {
+                tree->make_clean();
+                return;
+            }
+            if (tree->is_dirty()) {
+                // The move is rejected if the log likelihood is less than
+                // this minimum. It is lowered by a margin for rounding error,
+                // so that a move that stops early is rejected by the usual
+                // test too
+                double minimum_log_likelihood =
+                        log_u +
+                        tree->get_stored_log_likelihood_value() -
+                        (tree->get_log_prior_density_value() -
+                         tree->get_stored_log_prior_density_value()) -
+                        hastings_ratio;
+                minimum_log_likelihood -= 1e-8 * (1.0 + std::abs(minimum_log_likelihood));
+                tree->compute_log_likelihood_with_minimum(
+                        minimum_log_likelihood,
+                        nthreads);
+            }
+            tree->make_clean();
+        }
+
+        double begin_move(
+                RandomNumberGenerator& rng,
+                TreeType * tree,
+                unsigned int nthreads = 1) {
+            this->call_store_methods(tree);
+            return this->propose(rng, tree, nthreads);
+        }
+
+        void end_move(
+                TreeType * tree,
+                double log_acceptance_probability,
+                bool accepted,
+                bool state_is_restored = false) {
+            if (accepted) {
                 if (! this->ignore_proposal_attempt_) {
                     this->accept();
                 }
@@ -267,14 +391,19 @@ class GeneralTreeOperatorInterface : public GeneralTreeOperatorTemplate<TreeType
                     this->reject();
                 }
                 // std::cout << "REJECT!\n";
-                this->call_restore_methods(tree);
+                if (! state_is_restored) {
+                    this->call_restore_methods(tree);
+                }
             }
             tree->make_clean();
             if (this->auto_optimizing() && (! this->ignore_proposal_attempt_)) {
-                this->optimize(acceptance_probability);
+                this->optimize(log_acceptance_probability);
             }
             this->ignore_proposal_attempt_ = false;
-            // std::cout << "lnl at end: " << tree->get_log_likelihood_value() << "\n";
+        }
+
+        void discard_move() {
+            this->ignore_proposal_attempt_ = false;
         }
 
         void operate(RandomNumberGenerator& rng,
@@ -302,9 +431,15 @@ class GeneralTreeOperatorInterface : public GeneralTreeOperatorTemplate<TreeType
                 unsigned int helper_op_number_of_moves = 1) {
             for (unsigned int i = 0; i < number_of_moves; ++i) {
                 // std::cout << "\ncalling: " << this->get_name() << "\n";
-                this->perform_move(rng, tree, nthreads);
+                {
+                    OperatorStatsTimer timer(this->stats_, *tree);
+                    this->perform_move(rng, tree, nthreads);
+                }
+                // Helper costs are tallied by the helpers, so that they are
+                // not counted twice in the schedule
                 for (auto helper_op : this->helper_ops) {
                     // std::cout << "\nhelper call: " << helper_op->get_name() << "\n";
+                    OperatorStatsTimer timer(helper_op->get_stats(), *tree);
                     helper_op->operate(rng, tree, nthreads, helper_op_number_of_moves);
                 }
             }
@@ -2089,8 +2224,6 @@ class NeighborHeightNodeSwapAll : public NeighborHeightNodeSwap<TreeType> {
 template<class TreeType>
 class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeType, Op> {
     protected:
-        std::unordered_map<unsigned int, long double> stirling2_numbers;
-        std::unordered_map<unsigned int, long double> bell_numbers;
         double beta_a_ = 1.0;
         double beta_b_ = 1.0;
 
@@ -2124,18 +2257,43 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
             return BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::topology;
         }
 
-        double get_stirling2(unsigned int n) {
-            if (this->stirling2_numbers.count(n) < 1) {
-                this->stirling2_numbers[n] = stirling2_float(n, 2);
-            }
-            return this->stirling2_numbers[n];
+        /**
+         * Log of the number of ways to split n nodes into two non-empty sets,
+         * ln(S(n, 2)).
+         */
+        double get_ln_stirling2(unsigned int n) const {
+            return ln_stirling2(n, 2);
+        }
+
+        /**
+         * Log of the number of ways to split n nodes into two non-empty sets
+         * (in either order), plus the one way of not splitting them:
+         * ln((2 * S(n, 2)) + 1).
+         */
+        double get_ln_twice_stirling2_plus_one(unsigned int n) const {
+            double ln_twice_stirling2 = std::log(2.0) + ln_stirling2(n, 2);
+            return ln_twice_stirling2 + std::log1p(std::exp(-ln_twice_stirling2));
+        }
+
+        /**
+         * Log of the Bell number of n minus a constant, ln(Bell(n) - c).
+         */
+        double get_ln_bell_number_minus(unsigned int n, double c) const {
+            double ln_bell = ln_bell_number(n);
+            return ln_bell + std::log1p(-c * std::exp(-ln_bell));
         }
 
-        long double get_bell_number(unsigned int n) {
-            if (this->bell_numbers.count(n) < 1) {
-                this->bell_numbers[n] = bell_float(n);
+        /**
+         * The log of the product of (Bell(n) - 1) over polytomy sizes, minus
+         * 1: ln((\prod (Bell(n) - 1)) - 1).
+         */
+        double get_ln_bell_number_minus_one_product_minus_one(
+                const std::vector<unsigned int> & polytomy_sizes) const {
+            double ln_prod = 0.0;
+            for (auto polytomy_size : polytomy_sizes) {
+                ln_prod += this->get_ln_bell_number_minus(polytomy_size, 1.0);
             }
-            return this->bell_numbers[n];
+            return ln_prod + std::log1p(-std::exp(-ln_prod));
         }
 
         bool is_operable(TreeType * tree) const {
@@ -2466,8 +2624,8 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
             if (number_of_mapped_nodes == 1) {
                 // We have the special case of only a single polytomy
                 ECOEVOLITY_ASSERT(moving_polytomy_sizes.size() == 1);
-                double ln_bell_num_minus_2 = std::log(
-                        this->get_bell_number(moving_polytomy_sizes.at(0)) - 2.0);
+                double ln_bell_num_minus_2 = this->get_ln_bell_number_minus(
+                        moving_polytomy_sizes.at(0), 2.0);
                 ln_hastings =
                         std::log(number_of_splittable_heights) +
                         ln_bell_num_minus_2;
@@ -2477,7 +2635,7 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
             }
             else if (! mapped_nodes_include_polytomy) {
                 // We have multiple bifurcating nodes mapped to height
-                double ln_stirling2 = std::log(this->get_stirling2(number_of_mapped_nodes));
+                double ln_stirling2 = this->get_ln_stirling2(number_of_mapped_nodes);
                 ln_hastings =
                         std::log(number_of_splittable_heights) +
                         std::log(2.0) +
@@ -2489,60 +2647,23 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
             else {
                 // We have multiple nodes mapped to height and some are
                 // polytomies
-                bool hit_overflow = false;
-                long double long_double_max = std::numeric_limits<long double>::max();
-                long double stirl2_term = this->get_stirling2(number_of_mapped_nodes);
-                // Check for multiplication overflow
-                if (2.0 > (long_double_max / stirl2_term)) {
-                    hit_overflow = true;
-                } else {
-                    stirl2_term *= 2.0;
-                }
-                // Check for addition overflow
-                if (stirl2_term > (long_double_max - 1.0)) {
-                    hit_overflow = true;
-                } else {
-                    stirl2_term += 1.0;
-                }
-                double ln_stirling2_term;
-                if (hit_overflow) {
-                    // If we hit overflow, we will ignore the tiny plus 1 to 
-                    // (2 * Stirling)
-                    ln_stirling2_term = std::log(2.0) + std::log(this->get_stirling2(number_of_mapped_nodes));
-                } else {
-                    ln_stirling2_term = std::log(stirl2_term);
-                }
-
-                double ln_bell_num_minus_1_sum = 0.0;
-                for (auto polytomy_size : moving_polytomy_sizes) {
-                    ln_bell_num_minus_1_sum += std::log(this->get_bell_number(polytomy_size) - 1.0);
-                }
-                double ln_bell_term = ln_bell_num_minus_1_sum;
+                double ln_stirling2_term = this->get_ln_twice_stirling2_plus_one(
+                        number_of_mapped_nodes);
 
+                double ln_bell_term = 0.0;
                 if (number_of_mapped_nodes == number_of_nodes_in_split_subset) {
                     ECOEVOLITY_ASSERT(moving_polytomy_sizes.size() > 0);
                     // If all nodes mapped to height ended up in the move set,
                     // we need to account for the case we reject where none of
                     // the polytomies get broken up (i.e., all node simply
                     // slide down and no parameter is added to model).
-                    hit_overflow = false;
-                    long double bell_num_minus_1_prod = 1.0;
+                    ln_bell_term = this->get_ln_bell_number_minus_one_product_minus_one(
+                            moving_polytomy_sizes);
+                }
+                else {
                     for (auto polytomy_size : moving_polytomy_sizes) {
-                        // Check for multiplication overflow
-                        long double bell_minus_1 = this->get_bell_number(polytomy_size) - 1.0;
-                        if (bell_minus_1 > (long_double_max / bell_num_minus_1_prod)) {
-                            hit_overflow = true;
-                            break;
-                        }
-                        bell_num_minus_1_prod *= bell_minus_1;
-                    }
-                    // If we overflowed, we will use ln_bell_num_minus_1_sum,
-                    // because the minus 1 from the product will be tiny
-                    // TODO: We could probably be less conservative and use
-                    // ln_bell_num_minus_1_sum when the bell_num_minus_1_prod
-                    // gets to a threshold much smaller than the numeric limit.
-                    if (! hit_overflow) {
-                        ln_bell_term = std::log(bell_num_minus_1_prod - 1.0);
+                        ln_bell_term += this->get_ln_bell_number_minus(
+                                polytomy_size, 1.0);
                     }
                 }
                 ln_hastings =
@@ -2696,11 +2817,11 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
                         ln_density_of_rev_height;
                 ln_hastings -=
                         (std::log(post_num_splittable_heights) +
-                        std::log(this->get_bell_number(num_polytomy_children) - 2.0));
+                        this->get_ln_bell_number_minus(num_polytomy_children, 2.0));
             }
             else if (post_num_mapped_poly_nodes < 1) {
                 // Only shared bifurcating nodes
-                double ln_stirling2_num = std::log(this->get_stirling2(post_num_mapped_nodes));
+                double ln_stirling2_num = this->get_ln_stirling2(post_num_mapped_nodes);
                 ln_hastings =
                         std::log(num_heights - 1) +
                         ln_prob_of_drawing_old_node_states +
@@ -2712,37 +2833,10 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
             }
             // We have shared nodes that include at least on polytomy
             else {
-                bool hit_overflow = false;
-                long double long_double_max = std::numeric_limits<long double>::max();
-                long double stirl2_term = this->get_stirling2(post_num_mapped_nodes);
-                // Check for multiplication overflow
-                if (2.0 > (long_double_max / stirl2_term)) {
-                    hit_overflow = true;
-                } else {
-                    stirl2_term *= 2.0;
-                }
-                // Check for addition overflow
-                if (stirl2_term > (long_double_max - 1.0)) {
-                    hit_overflow = true;
-                } else {
-                    stirl2_term += 1.0;
-                }
-                double ln_stirling2_term;
-                if (hit_overflow) {
-                    // If we hit overflow, we will ignore the tiny plus 1 to 
-                    // (2 * Stirling)
-                    ln_stirling2_term = std::log(2.0) + std::log(this->get_stirling2(post_num_mapped_nodes));
-                } else {
-                    ln_stirling2_term = std::log(stirl2_term);
-                }
-
-                double ln_bell_num_minus_1_sum = 0.0;
-                for (auto poly_size : sizes_of_mapped_polytomies_after_merge) {
-                    ln_bell_num_minus_1_sum += std::log(
-                            this->get_bell_number(poly_size) - 1.0);
-                }
-                double ln_bell_term = ln_bell_num_minus_1_sum;
+                double ln_stirling2_term = this->get_ln_twice_stirling2_plus_one(
+                        post_num_mapped_nodes);
 
+                double ln_bell_term = 0.0;
                 if (post_num_mapped_nodes == number_of_resulting_merged_nodes) {
                     ECOEVOLITY_ASSERT(sizes_of_mapped_polytomies_after_merge.size() > 0);
                     // If all nodes mapped to height need to end up in the move
@@ -2750,24 +2844,13 @@ class SplitLumpNodesRevJumpSampler : public GeneralTreeOperatorInterface<TreeTyp
                     // case we reject where none of the polytomies get broken
                     // up (i.e., all node simply slide down and no parameter is
                     // added to model).
-                    hit_overflow = false;
-                    long double bell_num_minus_1_prod = 1.0;
+                    ln_bell_term = this->get_ln_bell_number_minus_one_product_minus_one(
+                            sizes_of_mapped_polytomies_after_merge);
+                }
+                else {
                     for (auto poly_size : sizes_of_mapped_polytomies_after_merge) {
-                        // Check for multiplication overflow
-                        long double bell_minus_1 = this->get_bell_number(poly_size) - 1.0;
-                        if (bell_minus_1 > (long_double_max / bell_num_minus_1_prod)) {
-                            hit_overflow = true;
-                            break;
-                        }
-                        bell_num_minus_1_prod *= bell_minus_1;
-                    }
-                    // If we overflowed, we will use ln_bell_num_minus_1_sum,
-                    // because the minus 1 from the product will be tiny
-                    // TODO: We could probably be less conservative and use
-                    // ln_bell_num_minus_1_sum when the bell_num_minus_1_prod
-                    // gets to a threshold much smaller than the numeric limit.
-                    if (! hit_overflow) {
-                        ln_bell_term = std::log(bell_num_minus_1_prod - 1.0);
+                        ln_bell_term += this->get_ln_bell_number_minus(
+                                poly_size, 1.0);
                     }
                 }
                 ln_hastings =
@@ -2955,6 +3038,310 @@ class PopSizeScaler : public GeneralTreeOperatorInterface<BasePopulationTree, Sc
         }
 };
 
+/**
+ * Base class for multiple-try Metropolis (MTM; Liu et al. 2000, J. Am. Stat.
+ * Assoc. 95:121-134) scalers of a single parameter.
+ *
+ * A move draws `number_of_tries` candidate values by scaling the current
+ * value, and selects one with probability proportional to its weight, the
+ * posterior density times the value (the proposal is symmetric on the log
+ * scale). Another `number_of_tries - 1` reference values are drawn by
+ * scaling the selected value and, with the current value, complete the
+ * reference set. The move is accepted with probability
+ *
+ *     min(1, sum of candidate weights / sum of reference weights).
+ *
+ * A move needs 2 * number_of_tries - 1 likelihoods, but they are computed in
+ * two batches in parallel, and the best of several candidates allows larger
+ * scales than a single try.
+ */
+class MultipleTryScaleOperator : public GeneralTreeOperatorInterface<BasePopulationTree, ScaleOp> {
+
+    protected:
+        unsigned int number_of_tries_ = 4;
+
+        /**
+         * Choose the parameter to update; called at the start of each move.
+         */
+        virtual void draw_target(RandomNumberGenerator& rng,
+                BasePopulationTree * tree) = 0;
+
+        virtual double get_target_value(BasePopulationTree * tree) const = 0;
+
+        /**
+         * Set the value of the target parameter. Returns false, without
+         * changing the tree, if the value is outside of the support of the
+         * parameter.
+         */
+        virtual bool set_target_value(BasePopulationTree * tree,
+                double value) = 0;
+
+        /**
+         * Compute the log weights of `values` of the target parameter, along
+         * with their log likelihoods and log prior densities. Weights of
+         * values outside of the support are -inf. The target is left at its
+         * value at the time of the call.
+         */
+        void compute_log_weights(
+                BasePopulationTree * tree,
+                const std::vector<double> & values,
+                std::vector<double> & log_weights,
+                std::vector<double> & log_likelihoods,
+                std::vector<double> & log_priors,
+                unsigned int nthreads) {
+            const double current_value = this->get_target_value(tree);
+            log_weights.assign(values.size(),
+                    -std::numeric_limits<double>::infinity());
+            log_priors.assign(values.size(),
+                    -std::numeric_limits<double>::infinity());
+            std::vector<PopulationTreeLikelihoodState> states;
+            std::vector<unsigned int> state_indices;
+            for (unsigned int i = 0; i < values.size(); ++i) {
+                if (! this->set_target_value(tree, values.at(i))) {
+                    continue;
+                }
+                log_priors.at(i) = tree->compute_log_prior_density();
+                states.push_back(tree->get_likelihood_state());
+                state_indices.push_back(i);
+            }
+            this->set_target_value(tree, current_value);
+
+            std::vector<double> state_log_likelihoods;
+            tree->compute_log_likelihoods(states, state_log_likelihoods, nthreads);
+            log_likelihoods.assign(values.size(),
+                    -std::numeric_limits<double>::infinity());
+            for (unsigned int s = 0; s < state_indices.size(); ++s) {
+                unsigned int i = state_indices.at(s);
+                log_likelihoods.at(i) = state_log_likelihoods.at(s);
+                log_weights.at(i) = log_likelihoods.at(i) +
+                        log_priors.at(i) +
+                        std::log(values.at(i));
+            }
+        }
+
+    public:
+        MultipleTryScaleOperator() : GeneralTreeOperatorInterface<BasePopulationTree, ScaleOp>() { }
+        MultipleTryScaleOperator(double weight) : GeneralTreeOperatorInterface<BasePopulationTree, ScaleOp>(weight) { }
+        MultipleTryScaleOperator(double weight, double tuning_parameter)
+            : GeneralTreeOperatorInterface<BasePopulationTree, ScaleOp>(weight, tuning_parameter) { }
+
+        unsigned int get_number_of_tries() const {
+            return this->number_of_tries_;
+        }
+        void set_number_of_tries(unsigned int number_of_tries) {
+            ECOEVOLITY_ASSERT(number_of_tries > 1);
+            this->number_of_tries_ = number_of_tries;
+        }
+
+        /**
+         * Multiple-try operators are only used if given a weight in the
+         * config.
+         */
+        double get_default_weight(unsigned int number_of_leaves) {
+            return 0.0;
+        }
+
+        /**
+         * @brief   Propose a new state.
+         *
+         * The likelihood and prior of the proposed state are computed here,
+         * and the tree is left clean, so they are not computed again.
+         *
+         * @return  Log of the MTM acceptance ratio less the log posterior
+         *          ratio of the proposed and current states.
+         */
+        double propose(RandomNumberGenerator& rng,
+                BasePopulationTree * tree,
+                unsigned int nthreads = 1) {
+            if (! this->is_operable(tree)) {
+                this->ignore_proposal_attempt_ = true;
+                return -std::numeric_limits<double>::infinity();
+            }
+            this->draw_target(rng, tree);
+            const double current_value = this->get_target_value(tree);
+            const double current_log_posterior =
+                    tree->get_log_likelihood_value() +
+                    tree->get_log_prior_density_value();
+
+            double ln_multiplier;
+            std::vector<double> candidates(this->number_of_tries_, current_value);
+            for (unsigned int i = 0; i < candidates.size(); ++i) {
+                this->update(rng, candidates.at(i), ln_multiplier);
+            }
+            std::vector<double> candidate_log_weights;
+            std::vector<double> candidate_log_likelihoods;
+            std::vector<double> candidate_log_priors;
+            this->compute_log_weights(tree,
+                    candidates,
+                    candidate_log_weights,
+                    candidate_log_likelihoods,
+                    candidate_log_priors,
+                    nthreads);
+            const double log_candidate_weight = log_sum_exp(candidate_log_weights);
+            if (log_candidate_weight == -std::numeric_limits<double>::infinity()) {
+                return -std::numeric_limits<double>::infinity();
+            }
+            std::vector<double> probs = candidate_log_weights;
+            normalize_log_likelihoods(probs);
+            const unsigned int selected = rng.weighted_index(probs);
+            const double new_value = candidates.at(selected);
+
+            std::vector<double> references(this->number_of_tries_ - 1, new_value);
+            for (unsigned int i = 0; i < references.size(); ++i) {
+                this->update(rng, references.at(i), ln_multiplier);
+            }
+            std::vector<double> reference_log_weights;
+            std::vector<double> reference_log_likelihoods;
+            std::vector<double> reference_log_priors;
+            // The candidate was valid when its weight was computed, so
+            // this cannot fail; the tree must not be left at the current
+            // value with the likelihood of the candidate
+            const bool moved_to_new_value = this->set_target_value(tree, new_value);
+            ECOEVOLITY_NDEBUG_ASSERT(moved_to_new_value);
+            this->compute_log_weights(tree,
+                    references,
+                    reference_log_weights,
+                    reference_log_likelihoods,
+                    reference_log_priors,
+                    nthreads);
+            reference_log_weights.push_back(
+                    current_log_posterior + std::log(current_value));
+            const double log_reference_weight = log_sum_exp(reference_log_weights);
+
+            tree->compute_log_prior_density();
+            tree->set_log_likelihood_value(candidate_log_likelihoods.at(selected));
+            tree->make_clean();
+            const double new_log_posterior =
+                    candidate_log_likelihoods.at(selected) +
+                    candidate_log_priors.at(selected);
+            return (log_candidate_weight - log_reference_weight) -
+                    (new_log_posterior - current_log_posterior);
+        }
+};
+
+/**
+ * Multiple-try version of NodeHeightScaler.
+ */
+class NodeHeightMultipleTryScaler : public MultipleTryScaleOperator {
+
+    protected:
+        unsigned int height_index_ = 0;
+
+        void draw_target(RandomNumberGenerator& rng,
+                BasePopulationTree * tree) {
+            unsigned int num_heights = tree->get_number_of_node_heights();
+            this->height_index_ = rng.uniform_int(0, num_heights - 2);
+        }
+
+        double get_target_value(BasePopulationTree * tree) const {
+            return tree->get_height(this->height_index_);
+        }
+
+        bool set_target_value(BasePopulationTree * tree, double value) {
+            if ((value < tree->get_height_of_oldest_child(this->height_index_)) ||
+                    (value > tree->get_height_of_youngest_parent(this->height_index_))) {
+                return false;
+            }
+            tree->set_height(this->height_index_, value);
+            return true;
+        }
+
+    public:
+        NodeHeightMultipleTryScaler() : MultipleTryScaleOperator() { }
+        NodeHeightMultipleTryScaler(double weight) : MultipleTryScaleOperator(weight) { }
+        NodeHeightMultipleTryScaler(double weight, double tuning_parameter)
+            : MultipleTryScaleOperator(weight, tuning_parameter) { }
+
+        std::string get_name() const {
+            return "NodeHeightMultipleTryScaler";
+        }
+
+        std::string target_parameter() const {
+            return "node heights";
+        }
+
+        BaseGeneralTreeOperatorTemplate::OperatorTypeEnum get_type() const {
+            return BaseGeneralTreeOperatorTemplate::OperatorTypeEnum::node_height_operator;
+        }
+        BaseGeneralTreeOperatorTemplate::OperatorScopeEnum get_scope() const {
+            return BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::node_height;
+        }
+
+        bool is_operable(BasePopulationTree * tree) const {
+            unsigned int num_heights = tree->get_number_of_node_heights();
+            if (num_heights < 2) {
+                // No non-root heights to operate on
+                return false;
+            }
+            return true;
+        }
+
+        double get_default_coercable_parameter_value() const {
+            return 0.05;
+        }
+};
+
+/**
+ * Multiple-try version of PopSizeScaler.
+ */
+class PopSizeMultipleTryScaler : public MultipleTryScaleOperator {
+
+    protected:
+        unsigned int node_index_ = 0;
+
+        void draw_target(RandomNumberGenerator& rng,
+                BasePopulationTree * tree) {
+            this->node_index_ = rng.uniform_positive_int(
+                    tree->pre_ordered_nodes_.size() - 1);
+        }
+
+        double get_target_value(BasePopulationTree * tree) const {
+            return tree->pre_ordered_nodes_.at(
+                    this->node_index_)->get_population_size();
+        }
+
+        bool set_target_value(BasePopulationTree * tree, double value) {
+            if (value <= 0.0) {
+                return false;
+            }
+            tree->pre_ordered_nodes_.at(this->node_index_)->set_population_size(
+                    value);
+            return true;
+        }
+
+    public:
+        PopSizeMultipleTryScaler() : MultipleTryScaleOperator() { }
+        PopSizeMultipleTryScaler(double weight) : MultipleTryScaleOperator(weight) { }
+        PopSizeMultipleTryScaler(double weight, double tuning_parameter)
+            : MultipleTryScaleOperator(weight, tuning_parameter) { }
+
+        std::string get_name() const {
+            return "PopSizeMultipleTryScaler";
+        }
+
+        std::string target_parameter() const {
+            return "population sizes";
+        }
+
+        BaseGeneralTreeOperatorTemplate::OperatorTypeEnum get_type() const {
+            return BaseGeneralTreeOperatorTemplate::OperatorTypeEnum::derived_operator;
+        }
+        BaseGeneralTreeOperatorTemplate::OperatorScopeEnum get_scope() const {
+            return BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::branch;
+        }
+
+        bool is_operable(BasePopulationTree * tree) const {
+            if (tree->population_sizes_are_fixed()) {
+                return false;
+            }
+            return true;
+        }
+
+        double get_default_coercable_parameter_value() const {
+            return 0.1;
+        }
+};
+
 class MuRateScaler : public GeneralTreeOperatorInterface<BasePopulationTree, ScaleOp> {
 
     public:
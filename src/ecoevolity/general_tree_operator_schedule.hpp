@@ -25,6 +25,13 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <map>
+#include <algorithm>
+#include <chrono>
+
+#ifdef BUILD_WITH_THREADS
+#include <future>
+#endif
 
 #include "general_tree_operator.hpp"
 #include "rng.hpp"
@@ -38,6 +45,49 @@ class GeneralTreeOperatorSchedule {
         std::vector<double> cumulative_probs_;
         unsigned int default_auto_optimize_delay_ = 50;
 
+        // State of operator weight adaptation. For each operator, the number
+        // of calls, their wall time, and the summed squared jumps of each
+        // summary statistic of the tree (see get_summary_statistics).
+        bool adapting_weights_ = false;
+        double weight_adaptation_floor_ = 0.1;
+        std::vector<unsigned int> adaptation_calls_;
+        std::vector<double> adaptation_seconds_;
+        std::vector< std::vector<double> > adaptation_squared_jumps_;
+        std::vector<double> adaptation_efficiencies_;
+        std::vector<double> weights_before_adaptation_;
+        unsigned int number_of_summary_samples_ = 0;
+        std::vector<double> summary_means_;
+        std::vector<double> summary_sums_of_squares_;
+
+        void update_cumulative_probs() {
+            this->total_weight_ = 0.0;
+            for (auto op : this->operators_) {
+                this->total_weight_ += op->get_weight();
+            }
+            this->cumulative_probs_.assign(this->operators_.size(), 0.0);
+            if (this->operators_.empty()) {
+                return;
+            }
+            this->cumulative_probs_.at(0) = this->operators_.at(0)->get_weight() / this->total_weight_;
+            for (unsigned int i = 1; i < this->operators_.size(); ++i) {
+                this->cumulative_probs_.at(i) =
+                        (this->operators_.at(i)->get_weight() /
+                        this->total_weight_) + 
+                        this->cumulative_probs_.at(i - 1);
+            }
+        }
+
+        void add_summary_sample(const std::vector<double> & summary) {
+            // Welford's online update of the means and variances
+            ++this->number_of_summary_samples_;
+            for (unsigned int k = 0; k < summary.size(); ++k) {
+                double delta = summary.at(k) - this->summary_means_.at(k);
+                this->summary_means_.at(k) += delta / this->number_of_summary_samples_;
+                this->summary_sums_of_squares_.at(k) +=
+                        delta * (summary.at(k) - this->summary_means_.at(k));
+            }
+        }
+
     public:
         GeneralTreeOperatorSchedule() { }
         GeneralTreeOperatorSchedule(
@@ -65,27 +115,24 @@ class GeneralTreeOperatorSchedule {
 
         void add_operator(std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > o) {
             this->operators_.push_back(o);
-            this->total_weight_ += o->get_weight();
-            this->cumulative_probs_.push_back(0.0);
+            this->update_cumulative_probs();
             ECOEVOLITY_ASSERT(this->operators_.size() == this->cumulative_probs_.size());
-            this->cumulative_probs_.at(0) = this->operators_.at(0)->get_weight() / this->total_weight_;
-            for (unsigned int i = 1; i < this->operators_.size(); ++i) {
-                this->cumulative_probs_.at(i) =
-                        (this->operators_.at(i)->get_weight() /
-                        this->total_weight_) + 
-                        this->cumulative_probs_.at(i - 1);
-            }
         }
 
-        std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > draw_operator(
+        unsigned int draw_operator_index(
                 RandomNumberGenerator& rng) const {
             double u = rng.uniform_real();
             for (unsigned int i = 0; i < this->cumulative_probs_.size(); ++i) {
                 if (u <= this->cumulative_probs_.at(i)) {
-                    return this->operators_.at(i);
+                    return i;
                 }
             }
-            return this->operators_.back();
+            return this->operators_.size() - 1;
+        }
+
+        std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > draw_operator(
+                RandomNumberGenerator& rng) const {
+            return this->operators_.at(this->draw_operator_index(rng));
         }
 
         std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > get_operator(
@@ -260,6 +307,401 @@ class GeneralTreeOperatorSchedule {
             out << std::flush;
         }
 
+        void write_operator_costs(std::ostream& out) const {
+            double total_wall_time = 0.0;
+            for (auto op : this->operators_) {
+                total_wall_time += op->get_stats().get_wall_time();
+            }
+            out << OperatorStats::header_string();
+            for (auto op : this->operators_) {
+                out << op->get_stats().to_string(op->get_name(), total_wall_time);
+            }
+            out << std::flush;
+        }
+
+        void set_operator_trace(std::shared_ptr<OperatorTraceWriter> trace_writer) {
+            for (auto op : this->operators_) {
+                op->get_stats().set_trace_writer(trace_writer, op->get_name());
+            }
+        }
+
+        void set_early_rejection(bool rejecting_early) {
+            for (auto op : this->operators_) {
+                op->set_early_rejection(rejecting_early);
+            }
+        }
+
+        /**
+         * Perform up to `max_number_of_moves` moves (at least one), evaluating
+         * the likelihoods of consecutive proposals concurrently.
+         *
+         * Operators are drawn and their moves proposed in sequence from the
+         * current state; each proposed state is copied (see
+         * TreeType::get_likelihood_state) and the tree restored before the
+         * next proposal. The likelihoods of the copies are then computed in
+         * parallel (one thread per proposal), and the proposals are accepted
+         * or rejected in order. The first accepted proposal is re-proposed
+         * from a copy of the random number generator and the remaining
+         * proposals are discarded, so the chain, including its random number
+         * stream, is identical to that of perform_move with one likelihood
+         * thread.
+         *
+         * A batch ends before an operator with helpers, or an operator that
+         * is already in the batch (its tuning could depend on the outcome of
+         * its earlier move).
+         *
+         * Returns the number of moves performed.
+         */
+        unsigned int perform_speculative_moves(
+                RandomNumberGenerator& rng,
+                TreeType * tree,
+                unsigned int max_number_of_moves) {
+            typedef typename TreeType::LikelihoodState LikelihoodStateType;
+            struct Proposal {
+                std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > op;
+                RandomNumberGenerator rng_before_move;
+                RandomNumberGenerator rng_after_move;
+                double hastings_ratio;
+                bool computes_likelihood;
+                LikelihoodStateType likelihood_state;
+                double log_likelihood;
+                double log_prior;
+                double u;
+            };
+            ECOEVOLITY_ASSERT(max_number_of_moves > 0);
+            std::vector<Proposal> proposals;
+            proposals.reserve(max_number_of_moves);
+            // The cost of each proposal, from its move to its acceptance or
+            // rejection; a timer is paused while other proposals are made
+            // and evaluated
+            std::vector< std::unique_ptr<OperatorStatsTimer> > timers;
+            timers.reserve(max_number_of_moves);
+            std::vector< GeneralTreeOperatorTemplate<TreeType> * > used_ops;
+            while (proposals.size() < max_number_of_moves) {
+                RandomNumberGenerator rng_before_draw = rng;
+                std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > op =
+                        this->draw_operator(rng);
+                bool op_is_used = (std::find(used_ops.begin(), used_ops.end(),
+                        op.get()) != used_ops.end());
+                if ((! op->helper_ops.empty()) || op_is_used) {
+                    if (! proposals.empty()) {
+                        rng = rng_before_draw;
+                        break;
+                    }
+                    op->operate_with_helpers(rng, tree, 1, 1, 1);
+                    return 1;
+                }
+                used_ops.push_back(op.get());
+                timers.push_back(std::unique_ptr<OperatorStatsTimer>(
+                        new OperatorStatsTimer(op->get_stats(), *tree)));
+
+                Proposal p;
+                p.op = op;
+                p.rng_before_move = rng;
+                p.hastings_ratio = op->begin_move(rng, tree, 1);
+                p.computes_likelihood = false;
+                p.log_likelihood = tree->get_log_likelihood_value();
+                p.log_prior = 0.0;
+                p.u = 1.0;
+                // A proposal with a Hastings ratio of zero is rejected without
+                // a likelihood or a draw for acceptance, as in perform_move
+                if (p.hastings_ratio != -std::numeric_limits<double>::infinity()) {
+                    // Operators that compute the likelihood of their own
+                    // proposal (e.g., multiple-try operators) leave the tree
+                    // clean
+                    p.computes_likelihood = tree->is_dirty();
+                    if (p.computes_likelihood) {
+                        p.likelihood_state = tree->get_likelihood_state();
+                    }
+                    else {
+                        p.log_likelihood = tree->get_log_likelihood_value();
+                    }
+                    p.log_prior = tree->compute_log_prior_density();
+                }
+                op->call_restore_methods(tree);
+                tree->make_clean();
+                if (p.hastings_ratio != -std::numeric_limits<double>::infinity()) {
+                    p.u = rng.uniform_real();
+                }
+                p.rng_after_move = rng;
+                proposals.push_back(p);
+                timers.back()->pause();
+            }
+
+            std::vector<double> log_likelihoods(proposals.size());
+            for (unsigned int i = 0; i < proposals.size(); ++i) {
+                log_likelihoods.at(i) = proposals.at(i).log_likelihood;
+            }
+#ifdef BUILD_WITH_THREADS
+            // The likelihoods are computed at the same time, so the wall time
+            // of each is measured by its thread, and the rest of the cost is
+            // split evenly among them (the likelihood calls of a tree all
+            // evaluate the same patterns)
+            std::vector< std::chrono::steady_clock::duration > wall_times(
+                    proposals.size(),
+                    std::chrono::steady_clock::duration::zero());
+            const ModelCost cost_before = tree->get_model_cost();
+            const std::clock_t cpu_before = std::clock();
+            std::vector< std::future<double> > threads;
+            std::vector<unsigned int> thread_proposal_indices;
+            for (unsigned int i = 0; i < proposals.size(); ++i) {
+                if (! proposals.at(i).computes_likelihood) {
+                    continue;
+                }
+                const LikelihoodStateType * state = &proposals.at(i).likelihood_state;
+                std::chrono::steady_clock::duration * wall_time = &wall_times.at(i);
+                threads.push_back(std::async(
+                        std::launch::async,
+                        [tree, state, wall_time]() {
+                            std::chrono::steady_clock::time_point start =
+                                    std::chrono::steady_clock::now();
+                            double lnl = tree->compute_log_likelihood(*state, 1);
+                            *wall_time = std::chrono::steady_clock::now() - start;
+                            return lnl;
+                        }));
+                thread_proposal_indices.push_back(i);
+            }
+            for (unsigned int t = 0; t < threads.size(); ++t) {
+                log_likelihoods.at(thread_proposal_indices.at(t)) = threads.at(t).get();
+            }
+            if (! thread_proposal_indices.empty()) {
+                const unsigned int n = thread_proposal_indices.size();
+                ModelCost cost = tree->get_model_cost();
+                cost -= cost_before;
+                cost /= n;
+                double cpu_seconds = (double)(std::clock() - cpu_before) /
+                        CLOCKS_PER_SEC / n;
+                for (auto i : thread_proposal_indices) {
+                    timers.at(i)->add(wall_times.at(i), cpu_seconds, cost);
+                }
+            }
+#else
+            for (unsigned int i = 0; i < proposals.size(); ++i) {
+                if (proposals.at(i).computes_likelihood) {
+                    timers.at(i)->resume();
+                    log_likelihoods.at(i) = tree->compute_log_likelihood(
+                            proposals.at(i).likelihood_state, 1);
+                    timers.at(i)->pause();
+                }
+            }
+#endif
+
+            for (unsigned int i = 0; i < proposals.size(); ++i) {
+                Proposal & p = proposals.at(i);
+                OperatorStatsTimer & timer = *timers.at(i);
+                timer.resume();
+                if (p.hastings_ratio == -std::numeric_limits<double>::infinity()) {
+                    p.op->end_move(tree, p.hastings_ratio, false, true);
+                    timer.pause();
+                    continue;
+                }
+                double likelihood_ratio =
+                        log_likelihoods.at(i) -
+                        tree->get_log_likelihood_value();
+                double prior_ratio =
+                        p.log_prior -
+                        tree->get_log_prior_density_value();
+                double acceptance_probability =
+                        likelihood_ratio +
+                        prior_ratio +
+                        p.hastings_ratio;
+                if (p.u < std::exp(acceptance_probability)) {
+                    rng = p.rng_before_move;
+                    double hastings_ratio = p.op->begin_move(rng, tree, 1);
+                    ECOEVOLITY_ASSERT(hastings_ratio == p.hastings_ratio);
+                    if (p.computes_likelihood) {
+                        tree->set_log_likelihood_value(log_likelihoods.at(i));
+                    }
+                    tree->compute_log_prior_density();
+                    p.op->end_move(tree, acceptance_probability, true);
+                    rng = p.rng_after_move;
+                    // The later proposals were made from the state before
+                    // this move, so they never happened
+                    for (unsigned int j = i + 1; j < proposals.size(); ++j) {
+                        proposals.at(j).op->discard_move();
+                    }
+                    return i + 1;
+                }
+                p.op->end_move(tree, acceptance_probability, false, true);
+                timer.pause();
+            }
+            return proposals.size();
+        }
+
+        /**
+         * Summary statistics of the state of the tree used to measure how
+         * far each operator moves the chain: root height, tree length, number
+         * of node heights, and log likelihood.
+         */
+        static std::vector<double> get_summary_statistics(const TreeType & tree) {
+            return {
+                tree.get_root_height(),
+                tree.get_tree_length(),
+                (double)tree.get_number_of_node_heights(),
+                tree.get_log_likelihood_value()
+            };
+        }
+
+        /**
+         * Start measuring the efficiency of each operator. Until
+         * stop_weight_adaptation is called, moves should be made with
+         * perform_weight_adaptation_move.
+         */
+        void start_weight_adaptation() {
+            const unsigned int n = this->operators_.size();
+            this->adapting_weights_ = true;
+            this->adaptation_calls_.assign(n, 0);
+            this->adaptation_seconds_.assign(n, 0.0);
+            this->adaptation_squared_jumps_.assign(n, std::vector<double>(4, 0.0));
+            this->adaptation_efficiencies_.assign(n, 0.0);
+            this->weights_before_adaptation_.clear();
+            for (auto op : this->operators_) {
+                this->weights_before_adaptation_.push_back(op->get_weight());
+            }
+            this->number_of_summary_samples_ = 0;
+            this->summary_means_.assign(4, 0.0);
+            this->summary_sums_of_squares_.assign(4, 0.0);
+        }
+
+        bool adapting_weights() const {
+            return this->adapting_weights_;
+        }
+
+        /**
+         * The minimum proportion of each operator's original weight within
+         * its scope that is retained when weights are adapted.
+         */
+        void set_weight_adaptation_floor(double floor) {
+            ECOEVOLITY_ASSERT((floor >= 0.0) && (floor <= 1.0));
+            this->weight_adaptation_floor_ = floor;
+        }
+
+        /**
+         * Draw an operator and call it (with its helpers), recording its run
+         * time and the squared jumps it makes in the summary statistics of
+         * the tree.
+         */
+        void perform_weight_adaptation_move(
+                RandomNumberGenerator& rng,
+                TreeType * tree,
+                unsigned int nthreads = 1) {
+            ECOEVOLITY_ASSERT(this->adapting_weights_);
+            unsigned int op_index = this->draw_operator_index(rng);
+            std::vector<double> before = get_summary_statistics(*tree);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            this->operators_.at(op_index)->operate_with_helpers(rng, tree, nthreads, 1, 1);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            std::vector<double> after = get_summary_statistics(*tree);
+
+            ++this->adaptation_calls_.at(op_index);
+            this->adaptation_seconds_.at(op_index) +=
+                    std::chrono::duration<double>(end - start).count();
+            for (unsigned int k = 0; k < after.size(); ++k) {
+                double jump = after.at(k) - before.at(k);
+                this->adaptation_squared_jumps_.at(op_index).at(k) += jump * jump;
+            }
+            this->add_summary_sample(after);
+        }
+
+        /**
+         * Reweight the operators to favor those that make the largest
+         * standardized squared jumps in the summary statistics per second of
+         * run time, and freeze the weights.
+         *
+         * The expected squared jump of a statistic is 2 * variance * (1 -
+         * lag-1 autocorrelation), so this favors the operators that most
+         * quickly reduce autocorrelation per unit of computation. Weight is
+         * only moved between operators of the same scope (e.g., among the
+         * topology operators), so the share of moves devoted to each part of
+         * the model is unchanged, and every operator keeps at least the
+         * floor proportion of its original weight. The weights of a scope are
+         * left unchanged if any of its operators was called fewer than
+         * `min_calls` times.
+         */
+        void stop_weight_adaptation(unsigned int min_calls = 10) {
+            ECOEVOLITY_ASSERT(this->adapting_weights_);
+            this->adapting_weights_ = false;
+            const unsigned int n = this->operators_.size();
+            for (unsigned int i = 0; i < n; ++i) {
+                this->adaptation_efficiencies_.at(i) = 0.0;
+                if (this->adaptation_seconds_.at(i) <= 0.0) {
+                    continue;
+                }
+                double standardized_jumps = 0.0;
+                for (unsigned int k = 0; k < this->summary_means_.size(); ++k) {
+                    if (this->number_of_summary_samples_ < 2) {
+                        break;
+                    }
+                    double variance = this->summary_sums_of_squares_.at(k) /
+                            (this->number_of_summary_samples_ - 1);
+                    if (variance > 0.0) {
+                        standardized_jumps += this->adaptation_squared_jumps_.at(i).at(k) / variance;
+                    }
+                }
+                this->adaptation_efficiencies_.at(i) =
+                        standardized_jumps / this->adaptation_seconds_.at(i);
+            }
+
+            std::map<BaseGeneralTreeOperatorTemplate::OperatorScopeEnum,
+                    std::vector<unsigned int> > scopes;
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->operators_.at(i)->get_weight() > 0.0) {
+                    scopes[this->operators_.at(i)->get_scope()].push_back(i);
+                }
+            }
+            for (auto const & scope : scopes) {
+                double scope_weight = 0.0;
+                double scope_efficiency = 0.0;
+                bool enough_calls = true;
+                for (unsigned int i : scope.second) {
+                    scope_weight += this->operators_.at(i)->get_weight();
+                    scope_efficiency += this->adaptation_efficiencies_.at(i);
+                    if (this->adaptation_calls_.at(i) < min_calls) {
+                        enough_calls = false;
+                    }
+                }
+                if ((! enough_calls) || (scope_efficiency <= 0.0)) {
+                    continue;
+                }
+                for (unsigned int i : scope.second) {
+                    double original_prop = this->operators_.at(i)->get_weight() / scope_weight;
+                    double efficient_prop = this->adaptation_efficiencies_.at(i) / scope_efficiency;
+                    this->operators_.at(i)->set_weight(scope_weight * (
+                            (this->weight_adaptation_floor_ * original_prop) +
+                            ((1.0 - this->weight_adaptation_floor_) * efficient_prop)));
+                }
+            }
+            this->update_cumulative_probs();
+        }
+
+        /**
+         * Write a tab-delimited table of the calls, mean run time, efficiency,
+         * and weights (before and after) of each operator during weight
+         * adaptation.
+         *
+         * The chain is only a fixed mixture of kernels after the weights are
+         * frozen, so samples drawn up to that generation must be discarded
+         * as burn-in; the burn-in is chosen when summarizing the samples, so
+         * it is up to the caller to report this (see mcmc).
+         */
+        void write_weight_adaptation_summary(std::ostream& out) const {
+            out << "name\tnumber_of_calls\tmean_wall_time\tefficiency\tweight_before\tweight_after\n";
+            for (unsigned int i = 0; i < this->adaptation_calls_.size(); ++i) {
+                out << this->operators_.at(i)->get_name() << "\t"
+                    << this->adaptation_calls_.at(i) << "\t";
+                if (this->adaptation_calls_.at(i) > 0) {
+                    out << this->adaptation_seconds_.at(i) / this->adaptation_calls_.at(i) << "\t";
+                }
+                else {
+                    out << "nan\t";
+                }
+                out << this->adaptation_efficiencies_.at(i) << "\t"
+                    << this->weights_before_adaptation_.at(i) << "\t"
+                    << this->operators_.at(i)->get_weight() << "\n";
+            }
+            out << std::flush;
+        }
+
         std::set<std::string> write_op_settings(
                 std::ostream & out,
                 const unsigned int indent_level = 0) const {
@@ -457,7 +899,8 @@ class GeneralTreeOperatorSchedule {
                         op_settings.auto_optimizing(i),
                         op_settings.get_auto_optimize_delay(i),
                         op_settings.get_number_of_operators(),
-                        number_of_leaves);
+                        number_of_leaves,
+                        op_settings.get_number_of_tries(i));
             }
         }
 
@@ -468,7 +911,8 @@ class GeneralTreeOperatorSchedule {
                 bool auto_optimize,
                 int auto_optimize_delay,
                 unsigned int operator_count,
-                unsigned int number_of_leaves) {
+                unsigned int number_of_leaves,
+                int number_of_tries = -1) {
             if (weight == 0.0) {
                 return;
             }
@@ -488,6 +932,11 @@ class GeneralTreeOperatorSchedule {
                                  NodeHeightScaler<TreeType>
                                       >();
             }
+            else if (op_name == "NodeHeightMultipleTryScaler") {
+                op = std::make_shared<
+                                 NodeHeightMultipleTryScaler
+                                      >();
+            }
             else if (op_name == "NodeHeightMover") {
                 op = std::make_shared<
                                  NodeHeightMover<TreeType>
@@ -563,6 +1012,11 @@ class GeneralTreeOperatorSchedule {
                                  PopSizeScaler
                                       >();
             }
+            else if (op_name == "PopSizeMultipleTryScaler") {
+                op = std::make_shared<
+                                 PopSizeMultipleTryScaler
+                                      >();
+            }
             else if (op_name == "GlobalHeightSizeMixer") {
                 op = std::make_shared<
                                  GlobalHeightSizeMixer
@@ -644,6 +1098,10 @@ class GeneralTreeOperatorSchedule {
                 op->set_auto_optimize_delay(auto_optimize_delay);
             }
 
+            if (number_of_tries > 0) {
+                op->set_number_of_tries(number_of_tries);
+            }
+
             ECOEVOLITY_ASSERT(op->get_weight() > 0.0);
 
             this->add_operator(op);
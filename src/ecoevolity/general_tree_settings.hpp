@@ -288,6 +288,8 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
         std::vector<double> tuning_parameters_;
         std::vector<bool> auto_optimize_bools_;
         std::vector<int> auto_optimize_delays_;
+        // Only used by multiple-try operators; empty if not specified
+        std::vector<int> numbers_of_tries_;
 
     public:
         GeneralTreeTunableOperatorSettings() : GeneralTreeOperatorSettings() { }
@@ -350,6 +352,7 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             this->tuning_parameters_ = other.tuning_parameters_;
             this->auto_optimize_bools_ = other.auto_optimize_bools_;
             this->auto_optimize_delays_ = other.auto_optimize_delays_;
+            this->numbers_of_tries_ = other.numbers_of_tries_;
         }
         virtual ~GeneralTreeTunableOperatorSettings() { }
         GeneralTreeTunableOperatorSettings& operator=(const GeneralTreeTunableOperatorSettings& other) {
@@ -357,6 +360,7 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             this->tuning_parameters_ = other.tuning_parameters_;
             this->auto_optimize_bools_ = other.auto_optimize_bools_;
             this->auto_optimize_delays_ = other.auto_optimize_delays_;
+            this->numbers_of_tries_ = other.numbers_of_tries_;
             return * this;
         }
 
@@ -388,6 +392,7 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             this->tuning_parameters_.clear();
             this->auto_optimize_bools_.clear();
             this->auto_optimize_delays_.clear();
+            this->numbers_of_tries_.clear();
         }
         void turn_off() {
             this->clear();
@@ -411,6 +416,27 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             return this->auto_optimize_delays_;
         }
 
+        /**
+         * Number of candidate states per move of a multiple-try operator;
+         * -1 if the default of the operator should be used.
+         */
+        int get_number_of_tries(unsigned int index) const {
+            if (this->numbers_of_tries_.empty()) {
+                return -1;
+            }
+            return this->numbers_of_tries_.at(index);
+        }
+        const std::vector<int> & get_numbers_of_tries() const {
+            return this->numbers_of_tries_;
+        }
+        void set_numbers_of_tries(const std::vector<int> & numbers_of_tries) {
+            if ((! numbers_of_tries.empty()) &&
+                    (numbers_of_tries.size() != this->weights_.size())) {
+                throw EcoevolityError("Number of numbers of tries does not equal number of weights");
+            }
+            this->numbers_of_tries_ = numbers_of_tries;
+        }
+
         bool auto_optimizing(unsigned int index) const {
             return this->auto_optimize_bools_.at(index);
         }
@@ -431,6 +457,7 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             std::vector<double> tuning_parameters;
             std::vector<int> opt_delays;
             std::vector<bool> auto_opt_bools;
+            std::vector<int> numbers_of_tries;
 
             std::unordered_set<std::string> keys;
             for (YAML::const_iterator p = operator_node.begin();
@@ -530,6 +557,29 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
                         throw EcoevolityYamlConfigError("Operator auto_optimize_delay node is not a scalar or sequence");
                     }
                 }
+                else if (p->first.as<std::string>() == "number_of_tries") {
+                    if (p->second.IsScalar()) {
+                        int n_tries = p->second.as<int>();
+                        if (n_tries < 2) {
+                            throw EcoevolityYamlConfigError("number_of_tries must be at least 2");
+                        }
+                        numbers_of_tries.push_back(n_tries);
+                    }
+                    else if (p->second.IsSequence()) {
+                        for (YAML::const_iterator tries_node = p->second.begin();
+                                tries_node != p->second.end();
+                                ++tries_node) {
+                            int n = tries_node->as<int>();
+                            if (n < 2) {
+                                throw EcoevolityYamlConfigError("number_of_tries must be at least 2");
+                            }
+                            numbers_of_tries.push_back(n);
+                        }
+                    }
+                    else {
+                        throw EcoevolityYamlConfigError("Operator number_of_tries node is not a scalar or sequence");
+                    }
+                }
                 else {
                     std::string message = (
                             "Unrecognized key in operator parameters: " +
@@ -542,7 +592,8 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
                     weights.size(),
                     tuning_parameters.size(),
                     opt_delays.size(),
-                    auto_opt_bools.size()};
+                    auto_opt_bools.size(),
+                    numbers_of_tries.size()};
             size_t n_ops = *std::max_element(std::begin(n_ops_vector), std::end(n_ops_vector));
             if (n_ops < 1) {
                 throw EcoevolityYamlConfigError("operator listed with no options");
@@ -569,6 +620,7 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
             }
 
             this->init(weights, tuning_parameters, auto_opt_bools, opt_delays);
+            this->set_numbers_of_tries(numbers_of_tries);
         }
 
         std::string to_string(unsigned int indent_level = 0) const {
@@ -627,6 +679,19 @@ class GeneralTreeTunableOperatorSettings : public GeneralTreeOperatorSettings {
                     ss << "]\n";
                 }
             }
+            if (! this->numbers_of_tries_.empty()) {
+                ss << margin << "number_of_tries: ";
+                if (this->numbers_of_tries_.size() == 1) {
+                    ss << this->numbers_of_tries_.at(0) << "\n";
+                }
+                else {
+                    ss << "[" << this->numbers_of_tries_.at(0);
+                    for (unsigned int i = 1; i < this->numbers_of_tries_.size(); ++i) {
+                        ss << ", " << this->numbers_of_tries_.at(i);
+                    }
+                    ss << "]\n";
+                }
+            }
             return ss.str();
         }
 };
@@ -649,6 +714,7 @@ class GeneralTreeOperatorSettingsCollection {
             {"SplitLumpNodesRevJumpSampler",        GeneralTreeTunableOperatorSettings()},
             {"TreeScaler",                          GeneralTreeTunableOperatorSettings()},
             {"NodeHeightScaler",                    GeneralTreeTunableOperatorSettings()},
+            {"NodeHeightMultipleTryScaler",         GeneralTreeTunableOperatorSettings()},
             {"NodeHeightMover",                     GeneralTreeTunableOperatorSettings()},
             {"NodeHeightSlideBumpScaler",           GeneralTreeTunableOperatorSettings()},
             {"NodeHeightSlideBumpPermuteScaler",    GeneralTreeTunableOperatorSettings()},
@@ -778,6 +844,7 @@ class PopulationTreeOperatorSettingsCollection : public GeneralTreeOperatorSetti
             this->tunable_operators["MuRateScaler"]                = GeneralTreeTunableOperatorSettings();
             this->tunable_operators["GlobalPopSizeScaler"]         = GeneralTreeTunableOperatorSettings();
             this->tunable_operators["PopSizeScaler"]               = GeneralTreeTunableOperatorSettings();
+            this->tunable_operators["PopSizeMultipleTryScaler"]    = GeneralTreeTunableOperatorSettings();
             this->tunable_operators["GlobalHeightSizeMixer"]       = GeneralTreeTunableOperatorSettings();
             this->tunable_operators["HeightSizeMixer"]             = GeneralTreeTunableOperatorSettings();
             this->tunable_operators["HeightSizeSlideBumpMixer"]    = GeneralTreeTunableOperatorSettings();
@@ -1251,6 +1318,8 @@ class TreeModelSettings {
 class PopSizeSettings : public PositiveRealParameterSettings {
     protected:
         bool population_sizes_are_constrained_ = true;
+        bool population_sizes_are_integrated_ = false;
+        unsigned int number_of_categories_ = 4;
 
     public:
         PopSizeSettings() { }
@@ -1260,10 +1329,39 @@ class PopSizeSettings : public PositiveRealParameterSettings {
                 this->population_sizes_are_constrained_ = n["equal_population_sizes"].as<bool>();
                 n.remove("equal_population_sizes");
             }
+            if (n["integrate"]) {
+                this->population_sizes_are_integrated_ = n["integrate"].as<bool>();
+                n.remove("integrate");
+            }
+            if (n["number_of_categories"]) {
+                int ncats = n["number_of_categories"].as<int>();
+                if (ncats < 1) {
+                    throw EcoevolityYamlConfigError(
+                            "population_size number_of_categories must be positive");
+                }
+                this->number_of_categories_ = ncats;
+                n.remove("number_of_categories");
+            }
             this->init_from_yaml_node(n);
+            if (this->population_sizes_are_integrated_) {
+                const std::string & prior_name = this->prior_settings_.get_name();
+                if ((prior_name != "gamma_distribution") &&
+                        (prior_name != "exponential_distribution")) {
+                    throw EcoevolityYamlConfigError(
+                            "population sizes can only be integrated over a "
+                            "gamma or exponential prior");
+                }
+                if (this->prior_settings_.get_instance()->get_min() != 0.0) {
+                    throw EcoevolityYamlConfigError(
+                            "population sizes cannot be integrated over a "
+                            "prior with an offset");
+                }
+            }
         }
         PopSizeSettings(const PopSizeSettings & other) : PositiveRealParameterSettings(other) {
             this->population_sizes_are_constrained_ = other.population_sizes_are_constrained_;
+            this->population_sizes_are_integrated_ = other.population_sizes_are_integrated_;
+            this->number_of_categories_ = other.number_of_categories_;
         }
         PopSizeSettings& operator=(const PopSizeSettings& other) {
             this->value_ = other.value_;
@@ -1273,6 +1371,8 @@ class PopSizeSettings : public PositiveRealParameterSettings {
             this->use_empirical_value_ = other.use_empirical_value_;
             this->prior_settings_ = other.prior_settings_;
             this->population_sizes_are_constrained_ = other.population_sizes_are_constrained_;
+            this->population_sizes_are_integrated_ = other.population_sizes_are_integrated_;
+            this->number_of_categories_ = other.number_of_categories_;
             return * this;
         }
         bool population_sizes_are_constrained() const {
@@ -1281,6 +1381,12 @@ class PopSizeSettings : public PositiveRealParameterSettings {
         void set_population_sizes_are_constrained(bool b) {
             this->population_sizes_are_constrained_ = b;
         }
+        bool population_sizes_are_integrated() const {
+            return this->population_sizes_are_integrated_;
+        }
+        unsigned int get_number_of_categories() const {
+            return this->number_of_categories_;
+        }
         virtual std::string to_string(unsigned int indent_level = 0) const {
             std::ostringstream ss;
             ss << std::boolalpha;
@@ -1291,6 +1397,13 @@ class PopSizeSettings : public PositiveRealParameterSettings {
             else {
                 ss << margin << "equal_population_sizes: false\n";
             }
+            if (this->population_sizes_are_integrated_) {
+                ss << margin << "integrate: true\n";
+                ss << margin << "number_of_categories: " << this->number_of_categories_ << "\n";
+                ss << margin << "prior:\n";
+                ss << this->prior_settings_.to_string(indent_level + 1);
+                return ss.str();
+            }
             if (this->is_vector_) {
                 if (this->values_.size() > 0) {
                     ss << margin << "value: [" << this->values_.at(0);
@@ -1581,6 +1694,7 @@ class PopulationTreeSettings {
             this->config_path_ = other.config_path_;
             this->chain_length_ = other.chain_length_;
             this->sample_frequency_ = other.sample_frequency_;
+            this->operator_weight_adaptation_generations_ = other.operator_weight_adaptation_generations_;
             this->tree_log_path_ = other.tree_log_path_;
             this->state_log_path_ = other.state_log_path_;
             this->operator_log_path_ = other.operator_log_path_;
@@ -1596,6 +1710,7 @@ class PopulationTreeSettings {
             this->config_path_ = other.config_path_;
             this->chain_length_ = other.chain_length_;
             this->sample_frequency_ = other.sample_frequency_;
+            this->operator_weight_adaptation_generations_ = other.operator_weight_adaptation_generations_;
             this->tree_log_path_ = other.tree_log_path_;
             this->state_log_path_ = other.state_log_path_;
             this->operator_log_path_ = other.operator_log_path_;
@@ -1656,6 +1771,9 @@ class PopulationTreeSettings {
         double get_sample_frequency() const {
             return this->sample_frequency_;
         }
+        unsigned int get_operator_weight_adaptation_generations() const {
+            return this->operator_weight_adaptation_generations_;
+        }
         bool constrain_state_frequencies() const {
             return ((this->freq_1_settings.is_fixed()) &&
                     (this->freq_1_settings.get_value() == 0.5));
@@ -1673,7 +1791,9 @@ class PopulationTreeSettings {
             }
 
             const bool root_height_is_fixed = tree_model_settings.tree_prior->root_height_is_fixed();
-            const bool pop_sizes_fixed = population_size_settings.is_fixed();
+            // Integrated population sizes are fixed in the tree
+            const bool pop_sizes_fixed = (population_size_settings.is_fixed() ||
+                    population_size_settings.population_sizes_are_integrated());
             const bool pop_sizes_constrained = population_size_settings.population_sizes_are_constrained();
 
             if (root_height_is_fixed || pop_sizes_constrained || pop_sizes_fixed) {
@@ -1689,6 +1809,7 @@ class PopulationTreeSettings {
             if (pop_sizes_fixed) {
                 this->operator_settings->tunable_operators.at("GlobalPopSizeScaler").turn_off();
                 this->operator_settings->tunable_operators.at("PopSizeScaler").turn_off();
+                this->operator_settings->tunable_operators.at("PopSizeMultipleTryScaler").turn_off();
             }
 
             if (pop_sizes_constrained && (! pop_sizes_fixed)) {
@@ -1738,8 +1859,12 @@ class PopulationTreeSettings {
                 << this->freq_1_settings.to_string(2)
                 << "mcmc_settings:\n"
                 << indent << "chain_length: " << this->get_chain_length() << "\n"
-                << indent << "sample_frequency: " << this->get_sample_frequency() << "\n"
-                << indent << "operators:\n"
+                << indent << "sample_frequency: " << this->get_sample_frequency() << "\n";
+            if (this->get_operator_weight_adaptation_generations() > 0) {
+                out << indent << "operator_weight_adaptation_generations: "
+                    << this->get_operator_weight_adaptation_generations() << "\n";
+            }
+            out << indent << "operators:\n"
                 << this->operator_settings->to_string(2);
         }
 
@@ -1753,6 +1878,7 @@ class PopulationTreeSettings {
         std::string config_path_ = "";
         unsigned int chain_length_ = 100000;
         unsigned int sample_frequency_ = 100;
+        unsigned int operator_weight_adaptation_generations_ = 0;
         std::string tree_log_path_ = "phycoeval-trees-run-1.nex";
         std::string state_log_path_ = "phycoeval-state-run-1.log";
         std::string operator_log_path_ = "phycoeval-operator-run-1.log";
@@ -1962,6 +2088,9 @@ class PopulationTreeSettings {
                 else if (mcmc->first.as<std::string>() == "sample_frequency") {
                     this->sample_frequency_ = mcmc->second.as<unsigned int>();
                 }
+                else if (mcmc->first.as<std::string>() == "operator_weight_adaptation_generations") {
+                    this->operator_weight_adaptation_generations_ = mcmc->second.as<unsigned int>();
+                }
                 // parse operator settings
                 else if (mcmc->first.as<std::string>() == "operators") {
                     this->operator_settings->update_from_config(mcmc->second);
@@ -1972,6 +2101,12 @@ class PopulationTreeSettings {
                             mcmc->first.as<std::string>());
                 }
             }
+            if ((this->operator_weight_adaptation_generations_ > 0) &&
+                    (this->operator_weight_adaptation_generations_ >= this->chain_length_)) {
+                throw EcoevolityYamlConfigError(
+                        "operator_weight_adaptation_generations must be less "
+                        "than chain_length");
+            }
         }
 
         virtual void update_settings_contingent_upon_data() {
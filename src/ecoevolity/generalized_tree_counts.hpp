@@ -0,0 +1,554 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_GENERALIZED_TREE_COUNTS_HPP
+#define ECOEVOLITY_GENERALIZED_TREE_COUNTS_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "rng.hpp"
+
+
+/**
+ * A tree built from the leaves to the root as a sequence of events.
+ *
+ * Each event is a vector of groups of lineages that coalesce at a shared
+ * height, and each group is a vector of the indices of the lineages that are
+ * the children of the new node. The leaves are lineages 0 to n-1, and the new
+ * nodes get the indices n, n+1, ... in the order of the events and of the
+ * groups within them. The last event has a single group, the root.
+ */
+typedef std::vector< std::vector< std::vector<unsigned int> > > TreeEventSequence;
+
+
+/**
+ * Counts of generalized trees (rooted trees with labeled leaves and
+ * polytomies, in which internal nodes can share heights), and exact draws
+ * from the uniform distribution over them.
+ *
+ * A generalized tree can be built by more than one sequence of events,
+ * because events that do not depend on each other can happen in either
+ * order. So, each tree is counted once, by its Foata normal form: the events
+ * are grouped into levels, and every event in a level uses at least one
+ * lineage created in the previous level. Then, the number of ways to finish a
+ * tree only depends on the number of lineages created in the last level
+ * ("new" lineages) and the number of other lineages ("old" lineages).
+ *
+ * These counts are tabulated once, in O(n^5) time for n leaves, after which
+ * trees are drawn one level at a time. The counts are stored as long doubles,
+ * which hold them for several hundred leaves.
+ */
+class GeneralizedTreeCounts {
+    protected:
+        unsigned int number_of_leaves_;
+
+        // C(n, k)
+        std::vector< std::vector<long double> > choose_;
+        // Stirling numbers of the second kind, S(n, k)
+        std::vector< std::vector<long double> > stirling2_;
+        // Number of partitions of n elements into k subsets, each with at
+        // least 2 elements
+        std::vector< std::vector<long double> > pair_stirling2_;
+        // Number of partitions of a new and y old lineages into h groups,
+        // each with at least 2 lineages and at least 1 new lineage;
+        // indexed [a][y][h]
+        std::vector< std::vector< std::vector<long double> > > new_group_counts_;
+        // Number of ways to assign h groups with new lineages and o groups
+        // without to events, so that every event has at least one group
+        // with a new lineage; indexed [h][o]
+        std::vector< std::vector<long double> > event_counts_;
+        // Number of ways a new and b old lineages can all be used by the
+        // events of one level, creating g nodes; indexed [a][b][g]
+        std::vector< std::vector< std::vector<long double> > > level_counts_;
+        // Number of ways to finish a tree from r old and m new lineages;
+        // indexed [r][m]
+        std::vector< std::vector<long double> > completion_counts_;
+
+        void tabulate_() {
+            const unsigned int n = this->number_of_leaves_;
+
+            this->choose_.assign(n + 1, std::vector<long double>(n + 1, 0.0));
+            this->stirling2_.assign(n + 1, std::vector<long double>(n + 1, 0.0));
+            this->pair_stirling2_.assign(n + 1, std::vector<long double>(n + 1, 0.0));
+            for (unsigned int i = 0; i <= n; ++i) {
+                this->choose_.at(i).at(0) = 1.0;
+                for (unsigned int k = 1; k <= i; ++k) {
+                    this->choose_.at(i).at(k) = this->choose_.at(i - 1).at(k - 1) +
+                            this->choose_.at(i - 1).at(k);
+                }
+            }
+            this->stirling2_.at(0).at(0) = 1.0;
+            this->pair_stirling2_.at(0).at(0) = 1.0;
+            for (unsigned int i = 1; i <= n; ++i) {
+                for (unsigned int k = 1; k <= i; ++k) {
+                    this->stirling2_.at(i).at(k) =
+                            (k * this->stirling2_.at(i - 1).at(k)) +
+                            this->stirling2_.at(i - 1).at(k - 1);
+                    long double p = k * this->pair_stirling2_.at(i - 1).at(k);
+                    if (i > 1) {
+                        p += (i - 1) * this->pair_stirling2_.at(i - 2).at(k - 1);
+                    }
+                    this->pair_stirling2_.at(i).at(k) = p;
+                }
+            }
+
+            // Groups with new lineages. An old lineage is either in a group
+            // of 3 or more (removing it leaves a valid partition), or paired
+            // with a new lineage.
+            this->new_group_counts_.resize(n + 1);
+            for (unsigned int a = 0; a <= n; ++a) {
+                this->new_group_counts_.at(a).resize(n - a + 1);
+                for (unsigned int y = 0; y <= (n - a); ++y) {
+                    std::vector<long double> & counts = this->new_group_counts_.at(a).at(y);
+                    counts.assign(((a + y) / 2) + 1, 0.0);
+                    for (unsigned int h = 0; h < counts.size(); ++h) {
+                        if (y == 0) {
+                            counts.at(h) = this->pair_stirling2_.at(a).at(h);
+                            continue;
+                        }
+                        long double c = h * this->get_new_group_count_(a, y - 1, h);
+                        if ((a > 0) && (h > 0)) {
+                            c += a * this->get_new_group_count_(a - 1, y - 1, h - 1);
+                        }
+                        counts.at(h) = c;
+                    }
+                }
+            }
+
+            // Groups with new lineages are partitioned into events, and each
+            // group without new lineages joins one of the events
+            this->event_counts_.assign(n + 1, std::vector<long double>(n + 1, 0.0));
+            for (unsigned int h = 1; h <= n; ++h) {
+                for (unsigned int o = 0; (h + o) <= n; ++o) {
+                    long double c = 0.0;
+                    for (unsigned int e = 1; e <= h; ++e) {
+                        c += this->stirling2_.at(h).at(e) * std::pow((long double)e, (int)o);
+                    }
+                    this->event_counts_.at(h).at(o) = c;
+                }
+            }
+
+            this->level_counts_.resize(n + 1);
+            for (unsigned int a = 0; a <= n; ++a) {
+                this->level_counts_.at(a).resize(n - a + 1);
+                for (unsigned int b = 0; b <= (n - a); ++b) {
+                    std::vector<long double> & counts = this->level_counts_.at(a).at(b);
+                    counts.assign(((a + b) / 2) + 1, 0.0);
+                    if (a < 1) {
+                        continue;
+                    }
+                    for (unsigned int g = 1; g < counts.size(); ++g) {
+                        long double c = 0.0;
+                        for (unsigned int h = 1; h <= g; ++h) {
+                            for (unsigned int x = 0; x <= b; ++x) {
+                                c += this->get_level_structure_count_(a, b, g, h, x);
+                            }
+                        }
+                        counts.at(g) = c;
+                    }
+                }
+            }
+
+            this->completion_counts_.assign(n + 1, std::vector<long double>(n + 1, 0.0));
+            this->completion_counts_.at(0).at(1) = 1.0;
+            this->completion_counts_.at(1).at(0) = 1.0;
+            for (unsigned int k = 2; k <= n; ++k) {
+                for (unsigned int m = 1; m <= k; ++m) {
+                    unsigned int r = k - m;
+                    long double c = 0.0;
+                    for (unsigned int a = 1; a <= m; ++a) {
+                        for (unsigned int b = 0; b <= r; ++b) {
+                            for (unsigned int g = 1; (2 * g) <= (a + b); ++g) {
+                                c += this->get_level_weight_(r, m, a, b, g);
+                            }
+                        }
+                    }
+                    if (! std::isfinite(c)) {
+                        throw EcoevolityNumericLimitError(
+                                "GeneralizedTreeCounts: the number of trees "
+                                "overflows for this many leaves");
+                    }
+                    this->completion_counts_.at(r).at(m) = c;
+                }
+            }
+        }
+
+        long double get_new_group_count_(unsigned int a, unsigned int y,
+                unsigned int h) const {
+            const std::vector<long double> & counts = this->new_group_counts_.at(a).at(y);
+            if (h >= counts.size()) {
+                return 0.0;
+            }
+            return counts.at(h);
+        }
+
+        long double get_level_count_(unsigned int a, unsigned int b,
+                unsigned int g) const {
+            const std::vector<long double> & counts = this->level_counts_.at(a).at(b);
+            if (g >= counts.size()) {
+                return 0.0;
+            }
+            return counts.at(g);
+        }
+
+        /**
+         * Number of ways a new and b old lineages can all be used by the
+         * events of a level with h groups that include new lineages, and
+         * g - h groups made of x of the old lineages.
+         */
+        long double get_level_structure_count_(unsigned int a, unsigned int b,
+                unsigned int g, unsigned int h, unsigned int x) const {
+            const unsigned int o = g - h;
+            if ((2 * o) > x) {
+                return 0.0;
+            }
+            return this->choose_.at(b).at(x) *
+                    this->pair_stirling2_.at(x).at(o) *
+                    this->get_new_group_count_(a, b - x, h) *
+                    this->event_counts_.at(h).at(o);
+        }
+
+        /**
+         * Number of trees that can be finished from r old and m new lineages
+         * when the next level uses a of the new and b of the old lineages to
+         * create g nodes.
+         */
+        long double get_level_weight_(unsigned int r, unsigned int m,
+                unsigned int a, unsigned int b, unsigned int g) const {
+            return this->choose_.at(m).at(a) *
+                    this->choose_.at(r).at(b) *
+                    this->get_level_count_(a, b, g) *
+                    this->completion_counts_.at(r - b + m - a).at(g);
+        }
+
+        unsigned int draw_index_(RandomNumberGenerator & rng,
+                const std::vector<long double> & weights) const {
+            long double total = 0.0;
+            for (auto w : weights) {
+                total += w;
+            }
+            ECOEVOLITY_ASSERT(total > 0.0);
+            long double u = rng.uniform_real() * total;
+            for (unsigned int i = 0; i < weights.size(); ++i) {
+                u -= weights.at(i);
+                if (u < 0.0) {
+                    return i;
+                }
+            }
+            // Rounding error; return the last option with any weight
+            for (unsigned int i = weights.size(); i > 0; --i) {
+                if (weights.at(i - 1) > 0.0) {
+                    return i - 1;
+                }
+            }
+            return weights.size() - 1;
+        }
+
+        /**
+         * Uniform draw of a partition of the lineages into k groups of at
+         * least 2.
+         */
+        std::vector< std::vector<unsigned int> > draw_pair_partition_(
+                RandomNumberGenerator & rng,
+                std::vector<unsigned int> lineages,
+                unsigned int k) const {
+            if (lineages.empty()) {
+                ECOEVOLITY_ASSERT(k == 0);
+                return std::vector< std::vector<unsigned int> >();
+            }
+            const unsigned int n = lineages.size();
+            unsigned int last = lineages.back();
+            lineages.pop_back();
+            long double u = rng.uniform_real() * this->pair_stirling2_.at(n).at(k);
+            if (u < (k * this->pair_stirling2_.at(n - 1).at(k))) {
+                std::vector< std::vector<unsigned int> > groups =
+                        this->draw_pair_partition_(rng, lineages, k);
+                groups.at(rng.uniform_positive_int(k - 1)).push_back(last);
+                return groups;
+            }
+            unsigned int partner_index = rng.uniform_positive_int(n - 2);
+            unsigned int partner = lineages.at(partner_index);
+            lineages.erase(lineages.begin() + partner_index);
+            std::vector< std::vector<unsigned int> > groups =
+                    this->draw_pair_partition_(rng, lineages, k - 1);
+            groups.push_back({partner, last});
+            return groups;
+        }
+
+        /**
+         * Uniform draw of a partition of new and old lineages into h groups
+         * of at least 2, each with at least one new lineage.
+         */
+        std::vector< std::vector<unsigned int> > draw_new_groups_(
+                RandomNumberGenerator & rng,
+                std::vector<unsigned int> new_lineages,
+                std::vector<unsigned int> old_lineages,
+                unsigned int h) const {
+            if (old_lineages.empty()) {
+                return this->draw_pair_partition_(rng, new_lineages, h);
+            }
+            const unsigned int a = new_lineages.size();
+            const unsigned int y = old_lineages.size();
+            unsigned int last = old_lineages.back();
+            old_lineages.pop_back();
+            long double u = rng.uniform_real() * this->get_new_group_count_(a, y, h);
+            if (u < (h * this->get_new_group_count_(a, y - 1, h))) {
+                std::vector< std::vector<unsigned int> > groups =
+                        this->draw_new_groups_(rng, new_lineages, old_lineages, h);
+                groups.at(rng.uniform_positive_int(h - 1)).push_back(last);
+                return groups;
+            }
+            unsigned int partner_index = rng.uniform_positive_int(a - 1);
+            unsigned int partner = new_lineages.at(partner_index);
+            new_lineages.erase(new_lineages.begin() + partner_index);
+            std::vector< std::vector<unsigned int> > groups =
+                    this->draw_new_groups_(rng, new_lineages, old_lineages, h - 1);
+            groups.push_back({partner, last});
+            return groups;
+        }
+
+        /**
+         * Uniform draw of the events of a level that uses all of the given
+         * new and old lineages to create g nodes.
+         */
+        std::vector< std::vector< std::vector<unsigned int> > > draw_level_(
+                RandomNumberGenerator & rng,
+                const std::vector<unsigned int> & new_lineages,
+                std::vector<unsigned int> old_lineages,
+                unsigned int g) const {
+            const unsigned int a = new_lineages.size();
+            const unsigned int b = old_lineages.size();
+            std::vector<long double> weights;
+            std::vector< std::pair<unsigned int, unsigned int> > options;
+            for (unsigned int h = 1; h <= g; ++h) {
+                for (unsigned int x = 0; x <= b; ++x) {
+                    long double w = this->get_level_structure_count_(a, b, g, h, x);
+                    if (w > 0.0) {
+                        weights.push_back(w);
+                        options.push_back(std::make_pair(h, x));
+                    }
+                }
+            }
+            const std::pair<unsigned int, unsigned int> & option =
+                    options.at(this->draw_index_(rng, weights));
+            const unsigned int h = option.first;
+            const unsigned int o = g - h;
+            const unsigned int x = option.second;
+
+            // The first x old lineages (in random order) form the groups
+            // without new lineages
+            rng.shuffle(old_lineages);
+            std::vector<unsigned int> grouped_old_lineages(
+                    old_lineages.begin(), old_lineages.begin() + x);
+            std::vector<unsigned int> attached_old_lineages(
+                    old_lineages.begin() + x, old_lineages.end());
+            std::vector< std::vector<unsigned int> > new_groups =
+                    this->draw_new_groups_(rng, new_lineages, attached_old_lineages, h);
+            std::vector< std::vector<unsigned int> > old_groups =
+                    this->draw_pair_partition_(rng, grouped_old_lineages, o);
+
+            std::vector<long double> event_weights(h, 0.0);
+            for (unsigned int e = 1; e <= h; ++e) {
+                event_weights.at(e - 1) = this->stirling2_.at(h).at(e) *
+                        std::pow((long double)e, (int)o);
+            }
+            unsigned int number_of_events = this->draw_index_(rng, event_weights) + 1;
+            std::vector< std::vector<unsigned int> > subsets = rng.random_subsets(
+                    h, number_of_events);
+            std::vector< std::vector< std::vector<unsigned int> > > events(number_of_events);
+            for (unsigned int e = 0; e < number_of_events; ++e) {
+                for (auto group_index : subsets.at(e)) {
+                    events.at(e).push_back(new_groups.at(group_index));
+                }
+            }
+            for (auto & group : old_groups) {
+                events.at(rng.uniform_positive_int(number_of_events - 1)).push_back(group);
+            }
+            return events;
+        }
+
+    public:
+        GeneralizedTreeCounts(unsigned int number_of_leaves) :
+                number_of_leaves_(number_of_leaves) {
+            if (number_of_leaves < 1) {
+                throw EcoevolityError(
+                        "GeneralizedTreeCounts: the number of leaves must be positive");
+            }
+            this->tabulate_();
+        }
+
+        unsigned int get_number_of_leaves() const {
+            return this->number_of_leaves_;
+        }
+
+        /**
+         * Number of generalized trees with `number_of_leaves` leaves, which
+         * must not be more than the number of leaves of the table.
+         */
+        long double get_number_of_trees(unsigned int number_of_leaves) const {
+            ECOEVOLITY_ASSERT(number_of_leaves > 0);
+            ECOEVOLITY_ASSERT(number_of_leaves <= this->number_of_leaves_);
+            return this->completion_counts_.at(0).at(number_of_leaves);
+        }
+        long double get_number_of_trees() const {
+            return this->get_number_of_trees(this->number_of_leaves_);
+        }
+
+        /**
+         * Draws a tree from the uniform distribution over generalized trees.
+         */
+        TreeEventSequence draw_tree(RandomNumberGenerator & rng) const {
+            TreeEventSequence tree_events;
+            unsigned int next_lineage = this->number_of_leaves_;
+            std::vector<unsigned int> new_lineages(this->number_of_leaves_);
+            for (unsigned int i = 0; i < this->number_of_leaves_; ++i) {
+                new_lineages.at(i) = i;
+            }
+            std::vector<unsigned int> old_lineages;
+            std::vector<long double> weights;
+            std::vector< std::vector<unsigned int> > options;
+            while ((new_lineages.size() + old_lineages.size()) > 1) {
+                const unsigned int m = new_lineages.size();
+                const unsigned int r = old_lineages.size();
+                weights.clear();
+                options.clear();
+                for (unsigned int a = 1; a <= m; ++a) {
+                    for (unsigned int b = 0; b <= r; ++b) {
+                        for (unsigned int g = 1; (2 * g) <= (a + b); ++g) {
+                            long double w = this->get_level_weight_(r, m, a, b, g);
+                            if (w > 0.0) {
+                                weights.push_back(w);
+                                options.push_back({a, b, g});
+                            }
+                        }
+                    }
+                }
+                const std::vector<unsigned int> & option =
+                        options.at(this->draw_index_(rng, weights));
+                const unsigned int a = option.at(0);
+                const unsigned int b = option.at(1);
+                const unsigned int g = option.at(2);
+
+                rng.shuffle(new_lineages);
+                rng.shuffle(old_lineages);
+                std::vector<unsigned int> level_new_lineages(
+                        new_lineages.begin(), new_lineages.begin() + a);
+                std::vector<unsigned int> level_old_lineages(
+                        old_lineages.begin(), old_lineages.begin() + b);
+                std::vector<unsigned int> next_old_lineages(
+                        old_lineages.begin() + b, old_lineages.end());
+                next_old_lineages.insert(next_old_lineages.end(),
+                        new_lineages.begin() + a, new_lineages.end());
+
+                std::vector< std::vector< std::vector<unsigned int> > > events =
+                        this->draw_level_(rng, level_new_lineages,
+                                level_old_lineages, g);
+                new_lineages.clear();
+                for (auto & event : events) {
+                    for (auto & group : event) {
+                        std::sort(group.begin(), group.end());
+                        new_lineages.push_back(next_lineage);
+                        ++next_lineage;
+                    }
+                    tree_events.push_back(event);
+                }
+                old_lineages = next_old_lineages;
+            }
+            return tree_events;
+        }
+};
+
+/**
+ * Draws a tree from the uniform distribution over rooted, bifurcating trees
+ * with `number_of_leaves` labeled leaves (ignoring the order of node
+ * heights). Leaves are added one at a time to a uniformly chosen branch,
+ * including the branch above the root.
+ */
+inline TreeEventSequence draw_random_bifurcating_tree(
+        RandomNumberGenerator & rng,
+        unsigned int number_of_leaves) {
+    ECOEVOLITY_ASSERT(number_of_leaves > 1);
+    // Nodes 0 to n-1 are the leaves and the others are internal nodes
+    // numbered as they are added; -1 is no parent
+    std::vector<int> parents(number_of_leaves, -1);
+    parents.reserve((2 * number_of_leaves) - 1);
+    parents.push_back(-1);
+    parents.at(0) = number_of_leaves;
+    parents.at(1) = number_of_leaves;
+    std::vector<unsigned int> nodes_in_tree {0, 1, number_of_leaves};
+    for (unsigned int leaf = 2; leaf < number_of_leaves; ++leaf) {
+        unsigned int sister = nodes_in_tree.at(
+                rng.uniform_positive_int(nodes_in_tree.size() - 1));
+        unsigned int new_node = parents.size();
+        parents.push_back(parents.at(sister));
+        parents.at(sister) = new_node;
+        parents.at(leaf) = new_node;
+        nodes_in_tree.push_back(leaf);
+        nodes_in_tree.push_back(new_node);
+    }
+    std::vector< std::vector<unsigned int> > children(parents.size());
+    int root = -1;
+    for (unsigned int i = 0; i < parents.size(); ++i) {
+        if (parents.at(i) < 0) {
+            root = i;
+            continue;
+        }
+        children.at(parents.at(i)).push_back(i);
+    }
+    ECOEVOLITY_ASSERT(root >= (int)number_of_leaves);
+
+    // Each internal node is its own event, in post order so that children
+    // get their lineage indices before their parents
+    TreeEventSequence tree_events;
+    std::vector<unsigned int> lineage_indices(parents.size(), 0);
+    for (unsigned int i = 0; i < number_of_leaves; ++i) {
+        lineage_indices.at(i) = i;
+    }
+    unsigned int next_lineage = number_of_leaves;
+    std::vector< std::pair<unsigned int, bool> > stack {std::make_pair((unsigned int)root, false)};
+    while (! stack.empty()) {
+        std::pair<unsigned int, bool> item = stack.back();
+        stack.pop_back();
+        if (item.first < number_of_leaves) {
+            continue;
+        }
+        if (! item.second) {
+            stack.push_back(std::make_pair(item.first, true));
+            for (auto child : children.at(item.first)) {
+                stack.push_back(std::make_pair(child, false));
+            }
+            continue;
+        }
+        std::vector<unsigned int> group;
+        for (auto child : children.at(item.first)) {
+            group.push_back(lineage_indices.at(child));
+        }
+        std::sort(group.begin(), group.end());
+        tree_events.push_back({group});
+        lineage_indices.at(item.first) = next_lineage;
+        ++next_lineage;
+    }
+    return tree_events;
+}
+
+#endif
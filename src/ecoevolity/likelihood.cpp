@@ -21,8 +21,8 @@
 
 const static MatrixExponentiator matrix_exponentiator;
 
-void compute_leaf_partials(
-        PopulationNode& node,
+void compute_leaf_pattern_probs(
+        BiallelicPatternProbabilityMatrix& pattern_probs,
         const unsigned int red_allele_count,
         const unsigned int allele_count,
         const bool markers_are_dominant
@@ -31,8 +31,8 @@ void compute_leaf_partials(
         unsigned int n = allele_count;
         unsigned int n_reds = red_allele_count;
         const unsigned int a_count = allele_count * 2;
+        pattern_probs.reset(a_count);
         if (red_allele_count > 0) {
-            BiallelicPatternProbabilityMatrix m(a_count);
             double p_r_k_n = 1.0;
             for (unsigned int r = 1; r <= n_reds; ++r) {
                 p_r_k_n = (p_r_k_n * 2.0 * (n - r + 1.0)) / ((2.0 * n) - r + 1.0);
@@ -42,47 +42,19 @@ void compute_leaf_partials(
                     p_r_k_n = (p_r_k_n * ((2.0 * n_reds) - k + 1) * k) /
                               (2.0 * ( k - n_reds) * ((2.0 * n) - k + 1.0));
                 }
-                m.set_pattern_probability(a_count, k, p_r_k_n);
+                pattern_probs.set_pattern_probability(a_count, k, p_r_k_n);
             }
-            node.copy_bottom_pattern_probs(m);
             return;
         }
-        BiallelicPatternProbabilityMatrix m(a_count, n_reds);
-        node.copy_bottom_pattern_probs(m);
+        if (a_count > 0) {
+            pattern_probs.set_pattern_probability(a_count, n_reds, 1.0);
+        }
         return;
     }
-    BiallelicPatternProbabilityMatrix m(allele_count, red_allele_count);
-    node.copy_bottom_pattern_probs(m);
-    return;
-}
-
-void compute_top_of_branch_partials(
-        PopulationNode& node,
-        const double u,
-        const double v,
-        const double mutation_rate, 
-        const double ploidy
-        ) {
-    if (node.get_allele_count() == 0) {
-        node.copy_top_pattern_probs(node.get_bottom_pattern_probs());
-        return;
+    pattern_probs.reset(allele_count);
+    if (allele_count > 0) {
+        pattern_probs.set_pattern_probability(allele_count, red_allele_count, 1.0);
     }
-
-    // Nested for loops here over discrete lengths and pop sizes (percentiles
-    // of discretized distributions). Average the probs inside the
-    // internal for loop, and sum averaged probs in outer for loop
-    double theta = 2 * ploidy * node.get_population_size() * mutation_rate;
-    double length = node.get_length() * mutation_rate;
-    BiallelicPatternProbabilityMatrix m = matrix_exponentiator.expQTtx(
-            node.get_allele_count(),
-            u,
-            v,
-            theta,
-            length,
-            node.get_bottom_pattern_probs());
-    // Get average probs after outer for loop finishes, and copy
-    // the final average probs to the top patterns
-    node.copy_top_pattern_probs(m);
 }
 
 void merge_top_of_branch_partials(
@@ -138,117 +110,15 @@ void merge_top_of_branch_partials(
     merged_allele_count = allele_count;
 }
 
-void compute_internal_partials(
-        PopulationNode& node) {
-    unsigned int number_of_children_with_alleles = 0;
-    std::vector<unsigned int> indices_of_children_with_alleles;
-    for (unsigned int child_idx = 0; child_idx < node.get_number_of_children(); ++child_idx) {
-        if (node.get_child(child_idx)->get_allele_count() > 0) {
-            ++number_of_children_with_alleles;
-            indices_of_children_with_alleles.push_back(child_idx);
-        }
-    }
-    if (number_of_children_with_alleles < 1) {
-        std::ostringstream message;
-        message << "compute_internal_partials; "
-                << "no children have alleles!";
-        throw EcoevolityError(message.str());
-    }
-    if (number_of_children_with_alleles == 1) {
-        node.copy_bottom_pattern_probs(node.get_child(indices_of_children_with_alleles.at(0))->get_top_pattern_probs());
-        return;
-    }
-
-    unsigned int merged_allele_count = node.get_child(indices_of_children_with_alleles.at(0))->get_allele_count();
-
-    std::vector<double> merged_pattern_probs = node.get_child(indices_of_children_with_alleles.at(0))->get_top_pattern_probs().get_pattern_prob_matrix();
-
-    for (unsigned int i = 1; i < node.get_number_of_children(); ++i) {
-        std::vector<double> pattern_probs_child1 = merged_pattern_probs;
-        unsigned int allele_count_child1 = merged_allele_count;
-        unsigned int allele_count_child2 = node.get_child(indices_of_children_with_alleles.at(i))->get_allele_count();
-        std::vector<double> pattern_probs_child2 = node.get_child(
-                indices_of_children_with_alleles.at(i))->get_top_pattern_probs().get_pattern_prob_matrix();
-        merge_top_of_branch_partials(
-                allele_count_child1,
-                allele_count_child2,
-                pattern_probs_child1,
-                pattern_probs_child2,
-                merged_allele_count,
-                merged_pattern_probs);
-    }
-    BiallelicPatternProbabilityMatrix m(merged_allele_count, merged_pattern_probs);
-    node.copy_bottom_pattern_probs(m);
-}
-
-void compute_pattern_partials(
-        PopulationNode& node,
-        const std::vector<unsigned int>& red_allele_counts,
-        const std::vector<unsigned int>& allele_counts,
-        const double u,
-        const double v,
-        const double mutation_rate,
-        const double ploidy,
-        const bool markers_are_dominant
-        ) {
-    ECOEVOLITY_ASSERT(red_allele_counts.size() == allele_counts.size());
-    if (node.is_leaf()) {
-        compute_leaf_partials(
-                node,
-                red_allele_counts.at(node.get_index()),
-                allele_counts.at(node.get_index()),
-                markers_are_dominant);
-        return;
-    }
-    else if (node.get_number_of_children() == 1) {
-        compute_pattern_partials(*node.get_child(0),
-                red_allele_counts,
-                allele_counts,
-                u,
-                v,
-                mutation_rate,
-                ploidy,
-                markers_are_dominant);
-        compute_top_of_branch_partials(*node.get_child(0), u, v, mutation_rate, ploidy);
-        compute_internal_partials(node);
-        return;
-    }
-    else if (node.get_number_of_children() > 1) {
-        for (unsigned int child_idx = 0; child_idx < node.get_number_of_children(); ++child_idx) {
-            compute_pattern_partials(*node.get_child(child_idx),
-                    red_allele_counts,
-                    allele_counts,
-                    u,
-                    v,
-                    mutation_rate,
-                    ploidy,
-                    markers_are_dominant);
-            compute_top_of_branch_partials(*node.get_child(child_idx), u, v, mutation_rate, ploidy);
-        }
-        compute_internal_partials(node);
-        return;
-    }
-    std::ostringstream message;
-    message << "compute_pattern_partials(); "
-            << "unexpected number of children: "
-            << node.get_number_of_children();
-    throw EcoevolityError(message.str());
-}
-
 std::vector< std::vector<double> > compute_root_probabilities(
-        const PopulationNode& root,
+        const unsigned int allele_count,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy
+        const double theta
         ) {
-    unsigned int N = root.get_allele_count();
+    unsigned int N = allele_count;
     std::vector< std::vector<double> > x (N + 1); 
-    QMatrix q = QMatrix(
-            N,
-            u,
-            v,
-            2 * ploidy * root.get_population_size() * mutation_rate);
+    QMatrix q = QMatrix(N, u, v, theta);
     std::vector<double> xcol = q.find_orthogonal_vector();
 
     // ECOEVOLITY_DEBUG(
@@ -277,21 +147,19 @@ std::vector< std::vector<double> > compute_root_probabilities(
 }
 
 double compute_root_likelihood(
-        const PopulationNode& root,
+        const BiallelicPatternProbabilityMatrix& bottom_pattern_probs,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy
+        const double theta
         ) {
-    unsigned int N = root.get_allele_count();
-    std::vector< std::vector<double> > conditionals = compute_root_probabilities(root, u, v, mutation_rate, ploidy);
+    unsigned int N = bottom_pattern_probs.get_allele_count();
+    std::vector< std::vector<double> > conditionals = compute_root_probabilities(N, u, v, theta);
 
     // ECOEVOLITY_DEBUG(
     //     for (unsigned int n = 1; n <= N; ++n) {
     //         for (unsigned int r = 0; r <= n; ++r) {
-    //             std::cerr << "root height: " << root.get_height() << std::endl;
     //             std::cerr << "conditional[" << n << ", " << r << "] = " << conditionals.at(n).at(r) << std::endl;
-    //             std::cerr << "bottom_pattern_probs[" << n << ", " << r << "] = " << root.get_bottom_pattern_probability(n, r) << std::endl;
+    //             std::cerr << "bottom_pattern_probs[" << n << ", " << r << "] = " << bottom_pattern_probs.get_pattern_probability(n, r) << std::endl;
     //         }
     //     }
     // )
@@ -299,21 +167,13 @@ double compute_root_likelihood(
     // NOTE about analytically integrating over pop sizes using a discretized
     // distibution: To integrate over pop size of the root branch, before this
     // point, we need to sum over `condtionals`. The bottom pattern probs
-    // (`root.get_bottom_pattern_probability(n, r)`) should already be
-    // integrated over pop sizes up to the bottom of the root branch, so only
-    // the `conditionals` need to be integrated here.
+    // should already be integrated over pop sizes up to the bottom of the
+    // root branch, so only the `conditionals` need to be integrated here.
     double sum = 0.0;
     for (unsigned int n = 1; n <= N; ++n) {
         for (unsigned int r = 0; r <= n; ++r) {
-            double term = conditionals.at(n).at(r) * root.get_bottom_pattern_probability(n, r);
+            double term = conditionals.at(n).at(r) * bottom_pattern_probs.get_pattern_probability(n, r);
             sum += term;
-            // if (sum < 0.0) {
-            //     std::ostringstream message;
-            //     message << "compute_root_likelihood(): Numerical error; "
-            //             << "root likelihood is negative: "
-            //             << sum;
-            //     throw EcoevolityError(message.str());
-            // }
         }
     }
 
@@ -334,39 +194,407 @@ double compute_root_likelihood(
     return sum;
 }
 
+void get_flat_branch_parameters(
+        const FlatTree<PopulationNode>& tree,
+        const double mutation_rate,
+        const double ploidy,
+        std::vector<double>& thetas,
+        std::vector<double>& lengths
+        ) {
+    const unsigned int n = tree.get_number_of_nodes();
+    thetas.resize(n);
+    lengths.resize(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        thetas[i] = 2 * ploidy * tree.get_node(i)->get_population_size() * mutation_rate;
+        lengths[i] = tree.get_length(i) * mutation_rate;
+    }
+}
+
+bool rescale_pattern_probs(
+        std::vector<double> & pattern_probs,
+        const double threshold,
+        int & scale_exponent) {
+    double max_prob = 0.0;
+    for (auto p : pattern_probs) {
+        if (p > max_prob) {
+            max_prob = p;
+        }
+    }
+    if ((max_prob <= 0.0) || (max_prob >= threshold)) {
+        return false;
+    }
+    int e;
+    std::frexp(max_prob, &e);
+    for (unsigned int i = 0; i < pattern_probs.size(); ++i) {
+        pattern_probs[i] = std::ldexp(pattern_probs[i], -e);
+    }
+    scale_exponent += e;
+    return true;
+}
+
+/**
+ * Merges the top-of-branch partials of the children of a node that have
+ * alleles into the partials at the bottom of the node.
+ * `get_child_partials(i, probs, scale_exponent)` points `probs` to the
+ * top-of-branch partials of child i and sets their scale exponent.
+ */
+template<class ChildPartialsGetter>
+static void compute_flat_bottom_partials(
+        const unsigned int number_of_children,
+        ChildPartialsGetter get_child_partials,
+        FlatLikelihoodWorkspace& workspace,
+        BiallelicPatternProbabilityMatrix& bottom_probs,
+        int& scale_exponent
+        ) {
+    unsigned int number_of_children_with_alleles = 0;
+    unsigned int merged_allele_count = 0;
+    const BiallelicPatternProbabilityMatrix * single_child_probs = nullptr;
+    for (unsigned int i = 0; i < number_of_children; ++i) {
+        const BiallelicPatternProbabilityMatrix * child_probs_ptr = nullptr;
+        int child_scale_exponent = 0;
+        get_child_partials(i, child_probs_ptr, child_scale_exponent);
+        const BiallelicPatternProbabilityMatrix& child_probs = *child_probs_ptr;
+        if (child_probs.get_allele_count() < 1) {
+            continue;
+        }
+        ++number_of_children_with_alleles;
+        scale_exponent += child_scale_exponent;
+        if (number_of_children_with_alleles == 1) {
+            single_child_probs = &child_probs;
+            merged_allele_count = child_probs.get_allele_count();
+            workspace.merged_pattern_probs = child_probs.get_pattern_prob_matrix();
+            continue;
+        }
+        workspace.child1_pattern_probs = workspace.merged_pattern_probs;
+        workspace.child2_pattern_probs = child_probs.get_pattern_prob_matrix();
+        merge_top_of_branch_partials(
+                merged_allele_count,
+                child_probs.get_allele_count(),
+                workspace.child1_pattern_probs,
+                workspace.child2_pattern_probs,
+                merged_allele_count,
+                workspace.merged_pattern_probs);
+    }
+    if (number_of_children_with_alleles < 1) {
+        std::ostringstream message;
+        message << "compute_pattern_partials; "
+                << "no children have alleles!";
+        throw EcoevolityError(message.str());
+    }
+    if (number_of_children_with_alleles == 1) {
+        bottom_probs = *single_child_probs;
+    }
+    else {
+        rescale_pattern_probs(workspace.merged_pattern_probs,
+                workspace.rescale_threshold,
+                scale_exponent);
+        bottom_probs = BiallelicPatternProbabilityMatrix(
+                merged_allele_count,
+                workspace.merged_pattern_probs);
+    }
+}
+
+/**
+ * Computes the partials at the top of a branch from those at the bottom,
+ * adding any rescaling to `scale_exponent`.
+ */
+static void compute_flat_top_partials(
+        const BiallelicPatternProbabilityMatrix& bottom_probs,
+        const double u,
+        const double v,
+        const double theta,
+        const double length,
+        const std::vector<double>& theta_multipliers,
+        FlatLikelihoodWorkspace& workspace,
+        BiallelicPatternProbabilityMatrix& top_probs,
+        int& scale_exponent
+        ) {
+    if (bottom_probs.get_allele_count() == 0) {
+        top_probs = bottom_probs;
+        return;
+    }
+    if (theta_multipliers.empty()) {
+        top_probs = matrix_exponentiator.expQTtx(
+                bottom_probs.get_allele_count(),
+                u,
+                v,
+                theta,
+                length,
+                bottom_probs);
+        const std::vector<double>& probs = top_probs.get_pattern_prob_matrix();
+        if ((! probs.empty()) &&
+                (*std::max_element(probs.begin(), probs.end()) <
+                workspace.rescale_threshold)) {
+            workspace.merged_pattern_probs = probs;
+            if (rescale_pattern_probs(workspace.merged_pattern_probs,
+                        workspace.rescale_threshold,
+                        scale_exponent)) {
+                top_probs = BiallelicPatternProbabilityMatrix(
+                        bottom_probs.get_allele_count(),
+                        workspace.merged_pattern_probs);
+            }
+        }
+        return;
+    }
+    // Average the top-of-branch partials over the categories of the
+    // population size of the branch
+    for (unsigned int k = 0; k < theta_multipliers.size(); ++k) {
+        BiallelicPatternProbabilityMatrix m = matrix_exponentiator.expQTtx(
+                bottom_probs.get_allele_count(),
+                u,
+                v,
+                theta * theta_multipliers[k],
+                length,
+                bottom_probs);
+        const std::vector<double>& probs = m.get_pattern_prob_matrix();
+        if (k == 0) {
+            workspace.merged_pattern_probs = probs;
+            continue;
+        }
+        for (unsigned int i = 0; i < probs.size(); ++i) {
+            workspace.merged_pattern_probs[i] += probs[i];
+        }
+    }
+    for (unsigned int i = 0; i < workspace.merged_pattern_probs.size(); ++i) {
+        workspace.merged_pattern_probs[i] /= theta_multipliers.size();
+    }
+    rescale_pattern_probs(workspace.merged_pattern_probs,
+            workspace.rescale_threshold,
+            scale_exponent);
+    top_probs = BiallelicPatternProbabilityMatrix(
+            bottom_probs.get_allele_count(),
+            workspace.merged_pattern_probs);
+}
+
+void compute_pattern_partials(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector<unsigned int>& red_allele_counts,
+        const std::vector<unsigned int>& allele_counts,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers,
+        const std::vector<unsigned int> * previous_red_allele_counts,
+        const std::vector<unsigned int> * previous_allele_counts
+        ) {
+    ECOEVOLITY_ASSERT(red_allele_counts.size() == allele_counts.size());
+    const unsigned int root_index = tree.get_root_index();
+    workspace.resize(tree.get_number_of_nodes());
+    const bool reusing_partials = (previous_red_allele_counts && previous_allele_counts);
+    for (unsigned int node_idx = 0; node_idx <= root_index; ++node_idx) {
+        // The partials of a subtree are unchanged if the allele counts of
+        // all of its leaves are the same as in the previous pattern
+        if (reusing_partials) {
+            bool unchanged = true;
+            if (tree.is_leaf(node_idx)) {
+                const int leaf_index = tree.get_node(node_idx)->get_index();
+                unchanged = ((allele_counts[leaf_index] == (*previous_allele_counts)[leaf_index]) &&
+                        (red_allele_counts[leaf_index] == (*previous_red_allele_counts)[leaf_index]));
+            }
+            else {
+                for (unsigned int i = 0; i < tree.get_number_of_children(node_idx); ++i) {
+                    if (! workspace.partials_are_reused[tree.get_child_index(node_idx, i)]) {
+                        unchanged = false;
+                        break;
+                    }
+                }
+            }
+            workspace.partials_are_reused[node_idx] = unchanged;
+            if (unchanged) {
+                continue;
+            }
+        }
+        BiallelicPatternProbabilityMatrix& bottom_probs = workspace.bottom_pattern_probs[node_idx];
+        int& scale_exponent = workspace.scale_exponents[node_idx];
+        scale_exponent = 0;
+        if (tree.is_leaf(node_idx)) {
+            const int leaf_index = tree.get_node(node_idx)->get_index();
+            compute_leaf_pattern_probs(
+                    bottom_probs,
+                    red_allele_counts.at(leaf_index),
+                    allele_counts.at(leaf_index),
+                    markers_are_dominant);
+        }
+        else {
+            compute_flat_bottom_partials(
+                    tree.get_number_of_children(node_idx),
+                    [&tree, &workspace, node_idx](unsigned int i,
+                            const BiallelicPatternProbabilityMatrix *& probs,
+                            int & child_scale_exponent) {
+                        const unsigned int child_idx = tree.get_child_index(node_idx, i);
+                        probs = &workspace.top_pattern_probs[child_idx];
+                        child_scale_exponent = workspace.scale_exponents[child_idx];
+                    },
+                    workspace,
+                    bottom_probs,
+                    scale_exponent);
+        }
+        if (node_idx == root_index) {
+            break;
+        }
+        compute_flat_top_partials(
+                bottom_probs,
+                u,
+                v,
+                thetas[node_idx],
+                lengths[node_idx],
+                theta_multipliers,
+                workspace,
+                workspace.top_pattern_probs[node_idx],
+                scale_exponent);
+    }
+}
+
+/**
+ * Likelihood of the pattern from the (possibly rescaled) partials at the
+ * bottom of the root; the true likelihood is this times
+ * 2^workspace.scale_exponents[root_index].
+ */
+static double compute_scaled_root_likelihood(
+        const BiallelicPatternProbabilityMatrix& bottom_probs,
+        const double theta,
+        const double u,
+        const double v,
+        const std::vector<double>& theta_multipliers
+        ) {
+    if (theta_multipliers.empty()) {
+        return compute_root_likelihood(
+                bottom_probs,
+                u,
+                v,
+                theta);
+    }
+    double sum = 0.0;
+    for (auto multiplier : theta_multipliers) {
+        sum += compute_root_likelihood(
+                bottom_probs,
+                u,
+                v,
+                theta * multiplier);
+    }
+    return sum / theta_multipliers.size();
+}
+
+static double compute_scaled_root_likelihood(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const FlatLikelihoodWorkspace& workspace,
+        const double u,
+        const double v,
+        const std::vector<double>& theta_multipliers
+        ) {
+    const unsigned int root_index = tree.get_root_index();
+    return compute_scaled_root_likelihood(
+            workspace.bottom_pattern_probs[root_index],
+            thetas[root_index],
+            u,
+            v,
+            theta_multipliers);
+}
+
 double compute_pattern_likelihood(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector<unsigned int>& red_allele_counts,
         const std::vector<unsigned int>& allele_counts,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
-        const bool markers_are_dominant
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers
         ) {
-    compute_pattern_partials(root,
+    compute_pattern_partials(tree,
+            thetas,
+            lengths,
+            workspace,
             red_allele_counts,
             allele_counts,
             u,
             v,
-            mutation_rate,
-            ploidy,
-            markers_are_dominant);
-    return compute_root_likelihood(root, u, v, mutation_rate, ploidy);
+            markers_are_dominant,
+            theta_multipliers);
+    double l = compute_scaled_root_likelihood(tree, thetas, workspace, u, v,
+            theta_multipliers);
+    const int scale_exponent = workspace.scale_exponents[tree.get_root_index()];
+    if (scale_exponent == 0) {
+        return l;
+    }
+    return std::ldexp(l, scale_exponent);
+}
+
+double compute_pattern_log_likelihood(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector<unsigned int>& red_allele_counts,
+        const std::vector<unsigned int>& allele_counts,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers,
+        const std::vector<unsigned int> * previous_red_allele_counts,
+        const std::vector<unsigned int> * previous_allele_counts
+        ) {
+    compute_pattern_partials(tree,
+            thetas,
+            lengths,
+            workspace,
+            red_allele_counts,
+            allele_counts,
+            u,
+            v,
+            markers_are_dominant,
+            theta_multipliers,
+            previous_red_allele_counts,
+            previous_allele_counts);
+    double l = compute_scaled_root_likelihood(tree, thetas, workspace, u, v,
+            theta_multipliers);
+    if (l <= 0.0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    const int scale_exponent = workspace.scale_exponents[tree.get_root_index()];
+    if (scale_exponent == 0) {
+        return std::log(l);
+    }
+    return std::log(l) + (scale_exponent * std::log(2.0));
 }
 
 void compute_constant_pattern_log_likelihood_correction(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector< std::vector<unsigned int> > & unique_allele_counts,
         const std::vector<unsigned int> & unique_allele_count_weights,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
         const bool markers_are_dominant,
         const bool state_frequencies_are_constrained,
-        double& constant_log_likelihood_correction 
+        double& constant_log_likelihood_correction,
+        const std::vector<double>& theta_multipliers,
+        ConstantPatternLikelihoodCache * cache
         ) {
+    if (cache) {
+        cache->compute_constant_pattern_log_likelihood_correction(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                unique_allele_counts,
+                unique_allele_count_weights,
+                u,
+                v,
+                markers_are_dominant,
+                state_frequencies_are_constrained,
+                constant_log_likelihood_correction,
+                theta_multipliers);
+        return;
+    }
     double lnl_correction = 0.0;
     for (unsigned int pattern_idx = 0;
             pattern_idx < unique_allele_count_weights.size();
@@ -374,24 +602,259 @@ void compute_constant_pattern_log_likelihood_correction(
         std::vector<unsigned int> red_allele_counts (
                 unique_allele_counts.at(pattern_idx).size(),
                 0); 
-        double all_green_likelihood = compute_pattern_likelihood(root,
+        double all_green_likelihood = compute_pattern_likelihood(tree,
+                thetas,
+                lengths,
+                workspace,
                 red_allele_counts,
                 unique_allele_counts.at(pattern_idx),
                 u,
                 v,
-                mutation_rate,
-                ploidy,
-                markers_are_dominant);
+                markers_are_dominant,
+                theta_multipliers);
         double all_red_likelihood = all_green_likelihood;
         if (! state_frequencies_are_constrained) {
-            all_red_likelihood = compute_pattern_likelihood(root,
+            all_red_likelihood = compute_pattern_likelihood(tree,
+                    thetas,
+                    lengths,
+                    workspace,
                     unique_allele_counts.at(pattern_idx),
                     unique_allele_counts.at(pattern_idx),
                     u,
                     v,
-                    mutation_rate,
-                    ploidy,
-                    markers_are_dominant);
+                    markers_are_dominant,
+                    theta_multipliers);
+        }
+        double variable_likelihood = 1.0 - all_green_likelihood - all_red_likelihood;
+        if (variable_likelihood <= 0.0) {
+            lnl_correction = -std::numeric_limits<double>::infinity();
+            break;
+        }
+        lnl_correction += (unique_allele_count_weights.at(pattern_idx) *
+                std::log(variable_likelihood));
+    }
+    constant_log_likelihood_correction = lnl_correction;
+}
+
+void ConstantPatternLikelihoodCache::clear() {
+    this->nodes_.clear();
+    this->root_green_likelihoods_.clear();
+    this->root_red_likelihoods_.clear();
+    this->root_theta_ = std::numeric_limits<double>::quiet_NaN();
+}
+
+void ConstantPatternLikelihoodCache::compute_constant_pattern_log_likelihood_correction(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector< std::vector<unsigned int> > & unique_allele_counts,
+        const std::vector<unsigned int> & unique_allele_count_weights,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const bool state_frequencies_are_constrained,
+        double& constant_log_likelihood_correction,
+        const std::vector<double>& theta_multipliers
+        ) {
+    const unsigned int number_of_nodes = tree.get_number_of_nodes();
+    const unsigned int root_index = tree.get_root_index();
+    const unsigned int number_of_patterns = unique_allele_counts.size();
+    if ((this->nodes_.size() != number_of_nodes) ||
+            (this->number_of_patterns_ != number_of_patterns) ||
+            (this->u_ != u) ||
+            (this->v_ != v) ||
+            (this->markers_are_dominant_ != markers_are_dominant) ||
+            (this->state_frequencies_are_constrained_ != state_frequencies_are_constrained) ||
+            (this->theta_multipliers_ != theta_multipliers)) {
+        this->clear();
+        this->nodes_.resize(number_of_nodes);
+        this->number_of_patterns_ = number_of_patterns;
+        this->u_ = u;
+        this->v_ = v;
+        this->markers_are_dominant_ = markers_are_dominant;
+        this->state_frequencies_are_constrained_ = state_frequencies_are_constrained;
+        this->theta_multipliers_ = theta_multipliers;
+    }
+    // Whether the signatures and partials of each node are unchanged since
+    // the last call
+    std::vector<bool> signatures_are_unchanged(number_of_nodes, false);
+    std::vector<bool> partials_are_unchanged(number_of_nodes, false);
+    std::vector<unsigned int> child_indices;
+    std::vector<unsigned int> key;
+    for (unsigned int node_idx = 0; node_idx <= root_index; ++node_idx) {
+        NodePartials & node = this->nodes_.at(node_idx);
+        const bool is_leaf = tree.is_leaf(node_idx);
+        const int leaf_index = is_leaf ? tree.get_node(node_idx)->get_index() : -1;
+        child_indices.clear();
+        for (unsigned int i = 0; i < tree.get_number_of_children(node_idx); ++i) {
+            child_indices.push_back(tree.get_child_index(node_idx, i));
+        }
+
+        // The signatures of a node only depend on which leaves are below it
+        bool signatures_unchanged = (node.has_signatures &&
+                (node.leaf_index == leaf_index) &&
+                (node.child_indices == child_indices));
+        bool children_unchanged = true;
+        for (auto child_idx : child_indices) {
+            if (! signatures_are_unchanged.at(child_idx)) {
+                signatures_unchanged = false;
+            }
+            if (! partials_are_unchanged.at(child_idx)) {
+                children_unchanged = false;
+            }
+        }
+        if (! signatures_unchanged) {
+            node.leaf_index = leaf_index;
+            node.child_indices = child_indices;
+            node.pattern_signatures.resize(number_of_patterns);
+            node.signature_keys.clear();
+            std::map<std::vector<unsigned int>, unsigned int> signature_map;
+            for (unsigned int pattern_idx = 0;
+                    pattern_idx < number_of_patterns;
+                    ++pattern_idx) {
+                key.clear();
+                if (is_leaf) {
+                    key.push_back(unique_allele_counts.at(pattern_idx).at(leaf_index));
+                }
+                for (auto child_idx : child_indices) {
+                    key.push_back(this->nodes_.at(child_idx).pattern_signatures.at(pattern_idx));
+                }
+                auto inserted = signature_map.insert(std::make_pair(key,
+                        (unsigned int)node.signature_keys.size()));
+                if (inserted.second) {
+                    node.signature_keys.push_back(key);
+                }
+                node.pattern_signatures.at(pattern_idx) = inserted.first->second;
+            }
+            node.has_signatures = true;
+            node.has_partials = false;
+        }
+        signatures_are_unchanged.at(node_idx) = signatures_unchanged;
+
+        // The root has no branch; its population size only affects the root
+        // likelihoods below
+        const bool branch_unchanged = ((node_idx == root_index) ||
+                ((node.theta == thetas.at(node_idx)) &&
+                 (node.length == lengths.at(node_idx))));
+        if (signatures_unchanged && children_unchanged && node.has_partials &&
+                branch_unchanged) {
+            partials_are_unchanged.at(node_idx) = true;
+            continue;
+        }
+
+        const unsigned int number_of_signatures = node.signature_keys.size();
+        node.green_probs.resize(number_of_signatures);
+        node.green_scale_exponents.assign(number_of_signatures, 0);
+        if (! state_frequencies_are_constrained) {
+            node.red_probs.resize(number_of_signatures);
+            node.red_scale_exponents.assign(number_of_signatures, 0);
+        }
+        BiallelicPatternProbabilityMatrix bottom_probs;
+        for (unsigned int sig_idx = 0; sig_idx < number_of_signatures; ++sig_idx) {
+            const std::vector<unsigned int> & sig_key = node.signature_keys.at(sig_idx);
+            for (unsigned int red = 0; red < 2; ++red) {
+                if (red && state_frequencies_are_constrained) {
+                    continue;
+                }
+                BiallelicPatternProbabilityMatrix & probs = red ?
+                        node.red_probs.at(sig_idx) : node.green_probs.at(sig_idx);
+                int & scale_exponent = red ?
+                        node.red_scale_exponents.at(sig_idx) :
+                        node.green_scale_exponents.at(sig_idx);
+                if (is_leaf) {
+                    const unsigned int allele_count = sig_key.at(0);
+                    compute_leaf_pattern_probs(
+                            bottom_probs,
+                            red ? allele_count : 0,
+                            allele_count,
+                            markers_are_dominant);
+                }
+                else {
+                    compute_flat_bottom_partials(
+                            child_indices.size(),
+                            [this, &child_indices, &sig_key, red](unsigned int i,
+                                    const BiallelicPatternProbabilityMatrix *& child_probs,
+                                    int & child_scale_exponent) {
+                                const NodePartials & child = this->nodes_.at(child_indices.at(i));
+                                const unsigned int child_sig_idx = sig_key.at(i);
+                                child_probs = red ?
+                                        &child.red_probs.at(child_sig_idx) :
+                                        &child.green_probs.at(child_sig_idx);
+                                child_scale_exponent = red ?
+                                        child.red_scale_exponents.at(child_sig_idx) :
+                                        child.green_scale_exponents.at(child_sig_idx);
+                            },
+                            workspace,
+                            bottom_probs,
+                            scale_exponent);
+                }
+                // The partials of the root are kept at the bottom of the root
+                if (node_idx == root_index) {
+                    probs = bottom_probs;
+                    continue;
+                }
+                compute_flat_top_partials(
+                        bottom_probs,
+                        u,
+                        v,
+                        thetas.at(node_idx),
+                        lengths.at(node_idx),
+                        theta_multipliers,
+                        workspace,
+                        probs,
+                        scale_exponent);
+            }
+        }
+        node.theta = thetas.at(node_idx);
+        node.length = lengths.at(node_idx);
+        node.has_partials = true;
+        this->number_of_partials_computed_ += number_of_signatures;
+    }
+
+    const NodePartials & root = this->nodes_.at(root_index);
+    const unsigned int number_of_root_signatures = root.signature_keys.size();
+    if ((! partials_are_unchanged.at(root_index)) ||
+            (this->root_theta_ != thetas.at(root_index))) {
+        this->root_theta_ = thetas.at(root_index);
+        this->root_green_likelihoods_.resize(number_of_root_signatures);
+        this->root_red_likelihoods_.resize(number_of_root_signatures);
+        for (unsigned int sig_idx = 0; sig_idx < number_of_root_signatures; ++sig_idx) {
+            for (unsigned int red = 0; red < 2; ++red) {
+                if (red && state_frequencies_are_constrained) {
+                    continue;
+                }
+                double l = compute_scaled_root_likelihood(
+                        red ? root.red_probs.at(sig_idx) : root.green_probs.at(sig_idx),
+                        thetas.at(root_index),
+                        u,
+                        v,
+                        theta_multipliers);
+                const int scale_exponent = red ?
+                        root.red_scale_exponents.at(sig_idx) :
+                        root.green_scale_exponents.at(sig_idx);
+                if (scale_exponent != 0) {
+                    l = std::ldexp(l, scale_exponent);
+                }
+                if (red) {
+                    this->root_red_likelihoods_.at(sig_idx) = l;
+                }
+                else {
+                    this->root_green_likelihoods_.at(sig_idx) = l;
+                }
+            }
+        }
+    }
+
+    double lnl_correction = 0.0;
+    for (unsigned int pattern_idx = 0;
+            pattern_idx < unique_allele_count_weights.size();
+            ++pattern_idx) {
+        const unsigned int sig_idx = root.pattern_signatures.at(pattern_idx);
+        double all_green_likelihood = this->root_green_likelihoods_.at(sig_idx);
+        double all_red_likelihood = all_green_likelihood;
+        if (! state_frequencies_are_constrained) {
+            all_red_likelihood = this->root_red_likelihoods_.at(sig_idx);
         }
         double variable_likelihood = 1.0 - all_green_likelihood - all_red_likelihood;
         if (variable_likelihood <= 0.0) {
@@ -405,7 +868,10 @@ void compute_constant_pattern_log_likelihood_correction(
 }
 
 double get_log_likelihood_for_pattern_range(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
         const std::vector< std::vector<unsigned int> >& allele_count_matrix,
         const std::vector<unsigned int>& pattern_weights,
@@ -413,9 +879,9 @@ double get_log_likelihood_for_pattern_range(
         const unsigned int stop_index,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
-        const bool markers_are_dominant
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers,
+        const double minimum_log_likelihood
         ) {
     ECOEVOLITY_ASSERT((red_allele_count_matrix.size() == allele_count_matrix.size()) &&
                       (red_allele_count_matrix.size() == pattern_weights.size()));
@@ -423,25 +889,301 @@ double get_log_likelihood_for_pattern_range(
     for (unsigned int pattern_idx = start_index;
             pattern_idx < stop_index;
             ++pattern_idx) {
-        double pattern_likelihood = compute_pattern_likelihood(root,
+        const bool reusing_partials = (pattern_idx > start_index);
+        double pattern_log_likelihood = compute_pattern_log_likelihood(tree,
+                thetas,
+                lengths,
+                workspace,
+                red_allele_count_matrix.at(pattern_idx),
+                allele_count_matrix.at(pattern_idx),
+                u,
+                v,
+                markers_are_dominant,
+                theta_multipliers,
+                reusing_partials ? &red_allele_count_matrix.at(pattern_idx - 1) : nullptr,
+                reusing_partials ? &allele_count_matrix.at(pattern_idx - 1) : nullptr);
+        if (pattern_log_likelihood == -std::numeric_limits<double>::infinity()) {
+            return -std::numeric_limits<double>::infinity();
+        }
+        double weight = (double) pattern_weights.at(pattern_idx);
+        log_likelihood += weight * pattern_log_likelihood;
+        if (log_likelihood < minimum_log_likelihood) {
+            return log_likelihood;
+        }
+    }
+    return log_likelihood;
+}
+
+void PatternOrder::clear() {
+    this->pattern_indices_.clear();
+    this->cumulative_costs_.clear();
+}
+
+void PatternOrder::update(
+        const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
+        const std::vector< std::vector<unsigned int> >& allele_count_matrix) {
+    ECOEVOLITY_ASSERT(red_allele_count_matrix.size() == allele_count_matrix.size());
+    const unsigned int number_of_patterns = allele_count_matrix.size();
+    this->pattern_indices_.resize(number_of_patterns);
+    for (unsigned int i = 0; i < number_of_patterns; ++i) {
+        this->pattern_indices_[i] = i;
+    }
+    std::stable_sort(this->pattern_indices_.begin(), this->pattern_indices_.end(),
+            [&red_allele_count_matrix, &allele_count_matrix](unsigned int a, unsigned int b) {
+                const std::vector<unsigned int> & counts_a = allele_count_matrix[a];
+                const std::vector<unsigned int> & counts_b = allele_count_matrix[b];
+                for (unsigned int i = 0; i < counts_a.size(); ++i) {
+                    if (counts_a[i] != counts_b[i]) {
+                        return counts_a[i] < counts_b[i];
+                    }
+                    if (red_allele_count_matrix[a][i] != red_allele_count_matrix[b][i]) {
+                        return red_allele_count_matrix[a][i] < red_allele_count_matrix[b][i];
+                    }
+                }
+                return false;
+            });
+    this->cumulative_costs_.resize(number_of_patterns + 1);
+    this->cumulative_costs_[0] = 0.0;
+    for (unsigned int i = 0; i < number_of_patterns; ++i) {
+        double allele_count = 0.0;
+        for (auto n : allele_count_matrix[this->pattern_indices_[i]]) {
+            allele_count += n;
+        }
+        this->cumulative_costs_[i + 1] = this->cumulative_costs_[i] +
+                (allele_count * allele_count);
+    }
+}
+
+unsigned int PatternOrder::get_batch_start(
+        unsigned int batch_index,
+        unsigned int number_of_batches) const {
+    ECOEVOLITY_ASSERT(number_of_batches > 0);
+    ECOEVOLITY_ASSERT(batch_index <= number_of_batches);
+    if (batch_index == 0) {
+        return 0;
+    }
+    if (batch_index == number_of_batches) {
+        return this->size();
+    }
+    const double cost = this->cumulative_costs_.back() *
+            ((double)batch_index / number_of_batches);
+    auto it = std::lower_bound(this->cumulative_costs_.begin(),
+            this->cumulative_costs_.end(), cost);
+    unsigned int start = it - this->cumulative_costs_.begin();
+    if (start > this->size()) {
+        start = this->size();
+    }
+    return start;
+}
+
+double get_log_likelihood_for_ordered_pattern_range(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
+        const std::vector< std::vector<unsigned int> >& allele_count_matrix,
+        const std::vector<unsigned int>& pattern_weights,
+        const PatternOrder& pattern_order,
+        const unsigned int start_position,
+        const unsigned int stop_position,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers,
+        std::vector<double>& pattern_log_likelihoods,
+        const double minimum_log_likelihood
+        ) {
+    ECOEVOLITY_ASSERT((red_allele_count_matrix.size() == allele_count_matrix.size()) &&
+                      (red_allele_count_matrix.size() == pattern_weights.size()));
+    ECOEVOLITY_ASSERT(pattern_order.size() == pattern_weights.size());
+    ECOEVOLITY_ASSERT(pattern_log_likelihoods.size() == pattern_weights.size());
+    const std::vector<unsigned int> & pattern_indices = pattern_order.get_pattern_indices();
+    double log_likelihood = 0.0;
+    for (unsigned int position = start_position;
+            position < stop_position;
+            ++position) {
+        const unsigned int pattern_idx = pattern_indices[position];
+        const bool reusing_partials = (position > start_position);
+        const unsigned int previous_idx = reusing_partials ?
+                pattern_indices[position - 1] : pattern_idx;
+        double pattern_log_likelihood = compute_pattern_log_likelihood(tree,
+                thetas,
+                lengths,
+                workspace,
                 red_allele_count_matrix.at(pattern_idx),
                 allele_count_matrix.at(pattern_idx),
                 u,
                 v,
-                mutation_rate,
-                ploidy,
-                markers_are_dominant);
-        if (pattern_likelihood <= 0.0) {
+                markers_are_dominant,
+                theta_multipliers,
+                reusing_partials ? &red_allele_count_matrix.at(previous_idx) : nullptr,
+                reusing_partials ? &allele_count_matrix.at(previous_idx) : nullptr);
+        if (pattern_log_likelihood == -std::numeric_limits<double>::infinity()) {
             return -std::numeric_limits<double>::infinity();
         }
         double weight = (double) pattern_weights.at(pattern_idx);
-        log_likelihood += weight * std::log(pattern_likelihood);
+        pattern_log_likelihoods[pattern_idx] = weight * pattern_log_likelihood;
+        log_likelihood += pattern_log_likelihoods[pattern_idx];
+        if (log_likelihood < minimum_log_likelihood) {
+            return log_likelihood;
+        }
+    }
+    return log_likelihood;
+}
+
+/**
+ * get_log_likelihood for patterns computed in `pattern_order`. The log
+ * likelihoods of the patterns are summed in the order of the data, so the
+ * result does not depend on the order or the number of threads.
+ */
+static double get_log_likelihood_in_pattern_order(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
+        const std::vector< std::vector<unsigned int> >& allele_count_matrix,
+        const std::vector<unsigned int>& pattern_weights,
+        const std::vector< std::vector<unsigned int> > & unique_allele_counts,
+        const std::vector<unsigned int> & unique_allele_count_weights,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const bool state_frequencies_are_constrained,
+        const bool constant_sites_removed,
+        double& constant_log_likelihood_correction,
+        unsigned int nthreads,
+        const std::vector<double>& theta_multipliers,
+        const double minimum_log_likelihood,
+        ConstantPatternLikelihoodCache * constant_pattern_cache,
+        const PatternOrder& pattern_order
+        ) {
+    // The correction is subtracted from the sum over patterns, so it is
+    // added to the minimum for the sum
+    double minimum_pattern_log_likelihood = minimum_log_likelihood;
+    if (constant_sites_removed) {
+        compute_constant_pattern_log_likelihood_correction(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                unique_allele_counts,
+                unique_allele_count_weights,
+                u,
+                v,
+                markers_are_dominant,
+                state_frequencies_are_constrained,
+                constant_log_likelihood_correction,
+                theta_multipliers,
+                constant_pattern_cache);
+        minimum_pattern_log_likelihood += constant_log_likelihood_correction;
+    }
+    const unsigned int npatterns = pattern_weights.size();
+    // Patterns that are not computed (after stopping early) count as zero,
+    // so the sum is still an upper bound
+    std::vector<double> pattern_log_likelihoods(npatterns, 0.0);
+    double log_likelihood = 0.0;
+#ifdef BUILD_WITH_THREADS
+    if (npatterns < nthreads) {
+        nthreads = npatterns;
+    }
+    if (nthreads > 1) {
+        // Batches are contiguous in the order, so they keep most of the
+        // reuse of partials, and have about the same estimated cost
+        std::vector< std::future<double> > threads(nthreads - 1);
+        std::vector<FlatLikelihoodWorkspace> workspaces(nthreads - 1,
+                FlatLikelihoodWorkspace(tree.get_number_of_nodes()));
+        std::vector<double> * pattern_lnls = &pattern_log_likelihoods;
+        for (unsigned int i = 0; i < (nthreads - 1); ++i) {
+            FlatLikelihoodWorkspace * thread_workspace = &workspaces.at(i);
+            const unsigned int start_position = pattern_order.get_batch_start(i + 1, nthreads);
+            const unsigned int stop_position = pattern_order.get_batch_start(i + 2, nthreads);
+            threads.at(i) = std::async(
+                    std::launch::async,
+                    [&tree, &thetas, &lengths, thread_workspace,
+                            &red_allele_count_matrix, &allele_count_matrix,
+                            &pattern_weights, &pattern_order, start_position,
+                            stop_position, u, v, markers_are_dominant,
+                            &theta_multipliers, pattern_lnls,
+                            minimum_pattern_log_likelihood]() {
+                        return get_log_likelihood_for_ordered_pattern_range(
+                                tree,
+                                thetas,
+                                lengths,
+                                *thread_workspace,
+                                red_allele_count_matrix,
+                                allele_count_matrix,
+                                pattern_weights,
+                                pattern_order,
+                                start_position,
+                                stop_position,
+                                u,
+                                v,
+                                markers_are_dominant,
+                                theta_multipliers,
+                                *pattern_lnls,
+                                minimum_pattern_log_likelihood);
+                    });
+        }
+        // Use the main thread for the first batch
+        log_likelihood = get_log_likelihood_for_ordered_pattern_range(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                red_allele_count_matrix,
+                allele_count_matrix,
+                pattern_weights,
+                pattern_order,
+                0,
+                pattern_order.get_batch_start(1, nthreads),
+                u,
+                v,
+                markers_are_dominant,
+                theta_multipliers,
+                pattern_log_likelihoods,
+                minimum_pattern_log_likelihood);
+        for (auto &t : threads) {
+            if (t.get() == -std::numeric_limits<double>::infinity()) {
+                log_likelihood = -std::numeric_limits<double>::infinity();
+            }
+        }
+    }
+    else {
+#endif
+        log_likelihood = get_log_likelihood_for_ordered_pattern_range(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                red_allele_count_matrix,
+                allele_count_matrix,
+                pattern_weights,
+                pattern_order,
+                0,
+                npatterns,
+                u,
+                v,
+                markers_are_dominant,
+                theta_multipliers,
+                pattern_log_likelihoods,
+                minimum_pattern_log_likelihood);
+#ifdef BUILD_WITH_THREADS
+    }
+#endif
+    if (log_likelihood == -std::numeric_limits<double>::infinity()) {
+        return log_likelihood;
+    }
+    log_likelihood = 0.0;
+    for (auto lnl : pattern_log_likelihoods) {
+        log_likelihood += lnl;
     }
     return log_likelihood;
 }
 
 double get_log_likelihood(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
         const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
         const std::vector< std::vector<unsigned int> >& allele_count_matrix,
         const std::vector<unsigned int>& pattern_weights,
@@ -455,26 +1197,67 @@ double get_log_likelihood(
         const bool state_frequencies_are_constrained,
         const bool constant_sites_removed,
         double& constant_log_likelihood_correction,
-        unsigned int nthreads
+        unsigned int nthreads,
+        const std::vector<double>& theta_multipliers,
+        const double minimum_log_likelihood,
+        ConstantPatternLikelihoodCache * constant_pattern_cache,
+        const PatternOrder * pattern_order
         ) {
+    std::vector<double> thetas;
+    std::vector<double> lengths;
+    get_flat_branch_parameters(tree, mutation_rate, ploidy, thetas, lengths);
+    FlatLikelihoodWorkspace workspace(tree.get_number_of_nodes());
+    if (pattern_order && (pattern_order->size() == pattern_weights.size())) {
+        return get_log_likelihood_in_pattern_order(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                red_allele_count_matrix,
+                allele_count_matrix,
+                pattern_weights,
+                unique_allele_counts,
+                unique_allele_count_weights,
+                u,
+                v,
+                markers_are_dominant,
+                state_frequencies_are_constrained,
+                constant_sites_removed,
+                constant_log_likelihood_correction,
+                nthreads,
+                theta_multipliers,
+                minimum_log_likelihood,
+                constant_pattern_cache,
+                *pattern_order);
+    }
+    // The correction is subtracted from the sum over patterns, so it is
+    // added to the minimum for the sum
+    double minimum_pattern_log_likelihood = minimum_log_likelihood;
 #ifdef BUILD_WITH_THREADS
     if (nthreads < 2) {
 #endif
         if (constant_sites_removed) {
             compute_constant_pattern_log_likelihood_correction(
-                    root,
+                    tree,
+                    thetas,
+                    lengths,
+                    workspace,
                     unique_allele_counts,
                     unique_allele_count_weights,
                     u,
                     v,
-                    mutation_rate,
-                    ploidy,
                     markers_are_dominant,
                     state_frequencies_are_constrained,
-                    constant_log_likelihood_correction);
+                    constant_log_likelihood_correction,
+                    theta_multipliers,
+                    constant_pattern_cache);
+            minimum_pattern_log_likelihood += constant_log_likelihood_correction;
         }
         return get_log_likelihood_for_pattern_range(
-                root,
+                tree,
+                thetas,
+                lengths,
+                workspace,
                 red_allele_count_matrix,
                 allele_count_matrix,
                 pattern_weights,
@@ -482,9 +1265,9 @@ double get_log_likelihood(
                 pattern_weights.size(),
                 u,
                 v,
-                mutation_rate,
-                ploidy,
-                markers_are_dominant);
+                markers_are_dominant,
+                theta_multipliers,
+                minimum_pattern_log_likelihood);
 #ifdef BUILD_WITH_THREADS
     }
     double log_likelihood = 0.0;
@@ -495,45 +1278,85 @@ double get_log_likelihood(
     const unsigned int batch_size = npatterns / nthreads;
     unsigned int start_idx = 0;
     std::vector< std::future<double> > threads(nthreads - 1);
-    std::vector< std::shared_ptr<PopulationNode> > root_clones(nthreads - 1);
+    // Each thread only needs its own workspace; the flat tree and branch
+    // parameters are shared read-only
+    std::vector<FlatLikelihoodWorkspace> workspaces(nthreads - 1,
+            FlatLikelihoodWorkspace(tree.get_number_of_nodes()));
+
+    // With a minimum, the threads need the correction before they start.
+    // The log likelihood of each batch is an upper bound on the total, so
+    // each thread can stop as soon as its own sum drops below the minimum.
+    const bool correcting_first = (constant_sites_removed &&
+            (minimum_log_likelihood > -std::numeric_limits<double>::infinity()));
+    if (correcting_first) {
+        compute_constant_pattern_log_likelihood_correction(
+                tree,
+                thetas,
+                lengths,
+                workspace,
+                unique_allele_counts,
+                unique_allele_count_weights,
+                u,
+                v,
+                markers_are_dominant,
+                state_frequencies_are_constrained,
+                constant_log_likelihood_correction,
+                theta_multipliers,
+                constant_pattern_cache);
+        minimum_pattern_log_likelihood += constant_log_likelihood_correction;
+    }
 
     // Launch nthreads - 1 threads
     for (unsigned int i = 0; i < (nthreads - 1); ++i) {
-        root_clones.at(i) = root.get_clade_clone();
+        FlatLikelihoodWorkspace * thread_workspace = &workspaces.at(i);
         threads.at(i) = std::async(
                 std::launch::async,
-                get_log_likelihood_for_pattern_range,
-                std::ref(*root_clones.at(i)),
-                std::cref(red_allele_count_matrix),
-                std::cref(allele_count_matrix),
-                std::cref(pattern_weights),
-                start_idx,
-                start_idx + batch_size,
-                u,
-                v,
-                mutation_rate,
-                ploidy,
-                markers_are_dominant
-                );
+                [&tree, &thetas, &lengths, thread_workspace,
+                        &red_allele_count_matrix, &allele_count_matrix,
+                        &pattern_weights, start_idx, batch_size, u, v,
+                        markers_are_dominant, &theta_multipliers,
+                        minimum_pattern_log_likelihood]() {
+                    return get_log_likelihood_for_pattern_range(
+                            tree,
+                            thetas,
+                            lengths,
+                            *thread_workspace,
+                            red_allele_count_matrix,
+                            allele_count_matrix,
+                            pattern_weights,
+                            start_idx,
+                            start_idx + batch_size,
+                            u,
+                            v,
+                            markers_are_dominant,
+                            theta_multipliers,
+                            minimum_pattern_log_likelihood);
+                });
         start_idx += batch_size;
     }
 
     // Use the main thread as the last thread
-    if (constant_sites_removed) {
+    if (constant_sites_removed && (! correcting_first)) {
         compute_constant_pattern_log_likelihood_correction(
-                root,
+                tree,
+                thetas,
+                lengths,
+                workspace,
                 unique_allele_counts,
                 unique_allele_count_weights,
                 u,
                 v,
-                mutation_rate,
-                ploidy,
                 markers_are_dominant,
                 state_frequencies_are_constrained,
-                constant_log_likelihood_correction);
+                constant_log_likelihood_correction,
+                theta_multipliers,
+                constant_pattern_cache);
     }
     log_likelihood += get_log_likelihood_for_pattern_range(
-            root,
+            tree,
+            thetas,
+            lengths,
+            workspace,
             red_allele_count_matrix,
             allele_count_matrix,
             pattern_weights,
@@ -541,9 +1364,9 @@ double get_log_likelihood(
             pattern_weights.size(),
             u,
             v,
-            mutation_rate,
-            ploidy,
-            markers_are_dominant);
+            markers_are_dominant,
+            theta_multipliers,
+            minimum_pattern_log_likelihood);
 
     // Join the launched threads
     for (auto &t : threads) {
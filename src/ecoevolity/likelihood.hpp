@@ -22,31 +22,188 @@
 
 #include <algorithm>
 #include <memory>
+#include <cmath>
+#include <limits>
+#include <map>
 
 #ifdef BUILD_WITH_THREADS
 #include <future>
 #endif
 
 #include "node.hpp"
+#include "flattree.hpp"
 #include "matrix.hpp"
 #include "error.hpp"
 #include "assert.hpp"
 
-void compute_leaf_partials(
-        PopulationNode& node,
+/**
+ * Scratch space for computing pattern likelihoods on a
+ * FlatTree<PopulationNode>. The partials of each node are stored by the
+ * node's post-order index, so each thread only needs its own workspace
+ * rather than its own copy of the tree.
+ *
+ * To avoid underflow with many alleles, the partials of a node are rescaled
+ * by a power of two whenever their largest value drops below
+ * `rescale_threshold`. The true partials of node i are the stored partials
+ * times 2^scale_exponents[i]. Scaling by a power of two is exact, and the
+ * default threshold is low enough that typical data sets are never scaled.
+ */
+class FlatLikelihoodWorkspace {
+    public:
+        FlatLikelihoodWorkspace() { }
+        FlatLikelihoodWorkspace(unsigned int number_of_nodes) {
+            this->resize(number_of_nodes);
+        }
+        void resize(unsigned int number_of_nodes) {
+            this->bottom_pattern_probs.resize(number_of_nodes);
+            this->top_pattern_probs.resize(number_of_nodes);
+            this->scale_exponents.resize(number_of_nodes, 0);
+            this->partials_are_reused.resize(number_of_nodes, false);
+        }
+
+        std::vector<BiallelicPatternProbabilityMatrix> bottom_pattern_probs;
+        std::vector<BiallelicPatternProbabilityMatrix> top_pattern_probs;
+        std::vector<int> scale_exponents;
+        std::vector<bool> partials_are_reused;
+        std::vector<double> child1_pattern_probs;
+        std::vector<double> child2_pattern_probs;
+        std::vector<double> merged_pattern_probs;
+        double rescale_threshold = std::ldexp(1.0, -128);
+};
+
+/**
+ * Partials of the constant patterns used to correct the likelihood for
+ * removed constant sites, kept between likelihood calculations.
+ *
+ * The partials of a node only depend on the allele counts of the leaves
+ * below it, so each node stores the partials of each distinct set of leaf
+ * allele counts (signature) among the unique allele-count vectors. The
+ * partials of a node are only recomputed if its branch parameters, or the
+ * leaves or partials below it, have changed since the last call. The results
+ * are identical to compute_constant_pattern_log_likelihood_correction
+ * without a cache.
+ *
+ * The cache must be cleared if the allele counts change, and can only be
+ * used by one thread at a time.
+ */
+class ConstantPatternLikelihoodCache {
+    protected:
+        struct NodePartials {
+            bool has_signatures = false;
+            bool has_partials = false;
+            int leaf_index = -1;
+            std::vector<unsigned int> child_indices;
+            double theta = std::numeric_limits<double>::quiet_NaN();
+            double length = std::numeric_limits<double>::quiet_NaN();
+            // Signature of each unique allele-count vector
+            std::vector<unsigned int> pattern_signatures;
+            // Allele count of each signature of a leaf, or the signatures of
+            // the children for each signature of an internal node
+            std::vector< std::vector<unsigned int> > signature_keys;
+            // Top-of-branch partials of each signature (bottom for the root)
+            std::vector<BiallelicPatternProbabilityMatrix> green_probs;
+            std::vector<BiallelicPatternProbabilityMatrix> red_probs;
+            std::vector<int> green_scale_exponents;
+            std::vector<int> red_scale_exponents;
+        };
+
+        std::vector<NodePartials> nodes_;
+        std::vector<double> root_green_likelihoods_;
+        std::vector<double> root_red_likelihoods_;
+        double root_theta_ = std::numeric_limits<double>::quiet_NaN();
+        unsigned int number_of_patterns_ = 0;
+        double u_ = std::numeric_limits<double>::quiet_NaN();
+        double v_ = std::numeric_limits<double>::quiet_NaN();
+        bool markers_are_dominant_ = false;
+        bool state_frequencies_are_constrained_ = false;
+        std::vector<double> theta_multipliers_;
+        unsigned int number_of_partials_computed_ = 0;
+
+    public:
+        void clear();
+
+        /**
+         * Number of signature partials computed so far (i.e., not found in
+         * the cache).
+         */
+        unsigned int get_number_of_partials_computed() const {
+            return this->number_of_partials_computed_;
+        }
+
+        void compute_constant_pattern_log_likelihood_correction(
+                const FlatTree<PopulationNode>& tree,
+                const std::vector<double>& thetas,
+                const std::vector<double>& lengths,
+                FlatLikelihoodWorkspace& workspace,
+                const std::vector< std::vector<unsigned int> > & unique_allele_counts,
+                const std::vector<unsigned int> & unique_allele_count_weights,
+                const double u,
+                const double v,
+                const bool markers_are_dominant,
+                const bool state_frequencies_are_constrained,
+                double& constant_log_likelihood_correction,
+                const std::vector<double>& theta_multipliers = std::vector<double>()
+                );
+};
+
+/**
+ * An order in which to compute the likelihoods of the patterns, and batches
+ * of it with about the same cost for threads.
+ *
+ * Patterns are sorted by the allele counts (then red allele counts) of the
+ * populations in order, so that consecutive patterns often share the counts
+ * of the leaves below a node, and the partials of the node computed for one
+ * pattern can be reused for the next. The cost of a pattern is estimated as
+ * the square of its total allele count.
+ *
+ * The order must be updated if the patterns change.
+ */
+class PatternOrder {
+    protected:
+        std::vector<unsigned int> pattern_indices_;
+        std::vector<double> cumulative_costs_;
+
+    public:
+        void update(
+                const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
+                const std::vector< std::vector<unsigned int> >& allele_count_matrix);
+        void clear();
+
+        unsigned int size() const {
+            return this->pattern_indices_.size();
+        }
+        const std::vector<unsigned int> & get_pattern_indices() const {
+            return this->pattern_indices_;
+        }
+
+        /**
+         * Position in the order at which batch `batch_index` (of
+         * `number_of_batches`) starts. Batch `number_of_batches` starts at
+         * the end.
+         */
+        unsigned int get_batch_start(
+                unsigned int batch_index,
+                unsigned int number_of_batches) const;
+};
+
+/**
+ * If the largest of `pattern_probs` is positive and less than `threshold`,
+ * multiplies all of them by the power of two that brings the largest into
+ * [0.5, 1), and subtracts that power from `scale_exponent`. Returns true if
+ * the probabilities were rescaled.
+ */
+bool rescale_pattern_probs(
+        std::vector<double> & pattern_probs,
+        const double threshold,
+        int & scale_exponent);
+
+void compute_leaf_pattern_probs(
+        BiallelicPatternProbabilityMatrix& pattern_probs,
         const unsigned int red_allele_count,
         const unsigned int allele_count,
         const bool markers_are_dominant
         );
 
-void compute_top_of_branch_partials(
-        PopulationNode& node,
-        const double u,
-        const double v,
-        const double mutation_rate, 
-        const double ploidy
-        );
-
 void merge_top_of_branch_partials(
         const unsigned int allele_count_child1,
         const unsigned int allele_count_child2,
@@ -55,62 +212,120 @@ void merge_top_of_branch_partials(
         unsigned int & merged_allele_count,
         std::vector<double> & merged_pattern_probs);
 
-void compute_internal_partials(
-        PopulationNode& node);
+std::vector< std::vector<double> > compute_root_probabilities(
+        const unsigned int allele_count,
+        const double u,
+        const double v,
+        const double theta
+        );
 
-void compute_pattern_partials(
-        PopulationNode& node,
-        const std::vector<unsigned int>& red_allele_counts,
-        const std::vector<unsigned int>& allele_counts,
+double compute_root_likelihood(
+        const BiallelicPatternProbabilityMatrix& bottom_pattern_probs,
         const double u,
         const double v,
+        const double theta
+        );
+
+/**
+ * Functions for computing likelihoods on a FlatTree<PopulationNode>.
+ *
+ * If `theta_multipliers` is not empty, the population size of each branch is
+ * integrated out of the likelihood of each pattern: the partials at the top
+ * of each branch (and the conditional probabilities at the root) are
+ * averaged over the branch's theta multiplied by each multiplier (e.g., the
+ * category means of a discretized gamma distribution with a mean of 1).
+ */
+void get_flat_branch_parameters(
+        const FlatTree<PopulationNode>& tree,
         const double mutation_rate,
         const double ploidy,
-        const bool markers_are_dominant
+        std::vector<double>& thetas,
+        std::vector<double>& lengths
         );
 
-std::vector< std::vector<double> > compute_root_probabilities(
-        const PopulationNode& root,
+/**
+ * If the allele counts of the previous pattern computed with `workspace`
+ * are given, the partials of the nodes with the same leaf allele counts
+ * below them are not recomputed.
+ */
+void compute_pattern_partials(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector<unsigned int>& red_allele_counts,
+        const std::vector<unsigned int>& allele_counts,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers = std::vector<double>(),
+        const std::vector<unsigned int> * previous_red_allele_counts = nullptr,
+        const std::vector<unsigned int> * previous_allele_counts = nullptr
         );
 
-double compute_root_likelihood(
-        const PopulationNode& root,
+double compute_pattern_likelihood(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector<unsigned int>& red_allele_counts,
+        const std::vector<unsigned int>& allele_counts,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers = std::vector<double>()
         );
 
-double compute_pattern_likelihood(
-        PopulationNode& root,
+/**
+ * Log likelihood of a pattern, including the scale factors of the partials,
+ * so it does not underflow even if the likelihood is smaller than the
+ * smallest double.
+ */
+double compute_pattern_log_likelihood(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector<unsigned int>& red_allele_counts,
         const std::vector<unsigned int>& allele_counts,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
-        const bool markers_are_dominant
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers = std::vector<double>(),
+        const std::vector<unsigned int> * previous_red_allele_counts = nullptr,
+        const std::vector<unsigned int> * previous_allele_counts = nullptr
         );
 
+/**
+ * If `cache` is not null, the correction is computed with it.
+ */
 void compute_constant_pattern_log_likelihood_correction(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector< std::vector<unsigned int> > & unique_allele_counts,
         const std::vector<unsigned int> & unique_allele_count_weights,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
         const bool markers_are_dominant,
         const bool state_frequencies_are_constrained,
-        double& constant_log_likelihood_correction
+        double& constant_log_likelihood_correction,
+        const std::vector<double>& theta_multipliers = std::vector<double>(),
+        ConstantPatternLikelihoodCache * cache = nullptr
         );
 
+/**
+ * The log likelihood of each pattern is at most zero, so the sum over
+ * patterns can only decrease. If it drops below `minimum_log_likelihood`,
+ * the remaining patterns are skipped and the partial sum, which is an upper
+ * bound on the log likelihood, is returned.
+ */
 double get_log_likelihood_for_pattern_range(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
         const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
         const std::vector< std::vector<unsigned int> >& allele_count_matrix,
         const std::vector<unsigned int>& pattern_weights,
@@ -118,13 +333,51 @@ double get_log_likelihood_for_pattern_range(
         const unsigned int stop_index,
         const double u,
         const double v,
-        const double mutation_rate,
-        const double ploidy,
-        const bool markers_are_dominant
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers = std::vector<double>(),
+        const double minimum_log_likelihood = -std::numeric_limits<double>::infinity()
         );
 
+/**
+ * get_log_likelihood_for_pattern_range for the patterns at positions
+ * `start_position` to `stop_position` in `pattern_order`. The weighted log
+ * likelihood of each pattern is also stored in `pattern_log_likelihoods` at
+ * the index of the pattern.
+ */
+double get_log_likelihood_for_ordered_pattern_range(
+        const FlatTree<PopulationNode>& tree,
+        const std::vector<double>& thetas,
+        const std::vector<double>& lengths,
+        FlatLikelihoodWorkspace& workspace,
+        const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
+        const std::vector< std::vector<unsigned int> >& allele_count_matrix,
+        const std::vector<unsigned int>& pattern_weights,
+        const PatternOrder& pattern_order,
+        const unsigned int start_position,
+        const unsigned int stop_position,
+        const double u,
+        const double v,
+        const bool markers_are_dominant,
+        const std::vector<double>& theta_multipliers,
+        std::vector<double>& pattern_log_likelihoods,
+        const double minimum_log_likelihood = -std::numeric_limits<double>::infinity()
+        );
+
+/**
+ * If the log likelihood (i.e., the returned sum over patterns less
+ * `constant_log_likelihood_correction`) is found to be less than
+ * `minimum_log_likelihood`, the calculation stops early and an upper bound
+ * that is less than `minimum_log_likelihood` is returned.
+ *
+ * If `constant_pattern_cache` is not null, the correction for constant sites
+ * is computed with it.
+ *
+ * If `pattern_order` is not null and has the same number of patterns, the
+ * patterns are computed in that order (and threads get batches of about the
+ * same cost), but the result is the same.
+ */
 double get_log_likelihood(
-        PopulationNode& root,
+        const FlatTree<PopulationNode>& tree,
         const std::vector< std::vector<unsigned int> >& red_allele_count_matrix,
         const std::vector< std::vector<unsigned int> >& allele_count_matrix,
         const std::vector<unsigned int>& pattern_weights,
@@ -138,7 +391,11 @@ double get_log_likelihood(
         const bool state_frequencies_are_constrained,
         const bool constant_sites_removed,
         double& constant_log_likelihood_correction,
-        unsigned int nthreads = 1
+        unsigned int nthreads = 1,
+        const std::vector<double>& theta_multipliers = std::vector<double>(),
+        const double minimum_log_likelihood = -std::numeric_limits<double>::infinity(),
+        ConstantPatternLikelihoodCache * constant_pattern_cache = nullptr,
+        const PatternOrder * pattern_order = nullptr
         );
 
 #endif
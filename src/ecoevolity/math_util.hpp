@@ -25,6 +25,7 @@
 #include <map>
 #include <algorithm>
 #include <numeric>
+#include <limits>
 
 #include "assert.hpp"
 #include "error.hpp"
@@ -126,6 +127,27 @@ inline void normalize_log_likelihoods(std::vector<double>& v) {
     ECOEVOLITY_ASSERT_APPROX_EQUAL(t, 1.0);
 }
 
+/**
+ * Log of the sum of the exponentials of the elements of `v`, without
+ * overflow. Returns -inf if all the elements are -inf (or `v` is empty).
+ */
+inline double log_sum_exp(const std::vector<double>& v) {
+    double mx = -std::numeric_limits<double>::infinity();
+    for (auto v_iter : v) {
+        if (v_iter > mx) {
+            mx = v_iter;
+        }
+    }
+    if (mx == -std::numeric_limits<double>::infinity()) {
+        return mx;
+    }
+    double sum = 0.0;
+    for (auto v_iter : v) {
+        sum += std::exp(v_iter - mx);
+    }
+    return mx + std::log(sum);
+}
+
 /**
  * Calculate the expected number of categories under a Dirichlet process.
  *
@@ -557,6 +579,97 @@ inline long double bell_float(int n) {
     return bell_number_base<long double>(n);
 }
 
+/**
+ * Tables of the logs of Stirling numbers of the second kind and Bell
+ * numbers.
+ *
+ * Rows of the Stirling triangle are computed with the recurrence
+ * S(n, k) = k S(n-1, k) + S(n-1, k-1) on the log scale, so there is no
+ * overflow, and the table only grows as larger numbers of elements are
+ * requested. Each thread has its own table, so lookups are O(1) and need no
+ * locking; each row is computed once per thread.
+ */
+class LogStirlingNumbers {
+    protected:
+        // Row n has the log Stirling numbers for k = 0, 1, ..., n
+        std::vector< std::vector<double> > ln_stirling2_;
+        std::vector<double> ln_bell_;
+
+        LogStirlingNumbers() {
+            this->ln_stirling2_.push_back(std::vector<double>(1, 0.0));
+            this->ln_bell_.push_back(0.0);
+        }
+
+        static LogStirlingNumbers & instance_() {
+            thread_local LogStirlingNumbers table;
+            return table;
+        }
+
+        void grow_(unsigned int n) {
+            const double neg_inf = -std::numeric_limits<double>::infinity();
+            while (this->ln_stirling2_.size() <= n) {
+                const std::vector<double> & previous = this->ln_stirling2_.back();
+                unsigned int m = previous.size();
+                std::vector<double> row(m + 1, neg_inf);
+                for (unsigned int k = 1; k <= m; ++k) {
+                    double a = neg_inf;
+                    if (k < m) {
+                        a = std::log((double)k) + previous.at(k);
+                    }
+                    double b = previous.at(k - 1);
+                    double mx = std::max(a, b);
+                    if (mx == neg_inf) {
+                        continue;
+                    }
+                    row.at(k) = mx + std::log(std::exp(a - mx) + std::exp(b - mx));
+                }
+                double mx = *std::max_element(row.begin(), row.end());
+                double sum = 0.0;
+                for (auto ln_s : row) {
+                    sum += std::exp(ln_s - mx);
+                }
+                this->ln_bell_.push_back(mx + std::log(sum));
+                this->ln_stirling2_.push_back(row);
+            }
+        }
+
+    public:
+        LogStirlingNumbers(const LogStirlingNumbers &) = delete;
+        LogStirlingNumbers & operator=(const LogStirlingNumbers &) = delete;
+
+        /**
+         * Log of the number of ways to partition n elements into k non-empty
+         * subsets. Returns -inf if there are none.
+         */
+        static double ln_stirling2(unsigned int n, unsigned int k) {
+            ECOEVOLITY_ASSERT(n >= k);
+            LogStirlingNumbers & table = instance_();
+            if (table.ln_stirling2_.size() <= n) {
+                table.grow_(n);
+            }
+            return table.ln_stirling2_.at(n).at(k);
+        }
+
+        /**
+         * Log of the number of partitions of n elements.
+         */
+        static double ln_bell_number(unsigned int n) {
+            LogStirlingNumbers & table = instance_();
+            if (table.ln_bell_.size() <= n) {
+                table.grow_(n);
+            }
+            return table.ln_bell_.at(n);
+        }
+};
+
+inline double ln_stirling2(unsigned int n, unsigned int k) {
+    return LogStirlingNumbers::ln_stirling2(n, k);
+}
+
+inline double ln_bell_number(unsigned int n) {
+    return LogStirlingNumbers::ln_bell_number(n);
+}
+
 template <typename T>
 inline double get_uniform_model_log_prior_probability(
         const unsigned int number_of_elements,
@@ -590,10 +703,18 @@ inline double get_uniform_model_log_prior_probability(
         const unsigned int number_of_elements,
         const unsigned int number_of_categories,
         const double split_weight) {
-    return get_uniform_model_log_prior_probability<long double>(
-            number_of_elements,
-            number_of_categories,
-            split_weight);
+    ECOEVOLITY_ASSERT(split_weight > 0.0);
+    ECOEVOLITY_ASSERT(number_of_elements > 0);
+    ECOEVOLITY_ASSERT(number_of_categories > 0);
+    ECOEVOLITY_ASSERT(number_of_categories <= number_of_elements);
+    double ln_split_weight = std::log(split_weight);
+    std::vector<double> ln_k_weights(number_of_elements);
+    for (unsigned int k = 1; k <= number_of_elements; ++k) {
+        ln_k_weights.at(k - 1) = ln_stirling2(number_of_elements, k) +
+                ((k - 1) * ln_split_weight);
+    }
+    return ((number_of_categories - 1) * ln_split_weight) -
+            log_sum_exp(ln_k_weights);
 }
 
 /**
@@ -650,26 +771,16 @@ inline void get_number_of_subset_probs(std::vector<long double> & number_of_subs
     ECOEVOLITY_ASSERT(split_weight > 0.0);
     ECOEVOLITY_ASSERT(number_of_subset_probs.size() > 0);
     unsigned int number_of_elements = number_of_subset_probs.size();
-    long double sum_of_k_weights = 0.0;
-    long double k_weight = 0.0;
+    double ln_split_weight = std::log(split_weight);
+    std::vector<double> ln_k_weights(number_of_elements);
     for (unsigned int i = 0; i < number_of_elements; ++i) {
-        unsigned int k = i + 1;
-        long double number_of_partitions_with_k_subsets = stirling2_base<long double>(number_of_elements, k);
-        long double weight_of_each_partition = std::pow(split_weight, (k - 1));
-        // Check for multiplication overflow
-        if (weight_of_each_partition > (std::numeric_limits<long double>::max() / number_of_partitions_with_k_subsets)) {
-            throw EcoevolityNumericLimitError("Overflow during multiplication in get_number_of_subset_probs");
-        }
-        k_weight = number_of_partitions_with_k_subsets * weight_of_each_partition;
-        number_of_subset_probs.at(i) = k_weight;
-        // Check for addition overflow
-        if (sum_of_k_weights > (std::numeric_limits<long double>::max() - k_weight)) {
-            throw EcoevolityNumericLimitError("Overflow during addition in get_number_of_subset_probs");
-        }
-        sum_of_k_weights += k_weight;
+        ln_k_weights.at(i) = ln_stirling2(number_of_elements, i + 1) +
+                (i * ln_split_weight);
     }
+    double ln_sum_of_k_weights = log_sum_exp(ln_k_weights);
     for (unsigned int i = 0; i < number_of_elements; ++i) {
-        number_of_subset_probs.at(i) = number_of_subset_probs.at(i) / sum_of_k_weights;
+        number_of_subset_probs.at(i) = std::exp(
+                (long double)(ln_k_weights.at(i) - ln_sum_of_k_weights));
     }
 }
 
@@ -680,6 +791,65 @@ inline std::vector<long double> get_number_of_subset_probs(unsigned int number_o
     return number_of_subset_probs;
 }
 
+/**
+ * Calculate the log probabilities of the number of categories under a
+ * Pitman-Yor process (a Dirichlet process if 'discount' is zero).
+ *
+ * Element i of the returned vector is the log probability of i + 1
+ * categories for 'number_of_elements' elements. The distribution is built up
+ * exactly by adding elements one at a time: when i elements are in k
+ * categories, the next element starts a new category with probability
+ * (concentration + discount * k) / (concentration + i). This takes
+ * O(n^2) time and is done on the log scale, so it works for numbers of
+ * elements far beyond what enumerating partitions allows. With no discount,
+ * this is the recurrence of the unsigned Stirling numbers of the first kind,
+ * and the result is |s(n,k)| concentration^k / (concentration)_n.
+ */
+inline std::vector<double> get_pyp_log_number_of_category_probs(
+        unsigned int number_of_elements,
+        double concentration,
+        double discount = 0.0) {
+    ECOEVOLITY_ASSERT(number_of_elements > 0);
+    ECOEVOLITY_ASSERT((discount >= 0.0) && (discount < 1.0));
+    ECOEVOLITY_ASSERT(concentration > -discount);
+    std::vector<double> log_probs(number_of_elements,
+            -std::numeric_limits<double>::infinity());
+    log_probs.at(0) = 0.0;
+    for (unsigned int i = 1; i < number_of_elements; ++i) {
+        double log_denom = std::log(concentration + i);
+        // Going from most to fewest categories lets us update in place
+        for (unsigned int k = i + 1; k > 0; --k) {
+            double ln_stay = -std::numeric_limits<double>::infinity();
+            double ln_new = -std::numeric_limits<double>::infinity();
+            if (k <= i) {
+                ln_stay = log_probs.at(k - 1) +
+                        std::log(i - (k * discount)) - log_denom;
+            }
+            if (k > 1) {
+                ln_new = log_probs.at(k - 2) +
+                        std::log(concentration + ((k - 1) * discount)) -
+                        log_denom;
+            }
+            double mx = std::max(ln_stay, ln_new);
+            if (mx == -std::numeric_limits<double>::infinity()) {
+                log_probs.at(k - 1) = mx;
+                continue;
+            }
+            log_probs.at(k - 1) = mx + std::log(
+                    std::exp(ln_stay - mx) + std::exp(ln_new - mx));
+        }
+    }
+    return log_probs;
+}
+
+inline std::vector<double> get_dpp_log_number_of_category_probs(
+        unsigned int number_of_elements,
+        double concentration) {
+    ECOEVOLITY_ASSERT(concentration > 0.0);
+    return get_pyp_log_number_of_category_probs(number_of_elements,
+            concentration, 0.0);
+}
+
 
 /**
  * Calculate log factorial.
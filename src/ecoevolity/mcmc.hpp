@@ -24,8 +24,12 @@
 #include "error.hpp"
 
 #include "tree.hpp"
+#include "binlog.hpp"
 #include "general_tree_operator.hpp"
 #include "general_tree_operator_schedule.hpp"
+#include "generalized_tree_counts.hpp"
+#include "prior_sampling.hpp"
+#include "async_log_writer.hpp"
 
 template<class TreeType>
 inline void mcmc(
@@ -41,17 +45,53 @@ inline void mcmc(
         std::ostream & std_output_stream,
         const std::string & logging_delimiter = "\t",
         const unsigned int logging_precision = 18,
-        const unsigned int nthreads = 1) {
+        const unsigned int nthreads = 1,
+        const bool binary_logs = false,
+        const unsigned int operator_weight_adaptation_generations = 0,
+        const unsigned int number_of_speculative_moves = 0) {
     tree_log_stream.precision(logging_precision);
     state_log_stream.precision(logging_precision);
     operator_log_stream.precision(logging_precision);
 
-    tree.write_state_log_header(state_log_stream, logging_delimiter);
-    tree.write_state_log_header(std_output_stream, logging_delimiter, true);
+    // Samples are formatted here, but written to the log files by a
+    // background thread (with threads), so the chain does not wait on them
+    AsyncLogStream tree_log(tree_log_stream);
+    AsyncLogStream state_log(state_log_stream);
+    AsyncLogStream operator_log(operator_log_stream);
 
-    tree_log_stream << "#NEXUS" << std::endl;
-    tree.write_nexus_taxa_block(tree_log_stream);
-    tree_log_stream << "\nBEGIN TREES;\n";
+    // With binary logs, the tree and state log streams should be opened in
+    // binary mode by the caller
+    binlog::StateLogWriter binary_state_log(state_log);
+    binlog::TreeLogWriter<TreeType> binary_tree_log(tree_log);
+    std::vector<double> state_values;
+    auto log_sample = [&](unsigned int generation_index) {
+        if (binary_logs) {
+            state_values.clear();
+            tree.get_state_log_values(state_values, generation_index);
+            binary_state_log.write_row(state_values);
+            binary_tree_log.log_tree(tree, generation_index);
+        }
+        else {
+            tree.log_state(state_log, generation_index, logging_delimiter);
+            tree.log_nexus_tree(tree_log, generation_index, true, logging_precision);
+        }
+    };
+
+    if (binary_logs) {
+        std::ostringstream header;
+        tree.write_state_log_header(header, logging_delimiter);
+        binary_state_log.write_header(string_util::split(
+                string_util::rstrip(header.str(), "\r\n"),
+                logging_delimiter.at(0)));
+        binary_tree_log.write_header(tree);
+    }
+    else {
+        tree.write_state_log_header(state_log, logging_delimiter);
+        tree_log << "#NEXUS" << std::endl;
+        tree.write_nexus_taxa_block(tree_log);
+        tree_log << "\nBEGIN TREES;\n";
+    }
+    tree.write_state_log_header(std_output_stream, logging_delimiter, true);
 
     tree.make_dirty();
     tree.compute_log_likelihood_and_prior(nthreads);
@@ -73,35 +113,71 @@ inline void mcmc(
                 << "#######################################################################\n";
         throw EcoevolityError(message.str());
     }
-    tree.log_state(state_log_stream, 0, logging_delimiter);
+    log_sample(0);
     tree.log_state(std_output_stream, 0, logging_delimiter, true);
-    tree.log_nexus_tree(tree_log_stream, 0, true, logging_precision);
 
     std::shared_ptr< GeneralTreeOperatorTemplate< TreeType > > op;
     unsigned int gen;
     unsigned int gen_of_last_state_log = 0;
     unsigned int gen_of_last_operator_log = 0;
+    if (operator_weight_adaptation_generations > 0) {
+        operator_schedule.start_weight_adaptation();
+    }
     for (gen = 0; gen < chain_length; ++gen) {
-        for (unsigned int move_count = 0;
-                move_count < number_of_moves_per_generation;
-                ++move_count) {
+        unsigned int move_count = 0;
+        while (move_count < number_of_moves_per_generation) {
+            if (operator_schedule.adapting_weights()) {
+                operator_schedule.perform_weight_adaptation_move(rng, &tree, nthreads);
+                ++move_count;
+                continue;
+            }
+            // Batches of speculative moves do not cross generations, so that
+            // states are logged as in the serial chain
+            if (number_of_speculative_moves > 1) {
+                move_count += operator_schedule.perform_speculative_moves(rng,
+                        &tree,
+                        std::min(number_of_speculative_moves,
+                                number_of_moves_per_generation - move_count));
+                continue;
+            }
             op = operator_schedule.draw_operator(rng);
             op->operate_with_helpers(rng,
                     &tree,
                     nthreads, 1, 1);
+            ++move_count;
+        }
+
+        // Weights are frozen after adaptation, so that the chain is a fixed
+        // mixture of kernels thereafter. The samples logged up to this
+        // generation (including the initial state) are not from that chain,
+        // so the burn-in used when summarizing must be at least this many
+        // samples
+        if ((gen + 1) == operator_weight_adaptation_generations) {
+            operator_schedule.stop_weight_adaptation();
+            const unsigned int min_burnin =
+                    ((gen + 1) / sample_frequency) + 1;
+            operator_log << "operator weights adapted at generation " << gen + 1 << ":\n";
+            operator_schedule.write_weight_adaptation_summary(operator_log);
+            operator_log << "minimum burn-in: " << min_burnin << " samples\n";
+            std_output_stream << "\nOperator weights adapted at generation " << gen + 1 << ":\n";
+            operator_schedule.write_weight_adaptation_summary(std_output_stream);
+            std_output_stream << "At least the first " << min_burnin
+                              << " samples should be discarded as burn-in,\n"
+                              << "because they were drawn while adapting operator weights\n\n";
         }
 
         if ((gen + 1) % sample_frequency == 0) {
-            tree.log_state(state_log_stream, gen + 1, logging_delimiter);
-            tree.log_nexus_tree(tree_log_stream, gen + 1, true, logging_precision);
+            log_sample(gen + 1);
             gen_of_last_state_log = gen;
             // Log every 10th sample to std out
             if ((gen + 1) % (sample_frequency * 10) == 0) {
                 tree.log_state(std_output_stream, gen + 1, logging_delimiter, true);
                 // Log operator performance every 100 samples
                 if ((gen + 1) % (sample_frequency * 100) == 0) {
-                    operator_log_stream << "generation " << gen + 1 << ":\n";
-                    operator_schedule.write_operator_rates(operator_log_stream);
+                    operator_log << "generation " << gen + 1 << ":\n";
+                    operator_schedule.write_operator_rates(operator_log);
+                    operator_log << "operator costs:\n";
+                    operator_schedule.write_operator_costs(operator_log);
                     gen_of_last_operator_log = gen;
                 }
             }
@@ -109,18 +185,147 @@ inline void mcmc(
     }
     // Make sure last generation is reported
     if (gen > (gen_of_last_state_log + 1)) {
-        tree.log_state(state_log_stream, gen + 1, logging_delimiter);
+        log_sample(gen + 1);
         tree.log_state(std_output_stream, gen + 1, logging_delimiter, true);
-        tree.log_nexus_tree(tree_log_stream, gen + 1, true, logging_precision);
     }
     if (gen > (gen_of_last_operator_log + 1)) {
-        operator_log_stream << "generation " << gen + 1 << ":\n";
-        operator_schedule.write_operator_rates(operator_log_stream);
+        operator_log << "generation " << gen + 1 << ":\n";
+        operator_schedule.write_operator_rates(operator_log);
+        operator_log << "operator costs:\n";
+        operator_schedule.write_operator_costs(operator_log);
+    }
+    if (! binary_logs) {
+        tree_log << "END;";
     }
-    tree_log_stream << "END;";
+    tree_log.close();
+    state_log.close();
+    operator_log.close();
     std_output_stream << "\nOperator stats:\n";
     operator_schedule.write_operator_rates(std_output_stream);
+    std_output_stream << "\nOperator costs:\n";
+    operator_schedule.write_operator_costs(std_output_stream);
     std_output_stream << "\n";
 }
 
+/**
+ * Writes independent draws from the prior to the tree and state logs, in
+ * place of the samples that an MCMC chain of `chain_length` generations
+ * would log. The trees must ignore the data.
+ *
+ * The topology is drawn uniformly from the bifurcating or generalized trees
+ * if `sampling_topology` is true; otherwise, it is fixed. The first tree is
+ * the model to log; the others are separate copies of it with which to draw
+ * samples in parallel threads. Binary tree logs are written in the order the
+ * samples are drawn, so only one tree can be used with `binary_logs`.
+ */
+template<class TreeType>
+inline void sample_prior_directly(
+        RandomNumberGenerator & rng,
+        const std::vector<TreeType *> & trees,
+        const bool sampling_topology,
+        const bool bifurcating_topology,
+        const unsigned int chain_length,
+        const unsigned int sample_frequency,
+        std::ostream & tree_log_stream,
+        std::ostream & state_log_stream,
+        std::ostream & std_output_stream,
+        const std::string & logging_delimiter = "\t",
+        const unsigned int logging_precision = 18,
+        const bool binary_logs = false) {
+    ECOEVOLITY_ASSERT(trees.size() > 0);
+    for (auto tree : trees) {
+        if (! tree->ignoring_data()) {
+            throw EcoevolityError(
+                    "The data must be ignored to sample directly from the prior");
+        }
+    }
+    if (binary_logs && (trees.size() > 1)) {
+        throw EcoevolityError(
+                "Prior samples must be drawn with one thread to write binary logs");
+    }
+    TreeType & tree = *trees.at(0);
+    tree_log_stream.precision(logging_precision);
+    state_log_stream.precision(logging_precision);
+    AsyncLogStream tree_log(tree_log_stream);
+    AsyncLogStream state_log(state_log_stream);
+
+    binlog::StateLogWriter binary_state_log(state_log);
+    binlog::TreeLogWriter<TreeType> binary_tree_log(tree_log);
+    if (binary_logs) {
+        std::ostringstream header;
+        tree.write_state_log_header(header, logging_delimiter);
+        binary_state_log.write_header(string_util::split(
+                string_util::rstrip(header.str(), "\r\n"),
+                logging_delimiter.at(0)));
+        binary_tree_log.write_header(tree);
+    }
+    else {
+        tree.write_state_log_header(state_log, logging_delimiter);
+        tree_log << "#NEXUS" << std::endl;
+        tree.write_nexus_taxa_block(tree_log);
+        tree_log << "\nBEGIN TREES;\n";
+    }
+
+    std::shared_ptr<GeneralizedTreeCounts> tree_counts;
+    if (sampling_topology && (! bifurcating_topology)) {
+        tree_counts = std::make_shared<GeneralizedTreeCounts>(
+                tree.get_leaf_node_count());
+    }
+
+    const unsigned int number_of_samples = (chain_length / sample_frequency) + 1;
+    std::vector<double> state_values;
+    auto draw_sample = [&](RandomNumberGenerator & sample_rng,
+            TreeType & sample_tree,
+            unsigned int sample_index,
+            PriorSampleBuffer & buffer) {
+        if (sampling_topology) {
+            if (bifurcating_topology) {
+                sample_tree.draw_bifurcating_topology_from_prior(sample_rng);
+            }
+            else {
+                sample_tree.draw_generalized_topology_from_prior(sample_rng,
+                        *tree_counts);
+            }
+        }
+        sample_tree.draw_from_prior(sample_rng);
+        sample_tree.make_dirty();
+        sample_tree.compute_log_likelihood_and_prior(1);
+        unsigned int generation_index = sample_index * sample_frequency;
+        if (binary_logs) {
+            // Only one tree is used, so the sample can be written now
+            state_values.clear();
+            sample_tree.get_state_log_values(state_values, generation_index);
+            binary_state_log.write_row(state_values);
+            binary_tree_log.log_tree(sample_tree, generation_index);
+        }
+        else {
+            buffer.state_log.precision(logging_precision);
+            buffer.tree_log.precision(logging_precision);
+            sample_tree.log_state(buffer.state_log, generation_index,
+                    logging_delimiter);
+            sample_tree.log_nexus_tree(buffer.tree_log, generation_index,
+                    true, logging_precision);
+        }
+    };
+    auto write_buffer = [&](PriorSampleBuffer & buffer) {
+        state_log << buffer.state_log.str();
+        tree_log << buffer.tree_log.str();
+        buffer.clear();
+    };
+
+    std_output_stream << "Drawing " << number_of_samples
+                      << " independent samples from the prior with "
+                      << trees.size() << " thread(s)..." << std::endl;
+    draw_prior_samples(rng,
+            trees,
+            number_of_samples,
+            draw_sample,
+            write_buffer);
+    if (! binary_logs) {
+        tree_log << "END;";
+    }
+    tree_log.close();
+    state_log.close();
+}
+
 #endif
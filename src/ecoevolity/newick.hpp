@@ -0,0 +1,667 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_NEWICK_HPP
+#define ECOEVOLITY_NEWICK_HPP
+
+#include <iostream>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <set>
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "string_util.hpp"
+
+
+/**
+ * Lightweight parsing of newick trees and streaming of tree statements from
+ * nexus tree files.
+ *
+ * This avoids reading whole tree logs into NCL when all we need is to visit
+ * each sampled tree once (e.g., when summarizing posterior samples of
+ * trees). Labels follow the same conventions as NCL: unquoted underscores are
+ * converted to spaces, and single quotes can be used to quote labels.
+ */
+namespace newick {
+
+/**
+ * A node of a parsed newick tree. Nodes are stored in pre-order in
+ * ParsedTree, so a node's parent always precedes it.
+ */
+struct ParsedNode {
+    std::string label;
+    std::map<std::string, std::string> comment_map;
+    double length = 0.0;
+    int parent = -1;
+    std::vector<unsigned int> children;
+
+    bool is_leaf() const {
+        return this->children.empty();
+    }
+};
+
+struct ParsedTree {
+    std::vector<ParsedNode> nodes;
+
+    void clear() {
+        this->nodes.clear();
+    }
+    unsigned int get_number_of_leaves() const {
+        unsigned int n = 0;
+        for (auto const & node : this->nodes) {
+            if (node.is_leaf()) {
+                ++n;
+            }
+        }
+        return n;
+    }
+};
+
+inline bool is_label_char(const char c) {
+    switch (c) {
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case ':':
+        case ';':
+        case ',':
+        case '\'':
+            return false;
+        default:
+            return (! std::isspace(static_cast<unsigned char>(c)));
+    }
+}
+
+/**
+ * Read a (possibly quoted) label starting at 'position', and advance
+ * 'position' past it.
+ */
+inline std::string read_label(
+        const std::string & s,
+        std::size_t & position) {
+    std::string label;
+    if (s.at(position) == '\'') {
+        ++position;
+        while (true) {
+            if (position >= s.size()) {
+                throw EcoevolityError("Unterminated quoted label: " + label);
+            }
+            if (s.at(position) == '\'') {
+                // Two single quotes are an escaped quote
+                if (((position + 1) < s.size()) && (s.at(position + 1) == '\'')) {
+                    label.push_back('\'');
+                    position += 2;
+                    continue;
+                }
+                ++position;
+                break;
+            }
+            label.push_back(s.at(position));
+            ++position;
+        }
+        return label;
+    }
+    while ((position < s.size()) && is_label_char(s.at(position))) {
+        if (s.at(position) == '_') {
+            label.push_back(' ');
+        }
+        else {
+            label.push_back(s.at(position));
+        }
+        ++position;
+    }
+    return label;
+}
+
+/**
+ * Read a comment starting at the opening bracket at 'position', and advance
+ * 'position' past the closing bracket. Returns the text within the brackets.
+ */
+inline std::string read_comment(
+        const std::string & s,
+        std::size_t & position) {
+    ECOEVOLITY_ASSERT(s.at(position) == '[');
+    std::size_t start = position + 1;
+    unsigned int depth = 0;
+    while (position < s.size()) {
+        if (s.at(position) == '[') {
+            ++depth;
+        }
+        else if (s.at(position) == ']') {
+            --depth;
+            if (depth == 0) {
+                ++position;
+                return s.substr(start, position - start - 1);
+            }
+        }
+        ++position;
+    }
+    throw EcoevolityError("Unterminated comment in tree");
+}
+
+/**
+ * Parse a newick tree string into 'tree'.
+ *
+ * Comments that begin with '&' are parsed as comma-separated key=value pairs
+ * and are assigned to the node that precedes them (e.g., 'A[&height=0]:0.1'
+ * or '(A,B)[&height=0.1]'). Comments that precede the tree (e.g., '[&R]')
+ * are ignored. If a translation table is provided, leaf labels are
+ * translated.
+ */
+inline void parse_tree(
+        const std::string & newick_string,
+        ParsedTree & tree,
+        const std::map<std::string, std::string> * translation_table = nullptr) {
+    tree.clear();
+    std::vector<unsigned int> open_nodes;
+    int current = -1;
+    bool finished = false;
+    std::size_t i = 0;
+    const std::size_t n = newick_string.size();
+    while (i < n) {
+        const char c = newick_string.at(i);
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+        if (finished) {
+            if (c == '[') {
+                read_comment(newick_string, i);
+                continue;
+            }
+            throw EcoevolityError("Unexpected characters after end of tree: " +
+                    newick_string.substr(i));
+        }
+        if (c == '[') {
+            std::string comment = string_util::strip(read_comment(newick_string, i));
+            if ((current > -1) && string_util::startswith(comment, "&")) {
+                string_util::parse_map(
+                        comment.substr(1),
+                        tree.nodes.at(current).comment_map,
+                        ',',
+                        '=');
+            }
+            continue;
+        }
+        if (c == '(') {
+            if (current > -1) {
+                throw EcoevolityError("Unexpected \'(\' in tree: " + newick_string);
+            }
+            ParsedNode node;
+            if (! open_nodes.empty()) {
+                node.parent = open_nodes.back();
+                tree.nodes.at(node.parent).children.push_back(tree.nodes.size());
+            }
+            else if (! tree.nodes.empty()) {
+                throw EcoevolityError("Multiple roots in tree: " + newick_string);
+            }
+            open_nodes.push_back(tree.nodes.size());
+            tree.nodes.push_back(node);
+            ++i;
+            continue;
+        }
+        if (c == ',') {
+            if (open_nodes.empty() || (current < 0)) {
+                throw EcoevolityError("Unexpected \',\' in tree: " + newick_string);
+            }
+            current = -1;
+            ++i;
+            continue;
+        }
+        if (c == ')') {
+            if (open_nodes.empty() || (current < 0)) {
+                throw EcoevolityError("Unexpected \')\' in tree: " + newick_string);
+            }
+            current = open_nodes.back();
+            open_nodes.pop_back();
+            ++i;
+            continue;
+        }
+        if (c == ':') {
+            if (current < 0) {
+                throw EcoevolityError("Unexpected \':\' in tree: " + newick_string);
+            }
+            ++i;
+            std::size_t start = i;
+            while ((i < n) && is_label_char(newick_string.at(i))) {
+                ++i;
+            }
+            const std::string length_str = newick_string.substr(start, i - start);
+            char * end;
+            double length = std::strtod(length_str.c_str(), &end);
+            if (length_str.empty() || (*end != '\0')) {
+                throw EcoevolityError("could not convert edge length \'" +
+                        length_str + "\'");
+            }
+            tree.nodes.at(current).length = length;
+            continue;
+        }
+        if (c == ';') {
+            finished = true;
+            ++i;
+            continue;
+        }
+        if (c == ']') {
+            throw EcoevolityError("Unexpected \']\' in tree: " + newick_string);
+        }
+        // Must be a label
+        std::string label = read_label(newick_string, i);
+        if (current > -1) {
+            // Label of an internal node
+            tree.nodes.at(current).label = label;
+            continue;
+        }
+        if (translation_table && (translation_table->count(label) > 0)) {
+            label = translation_table->at(label);
+        }
+        ParsedNode leaf;
+        leaf.label = label;
+        if (! open_nodes.empty()) {
+            leaf.parent = open_nodes.back();
+            tree.nodes.at(leaf.parent).children.push_back(tree.nodes.size());
+        }
+        else if (! tree.nodes.empty()) {
+            throw EcoevolityError("Multiple roots in tree: " + newick_string);
+        }
+        current = tree.nodes.size();
+        tree.nodes.push_back(leaf);
+    }
+    if (tree.nodes.empty()) {
+        throw EcoevolityError("Empty tree");
+    }
+    if (! open_nodes.empty()) {
+        throw EcoevolityError("Unbalanced parentheses in tree: " + newick_string);
+    }
+    for (auto const & node : tree.nodes) {
+        if (node.is_leaf() && node.label.empty()) {
+            throw EcoevolityError("Unlabeled leaf in tree: " + newick_string);
+        }
+    }
+}
+
+
+/**
+ * Streams the tree statements of a nexus file, one at a time.
+ *
+ * The TAXA block (if present) is used to vet leaf labels, and the TRANSLATE
+ * command of the TREES block (if present) is applied to leaf labels. Trees
+ * can be skipped (e.g., as burn in) without being parsed.
+ */
+class NexusTreeReader {
+    protected:
+        std::istream & in_;
+        std::string path_;
+        std::vector<std::string> taxon_labels_;
+        std::set<std::string> taxon_label_set_;
+        std::map<std::string, std::string> translation_table_;
+        bool in_trees_block_ = false;
+        bool finished_ = false;
+        unsigned int number_of_trees_read_ = 0;
+
+        void throw_error_(const std::string & message) const {
+            throw EcoevolityParsingError(message, this->path_);
+        }
+
+        int peek_() {
+            return this->in_.peek();
+        }
+        int get_() {
+            return this->in_.get();
+        }
+
+        void skip_comment_() {
+            unsigned int depth = 0;
+            int c;
+            while ((c = this->get_()) != EOF) {
+                if (c == '[') {
+                    ++depth;
+                }
+                else if (c == ']') {
+                    --depth;
+                    if (depth == 0) {
+                        return;
+                    }
+                }
+            }
+            this->throw_error_("Unterminated comment");
+        }
+
+        void skip_whitespace_and_comments_() {
+            int c;
+            while ((c = this->peek_()) != EOF) {
+                if (std::isspace(c)) {
+                    this->get_();
+                }
+                else if (c == '[') {
+                    this->skip_comment_();
+                }
+                else {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * Returns the next nexus token; punctuation (';', '=', ',') are
+         * returned as single-character tokens. An empty string is returned
+         * at the end of the stream.
+         */
+        std::string next_token_() {
+            this->skip_whitespace_and_comments_();
+            int c = this->peek_();
+            if (c == EOF) {
+                return "";
+            }
+            std::string token;
+            if ((c == ';') || (c == '=') || (c == ',')) {
+                token.push_back(this->get_());
+                return token;
+            }
+            if (c == '\'') {
+                this->get_();
+                while (true) {
+                    c = this->get_();
+                    if (c == EOF) {
+                        this->throw_error_("Unterminated quoted token");
+                    }
+                    if (c == '\'') {
+                        if (this->peek_() == '\'') {
+                            token.push_back(this->get_());
+                            continue;
+                        }
+                        break;
+                    }
+                    token.push_back(c);
+                }
+                return token;
+            }
+            while ((c = this->peek_()) != EOF) {
+                if (std::isspace(c) || (c == ';') || (c == '=') ||
+                        (c == ',') || (c == '[') || (c == '\'')) {
+                    break;
+                }
+                this->get_();
+                token.push_back((c == '_') ? ' ' : c);
+            }
+            return token;
+        }
+
+        static std::string upper_(const std::string & s) {
+            std::string u = s;
+            for (auto & c : u) {
+                c = std::toupper(static_cast<unsigned char>(c));
+            }
+            return u;
+        }
+
+        void skip_command_() {
+            std::string token;
+            while ((token = this->next_token_()) != ";") {
+                if (token.empty()) {
+                    this->throw_error_("Unexpected end of file");
+                }
+            }
+        }
+
+        void parse_taxa_block_() {
+            while (true) {
+                std::string command = upper_(this->next_token_());
+                if (command.empty()) {
+                    this->throw_error_("Unexpected end of file in TAXA block");
+                }
+                if ((command == "END") || (command == "ENDBLOCK")) {
+                    this->skip_command_();
+                    return;
+                }
+                if (command == "TAXLABELS") {
+                    std::string token;
+                    while ((token = this->next_token_()) != ";") {
+                        if (token.empty()) {
+                            this->throw_error_("Unexpected end of file in TAXLABELS");
+                        }
+                        this->taxon_labels_.push_back(token);
+                        this->taxon_label_set_.insert(token);
+                    }
+                    continue;
+                }
+                if (command != ";") {
+                    this->skip_command_();
+                }
+            }
+        }
+
+        void parse_translate_command_() {
+            while (true) {
+                std::string key = this->next_token_();
+                if (key == ";") {
+                    return;
+                }
+                std::string label = this->next_token_();
+                if (key.empty() || label.empty() || (label == ";") || (label == ",")) {
+                    this->throw_error_("Problem parsing TRANSLATE command");
+                }
+                this->translation_table_[key] = label;
+                std::string delimiter = this->next_token_();
+                if (delimiter == ";") {
+                    return;
+                }
+                if (delimiter != ",") {
+                    this->throw_error_("Problem parsing TRANSLATE command");
+                }
+            }
+        }
+
+        /**
+         * Read the text of the tree description (everything after the '='
+         * up to the terminating semicolon). If 'tree_string' is null, the
+         * text is skipped.
+         */
+        void read_tree_description_(std::string * tree_string) {
+            unsigned int comment_depth = 0;
+            bool in_quotes = false;
+            int c;
+            while ((c = this->get_()) != EOF) {
+                if (tree_string) {
+                    tree_string->push_back(c);
+                }
+                if (in_quotes) {
+                    if (c == '\'') {
+                        in_quotes = false;
+                    }
+                    continue;
+                }
+                if (c == '[') {
+                    ++comment_depth;
+                }
+                else if ((c == ']') && (comment_depth > 0)) {
+                    --comment_depth;
+                }
+                else if (comment_depth == 0) {
+                    if (c == '\'') {
+                        in_quotes = true;
+                    }
+                    else if (c == ';') {
+                        return;
+                    }
+                }
+            }
+            this->throw_error_("Unexpected end of file in tree description");
+        }
+
+        /**
+         * Advance to the next tree description; returns false if there are
+         * no more trees.
+         */
+        bool advance_to_tree_() {
+            while (! this->finished_) {
+                std::string token = this->next_token_();
+                if (token.empty()) {
+                    this->finished_ = true;
+                    return false;
+                }
+                std::string command = upper_(token);
+                if (! this->in_trees_block_) {
+                    if (command == "#NEXUS") {
+                        continue;
+                    }
+                    if (command != "BEGIN") {
+                        this->skip_command_();
+                        continue;
+                    }
+                    std::string block = upper_(this->next_token_());
+                    this->skip_command_();
+                    if (block == "TAXA") {
+                        this->parse_taxa_block_();
+                    }
+                    else if (block == "TREES") {
+                        this->in_trees_block_ = true;
+                    }
+                    else {
+                        // Skip block
+                        while (true) {
+                            std::string t = upper_(this->next_token_());
+                            if (t.empty()) {
+                                this->throw_error_("Unexpected end of file in " +
+                                        block + " block");
+                            }
+                            if ((t == "END") || (t == "ENDBLOCK")) {
+                                this->skip_command_();
+                                break;
+                            }
+                            if (t != ";") {
+                                this->skip_command_();
+                            }
+                        }
+                    }
+                    continue;
+                }
+                if ((command == "END") || (command == "ENDBLOCK")) {
+                    this->skip_command_();
+                    this->in_trees_block_ = false;
+                    continue;
+                }
+                if (command == "TRANSLATE") {
+                    this->parse_translate_command_();
+                    continue;
+                }
+                if ((command == "TREE") || (command == "UTREE")) {
+                    std::string name = this->next_token_();
+                    if (name == "*") {
+                        name = this->next_token_();
+                    }
+                    if (this->next_token_() != "=") {
+                        this->throw_error_("Expecting \'=\' after tree name " + name);
+                    }
+                    return true;
+                }
+                if (command != ";") {
+                    this->skip_command_();
+                }
+            }
+            return false;
+        }
+
+    public:
+        NexusTreeReader(std::istream & in_stream,
+                const std::string & path = "")
+            : in_(in_stream),
+              path_(path) { }
+
+        /**
+         * Read the next tree description (the text after the '=' of the tree
+         * command) without parsing it; returns false if there are no more
+         * trees.
+         */
+        bool next_tree(std::string & tree_string) {
+            if (! this->advance_to_tree_()) {
+                return false;
+            }
+            tree_string.clear();
+            this->read_tree_description_(&tree_string);
+            ++this->number_of_trees_read_;
+            return true;
+        }
+
+        /**
+         * Parse a tree description returned by next_tree(std::string &),
+         * applying the translation table and vetting the leaf labels against
+         * the TAXA block. This does not change the state of the reader, so
+         * it can be called from multiple threads.
+         */
+        void parse_tree_description(const std::string & tree_string,
+                ParsedTree & tree) const {
+            if (this->translation_table_.empty()) {
+                parse_tree(tree_string, tree);
+            }
+            else {
+                parse_tree(tree_string, tree, &this->translation_table_);
+            }
+            if (! this->taxon_label_set_.empty()) {
+                for (auto const & node : tree.nodes) {
+                    if (node.is_leaf() &&
+                            (this->taxon_label_set_.count(node.label) < 1)) {
+                        this->throw_error_("Tree has leaf label \'" +
+                                node.label + "\' that is not in the TAXA block");
+                    }
+                }
+            }
+        }
+
+        /**
+         * Read and parse the next tree into 'tree'; returns false if there
+         * are no more trees.
+         */
+        bool next_tree(ParsedTree & tree) {
+            std::string tree_string;
+            if (! this->next_tree(tree_string)) {
+                return false;
+            }
+            this->parse_tree_description(tree_string, tree);
+            return true;
+        }
+
+        /**
+         * Skip the next tree without parsing it; returns false if there are
+         * no more trees.
+         */
+        bool skip_tree() {
+            if (! this->advance_to_tree_()) {
+                return false;
+            }
+            this->read_tree_description_(nullptr);
+            ++this->number_of_trees_read_;
+            return true;
+        }
+
+        unsigned int get_number_of_trees_read() const {
+            return this->number_of_trees_read_;
+        }
+        const std::vector<std::string> & get_taxon_labels() const {
+            return this->taxon_labels_;
+        }
+};
+
+} // namespace newick
+
+#endif
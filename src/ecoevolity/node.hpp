@@ -384,6 +384,17 @@ class PopulationNode: public BaseNode<PopulationNode>{
             }
         }
 
+        /**
+         * Method to populate pop size from a map of parameter values.
+         * Overridding from BaseNode.
+         */
+        void extract_data_from_parameter_map(
+                const std::map<std::string, double> & parameter_map) {
+            if (parameter_map.count("pop_size") > 0) {
+                this->set_population_size(parameter_map.at("pop_size"));
+            }
+        }
+
         // methods for accessing/changing pattern probabilities
         unsigned int get_allele_count() const {
             return this->bottom_pattern_probs_.get_allele_count();
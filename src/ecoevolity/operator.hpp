@@ -31,11 +31,13 @@
 #include "assert.hpp"
 #include "math_util.hpp"
 #include "operator_schedule.hpp"
+#include "operator_stats.hpp"
 
 
 class OperatorInterface {
     protected:
         double weight_ = 1.0;
+        OperatorStats stats_;
 
     public:
         OperatorInterface() { }
@@ -109,6 +111,9 @@ class OperatorInterface {
         virtual std::string to_string(const OperatorSchedule& os) const = 0;
 
         virtual int get_tree_index() const { return -1; }
+
+        OperatorStats & get_stats() { return this->stats_; }
+        const OperatorStats & get_stats() const { return this->stats_; }
 };
 
 template<class DerivedOperatorType>
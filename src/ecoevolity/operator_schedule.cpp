@@ -618,6 +618,25 @@ void OperatorSchedule::write_operator_rates(std::ostream& out) const {
     out << std::flush;
 }
 
+void OperatorSchedule::write_operator_costs(std::ostream& out) const {
+    double total_wall_time = 0.0;
+    for (auto op : this->operators_) {
+        total_wall_time += op->get_stats().get_wall_time();
+    }
+    out << OperatorStats::header_string();
+    for (auto op : this->operators_) {
+        out << op->get_stats().to_string(op->get_name(), total_wall_time);
+    }
+    out << std::flush;
+}
+
+void OperatorSchedule::set_operator_trace(
+        std::shared_ptr<OperatorTraceWriter> trace_writer) {
+    for (auto op : this->operators_) {
+        op->get_stats().set_trace_writer(trace_writer, op->get_name());
+    }
+}
+
 bool OperatorSchedule::auto_optimizing() const {
     return this->auto_optimize_;
 }
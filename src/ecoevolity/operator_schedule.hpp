@@ -29,6 +29,7 @@
 #include "rng.hpp"
 #include "assert.hpp"
 #include "settings.hpp"
+#include "operator_stats.hpp"
 
 class Operator;
 class OperatorInterface;
@@ -71,6 +72,9 @@ class OperatorSchedule {
         void set_auto_optimize_delay(unsigned int delay);
 
         void write_operator_rates(std::ostream& out) const;
+        void write_operator_costs(std::ostream& out) const;
+
+        void set_operator_trace(std::shared_ptr<OperatorTraceWriter> trace_writer);
 
         bool auto_optimizing() const;
         void turn_on_auto_optimize();
@@ -0,0 +1,286 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_OPERATOR_STATS_HPP
+#define ECOEVOLITY_OPERATOR_STATS_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <chrono>
+#include <ctime>
+#include <functional>
+
+#include "cost_counters.hpp"
+#include "error.hpp"
+
+
+/**
+ * Writes operator calls as complete ("X") events of the Chrome trace event
+ * format, which can be viewed with chrome://tracing or Perfetto.
+ */
+class OperatorTraceWriter {
+    protected:
+        std::ofstream out_;
+        std::chrono::steady_clock::time_point origin_;
+        unsigned long long number_of_events_ = 0;
+
+    public:
+        OperatorTraceWriter(const std::string & path) {
+            this->out_.open(path);
+            if (! this->out_.is_open()) {
+                throw EcoevolityError(
+                        "Could not open operator trace file \'" + path + "\'");
+            }
+            this->origin_ = std::chrono::steady_clock::now();
+            this->out_ << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        }
+        ~OperatorTraceWriter() {
+            this->close();
+        }
+
+        void close() {
+            if (this->out_.is_open()) {
+                this->out_ << "\n]}\n";
+                this->out_.close();
+            }
+        }
+
+        void write_event(
+                const std::string & name,
+                const std::chrono::steady_clock::time_point & start,
+                const std::chrono::steady_clock::time_point & end,
+                unsigned long long likelihood_calls,
+                unsigned long long patterns_evaluated,
+                unsigned long long store_restore_nanoseconds) {
+            double ts = std::chrono::duration<double, std::micro>(
+                    start - this->origin_).count();
+            double dur = std::chrono::duration<double, std::micro>(
+                    end - start).count();
+            this->out_ << ((this->number_of_events_ > 0) ? ",\n" : "\n")
+                       << "{\"name\": \"" << name << "\", "
+                       << "\"cat\": \"operator\", "
+                       << "\"ph\": \"X\", "
+                       << "\"pid\": 1, \"tid\": 1, "
+                       << "\"ts\": " << ts << ", "
+                       << "\"dur\": " << dur << ", "
+                       << "\"args\": {"
+                       << "\"likelihood_calls\": " << likelihood_calls << ", "
+                       << "\"patterns_evaluated\": " << patterns_evaluated << ", "
+                       << "\"store_restore_us\": " << store_restore_nanoseconds / 1000.0
+                       << "}}";
+            ++this->number_of_events_;
+        }
+
+        unsigned long long get_number_of_events() const {
+            return this->number_of_events_;
+        }
+};
+
+
+/**
+ * Running totals of the cost of an operator: number of calls, wall and CPU
+ * time, and the number of likelihood calls, patterns evaluated, and time spent
+ * storing and restoring model state during its calls.
+ *
+ * CPU time is that of the whole process, so it includes the time of all
+ * threads used for the likelihood.
+ */
+class OperatorStats {
+    protected:
+        unsigned long long number_of_calls_ = 0;
+        unsigned long long wall_nanoseconds_ = 0;
+        double cpu_seconds_ = 0.0;
+        unsigned long long likelihood_calls_ = 0;
+        unsigned long long patterns_evaluated_ = 0;
+        unsigned long long store_restore_nanoseconds_ = 0;
+        std::shared_ptr<OperatorTraceWriter> trace_writer_;
+        std::string trace_name_;
+
+    public:
+        void add_call(
+                const std::chrono::steady_clock::time_point & start,
+                const std::chrono::steady_clock::time_point & end,
+                double cpu_seconds,
+                unsigned long long likelihood_calls,
+                unsigned long long patterns_evaluated,
+                unsigned long long store_restore_nanoseconds) {
+            ++this->number_of_calls_;
+            this->wall_nanoseconds_ += std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(end - start).count();
+            this->cpu_seconds_ += cpu_seconds;
+            this->likelihood_calls_ += likelihood_calls;
+            this->patterns_evaluated_ += patterns_evaluated;
+            this->store_restore_nanoseconds_ += store_restore_nanoseconds;
+            if (this->trace_writer_) {
+                this->trace_writer_->write_event(this->trace_name_,
+                        start,
+                        end,
+                        likelihood_calls,
+                        patterns_evaluated,
+                        store_restore_nanoseconds);
+            }
+        }
+
+        void set_trace_writer(
+                std::shared_ptr<OperatorTraceWriter> trace_writer,
+                const std::string & name) {
+            this->trace_writer_ = trace_writer;
+            this->trace_name_ = name;
+        }
+
+        void reset() {
+            this->number_of_calls_ = 0;
+            this->wall_nanoseconds_ = 0;
+            this->cpu_seconds_ = 0.0;
+            this->likelihood_calls_ = 0;
+            this->patterns_evaluated_ = 0;
+            this->store_restore_nanoseconds_ = 0;
+        }
+
+        unsigned long long get_number_of_calls() const {
+            return this->number_of_calls_;
+        }
+        double get_wall_time() const {
+            return this->wall_nanoseconds_ / 1.0e9;
+        }
+        double get_cpu_time() const {
+            return this->cpu_seconds_;
+        }
+        unsigned long long get_number_of_likelihood_calls() const {
+            return this->likelihood_calls_;
+        }
+        unsigned long long get_number_of_patterns_evaluated() const {
+            return this->patterns_evaluated_;
+        }
+        double get_store_restore_time() const {
+            return this->store_restore_nanoseconds_ / 1.0e9;
+        }
+
+        static std::string header_string() {
+            return "name\tnumber_of_calls\twall_time\tcpu_time\tprop_wall_time\tmean_wall_time\tlikelihood_calls\tpatterns_evaluated\tstore_restore_time\n";
+        }
+
+        /**
+         * Times are in seconds; `total_wall_time` is the wall time of all the
+         * operators in the schedule.
+         */
+        std::string to_string(const std::string & name,
+                double total_wall_time) const {
+            std::ostringstream ss;
+            ss << name << "\t"
+               << this->get_number_of_calls() << "\t"
+               << this->get_wall_time() << "\t"
+               << this->get_cpu_time() << "\t";
+            if (total_wall_time > 0.0) {
+                ss << this->get_wall_time() / total_wall_time << "\t";
+            }
+            else {
+                ss << "nan\t";
+            }
+            if (this->get_number_of_calls() > 0) {
+                ss << this->get_wall_time() / this->get_number_of_calls() << "\t";
+            }
+            else {
+                ss << "nan\t";
+            }
+            ss << this->get_number_of_likelihood_calls() << "\t"
+               << this->get_number_of_patterns_evaluated() << "\t"
+               << this->get_store_restore_time() << "\n";
+            return ss.str();
+        }
+};
+
+
+/**
+ * Adds the cost of the work done on a model (a tree or collection) while it
+ * runs to an OperatorStats instance when it is destroyed; the cost is
+ * counted by the model, so chains run in parallel do not count each other's
+ * work. Timers should not be nested for the same schedule, otherwise costs
+ * are counted by both operators.
+ *
+ * A timer can be paused and resumed, and work done elsewhere (e.g., in
+ * another thread) can be added to it, so that the parts of an operator
+ * call that are interleaved with other calls are recorded as one call.
+ */
+class OperatorStatsTimer {
+    protected:
+        OperatorStats & stats_;
+        std::function<ModelCost()> get_model_cost_;
+        std::chrono::steady_clock::time_point start_;
+        std::chrono::steady_clock::time_point resume_time_;
+        std::chrono::steady_clock::duration wall_time_;
+        std::clock_t cpu_resume_time_;
+        double cpu_seconds_ = 0.0;
+        ModelCost cost_at_resume_;
+        ModelCost cost_;
+        bool running_ = false;
+
+    public:
+        template <class ModelType>
+        OperatorStatsTimer(OperatorStats & stats, const ModelType & model) :
+                stats_(stats),
+                get_model_cost_([&model]() { return model.get_model_cost(); }),
+                start_(std::chrono::steady_clock::now()),
+                wall_time_(std::chrono::steady_clock::duration::zero()) {
+            this->resume();
+        }
+        OperatorStatsTimer(const OperatorStatsTimer &) = delete;
+        OperatorStatsTimer & operator=(const OperatorStatsTimer &) = delete;
+        ~OperatorStatsTimer() {
+            this->pause();
+            this->stats_.add_call(this->start_,
+                    this->start_ + this->wall_time_,
+                    this->cpu_seconds_,
+                    this->cost_.likelihood_calls,
+                    this->cost_.patterns_evaluated,
+                    this->cost_.store_restore_nanoseconds);
+        }
+
+        void resume() {
+            if (this->running_) {
+                return;
+            }
+            this->running_ = true;
+            this->resume_time_ = std::chrono::steady_clock::now();
+            this->cpu_resume_time_ = std::clock();
+            this->cost_at_resume_ = this->get_model_cost_();
+        }
+        void pause() {
+            if (! this->running_) {
+                return;
+            }
+            this->running_ = false;
+            this->wall_time_ += std::chrono::steady_clock::now() - this->resume_time_;
+            this->cpu_seconds_ += (double)(std::clock() - this->cpu_resume_time_) / CLOCKS_PER_SEC;
+            ModelCost cost = this->get_model_cost_();
+            cost -= this->cost_at_resume_;
+            this->cost_ += cost;
+        }
+        void add(const std::chrono::steady_clock::duration & wall_time,
+                double cpu_seconds,
+                const ModelCost & cost) {
+            this->wall_time_ += wall_time;
+            this->cpu_seconds_ += cpu_seconds;
+            this->cost_ += cost;
+        }
+};
+
+#endif
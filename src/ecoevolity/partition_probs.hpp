@@ -0,0 +1,250 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_PARTITION_PROBS_HPP
+#define ECOEVOLITY_PARTITION_PROBS_HPP
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <future>
+#endif
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "math_util.hpp"
+#include "discretized_gamma.hpp"
+#include "rng.hpp"
+
+
+namespace partition_probs {
+
+/**
+ * Stores `get_probs(value)` for the values in [begin, end) in `probs`.
+ */
+template <class F>
+inline void get_probs_(
+        const std::vector<double> & values,
+        unsigned int begin,
+        unsigned int end,
+        F get_probs,
+        std::vector< std::vector<long double> > & probs) {
+    for (unsigned int i = begin; i < end; ++i) {
+        probs.at(i) = get_probs(values.at(i));
+    }
+}
+
+/**
+ * Integrates the probabilities returned by `get_probs(x)` over a gamma
+ * distribution on x.
+ *
+ * This is a quadrature approximation: the gamma distribution is split into
+ * `number_of_points` (by default, 1000) bins of equal probability, and the
+ * probabilities are averaged over the means of the bins. The bins are
+ * divided among `nthreads` threads, but the probabilities of the bins are
+ * summed in order afterward, so the result is identical for any number of
+ * threads.
+ */
+template <class F>
+inline std::vector<long double> integrate_over_gamma(
+        unsigned int number_of_probs,
+        double shape,
+        double scale,
+        F get_probs,
+        unsigned int number_of_points = 1000,
+        unsigned int nthreads = 1) {
+    if (number_of_points < 1) {
+        throw EcoevolityError(
+                "The number of integration points must be positive");
+    }
+    DiscretizedGamma gamma(shape, scale, number_of_points);
+    const std::vector<double> & values = gamma.get_quantiles();
+    std::vector< std::vector<long double> > bin_probs(number_of_points);
+#ifdef BUILD_WITH_THREADS
+    unsigned int nchunks = std::max(1U, std::min(nthreads, number_of_points));
+    if (nchunks > 1) {
+        unsigned int chunk_size = number_of_points / nchunks;
+        std::vector< std::future<void> > threads;
+        threads.reserve(nchunks - 1);
+        for (unsigned int t = 0; t < (nchunks - 1); ++t) {
+            threads.push_back(std::async(
+                    std::launch::async,
+                    get_probs_<F>,
+                    std::cref(values),
+                    t * chunk_size,
+                    (t + 1) * chunk_size,
+                    get_probs,
+                    std::ref(bin_probs)));
+        }
+        // Use the main thread for the last chunk
+        get_probs_(values, (nchunks - 1) * chunk_size, number_of_points,
+                get_probs, bin_probs);
+        for (auto & t : threads) {
+            t.get();
+        }
+    }
+    else {
+        get_probs_(values, 0, number_of_points, get_probs, bin_probs);
+    }
+#else
+    get_probs_(values, 0, number_of_points, get_probs, bin_probs);
+#endif
+    std::vector<long double> probs(number_of_probs, 0.0);
+    for (unsigned int i = 0; i < number_of_points; ++i) {
+        ECOEVOLITY_ASSERT(bin_probs.at(i).size() == number_of_probs);
+        for (unsigned int j = 0; j < number_of_probs; ++j) {
+            probs.at(j) += bin_probs.at(i).at(j);
+        }
+    }
+    for (unsigned int j = 0; j < number_of_probs; ++j) {
+        probs.at(j) /= number_of_points;
+    }
+    return probs;
+}
+
+/**
+ * Runs `number_of_reps` replicates of `simulate(rng, sums)`, each of which
+ * adds to `sums`, and returns the totals.
+ *
+ * With more than one thread, the replicates are divided among the threads,
+ * each of which uses its own RandomNumberGenerator seeded from `rng`. With
+ * one thread, `rng` is used directly.
+ */
+template <class F>
+inline std::vector<long double> simulate_sums(
+        RandomNumberGenerator & rng,
+        unsigned int number_of_sums,
+        unsigned int number_of_reps,
+        F simulate,
+        unsigned int nthreads = 1) {
+#ifndef BUILD_WITH_THREADS
+    nthreads = 1;
+#endif
+    unsigned int nchunks = std::max(1U, std::min(nthreads, number_of_reps));
+    std::vector< std::vector<long double> > sums(nchunks,
+            std::vector<long double>(number_of_sums, 0.0));
+    if (nchunks < 2) {
+        for (unsigned int i = 0; i < number_of_reps; ++i) {
+            simulate(rng, sums.back());
+        }
+        return sums.back();
+    }
+#ifdef BUILD_WITH_THREADS
+    std::vector<RandomNumberGenerator> rngs;
+    rngs.reserve(nchunks);
+    for (unsigned int t = 0; t < nchunks; ++t) {
+        rngs.push_back(RandomNumberGenerator(
+                rng.uniform_int(1, std::numeric_limits<int>::max() - 1)));
+    }
+    unsigned int chunk_size = number_of_reps / nchunks;
+    auto run_chunk = [&simulate, &rngs, &sums](unsigned int t,
+            unsigned int nreps) {
+        for (unsigned int i = 0; i < nreps; ++i) {
+            simulate(rngs.at(t), sums.at(t));
+        }
+    };
+    std::vector< std::future<void> > threads;
+    threads.reserve(nchunks - 1);
+    for (unsigned int t = 0; t < (nchunks - 1); ++t) {
+        threads.push_back(std::async(std::launch::async, run_chunk, t,
+                chunk_size));
+    }
+    // Use the main thread for the last chunk
+    run_chunk(nchunks - 1, number_of_reps - ((nchunks - 1) * chunk_size));
+    for (auto & t : threads) {
+        t.get();
+    }
+#endif
+    std::vector<long double> totals(number_of_sums, 0.0);
+    for (unsigned int t = 0; t < nchunks; ++t) {
+        for (unsigned int j = 0; j < number_of_sums; ++j) {
+            totals.at(j) += sums.at(t).at(j);
+        }
+    }
+    return totals;
+}
+
+/**
+ * Probabilities of the number of categories (1 to `number_of_elements`)
+ * under a Pitman-Yor process with a fixed discount and a concentration that
+ * is either fixed or gamma distributed (if `concentration_shape` is
+ * positive; the gamma is integrated over with `number_of_points` bins, see
+ * integrate_over_gamma).
+ */
+inline std::vector<long double> get_pyp_number_of_category_probs(
+        unsigned int number_of_elements,
+        double concentration,
+        double discount,
+        double concentration_shape = 0.0,
+        double concentration_scale = 0.0,
+        unsigned int number_of_points = 1000,
+        unsigned int nthreads = 1) {
+    auto get_probs = [number_of_elements, discount](double c) {
+        std::vector<double> log_probs = get_pyp_log_number_of_category_probs(
+                number_of_elements, c, discount);
+        std::vector<long double> probs(number_of_elements, 0.0);
+        for (unsigned int i = 0; i < number_of_elements; ++i) {
+            probs.at(i) = std::exp((long double)log_probs.at(i));
+        }
+        return probs;
+    };
+    if (concentration_shape <= 0.0) {
+        return get_probs(concentration);
+    }
+    return integrate_over_gamma(number_of_elements,
+            concentration_shape,
+            concentration_scale,
+            get_probs,
+            number_of_points,
+            nthreads);
+}
+
+/**
+ * Probabilities of the number of subsets (1 to `number_of_elements`) under
+ * the split-weighted uniform prior, with a split weight that is either fixed
+ * or gamma distributed (if `split_weight_shape` is positive; the gamma is
+ * integrated over with `number_of_points` bins, see integrate_over_gamma).
+ */
+inline std::vector<long double> get_split_weight_number_of_subset_probs(
+        unsigned int number_of_elements,
+        double split_weight,
+        double split_weight_shape = 0.0,
+        double split_weight_scale = 0.0,
+        unsigned int number_of_points = 1000,
+        unsigned int nthreads = 1) {
+    auto get_probs = [number_of_elements](double w) {
+        return get_number_of_subset_probs(number_of_elements, w);
+    };
+    if (split_weight_shape <= 0.0) {
+        return get_probs(split_weight);
+    }
+    return integrate_over_gamma(number_of_elements,
+            split_weight_shape,
+            split_weight_scale,
+            get_probs,
+            number_of_points,
+            nthreads);
+}
+
+} // partition_probs
+
+#endif
@@ -0,0 +1,404 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_PARTITIONSUM_HPP
+#define ECOEVOLITY_PARTITIONSUM_HPP
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "string_util.hpp"
+#include "binlog.hpp"
+#include "spreadsheet.hpp"
+#include "compressed_stream.hpp"
+
+namespace partitionsum {
+
+/**
+ * Encodes partitions of n elements as restricted-growth strings (RGS)
+ * packed into words.
+ *
+ * In an RGS, the subset index of element i is at most i, so element i only
+ * needs ceil(log2(i + 1)) bits; e.g., a partition of 20 elements fits in
+ * 69 bits (two words).
+ */
+class PartitionEncoder {
+    protected:
+        unsigned int number_of_elements_ = 0;
+        unsigned int number_of_words_ = 0;
+        std::vector<unsigned int> bit_widths_;
+        std::vector<unsigned int> word_indices_;
+        std::vector<unsigned int> bit_offsets_;
+
+    public:
+        typedef std::vector<std::uint64_t> key_type;
+
+        PartitionEncoder() { }
+        PartitionEncoder(const unsigned int number_of_elements) {
+            this->number_of_elements_ = number_of_elements;
+            this->bit_widths_.reserve(number_of_elements);
+            this->word_indices_.reserve(number_of_elements);
+            this->bit_offsets_.reserve(number_of_elements);
+            unsigned int word = 0;
+            unsigned int offset = 0;
+            for (unsigned int i = 0; i < number_of_elements; ++i) {
+                unsigned int width = 0;
+                while ((1u << width) < (i + 1)) {
+                    ++width;
+                }
+                if ((offset + width) > 64) {
+                    ++word;
+                    offset = 0;
+                }
+                this->bit_widths_.push_back(width);
+                this->word_indices_.push_back(word);
+                this->bit_offsets_.push_back(offset);
+                offset += width;
+            }
+            this->number_of_words_ = word + 1;
+        }
+
+        unsigned int get_number_of_elements() const {
+            return this->number_of_elements_;
+        }
+        unsigned int get_number_of_words() const {
+            return this->number_of_words_;
+        }
+
+        /**
+         * Encode the partition given by the subset index of each element.
+         * The indices need not be in RGS form (i.e., any labeling of the
+         * subsets is accepted); 'relabel' is used as scratch space. Returns
+         * the number of subsets.
+         */
+        template <typename IndexType>
+        unsigned int encode(
+                const std::vector<IndexType> & subset_indices,
+                key_type & key,
+                std::vector<unsigned int> & relabel) const {
+            ECOEVOLITY_ASSERT(subset_indices.size() == this->number_of_elements_);
+            key.assign(this->number_of_words_, 0);
+            relabel.clear();
+            unsigned int number_of_subsets = 0;
+            for (unsigned int i = 0; i < this->number_of_elements_; ++i) {
+                unsigned int raw_index = static_cast<unsigned int>(subset_indices[i]);
+                if (raw_index >= relabel.size()) {
+                    relabel.resize(raw_index + 1, this->number_of_elements_);
+                }
+                if (relabel[raw_index] == this->number_of_elements_) {
+                    relabel[raw_index] = number_of_subsets++;
+                }
+                key[this->word_indices_[i]] |= (
+                        static_cast<std::uint64_t>(relabel[raw_index]) <<
+                        this->bit_offsets_[i]);
+            }
+            return number_of_subsets;
+        }
+
+        void decode(const key_type & key,
+                std::vector<unsigned int> & subset_indices) const {
+            ECOEVOLITY_ASSERT(key.size() == this->number_of_words_);
+            subset_indices.resize(this->number_of_elements_);
+            for (unsigned int i = 0; i < this->number_of_elements_; ++i) {
+                std::uint64_t mask = (this->bit_widths_[i] == 64) ?
+                        ~static_cast<std::uint64_t>(0) :
+                        ((static_cast<std::uint64_t>(1) << this->bit_widths_[i]) - 1);
+                subset_indices[i] = static_cast<unsigned int>(
+                        (key[this->word_indices_[i]] >> this->bit_offsets_[i]) & mask);
+            }
+        }
+};
+
+struct PartitionKeyHash {
+    std::size_t operator()(const PartitionEncoder::key_type & key) const {
+        std::uint64_t h = 0x9e3779b97f4a7c15ULL;
+        for (auto w : key) {
+            h ^= w + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h = (h ^ (h >> 31)) * 0xbf58476d1ce4e5b9ULL;
+        }
+        return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+};
+
+/**
+ * Tallies samples of partitions (e.g., the assignment of comparisons to
+ * divergence events) in a single pass: counts of each partition, of the
+ * number of subsets, and of each pair of elements being in the same subset.
+ */
+class PartitionSummarizer {
+    protected:
+        PartitionEncoder encoder_;
+        std::unordered_map<PartitionEncoder::key_type, unsigned int, PartitionKeyHash> partition_counts_;
+        std::map<unsigned int, unsigned int> number_of_subsets_counts_;
+        // Upper triangle (row-major) of the co-occurrence counts
+        std::vector<unsigned int> pair_counts_;
+        unsigned int number_of_samples_ = 0;
+        PartitionEncoder::key_type key_;
+        std::vector<unsigned int> relabel_;
+        std::vector<unsigned int> rgs_;
+
+        unsigned int pair_index_(unsigned int i, unsigned int j) const {
+            if (i > j) {
+                std::swap(i, j);
+            }
+            const unsigned int n = this->encoder_.get_number_of_elements();
+            return (i * n) - ((i * (i + 1)) / 2) + (j - i - 1);
+        }
+
+    public:
+        PartitionSummarizer() { }
+        PartitionSummarizer(const unsigned int number_of_elements)
+            : encoder_(number_of_elements) {
+            for (unsigned int i = 1; i <= number_of_elements; ++i) {
+                this->number_of_subsets_counts_[i] = 0;
+            }
+            this->pair_counts_.assign(
+                    (number_of_elements * (number_of_elements - 1)) / 2, 0);
+        }
+
+        unsigned int get_number_of_elements() const {
+            return this->encoder_.get_number_of_elements();
+        }
+        unsigned int get_number_of_samples() const {
+            return this->number_of_samples_;
+        }
+        unsigned int get_number_of_partitions() const {
+            return this->partition_counts_.size();
+        }
+
+        /**
+         * Add a sample partition, given the subset index of each element.
+         * Returns the number of subsets.
+         */
+        template <typename IndexType>
+        unsigned int add_sample(const std::vector<IndexType> & subset_indices) {
+            unsigned int number_of_subsets = this->encoder_.encode(
+                    subset_indices,
+                    this->key_,
+                    this->relabel_);
+            ++this->partition_counts_[this->key_];
+            ++this->number_of_subsets_counts_[number_of_subsets];
+            const unsigned int n = this->get_number_of_elements();
+            unsigned int p = 0;
+            for (unsigned int i = 0; i < n; ++i) {
+                for (unsigned int j = i + 1; j < n; ++j) {
+                    if (subset_indices[i] == subset_indices[j]) {
+                        ++this->pair_counts_[p];
+                    }
+                    ++p;
+                }
+            }
+            ++this->number_of_samples_;
+            return number_of_subsets;
+        }
+
+        /**
+         * Returns the number of samples of the partition, given in RGS form.
+         */
+        unsigned int get_count(const std::vector<unsigned int> & partition) const {
+            PartitionEncoder::key_type key;
+            std::vector<unsigned int> relabel;
+            this->encoder_.encode(partition, key, relabel);
+            auto c = this->partition_counts_.find(key);
+            if (c == this->partition_counts_.end()) {
+                return 0;
+            }
+            return c->second;
+        }
+
+        unsigned int get_number_of_subsets_count(
+                const unsigned int number_of_subsets) const {
+            auto c = this->number_of_subsets_counts_.find(number_of_subsets);
+            if (c == this->number_of_subsets_counts_.end()) {
+                return 0;
+            }
+            return c->second;
+        }
+
+        const std::map<unsigned int, unsigned int> & get_number_of_subsets_counts() const {
+            return this->number_of_subsets_counts_;
+        }
+
+        /**
+         * Returns the sampled partitions (in RGS form) and their counts,
+         * ordered lexicographically by partition.
+         */
+        std::vector< std::pair<std::vector<unsigned int>, unsigned int> > get_partition_counts() const {
+            std::vector< std::pair<std::vector<unsigned int>, unsigned int> > counts;
+            counts.reserve(this->partition_counts_.size());
+            std::vector<unsigned int> partition;
+            for (auto const & kv : this->partition_counts_) {
+                this->encoder_.decode(kv.first, partition);
+                counts.push_back(std::make_pair(partition, kv.second));
+            }
+            std::sort(counts.begin(), counts.end());
+            return counts;
+        }
+
+        unsigned int get_pair_count(const unsigned int i, const unsigned int j) const {
+            if (i == j) {
+                return this->number_of_samples_;
+            }
+            return this->pair_counts_.at(this->pair_index_(i, j));
+        }
+
+        /**
+         * Proportion of samples in which elements i and j are in the same
+         * subset.
+         */
+        double get_pair_probability(const unsigned int i, const unsigned int j) const {
+            ECOEVOLITY_ASSERT(this->number_of_samples_ > 0);
+            return this->get_pair_count(i, j) / (double)this->number_of_samples_;
+        }
+
+        void write_pair_probabilities(std::ostream & out,
+                const std::vector<std::string> & labels,
+                const char delimiter = '\t') const {
+            const unsigned int n = this->get_number_of_elements();
+            ECOEVOLITY_ASSERT(labels.size() == n);
+            out << "comparison";
+            for (auto const & l : labels) {
+                out << delimiter << l;
+            }
+            out << "\n";
+            for (unsigned int i = 0; i < n; ++i) {
+                out << labels.at(i);
+                for (unsigned int j = 0; j < n; ++j) {
+                    out << delimiter << this->get_pair_probability(i, j);
+                }
+                out << "\n";
+            }
+        }
+};
+
+/**
+ * Stream the rows of tab-delimited state logs (or binary state logs),
+ * parsing only the requested columns, and pass the values of each row
+ * (after the burn in of each log) to 'process_row'. The burn in of each log
+ * is given by 'offsets'.
+ *
+ * Tab-delimited logs are parsed by spreadsheet::stream_numeric_columns. The
+ * header of each log must match that of the first log. Returns the header.
+ */
+template <class RowFunction>
+std::vector<std::string> stream_state_log_columns(
+        const std::vector<std::string> & paths,
+        const std::vector<std::string> & column_labels,
+        const std::vector<unsigned int> & offsets,
+        RowFunction process_row,
+        const char delimiter = '\t') {
+    ECOEVOLITY_ASSERT(offsets.size() == paths.size());
+    std::vector<std::string> header;
+    std::vector<unsigned int> values(column_labels.size(), 0);
+    for (unsigned int path_idx = 0; path_idx < paths.size(); ++path_idx) {
+        const std::string & path = paths.at(path_idx);
+        const unsigned int offset = offsets.at(path_idx);
+
+        if (binlog::is_binary_state_log(path)) {
+            binlog::StateLogReader reader(path);
+            if (header.empty()) {
+                header = reader.get_header();
+            }
+            else if (reader.get_header() != header) {
+                throw EcoevolityParsingError(
+                        "Headers does not match",
+                        path,
+                        1);
+            }
+            std::vector<unsigned int> column_indices;
+            column_indices.reserve(column_labels.size());
+            for (auto const & label : column_labels) {
+                column_indices.push_back(reader.get_column_index(label));
+            }
+            for (std::size_t row = offset; row < reader.get_number_of_rows(); ++row) {
+                for (unsigned int c = 0; c < column_indices.size(); ++c) {
+                    values[c] = static_cast<unsigned int>(
+                            reader.get_value(row, column_indices[c]));
+                }
+                process_row(values);
+            }
+            continue;
+        }
+
+        InputFileStream in_stream;
+        in_stream.open(path);
+        if (! in_stream.is_open()) {
+            throw EcoevolityParsingError(
+                    "Could not open spreadsheet file",
+                    path);
+        }
+        spreadsheet::stream_numeric_columns<unsigned int>(in_stream,
+                header,
+                column_labels,
+                process_row,
+                offset,
+                delimiter,
+                path);
+        in_stream.close();
+    }
+    return header;
+}
+
+template <class RowFunction>
+std::vector<std::string> stream_state_log_columns(
+        const std::vector<std::string> & paths,
+        const std::vector<std::string> & column_labels,
+        const unsigned int offset,
+        RowFunction process_row,
+        const char delimiter = '\t') {
+    return stream_state_log_columns(paths,
+            column_labels,
+            std::vector<unsigned int>(paths.size(), offset),
+            process_row,
+            delimiter);
+}
+
+/**
+ * Returns the header of a (binary or tab-delimited) state log.
+ */
+inline std::vector<std::string> get_state_log_header(
+        const std::string & path,
+        const char delimiter = '\t') {
+    if (binlog::is_binary_state_log(path)) {
+        binlog::StateLogReader reader(path);
+        return reader.get_header();
+    }
+    InputFileStream in_stream;
+    in_stream.open(path);
+    if (! in_stream.is_open()) {
+        throw EcoevolityParsingError(
+                "Could not open spreadsheet file",
+                path);
+    }
+    std::string line;
+    std::getline(in_stream, line);
+    return string_util::split(line, delimiter);
+}
+
+} // namespace partitionsum
+
+#endif
@@ -63,7 +63,10 @@ void increment_log_path(
     std::string new_suffix;
     int run_number;
 
-    prefix_ext = path::splitext(log_path);
+    // The run number precedes the extensions of the log and any compression
+    std::pair<std::string, std::string> path_compression_ext =
+            compressed_stream::split_compression_extension(log_path);
+    prefix_ext = path::splitext(path_compression_ext.first);
     path_elements = string_util::split(prefix_ext.first, '-');
     run_number = std::stoi(path_elements.back());
     path_elements.pop_back();
@@ -71,5 +74,6 @@ void increment_log_path(
     
     new_suffix = "-" + std::to_string(run_number) + prefix_ext.second;
 
-    log_path = string_util::join(path_elements, "-") + new_suffix;
+    log_path = string_util::join(path_elements, "-") + new_suffix +
+            path_compression_ext.second;
 }
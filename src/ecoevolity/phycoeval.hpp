@@ -29,6 +29,7 @@
 #include "error.hpp"
 #include "rng.hpp"
 #include "path.hpp"
+#include "compressed_stream.hpp"
 #include "string_util.hpp"
 #include "general_tree_settings.hpp"
 #include "settings_io.hpp"
@@ -81,6 +82,18 @@ int phycoeval_main(int argc, char * argv[]) {
             .dest("ignore_data")
             .help("Ignore data to sample from the prior distribution. Default: "
                   "Use data to sample from the posterior distribution");
+    parser.add_option("--sample-prior-directly")
+            .action("store_true")
+            .dest("sample_prior_directly")
+            .help("Rather than using MCMC, draw independent samples directly "
+                  "from the prior distribution. The samples are written to "
+                  "the tree and state logs for the same generations as MCMC "
+                  "samples would be (every \'sample_frequency\' "
+                  "generations of \'chain_length\'). This implies "
+                  "\'--ignore-data\', and no operator log is written. "
+                  "With \'--nthreads\', the samples are drawn in parallel, "
+                  "with a random number generator for each thread seeded "
+                  "from the seed (unless \'--binary-logs\' is used).");
 #ifdef BUILD_WITH_THREADS
     parser.add_option("--nthreads")
             .action("store")
@@ -90,7 +103,21 @@ int phycoeval_main(int argc, char * argv[]) {
             .help("Number of threads to use for likelihood calculations. "
                   "Default: 1 (no multithreading). If you are using "
                   "the \'--ignore-data\' option, no likelihood calculations "
-                  "will be performed, and so no multithreading is used.");
+                  "will be performed, and so no multithreading is used, "
+                  "unless you are also using \'--sample-prior-directly\'.");
+    parser.add_option("--speculative-moves")
+            .action("store")
+            .type("unsigned int")
+            .dest("speculative_moves")
+            .set_default("0")
+            .help("Propose up to this many MCMC moves ahead and compute "
+                  "their likelihoods in parallel (one thread per move). The "
+                  "proposals are accepted or rejected in order, and those "
+                  "after the first accepted move are discarded, so the chain "
+                  "is the same as without this option (with '--nthreads 1'). "
+                  "This helps when the likelihood is too cheap to split "
+                  "across threads, or moves are often rejected. "
+                  "Default: 0 (moves are made one at a time).");
 #endif
     parser.add_option("--prefix")
             .action("store")
@@ -130,6 +157,43 @@ int phycoeval_main(int argc, char * argv[]) {
                   "affected by this option, not alignments of standard "
                   "characters (i.e., 0, 1, 2)."
                 );
+    parser.add_option("--binary-logs")
+            .action("store_true")
+            .dest("binary_logs")
+            .help("Write the state and tree logs in a compact binary format "
+                  "rather than as text. The binary logs are much faster for "
+                  "sumphycoeval and sumcoevolity to read. Default: Write "
+                  "text logs.");
+    parser.add_option("--compress-logs")
+            .action("store_true")
+            .dest("compress_logs")
+            .help("Write the state and tree logs compressed with gzip (with "
+                  "a '.gz' extension). Compressed logs are read by "
+                  "sumphycoeval as is. Cannot be used with '--binary-logs'. "
+                  "Default: Write uncompressed logs.");
+    parser.add_option("--operator-trace")
+            .action("store")
+            .dest("operator_trace")
+            .help("Path to which to write a trace of every operator call in "
+                  "the Chrome trace event (JSON) format, which can be viewed "
+                  "with chrome://tracing or Perfetto. The trace includes the "
+                  "run time of each call and the number of likelihood "
+                  "calculations it required. The file can be large for long "
+                  "chains. Default: No trace is written; the summed costs "
+                  "of each operator are always reported in the operator "
+                  "log.");
+    parser.add_option("--early-rejection")
+            .action("store_true")
+            .dest("early_rejection")
+            .help("Draw the random number for accepting or rejecting each "
+                  "MCMC move before computing the likelihood of the proposed "
+                  "state, and stop the likelihood calculation as soon as it "
+                  "is too small for the move to be accepted. This makes most "
+                  "rejected moves cheaper without changing which moves are "
+                  "accepted, but operators are tuned by whether moves are "
+                  "accepted rather than by their acceptance probabilities, "
+                  "so the chain can differ if operators are auto-optimized. "
+                  "Moves are not rejected early with '--speculative-moves'.");
     parser.add_option("--dry-run")
             .action("store_true")
             .dest("dry_run")
@@ -151,9 +215,24 @@ int phycoeval_main(int argc, char * argv[]) {
     std::cout << "Seed: " << seed << std::endl;
 
     const bool dry_run = options.get("dry_run");
+    const bool binary_logs = options.get("binary_logs");
+    const bool compress_logs = options.get("compress_logs");
+    if (binary_logs && compress_logs) {
+        throw EcoevolityError(
+                "The '--binary-logs' and '--compress-logs' options cannot be used together");
+    }
+    if (compress_logs && (! compressed_stream::is_supported(
+            compressed_stream::Compression::gzip))) {
+        throw EcoevolityError(
+                "Logs cannot be compressed; this build does not support gzip (zlib)");
+    }
 
-    const bool ignore_data = options.get("ignore_data");
-    if (ignore_data) {
+    const bool drawing_prior_samples = options.get("sample_prior_directly");
+    const bool ignore_data = (drawing_prior_samples || options.get("ignore_data"));
+    if (drawing_prior_samples) {
+        std::cout << "Ignoring data in order to sample directly from the prior distribution..." << std::endl;
+    }
+    else if (ignore_data) {
         std::cout << "Ignoring data in order to sample from the prior distribution..." << std::endl;
     }
     else {
@@ -163,11 +242,14 @@ int phycoeval_main(int argc, char * argv[]) {
     const bool strict_on_constant_sites = (! options.get("relax_constant_sites"));
     const bool strict_on_missing_sites = (! options.get("relax_missing_sites"));
     const bool strict_on_triallelic_sites = (! options.get("relax_triallelic_sites"));
+    const bool rejecting_early = options.get("early_rejection");
 
 #ifdef BUILD_WITH_THREADS 
     unsigned int nthreads = options.get("nthreads");
+    unsigned int number_of_speculative_moves = options.get("speculative_moves");
 #else
     unsigned int nthreads = 1;
+    unsigned int number_of_speculative_moves = 0;
 #endif
 
     if (args.size() < 1) {
@@ -203,6 +285,7 @@ int phycoeval_main(int argc, char * argv[]) {
 
     GeneralTreeOperatorSchedule<BasePopulationTree> operator_schedule(
             settings.operator_settings, tree.get_leaf_node_count());
+    operator_schedule.set_early_rejection(rejecting_early);
 
     std::cout << "\n" << string_util::banner('-') << "\n";
     write_settings(std::cout, settings, operator_schedule);
@@ -228,6 +311,10 @@ int phycoeval_main(int argc, char * argv[]) {
         state_log_path = output_prefix + path::basename(state_log_path);
         operator_log_path = output_prefix + path::basename(operator_log_path);
     }
+    if (compress_logs) {
+        tree_log_path += ".gz";
+        state_log_path += ".gz";
+    }
     update_log_paths(tree_log_path, state_log_path, operator_log_path);
 
     std::cout << "\n" << string_util::banner('-') << "\n";
@@ -235,6 +322,12 @@ int phycoeval_main(int argc, char * argv[]) {
     std::cout << string_util::banner('-') << "\n\n";
 
     std::cout << "Number of threads: " << nthreads << std::endl;
+    if (number_of_speculative_moves > 1) {
+        std::cout << "Number of speculative moves: "
+                  << number_of_speculative_moves << std::endl;
+    }
+    std::cout << "Early rejection of moves: "
+              << (rejecting_early ? "on" : "off") << std::endl;
 
     if (dry_run) {
         return 0;
@@ -254,7 +347,7 @@ int phycoeval_main(int argc, char * argv[]) {
                 << "\' already exists!\n";
         throw EcoevolityError(message.str());
     }
-    if (path::exists(operator_log_path)) {
+    if ((! drawing_prior_samples) && path::exists(operator_log_path)) {
         std::ostringstream message;
         message << "ERROR: The operator log file \'"
                 << operator_log_path
@@ -262,14 +355,22 @@ int phycoeval_main(int argc, char * argv[]) {
         throw EcoevolityError(message.str());
     }
 
-    std::ofstream tree_log_stream;
-    std::ofstream state_log_stream;
+    OutputFileStream tree_log_stream;
+    OutputFileStream state_log_stream;
     std::ofstream operator_log_stream;
 
-    tree_log_stream.open(tree_log_path);
-    state_log_stream.open(state_log_path);
-    operator_log_stream.open(operator_log_path);
-    
+    if (binary_logs) {
+        tree_log_stream.open(tree_log_path, std::ios::out | std::ios::binary);
+        state_log_stream.open(state_log_path, std::ios::out | std::ios::binary);
+    }
+    else {
+        tree_log_stream.open(tree_log_path, std::ios::out, nthreads);
+        state_log_stream.open(state_log_path, std::ios::out, nthreads);
+    }
+    if (! drawing_prior_samples) {
+        operator_log_stream.open(operator_log_path);
+    }
+
     if (! tree_log_stream.is_open()) {
         std::ostringstream message;
         message << "ERROR: Could not open tree log file \'"
@@ -284,7 +385,7 @@ int phycoeval_main(int argc, char * argv[]) {
                 << "\'\n";
         throw EcoevolityError(message.str());
     }
-    if (! operator_log_stream.is_open()) {
+    if ((! drawing_prior_samples) && (! operator_log_stream.is_open())) {
         std::ostringstream message;
         message << "ERROR: Could not open operator log file \'"
                 << operator_log_path
@@ -294,12 +395,79 @@ int phycoeval_main(int argc, char * argv[]) {
 
     std::cout << "Tree log path: " << tree_log_path << std::endl;
     std::cout << "State log path: " << state_log_path << std::endl;
-    std::cout << "Operator log path: " << operator_log_path << std::endl;
+    if (! drawing_prior_samples) {
+        std::cout << "Operator log path: " << operator_log_path << std::endl;
+    }
+
+    std::shared_ptr<OperatorTraceWriter> operator_trace;
+    if (options.is_set_by_user("operator_trace")) {
+        std::string operator_trace_path = options.get("operator_trace").get_str();
+        if (path::exists(operator_trace_path)) {
+            throw EcoevolityError("ERROR: The operator trace file \'" +
+                    operator_trace_path + "\' already exists!");
+        }
+        operator_trace = std::make_shared<OperatorTraceWriter>(operator_trace_path);
+        operator_schedule.set_operator_trace(operator_trace);
+        std::cout << "Operator trace path: " << operator_trace_path << std::endl;
+    }
 
     time_t start;
     time_t finish;
     time(&start);
 
+    if (drawing_prior_samples) {
+        std::vector< std::shared_ptr< GeneralTreeOperatorTemplate<TreeType> > > topology_operators =
+                operator_schedule.get_operators(
+                        BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::topology);
+        const bool sampling_topology = (topology_operators.size() > 0);
+        const bool bifurcating_topology = (
+                settings.tree_model_settings.get_tree_space() ==
+                        EcoevolityOptions::TreeSpace::bifurcating);
+
+        // Each thread draws samples with its own copy of the model, but
+        // binary logs must be written as the samples are drawn
+        std::vector< std::shared_ptr<TreeType> > helper_trees;
+        std::vector<TreeType *> trees {&tree};
+        if ((nthreads > 1) && binary_logs) {
+            std::cout << "Drawing prior samples with one thread to write "
+                      << "binary logs" << std::endl;
+        }
+        for (unsigned int i = 1; (i < nthreads) && (! binary_logs); ++i) {
+            helper_trees.push_back(std::make_shared<TreeType>(
+                    settings,
+                    rng,
+                    strict_on_constant_sites,
+                    strict_on_missing_sites,
+                    strict_on_triallelic_sites,
+                    false // store_seq_loci_info
+                    ));
+            helper_trees.back()->ignore_data();
+            trees.push_back(helper_trees.back().get());
+        }
+        sample_prior_directly<TreeType>(
+                rng,
+                trees,
+                sampling_topology,
+                bifurcating_topology,
+                settings.get_chain_length(),
+                settings.get_sample_frequency(),
+                tree_log_stream,
+                state_log_stream,
+                std::cout,
+                "\t",
+                logging_precision,
+                binary_logs);
+
+        tree_log_stream.close();
+        state_log_stream.close();
+
+        time(&finish);
+        double duration = difftime(finish, start);
+        std::cout << "Runtime: " << duration << " seconds." << std::endl;
+
+        return 0;
+    }
+
     std::cout << "Firing up MCMC..." << std::endl;
     mcmc<TreeType>(
             rng,
@@ -314,7 +482,10 @@ int phycoeval_main(int argc, char * argv[]) {
             std::cout,
             "\t",
             logging_precision,
-            nthreads);
+            nthreads,
+            binary_logs,
+            settings.get_operator_weight_adaptation_generations(),
+            number_of_speculative_moves);
 
     tree_log_stream.close();
     state_log_stream.close();
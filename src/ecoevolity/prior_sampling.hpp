@@ -0,0 +1,137 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_PRIOR_SAMPLING_HPP
+#define ECOEVOLITY_PRIOR_SAMPLING_HPP
+
+#include <vector>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <future>
+#endif
+
+#include "assert.hpp"
+#include "error.hpp"
+#include "rng.hpp"
+
+
+/**
+ * Log output of prior samples drawn by one thread, which is held until the
+ * samples drawn before them have been written.
+ */
+class PriorSampleBuffer {
+    public:
+        std::ostringstream state_log;
+        std::ostringstream tree_log;
+        std::vector< std::vector<double> > state_values;
+
+        void clear() {
+            this->state_log.str("");
+            this->state_log.clear();
+            this->tree_log.str("");
+            this->tree_log.clear();
+            this->state_values.clear();
+        }
+};
+
+/**
+ * Draws `number_of_samples` independent samples from the prior.
+ *
+ * Sample `i` is drawn by calling `draw_sample(rng, model, i, buffer)`, which
+ * should draw the model from its prior and add the sample to the log output
+ * in `buffer`. The buffers are passed to `write_buffer(buffer)`, which should
+ * write and clear them, in the order of the samples.
+ *
+ * Each model is used by its own thread, so all of the models must be separate
+ * copies of the same model. The samples are divided among the threads in
+ * blocks of `block_size`, each thread using its own RandomNumberGenerator
+ * seeded from `rng`. With one model, `rng` is used directly.
+ */
+template <class ModelType, class DrawFunction, class WriteFunction>
+inline void draw_prior_samples(
+        RandomNumberGenerator & rng,
+        const std::vector<ModelType *> & models,
+        unsigned int number_of_samples,
+        DrawFunction draw_sample,
+        WriteFunction write_buffer,
+        unsigned int block_size = 1000) {
+    ECOEVOLITY_ASSERT(models.size() > 0);
+    ECOEVOLITY_ASSERT(block_size > 0);
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = models.size();
+#else
+    unsigned int nthreads = 1;
+#endif
+    std::vector<PriorSampleBuffer> buffers(nthreads);
+    if (nthreads < 2) {
+        for (unsigned int i = 0; i < number_of_samples; ++i) {
+            draw_sample(rng, *models.at(0), i, buffers.at(0));
+            if (((i + 1) % block_size == 0) || ((i + 1) == number_of_samples)) {
+                write_buffer(buffers.at(0));
+            }
+        }
+        return;
+    }
+#ifdef BUILD_WITH_THREADS
+    std::vector<RandomNumberGenerator> rngs;
+    rngs.reserve(nthreads);
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        rngs.push_back(RandomNumberGenerator(
+                rng.uniform_int(1, std::numeric_limits<int>::max() - 1)));
+    }
+    auto draw_block = [&draw_sample, &rngs, &models, &buffers](unsigned int t,
+            unsigned int begin,
+            unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            draw_sample(rngs.at(t), *models.at(t), i, buffers.at(t));
+        }
+    };
+    unsigned int round_size = nthreads * block_size;
+    for (unsigned int round_begin = 0;
+            round_begin < number_of_samples;
+            round_begin += round_size) {
+        std::vector< std::future<void> > threads;
+        threads.reserve(nthreads - 1);
+        for (unsigned int t = 0; t < (nthreads - 1); ++t) {
+            unsigned int begin = std::min(number_of_samples,
+                    round_begin + (t * block_size));
+            unsigned int end = std::min(number_of_samples, begin + block_size);
+            threads.push_back(std::async(std::launch::async, draw_block, t,
+                    begin, end));
+        }
+        // Use the main thread for the last block
+        unsigned int begin = std::min(number_of_samples,
+                round_begin + ((nthreads - 1) * block_size));
+        draw_block(nthreads - 1, begin,
+                std::min(number_of_samples, begin + block_size));
+        for (auto & t : threads) {
+            t.get();
+        }
+        for (auto & buffer : buffers) {
+            write_buffer(buffer);
+        }
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,570 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef SBCOEVOLITY_HPP
+#define SBCOEVOLITY_HPP
+
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <time.h>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <future>
+#endif
+
+#include "cpp-optparse/OptionParser.h"
+
+#include "version.hpp"
+#include "error.hpp"
+#include "rng.hpp"
+#include "path.hpp"
+#include "settings.hpp"
+#include "collection.hpp"
+#include "stats_util.hpp"
+
+
+void write_sbc_splash(std::ostream& out);
+
+void check_sbc_output_path(const std::string& path);
+
+/**
+ * The rank of the true value `value` among posterior `samples`: the number of
+ * samples less than the value, plus a random number of the samples equal to
+ * it, so that the ranks of discrete parameters are also uniform when the
+ * analysis is calibrated.
+ */
+template <typename T>
+inline unsigned int get_sbc_rank(
+        const std::vector<T> & samples,
+        const T value,
+        RandomNumberGenerator & rng) {
+    unsigned int number_less = 0;
+    unsigned int number_equal = 0;
+    for (auto s : samples) {
+        if (s < value) {
+            ++number_less;
+        }
+        else if (s == value) {
+            ++number_equal;
+        }
+    }
+    if (number_equal < 1) {
+        return number_less;
+    }
+    return number_less + rng.uniform_int(0, number_equal);
+}
+
+/**
+ * The results of one simulation-based calibration replicate: for each
+ * parameter, the rank of its true value among the posterior samples and
+ * whether its HPD interval contains the true value.
+ */
+class SBCReplicateResult {
+    public:
+        unsigned int number_of_samples = 0;
+        std::vector<unsigned int> ranks;
+        std::vector<bool> covered;
+};
+
+
+template <class SettingsType, class CollectionType>
+int sbcoevolity_main(int argc, char * argv[]) {
+
+    write_sbc_splash(std::cerr);
+    std::cerr << "\n";
+
+    const std::string usage =
+        "usage: %prog [OPTIONS] YAML-CONFIG-FILE";
+
+    std::ostringstream version_ss;
+    version_ss << PROJECT_NAME << " version " << PROJECT_DETAILED_VERSION;
+    const std::string version = version_ss.str();
+
+    const std::string description =
+        "Sbcoevolity: Simulation-based calibration of evolutionary coevality. "
+        "For each replicate, parameters are drawn from the prior, data are "
+        "simulated, and the data are analysed with MCMC, all in memory. Only "
+        "the ranks of the true values among the posterior samples and the "
+        "coverage of HPD intervals are written. By default, the posterior "
+        "samples of each replicate are thinned to about their effective "
+        "sample size before ranking, because ranks among autocorrelated "
+        "samples are not uniform even when the analysis is calibrated "
+        "(Talts et al. 2018, arXiv:1804.06788).";
+
+    optparse::OptionParser parser = optparse::OptionParser()
+            .usage(usage)
+            .version(version)
+            .description(description);
+
+    parser.add_option("--seed")
+            .action("store")
+            .type("long")
+            .dest("seed")
+            .help("Seed for random number generator. Default: Set from clock.");
+    parser.add_option("-n", "--number-of-replicates")
+            .action("store")
+            .type("unsigned int")
+            .dest("number_of_replicates")
+            .set_default("100")
+            .help("Number of simulation replicates. Default: 100.");
+    parser.add_option("-p", "--prior")
+            .action("store")
+            .dest("prior")
+            .set_default("")
+            .help("The path to the configuration file that contains the "
+                  "priors and MCMC settings to use when analysing the "
+                  "simulated datasets. By default, the same priors are used "
+                  "to simulate and analyse the datasets.");
+    parser.add_option("-b", "--burnin")
+            .action("store")
+            .type("unsigned int")
+            .dest("burnin")
+            .set_default("0")
+            .help("Number of samples from the beginning of each chain to "
+                  "ignore. Default: 0.");
+    parser.add_option("--thin")
+            .action("store")
+            .type("unsigned int")
+            .dest("thin")
+            .set_default("0")
+            .help("Rank the true values among every Nth posterior sample "
+                  "after burn in. When 0, each replicate is thinned to about "
+                  "the smallest effective sample size of the parameters, so "
+                  "that the ranks are not distorted by autocorrelation. Use "
+                  "1 to rank among all samples. The HPD intervals used for "
+                  "coverage always use all of the samples after burn in. "
+                  "Default: 0.");
+    parser.add_option("--credibility-level")
+            .action("store")
+            .type("double")
+            .dest("credibility_level")
+            .set_default("0.95")
+            .help("The probability of the HPD intervals used for coverage. "
+                  "Default: 0.95.");
+    parser.add_option("--singleton-sample-probability")
+            .action("store")
+            .type("double")
+            .dest("singleton_sample_probability")
+            .set_default("1.0")
+            .help("The probability of sampling singleton site patterns "
+                  "(see simcoevolity). Default: 1.0 (no acquisition bias).");
+    parser.add_option("-l", "--locus-size")
+            .action("store")
+            .type("unsigned int")
+            .dest("locus_size")
+            .set_default("1")
+            .help("Number of sites simulated on each gene tree "
+                  "(see simcoevolity). Default: 1 (every site is unlinked).");
+    parser.add_option("--max-one-variable-site-per-locus")
+            .action("store_true")
+            .dest("max_one_variable_site_per_locus")
+            .help("When locus size is greater than one, this option forces "
+                  "only one variable site per locus to be retained "
+                  "(see simcoevolity).");
+    parser.add_option("-c", "--charsets")
+            .action("store_true")
+            .dest("charsets")
+            .help("Use charsets defined in the nexus-formatted alignment "
+                  "files to simulate multi-locus data (see simcoevolity).");
+#ifdef BUILD_WITH_THREADS
+    parser.add_option("--nthreads")
+            .action("store")
+            .type("unsigned int")
+            .dest("nthreads")
+            .set_default("1")
+            .help("Number of replicates to simulate and analyse at the same "
+                  "time. The results do not depend on the number of "
+                  "threads. Default: 1.");
+#endif
+    parser.add_option("--prefix")
+            .action("store")
+            .dest("prefix")
+            .set_default("")
+            .help("Optional string to prefix all output files.");
+    parser.add_option("--relax-constant-sites")
+            .action("store_true")
+            .dest("relax_constant_sites")
+            .help("Only warn about constant sites when "
+                  "\'constant_sites_removed = true\' (see simcoevolity).");
+    parser.add_option("--relax-missing-sites")
+            .action("store_true")
+            .dest("relax_missing_sites")
+            .help("Ignore sites with no data for a population "
+                  "(see simcoevolity).");
+    parser.add_option("--relax-triallelic-sites")
+            .action("store_true")
+            .dest("relax_triallelic_sites")
+            .help("Only warn about DNA sites with more than two nucleotides "
+                  "(see simcoevolity).");
+
+    optparse::Values& options = parser.parse_args(argc, argv);
+    std::vector<std::string> args = parser.args();
+
+    RandomNumberGenerator rng;
+    long seed_opt;
+    if (options.is_set_by_user("seed")) {
+        seed_opt = options.get("seed");
+    }
+    else {
+        seed_opt = rng.uniform_int(1, std::numeric_limits<int>::max() - 1);
+    }
+    const long seed = seed_opt;
+    rng.set_seed(seed);
+    std::cerr << "Seed: " << seed << std::endl;
+
+    const unsigned int nreps = options.get("number_of_replicates");
+    if (nreps < 1) {
+        throw EcoevolityError(
+                "Number of simulation replicates must be 1 or greater");
+    }
+    std::cerr << "Number of simulation replicates: " << nreps << std::endl;
+
+    const unsigned int burnin = options.get("burnin");
+    const unsigned int thin = options.get("thin");
+    const double credibility_level = options.get("credibility_level");
+    if ((credibility_level <= 0.0) || (credibility_level > 1.0)) {
+        throw EcoevolityError(
+                "The credibility level must be greater than 0 and at most 1");
+    }
+
+    const double singleton_sample_probability = options.get(
+            "singleton_sample_probability");
+
+    const unsigned int locus_size = options.get("locus_size");
+    if (locus_size < 1) {
+        throw EcoevolityError(
+                "Number of sites simulated per locus must be 1 or greater");
+    }
+
+    const bool use_charsets = options.get("charsets");
+
+    const bool max_one_variable_site_per_locus = options.get(
+            "max_one_variable_site_per_locus");
+    if ((! use_charsets) && (max_one_variable_site_per_locus && (locus_size < 2))) {
+        throw EcoevolityError(
+                "Locus length must be 1 or greater to use "
+                "\'--max-one-variable-site-per-locus\'");
+    }
+
+    const bool strict_on_constant_sites = (! options.get("relax_constant_sites"));
+    const bool strict_on_missing_sites = (! options.get("relax_missing_sites"));
+    const bool strict_on_triallelic_sites = (! options.get("relax_triallelic_sites"));
+
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = options.get("nthreads");
+#else
+    unsigned int nthreads = 1;
+#endif
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > nreps) {
+        nthreads = nreps;
+    }
+
+    if (args.size() < 1) {
+        throw EcoevolityError("Path to YAML-formatted config file is required");
+    }
+    if (args.size() > 1) {
+        throw EcoevolityError("Too many arguments; only one config file is allowed");
+    }
+    const std::string config_path = args.at(0);
+    if (! path::exists(config_path)) {
+        throw EcoevolityError("Config file \'" + config_path +
+                "\' does not exist");
+    }
+    if (! path::isfile(config_path)) {
+        throw EcoevolityError("Config path \'" + config_path +
+                "\' is not a regular file");
+    }
+    std::cerr << "Config path: " << config_path << std::endl;
+
+    std::string prior_config_path = config_path;
+    if (options.is_set_by_user("prior")) {
+        prior_config_path = options.get("prior").get_str();
+        if (! path::exists(prior_config_path)) {
+            throw EcoevolityError("Config file \'" + prior_config_path +
+                    "\' does not exist");
+        }
+        if (! path::isfile(prior_config_path)) {
+            throw EcoevolityError("Config path \'" + prior_config_path +
+                    "\' is not a regular file");
+        }
+    }
+    std::cerr << "Prior config path: " << prior_config_path << std::endl;
+
+    std::string output_prefix = "";
+    if (options.is_set_by_user("prefix")) {
+        output_prefix = options.get("prefix").get_str();
+    }
+    output_prefix += "sbcoevolity-";
+    const std::string ranks_path = output_prefix + "ranks.txt";
+    const std::string coverage_path = output_prefix + "coverage.txt";
+    check_sbc_output_path(ranks_path);
+    check_sbc_output_path(coverage_path);
+
+    std::cerr << "Parsing config files..." << std::endl;
+    SettingsType settings = SettingsType(config_path);
+    SettingsType prior_settings = SettingsType(prior_config_path);
+    if (! settings.same_comparison_paths(prior_settings)) {
+        throw EcoevolityError(
+                "The comparison files specified in \'" + config_path +
+                "\' and \'" + prior_config_path +
+                "\' do not match");
+    }
+    const unsigned int chain_length = prior_settings.get_chain_length();
+    const unsigned int sample_frequency = prior_settings.get_sample_frequency();
+    if (burnin >= ((chain_length / sample_frequency) + 1)) {
+        throw EcoevolityError(
+                "The burn-in must be less than the number of MCMC samples");
+    }
+
+    // Every replicate has its own seed, so that the results do not depend on
+    // the number of threads
+    std::vector<long> replicate_seeds;
+    replicate_seeds.reserve(nreps);
+    for (unsigned int i = 0; i < nreps; ++i) {
+        replicate_seeds.push_back(rng.uniform_int(1, std::numeric_limits<int>::max() - 1));
+    }
+
+    // Each thread simulates and analyses replicates with its own copies of
+    // the models, which are only configured (and the alignments parsed) once
+    std::cerr << "Configuring models for " << nthreads << " thread(s)..." << std::endl;
+    std::vector< std::shared_ptr<CollectionType> > sim_collections;
+    std::vector< std::shared_ptr<CollectionType> > analysis_collections;
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        sim_collections.push_back(std::make_shared<CollectionType>(
+                settings,
+                rng,
+                strict_on_constant_sites,
+                strict_on_missing_sites,
+                strict_on_triallelic_sites,
+                use_charsets));
+        analysis_collections.push_back(std::make_shared<CollectionType>(
+                prior_settings,
+                rng,
+                strict_on_constant_sites,
+                strict_on_missing_sites,
+                strict_on_triallelic_sites));
+        analysis_collections.back()->use_data();
+        analysis_collections.back()->set_number_of_threads(1);
+    }
+    if (use_charsets && (! sim_collections.at(0)->has_seq_loci_info())) {
+        throw EcoevolityError(
+                "All comparisons must have charsets defined when "
+                "using the \'--charsets\' option.");
+    }
+
+    std::cerr << "\n" << string_util::banner('-') << "\n";
+    sim_collections.at(0)->write_summary(std::cerr);
+    std::cerr << string_util::banner('-') << "\n\n";
+
+    // Simulated alignments are keyed by the path of the data they mimic,
+    // which is lost when they replace the data of the analysis trees
+    std::vector<std::string> analysis_tree_paths;
+    for (unsigned int i = 0; i < analysis_collections.at(0)->get_number_of_trees(); ++i) {
+        analysis_tree_paths.push_back(
+                analysis_collections.at(0)->get_tree(i)->get_data().get_path());
+    }
+
+    // Parameters are matched by their state log column, skipping the
+    // generation and the (log) likelihood and prior columns
+    std::vector<std::string> sim_header = sim_collections.at(0)->get_state_log_header();
+    std::vector<std::string> analysis_header = analysis_collections.at(0)->get_state_log_header();
+    std::vector<std::string> parameter_names;
+    std::vector<unsigned int> sim_columns;
+    std::vector<unsigned int> analysis_columns;
+    for (unsigned int i = 1; i < analysis_header.size(); ++i) {
+        if (string_util::startswith(analysis_header.at(i), "ln_")) {
+            continue;
+        }
+        auto sim_iter = std::find(sim_header.begin(), sim_header.end(),
+                analysis_header.at(i));
+        if (sim_iter == sim_header.end()) {
+            continue;
+        }
+        parameter_names.push_back(analysis_header.at(i));
+        analysis_columns.push_back(i);
+        sim_columns.push_back(std::distance(sim_header.begin(), sim_iter));
+    }
+    if (parameter_names.empty()) {
+        throw EcoevolityError(
+                "The simulation and analysis models have no parameters in common");
+    }
+
+    std::vector<SBCReplicateResult> results(nreps);
+
+    auto run_replicate = [&](unsigned int thread_index, unsigned int rep_index) {
+        RandomNumberGenerator rep_rng(replicate_seeds.at(rep_index));
+        CollectionType & sim = *sim_collections.at(thread_index);
+        CollectionType & analysis = *analysis_collections.at(thread_index);
+
+        sim.draw_from_prior(rep_rng);
+        std::map<std::string, BiallelicData> sim_alignments;
+        if (use_charsets) {
+            sim_alignments = sim.simulate_linked_biallelic_data_sets(rep_rng,
+                    singleton_sample_probability,
+                    max_one_variable_site_per_locus,
+                    true);
+        }
+        else if (locus_size < 2) {
+            sim_alignments = sim.simulate_biallelic_data_sets(rep_rng,
+                    singleton_sample_probability,
+                    true);
+        }
+        else {
+            sim_alignments = sim.simulate_complete_biallelic_data_sets(rep_rng,
+                    locus_size,
+                    singleton_sample_probability,
+                    max_one_variable_site_per_locus,
+                    true);
+        }
+        std::vector<double> true_values;
+        sim.get_state_log_values(true_values, 0);
+
+        for (unsigned int i = 0; i < analysis.get_number_of_trees(); ++i) {
+            auto alignment_iter = sim_alignments.find(analysis_tree_paths.at(i));
+            if (alignment_iter == sim_alignments.end()) {
+                throw EcoevolityError("No data were simulated for \'" +
+                        analysis_tree_paths.at(i) + "\'");
+            }
+            std::shared_ptr<PopulationTree> tree = analysis.get_tree(i);
+            tree->set_data(alignment_iter->second,
+                    (tree->constant_sites_removed() || max_one_variable_site_per_locus));
+        }
+        // Operators are tuned afresh for every replicate
+        OperatorSchedule operator_schedule(prior_settings);
+        analysis.set_operator_schedule(operator_schedule);
+        analysis.draw_from_prior(rep_rng);
+
+        std::vector< std::vector<double> > samples;
+        analysis.mcmc(rep_rng, chain_length, sample_frequency, samples);
+
+        SBCReplicateResult & result = results.at(rep_index);
+        std::vector< std::vector<double> > parameter_samples(
+                parameter_names.size(),
+                std::vector<double>(samples.size() - burnin));
+        for (unsigned int p = 0; p < parameter_names.size(); ++p) {
+            for (unsigned int i = burnin; i < samples.size(); ++i) {
+                parameter_samples.at(p).at(i - burnin) = samples.at(i).at(analysis_columns.at(p));
+            }
+        }
+        unsigned int rep_thin = thin;
+        if (rep_thin < 1) {
+            rep_thin = get_effective_thinning_interval(parameter_samples);
+        }
+        result.number_of_samples = (samples.size() - burnin + rep_thin - 1) / rep_thin;
+        std::vector<double> thinned_samples(result.number_of_samples);
+        for (unsigned int p = 0; p < parameter_names.size(); ++p) {
+            for (unsigned int i = 0; i < result.number_of_samples; ++i) {
+                thinned_samples.at(i) = parameter_samples.at(p).at(i * rep_thin);
+            }
+            double true_value = true_values.at(sim_columns.at(p));
+            result.ranks.push_back(get_sbc_rank(thinned_samples,
+                    true_value,
+                    rep_rng));
+            std::pair<double, double> hpd = get_hpd_interval(parameter_samples.at(p),
+                    credibility_level);
+            result.covered.push_back(
+                    (true_value >= hpd.first) && (true_value <= hpd.second));
+        }
+
+        std::ostringstream message;
+        message << "Finished replicate " << (rep_index + 1) << " of " << nreps << "\n";
+        std::cerr << message.str();
+    };
+
+    // Replicates are handed out to the threads as they finish the previous
+    // ones, so that threads are not idle when chains differ in cost
+    std::atomic<unsigned int> next_replicate(0);
+    auto run_replicates = [&](unsigned int thread_index) {
+        for (unsigned int rep_index = next_replicate++;
+                rep_index < nreps;
+                rep_index = next_replicate++) {
+            run_replicate(thread_index, rep_index);
+        }
+    };
+
+    time_t start;
+    time_t finish;
+    time(&start);
+
+    std::cerr << "Starting simulation-based calibration..." << std::endl;
+#ifdef BUILD_WITH_THREADS
+    std::vector< std::future<void> > threads;
+    threads.reserve(nthreads - 1);
+    for (unsigned int t = 0; t < (nthreads - 1); ++t) {
+        threads.push_back(std::async(std::launch::async, run_replicates, t));
+    }
+    // Use the main thread for the last worker
+    run_replicates(nthreads - 1);
+    for (auto & t : threads) {
+        t.get();
+    }
+#else
+    run_replicates(0);
+#endif
+
+    std::ofstream ranks_stream;
+    ranks_stream.open(ranks_path);
+    ranks_stream << "replicate\tnumber_of_samples";
+    for (auto const & name : parameter_names) {
+        ranks_stream << "\t" << name;
+    }
+    ranks_stream << "\n";
+    for (unsigned int i = 0; i < nreps; ++i) {
+        ranks_stream << (i + 1) << "\t" << results.at(i).number_of_samples;
+        for (auto rank : results.at(i).ranks) {
+            ranks_stream << "\t" << rank;
+        }
+        ranks_stream << "\n";
+    }
+    ranks_stream.close();
+
+    std::ofstream coverage_stream;
+    coverage_stream.open(coverage_path);
+    coverage_stream << "parameter\tcoverage\tmean_relative_rank\n";
+    for (unsigned int p = 0; p < parameter_names.size(); ++p) {
+        unsigned int number_covered = 0;
+        double sum_relative_rank = 0.0;
+        for (auto const & result : results) {
+            if (result.covered.at(p)) {
+                ++number_covered;
+            }
+            sum_relative_rank += result.ranks.at(p) / (double)result.number_of_samples;
+        }
+        coverage_stream << parameter_names.at(p) << "\t"
+                        << number_covered / (double)nreps << "\t"
+                        << sum_relative_rank / nreps << "\n";
+    }
+    coverage_stream.close();
+
+    std::cerr << "Ranks path: " << ranks_path << std::endl;
+    std::cerr << "Coverage path: " << coverage_path << std::endl;
+
+    time(&finish);
+    double duration = difftime(finish, start);
+    std::cerr << "Runtime: " << duration << " seconds." << std::endl;
+
+    return 0;
+}
+
+#endif
@@ -48,8 +48,12 @@ inline void write_settings(
         << settings.freq_1_settings.to_string(2)
         << "mcmc_settings:\n"
         << indent << "chain_length: " << settings.get_chain_length() << "\n"
-        << indent << "sample_frequency: " << settings.get_sample_frequency() << "\n"
-        << indent << "operators:\n";
+        << indent << "sample_frequency: " << settings.get_sample_frequency() << "\n";
+    if (settings.get_operator_weight_adaptation_generations() > 0) {
+        out << indent << "operator_weight_adaptation_generations: "
+            << settings.get_operator_weight_adaptation_generations() << "\n";
+    }
+    out << indent << "operators:\n";
     std::set<std::string> op_names;
     op_names = operator_schedule.write_op_settings(out, 2);
     std::string margin = string_util::get_indent(2);
@@ -29,8 +29,10 @@
 #include "error.hpp"
 #include "rng.hpp"
 #include "path.hpp"
+#include "compressed_stream.hpp"
 #include "settings.hpp"
 #include "collection.hpp"
+#include "async_log_writer.hpp"
 
 
 void write_sim_splash(std::ostream& out);
@@ -184,6 +186,14 @@ int simcoevolity_main(int argc, char * argv[]) {
             .help("Output simulated data in nexus format, rather than the "
                   "default YAML format."
                 );
+    parser.add_option("--compress")
+            .action("store_true")
+            .dest("compress")
+            .help("Compress the simulated data sets and true values with "
+                  "gzip (with a '.gz' extension). The analysis configs "
+                  "refer to the compressed data files, which ecoevolity "
+                  "reads as is."
+                );
 
     optparse::Values& options = parser.parse_args(argc, argv);
     std::vector<std::string> args = parser.args();
@@ -232,6 +242,13 @@ int simcoevolity_main(int argc, char * argv[]) {
     const bool strict_on_triallelic_sites = (! options.get("relax_triallelic_sites"));
     const bool simulate_sequences = (! options.get("parameters_only"));
     const bool output_nexus = options.get("output_nexus");
+    const bool compress = options.get("compress");
+    if (compress && (! compressed_stream::is_supported(
+            compressed_stream::Compression::gzip))) {
+        throw EcoevolityError(
+                "Output cannot be compressed; this build does not support gzip (zlib)");
+    }
+    const std::string compression_ext = compress ? ".gz" : "";
 
     if (args.size() < 1) {
         throw EcoevolityError("Path to YAML-formatted config file is required");
@@ -369,7 +386,7 @@ int simcoevolity_main(int argc, char * argv[]) {
             std::string rep_str = string_util::pad_int(i, pad_width);
             std::string analysis_config_path = sim_prefix + rep_str + "-config.yml";
             check_output_path(analysis_config_path);
-            std::string true_state_path = sim_prefix + rep_str + "-true-values.txt";
+            std::string true_state_path = sim_prefix + rep_str + "-true-values.txt" + compression_ext;
             check_output_path(true_state_path);
 
             comparisons.draw_from_prior(rng);
@@ -392,7 +409,7 @@ int simcoevolity_main(int argc, char * argv[]) {
                         true);
             }
 
-            std::ofstream true_state_stream;
+            OutputFileStream true_state_stream;
             true_state_stream.open(true_state_path);
             true_state_stream.precision(comparisons.get_logging_precision());
             comparisons.write_state_log_header(true_state_stream);
@@ -400,9 +417,9 @@ int simcoevolity_main(int argc, char * argv[]) {
             true_state_stream.close();
 
 
-            std::ofstream sim_alignment_stream;
+            OutputFileStream sim_alignment_stream;
             for (auto const & k_v: sim_alignments) {
-                std::string sim_alignment_path = sim_prefix + rep_str + "-" + path::basename(k_v.first);
+                std::string sim_alignment_path = sim_prefix + rep_str + "-" + path::basename(k_v.first) + compression_ext;
                 check_output_path(sim_alignment_path);
 
                 char delim = prior_settings.get_population_name_delimiter(k_v.first);
@@ -427,13 +444,13 @@ int simcoevolity_main(int argc, char * argv[]) {
             prior_settings.write_settings(analysis_settings_stream);
             analysis_settings_stream.close();
             for (auto const & k_v: sim_alignments) {
-                std::string sim_alignment_path = sim_prefix + rep_str + "-" + path::basename(k_v.first);
+                std::string sim_alignment_path = sim_prefix + rep_str + "-" + path::basename(k_v.first) + compression_ext;
                 prior_settings.replace_comparison_path(path::basename(sim_alignment_path), k_v.first);
             }
         }
     }
     else {
-        std::ostream & state_stream = std::cout;
+        AsyncLogStream state_stream(std::cout);
         state_stream.precision(comparisons.get_logging_precision());
         comparisons.write_state_log_header(state_stream);
         std::cerr << "Only drawing samples of parameters and writing to stdout." << std::endl;
@@ -441,6 +458,7 @@ int simcoevolity_main(int argc, char * argv[]) {
             comparisons.draw_from_prior(rng);
             comparisons.log_state(state_stream, i + 1);
         }
+        state_stream.close();
     }
 
     time(&finish);
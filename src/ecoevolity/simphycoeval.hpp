@@ -29,6 +29,7 @@
 #include "error.hpp"
 #include "rng.hpp"
 #include "path.hpp"
+#include "compressed_stream.hpp"
 #include "string_util.hpp"
 #include "general_tree_settings.hpp"
 #include "settings_io.hpp"
@@ -78,14 +79,12 @@ int simphycoeval_main(int argc, char * argv[]) {
             .action("store")
             .type("unsigned int")
             .dest("topo_mcmc_gens_per_rep")
-            .set_default("1000")
-            .help("Number of generations of MCMC topology moves to perform per "
-                  "simulation replicate. Default 1000. "
-                  "Simphycoeval uses MCMC to sample the "
-                  "topology from the prior, but draws all other parameters "
-                  "\"directly\" from their respective distribuutions. If the "
-                  "topology is fixed in the config provded, this option will "
-                  "be ignored (i.e., the topology will not be sampled).");
+            .set_default("0")
+            .help("DEPRECATED and ignored. Simphycoeval used to sample the "
+                  "topology from the prior with this many generations of MCMC "
+                  "topology moves per replicate. Now, the topology is drawn "
+                  "directly from its prior, along with all other "
+                  "parameters.");
     parser.add_option("-o", "--output-directory")
             .action("store")
             .dest("output_directory")
@@ -216,6 +215,14 @@ int simphycoeval_main(int argc, char * argv[]) {
                   "affected by this option, not alignments of standard "
                   "characters (i.e., 0, 1, 2)."
                 );
+    parser.add_option("--compress")
+            .action("store_true")
+            .dest("compress")
+            .help("Compress the simulated data sets, true parameters and true "
+                  "trees with gzip (with a '.gz' extension). The analysis "
+                  "configs refer to the compressed data files, which "
+                  "phycoeval reads as is."
+                );
 
     optparse::Values& options = parser.parse_args(argc, argv);
     std::vector<std::string> args = parser.args();
@@ -238,12 +245,11 @@ int simphycoeval_main(int argc, char * argv[]) {
                 "Number of simulation replicates must be 1 or greater");
     }
     std::cerr << "Number of simulation replicates: " << nreps << std::endl;
-    const unsigned int topo_mcmc_gens_per_rep = options.get("topo_mcmc_gens_per_rep");
-    // This check will always be true, because the option is unsigned
-    // if (topo_mcmc_gens_per_rep < 0) {
-    //     throw EcoevolityError(
-    //             "Number of topology MCMC generations per replicate cannot be negative");
-    // }
+    if (options.is_set_by_user("topo_mcmc_gens_per_rep")) {
+        std::cerr << "WARNING: The \'--topo-mcmc-gens-per-rep\' option is "
+                  << "deprecated and will be ignored; topologies are drawn "
+                  << "directly from the prior" << std::endl;
+    }
 
     const double singleton_sample_probability = options.get(
             "singleton_sample_probability");
@@ -273,6 +279,13 @@ int simphycoeval_main(int argc, char * argv[]) {
     const bool strict_on_triallelic_sites = (! options.get("relax_triallelic_sites"));
     const bool simulate_sequences = (! options.get("parameters_only"));
     const bool fix_model = options.get("fix_model");
+    const bool compress = options.get("compress");
+    if (compress && (! compressed_stream::is_supported(
+            compressed_stream::Compression::gzip))) {
+        throw EcoevolityError(
+                "Output cannot be compressed; this build does not support gzip (zlib)");
+    }
+    const std::string compression_ext = compress ? ".gz" : "";
 
     if (args.size() < 1) {
         throw EcoevolityError("Path to YAML-formatted config file is required");
@@ -390,8 +403,6 @@ int simphycoeval_main(int argc, char * argv[]) {
     tree.ignore_data();
     tree.compute_log_likelihood_and_prior(1);
 
-    unsigned int n_moves_per_generation = tree.get_leaf_node_count();
-
     GeneralTreeOperatorSchedule<BasePopulationTree> operator_schedule(
             settings.operator_settings, tree.get_leaf_node_count());
 
@@ -423,10 +434,26 @@ int simphycoeval_main(int argc, char * argv[]) {
         sampling_topology = true;
     }
 
+    const bool sampling_bifurcating_topology = (sampling_topology &&
+            (settings.tree_model_settings.get_tree_space() ==
+                    EcoevolityOptions::TreeSpace::bifurcating));
+    std::shared_ptr<GeneralizedTreeCounts> tree_counts;
+    if (sampling_topology && (! sampling_bifurcating_topology)) {
+        tree_counts = std::make_shared<GeneralizedTreeCounts>(
+                tree.get_leaf_node_count());
+    }
+
     if (sampling_topology) {
         std::cerr << "Sampling topology: true" << std::endl;
-        std::cerr << "Number of topology MCMC generations per replicate: "
-                  << topo_mcmc_gens_per_rep << std::endl;
+        if (sampling_bifurcating_topology) {
+            std::cerr << "Topology prior: uniform over bifurcating trees"
+                      << std::endl;
+        }
+        else {
+            std::cerr << "Topology prior: uniform over "
+                      << tree_counts->get_number_of_trees()
+                      << " generalized trees" << std::endl;
+        }
     }
     else {
         std::cerr << "Sampling topology: false" << std::endl;
@@ -493,24 +520,28 @@ int simphycoeval_main(int argc, char * argv[]) {
     // Prepare output files for if we are not simulating datasets
     std::string true_params_path = path::join(
             output_dir,
-            output_prefix + "true-parameters.txt");
+            output_prefix + "true-parameters.txt" + compression_ext);
     std::string true_trees_path = path::join(
             output_dir,
-            output_prefix + "true-trees.phy");
+            output_prefix + "true-trees.phy" + compression_ext);
     std::string rejected_trees_path = path::join(
             output_dir,
             output_prefix + "rejected-trees.phy");
     check_simphy_output_path(true_params_path);
     check_simphy_output_path(true_trees_path);
-    std::ofstream true_params_stream;
-    std::ofstream true_trees_stream;
+    OutputFileStream true_params_stream;
+    OutputFileStream true_trees_stream;
     std::ofstream rejected_trees_stream;
     if (! simulate_sequences) {
         true_params_stream.open(true_params_path);
         true_trees_stream.open(true_trees_path);
         true_params_stream.precision(logging_precision);
         true_trees_stream.precision(logging_precision);
-        tree.write_state_log_header(true_params_stream);
+    }
+    AsyncLogStream true_params_log(true_params_stream);
+    AsyncLogStream true_trees_log(true_trees_stream);
+    if (! simulate_sequences) {
+        tree.write_state_log_header(true_params_log);
     }
 
     unsigned int pad_width = std::to_string(nreps).size();
@@ -530,17 +561,12 @@ int simphycoeval_main(int argc, char * argv[]) {
         while (reject_tree) {
             reject_tree = false;
             std::cerr << "Simulating data set " << (i + 1) << " of " << nreps << "\n";
-            if (sampling_topology && (! fix_model)) {
-                for (unsigned int mcmc_i = 0;
-                        mcmc_i < topo_mcmc_gens_per_rep;
-                        ++mcmc_i) {
-                    for (unsigned int move_i = 0;
-                            move_i < n_moves_per_generation;
-                            ++move_i) {
-                        for (auto op : topology_operators) {
-                            op->operate(rng, &tree, 1, 1);
-                        }
-                    }
+            if (sampling_topology) {
+                if (sampling_bifurcating_topology) {
+                    tree.draw_bifurcating_topology_from_prior(rng);
+                }
+                else {
+                    tree.draw_generalized_topology_from_prior(rng, *tree_counts);
                 }
             }
             if (! fix_model) {
@@ -564,9 +590,9 @@ int simphycoeval_main(int argc, char * argv[]) {
 
         if (simulate_sequences) {
             std::string rep_str = string_util::pad_int(i, pad_width);
-            std::string true_state_path = sim_prefix + rep_str + "-true-parameters.txt";
-            std::string true_tree_path = sim_prefix + rep_str + "-true-tree.phy";
-            std::string sim_alignment_path = sim_prefix + rep_str + "-" + sim_data_suffix;
+            std::string true_state_path = sim_prefix + rep_str + "-true-parameters.txt" + compression_ext;
+            std::string true_tree_path = sim_prefix + rep_str + "-true-tree.phy" + compression_ext;
+            std::string sim_alignment_path = sim_prefix + rep_str + "-" + sim_data_suffix + compression_ext;
             check_simphy_output_path(true_state_path);
             check_simphy_output_path(true_tree_path);
             check_simphy_output_path(sim_alignment_path);
@@ -603,14 +629,14 @@ int simphycoeval_main(int argc, char * argv[]) {
                 sim_alignment = data_nloci.first;
             }
 
-            std::ofstream true_state_stream;
+            OutputFileStream true_state_stream;
             true_state_stream.open(true_state_path);
             true_state_stream.precision(logging_precision);
             tree.write_state_log_header(true_state_stream, logging_delimiter);
             tree.log_state(true_state_stream, 0, logging_delimiter);
             true_state_stream.close();
 
-            std::ofstream true_tree_stream;
+            OutputFileStream true_tree_stream;
             true_tree_stream.open(true_tree_path);
             true_tree_stream.precision(logging_precision);
             true_tree_stream << "[&R]"
@@ -618,7 +644,7 @@ int simphycoeval_main(int argc, char * argv[]) {
                              << ";";
             true_tree_stream.close();
 
-            std::ofstream sim_alignment_stream;
+            OutputFileStream sim_alignment_stream;
             sim_alignment_stream.open(sim_alignment_path);
             sim_alignment.write_yaml(sim_alignment_stream);
             sim_alignment_stream.close();
@@ -645,12 +671,14 @@ int simphycoeval_main(int argc, char * argv[]) {
             }
         }
         else {
-            tree.log_state(true_params_stream, i + 1, logging_delimiter);
-            true_trees_stream << "[&R]"
+            tree.log_state(true_params_log, i + 1, logging_delimiter);
+            true_trees_log << "[&R]"
                               << tree.to_parentheses(true, logging_precision)
                               << ";" << std::endl;
         }
     }
+    true_params_log.close();
+    true_trees_log.close();
     if (! simulate_sequences) {
         true_params_stream.close();
         true_trees_stream.close();
@@ -26,6 +26,8 @@
 #include <map>
 #include <climits>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 
 #include "error.hpp"
 
@@ -94,13 +96,66 @@ class Split {
                 const char set_char = '1') const;
         split_metrics_t get_split_metrics() const;
 
+        std::size_t hash() const;
+
     private:
+        // The first unit of bits is stored in 'first_unit_'; 'bits_' only
+        // holds the remaining units, so splits of up to 64 leaves require no
+        // heap allocation.
         split_unit_t  mask_;
+        split_unit_t  first_unit_;
         split_t       bits_;
+        unsigned int  number_of_units_;
         unsigned int  bits_per_unit_;
         unsigned int  number_of_leaves_;
 
+        inline split_unit_t & unit_(const unsigned int unit_index) {
+            if (unit_index == 0) {
+                return this->first_unit_;
+            }
+            return this->bits_[unit_index - 1];
+        }
+        inline const split_unit_t & unit_(const unsigned int unit_index) const {
+            if (unit_index == 0) {
+                return this->first_unit_;
+            }
+            return this->bits_[unit_index - 1];
+        }
+
     public:
+        static inline std::uint64_t mix_hash(std::uint64_t x) {
+            // splitmix64 finalizer
+            x += 0x9e3779b97f4a7c15ULL;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+        /**
+         * Hash of a set of splits (e.g., a node or the splits of a height).
+         * The hashes of the member splits are combined with a commutative
+         * operation (Zobrist-style), so the result does not depend on the
+         * order of the splits.
+         */
+        static std::size_t hash(const std::set<Split> & split_set) {
+            std::uint64_t h = mix_hash(split_set.size());
+            for (auto const & s : split_set) {
+                h += mix_hash(s.hash());
+            }
+            return static_cast<std::size_t>(h);
+        }
+
+        /**
+         * Hash of a set of sets of splits (e.g., a topology).
+         */
+        static std::size_t hash(const std::set< std::set<Split> > & split_set_set) {
+            std::uint64_t h = mix_hash(split_set_set.size() + 0x5bd1e995ULL);
+            for (auto const & s : split_set_set) {
+                h += mix_hash(hash(s) ^ 0x2545f4914f6cdd1dULL);
+            }
+            return static_cast<std::size_t>(h);
+        }
+
         static Split get_parent_of(std::set<Split> splits) {
             assert(splits.size() > 1);
             Split parent_split;
@@ -151,6 +206,8 @@ class Split {
 
 inline Split::Split() {
     this->mask_ = 0L;
+    this->first_unit_ = 0L;
+    this->number_of_units_ = 0;
     this->number_of_leaves_ = 0;
     this->bits_per_unit_ = (CHAR_BIT)*sizeof(Split::split_unit_t);
     this->clear();
@@ -158,6 +215,8 @@ inline Split::Split() {
 
 inline Split::Split(const Split & other) {
     this->mask_ = other.mask_;
+    this->first_unit_ = other.first_unit_;
+    this->number_of_units_ = other.number_of_units_;
     this->number_of_leaves_ = other.number_of_leaves_;
     this->bits_per_unit_ = (CHAR_BIT)*sizeof(Split::split_unit_t);
     this->bits_ = other.bits_;
@@ -166,12 +225,16 @@ inline Split::Split(const Split & other) {
 inline Split::~Split() {}
 
 inline void Split::clear() {
+    this->first_unit_ = 0L;
     for (auto & split_u : this->bits_) {
         split_u = 0L;
     }
 }
 
 inline bool Split::is_empty() const {
+    if (this->first_unit_ != 0) {
+        return false;
+    }
     for (auto & split_u : this->bits_) {
         if (split_u != 0) {
             return false;
@@ -182,6 +245,8 @@ inline bool Split::is_empty() const {
 
 inline Split & Split::operator=(const Split & other) {
     this->mask_ = other.mask_;
+    this->first_unit_ = other.first_unit_;
+    this->number_of_units_ = other.number_of_units_;
     this->number_of_leaves_ = other.number_of_leaves_;
     this->bits_per_unit_ = (CHAR_BIT)*sizeof(Split::split_unit_t);
     this->bits_ = other.bits_;
@@ -189,7 +254,9 @@ inline Split & Split::operator=(const Split & other) {
 }
 
 inline bool Split::operator==(const Split & other) const {
-    return (this->bits_ == other.bits_);
+    return ((this->first_unit_ == other.first_unit_) &&
+            (this->number_of_units_ == other.number_of_units_) &&
+            (this->bits_ == other.bits_));
 }
 
 inline bool Split::operator!=(const Split & other) const {
@@ -198,6 +265,9 @@ inline bool Split::operator!=(const Split & other) const {
 
 inline bool Split::operator<(const Split & other) const {
     assert(this->size() == other.size());
+    if (this->first_unit_ != other.first_unit_) {
+        return (this->first_unit_ < other.first_unit_);
+    }
     return (this->bits_ < other.bits_);
 }
 
@@ -208,7 +278,8 @@ inline unsigned int Split::size() const {
 inline void Split::resize(const unsigned int nleaves) {
     this->number_of_leaves_ = nleaves;
     unsigned int nunits = 1 + ((nleaves - 1) / this->bits_per_unit_);
-    this->bits_.resize(nunits);
+    this->number_of_units_ = nunits;
+    this->bits_.resize(nunits - 1);
 
     // create mask used to select only those bits used in final unit
     unsigned int num_unused_bits = nunits * this->bits_per_unit_ - nleaves;
@@ -226,12 +297,13 @@ inline void Split::set_leaf_bit(const unsigned int leaf_index) {
     unsigned int bit_index = leaf_index - unit_index * this->bits_per_unit_;
     split_unit_t unity = 1;
     split_unit_t bit_to_set = unity << bit_index;
-    this->bits_.at(unit_index) |= bit_to_set;
+    assert(unit_index < this->number_of_units_);
+    this->unit_(unit_index) |= bit_to_set;
 }
 
 inline Split::split_unit_t Split::get_bits(const unsigned int unit_index) const {
-    // assert(unit_index < this->bits_.size());
-    return this->bits_.at(unit_index);
+    assert(unit_index < this->number_of_units_);
+    return this->unit_(unit_index);
 }
 
 inline bool Split::get_leaf_bit(const unsigned leaf_index) const {
@@ -239,15 +311,16 @@ inline bool Split::get_leaf_bit(const unsigned leaf_index) const {
     unsigned int bit_index = leaf_index - unit_index * this->bits_per_unit_;
     split_unit_t unity = 1;
     split_unit_t bit_to_check = unity << bit_index;
-    return (bool)(this->bits_.at(unit_index) & bit_to_check);
+    assert(unit_index < this->number_of_units_);
+    return (bool)(this->unit_(unit_index) & bit_to_check);
 }
 
 inline void Split::add_split(const Split & other) {
     assert(this->size() == other.size());
-    unsigned nunits = (unsigned int)this->bits_.size();
-    assert(nunits == other.bits_.size());
-    for (unsigned int i = 0; i < nunits; ++i) {
-        this->bits_.at(i) |= other.bits_.at(i);
+    assert(this->number_of_units_ == other.number_of_units_);
+    this->first_unit_ |= other.first_unit_;
+    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
+        this->bits_[i] |= other.bits_[i];
     }
 }
 
@@ -281,10 +354,10 @@ inline std::string Split::as_string(
         const char set_char) const {
     std::ostringstream ss;
     unsigned int nleaves_added = 0;
-    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
+    for (unsigned int i = 0; i < this->number_of_units_; ++i) {
         for (unsigned int j = 0; j < this->bits_per_unit_; ++j) {
             split_unit_t bitmask = ((split_unit_t)1 << j);
-            bool bit_is_set = ((this->bits_.at(i) & bitmask) > (split_unit_t)0);
+            bool bit_is_set = ((this->unit_(i) & bitmask) > (split_unit_t)0);
             if (bit_is_set) {
                 ss << set_char;
             }
@@ -305,17 +378,17 @@ inline bool Split::is_equivalent(const Split & other,
         return false;
     }
     if (strict_root) {
-        return (this->bits_ == other.bits_);
+        return (*this == other);
     }
-    unsigned int nunits = (unsigned int)this->bits_.size();
+    unsigned int nunits = this->number_of_units_;
     assert(nunits > 0);
 
     // polarity 1 means root is on the same side of both splits
     // polarity 2 means they are inverted relative to one another
     unsigned int polarity = 0;
     for (unsigned int i = 0; i < nunits; ++i) {
-        split_unit_t a = this->bits_.at(i);
-        split_unit_t b = other.bits_.at(i);
+        split_unit_t a = this->unit_(i);
+        split_unit_t b = other.unit_(i);
         bool a_equals_b = (a == b);
         bool a_equals_inverse_b = (a == ~b);
         if (i == nunits - 1) {
@@ -351,9 +424,9 @@ inline bool Split::is_equivalent(const Split & other,
 
 inline bool Split::is_compatible(const Split & other) const {
     assert(this->size() == other.size());
-    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
-        split_unit_t a = this->bits_.at(i);
-        split_unit_t b = other.bits_.at(i);
+    for (unsigned int i = 0; i < this->number_of_units_; ++i) {
+        split_unit_t a = this->unit_(i);
+        split_unit_t b = other.unit_(i);
         split_unit_t a_and_b = (a & b);
         bool equals_a = (a == a_and_b);
         bool equals_b = (b == a_and_b);
@@ -375,9 +448,9 @@ inline bool Split::is_proper_subset_of(const Split & other) const {
         // Proper excludes equivalent sets
         return false;
     }
-    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
-        split_unit_t a = this->bits_.at(i);
-        split_unit_t b = other.bits_.at(i);
+    for (unsigned int i = 0; i < this->number_of_units_; ++i) {
+        split_unit_t a = this->unit_(i);
+        split_unit_t b = other.unit_(i);
         split_unit_t a_and_b = (a & b);
         if (a != a_and_b) {
             // other does not contain this
@@ -393,9 +466,9 @@ inline bool Split::is_proper_superset_of(const Split & other) const {
         // Proper excludes equivalent sets
         return false;
     }
-    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
-        split_unit_t a = this->bits_.at(i);
-        split_unit_t b = other.bits_.at(i);
+    for (unsigned int i = 0; i < this->number_of_units_; ++i) {
+        split_unit_t a = this->unit_(i);
+        split_unit_t b = other.unit_(i);
         split_unit_t a_and_b = (a & b);
         if (b != a_and_b) {
             // this does not contain other
@@ -407,9 +480,9 @@ inline bool Split::is_proper_superset_of(const Split & other) const {
 
 inline bool Split::overlaps_with(const Split & other) const {
     assert(this->size() == other.size());
-    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
-        split_unit_t a = this->bits_.at(i);
-        split_unit_t b = other.bits_.at(i);
+    for (unsigned int i = 0; i < this->number_of_units_; ++i) {
+        split_unit_t a = this->unit_(i);
+        split_unit_t b = other.unit_(i);
         split_unit_t a_and_b = (a & b);
         if (a_and_b) {
             // this does not contain other
@@ -441,4 +514,34 @@ inline bool Split::is_parent_of(
     return (this->is_equivalent(parent_split, true));
 }
 
+inline std::size_t Split::hash() const {
+    std::uint64_t h = mix_hash(this->first_unit_);
+    for (unsigned int i = 0; i < this->bits_.size(); ++i) {
+        h = mix_hash(h ^ this->bits_[i]);
+    }
+    return static_cast<std::size_t>(h);
+}
+
+/**
+ * Hash functors for using splits, sets of splits (nodes), and sets of sets
+ * of splits (topologies) as keys of unordered containers.
+ */
+struct SplitHash {
+    std::size_t operator()(const Split & split) const {
+        return split.hash();
+    }
+};
+
+struct SplitSetHash {
+    std::size_t operator()(const std::set<Split> & split_set) const {
+        return Split::hash(split_set);
+    }
+};
+
+struct SplitSetSetHash {
+    std::size_t operator()(const std::set< std::set<Split> > & split_set_set) const {
+        return Split::hash(split_set_set);
+    }
+};
+
 #endif
@@ -24,11 +24,20 @@
 #include <sstream>
 #include <fstream>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
 
 #include "assert.hpp"
 #include "error.hpp"
 #include "string_util.hpp"
 #include "stats_util.hpp"
+#include "compressed_stream.hpp"
 
 namespace spreadsheet {
 
@@ -102,7 +111,7 @@ inline void parse(
         std::vector<std::string>& header,
         unsigned int offset = 0,
         char delimiter = '\t') {
-    std::ifstream in_stream;
+    InputFileStream in_stream;
     in_stream.open(path);
     if (! in_stream.is_open()) {
         throw EcoevolityParsingError(
@@ -221,6 +230,369 @@ class Spreadsheet {
 
 };
 
+/**
+ * Parses the number in [begin, end), which must be followed by a character
+ * that cannot be part of a number (e.g., a delimiter or the null terminator
+ * of a string). Returns false if the characters are not a number.
+ *
+ * Decimals with up to 15 significant digits and small exponents are
+ * converted exactly without strtod; others fall back to strtod. Either way,
+ * the result is the nearest double, as with `std::istream >> double`.
+ */
+inline bool parse_number(const char * begin, const char * end, double & value) {
+    static const double powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (begin == end) {
+        return false;
+    }
+    const char * c = begin;
+    bool negative = false;
+    if ((*c == '-') || (*c == '+')) {
+        negative = (*c == '-');
+        ++c;
+    }
+    std::uint64_t mantissa = 0;
+    int number_of_digits = 0;
+    int exponent = 0;
+    bool has_digits = false;
+    while ((c < end) && (*c >= '0') && (*c <= '9')) {
+        if ((mantissa > 0) || (*c != '0')) {
+            ++number_of_digits;
+        }
+        mantissa = (mantissa * 10) + (*c - '0');
+        has_digits = true;
+        ++c;
+        if (number_of_digits > 15) {
+            break;
+        }
+    }
+    if ((c < end) && (*c == '.') && (number_of_digits <= 15)) {
+        ++c;
+        while ((c < end) && (*c >= '0') && (*c <= '9')) {
+            if ((mantissa > 0) || (*c != '0')) {
+                ++number_of_digits;
+            }
+            mantissa = (mantissa * 10) + (*c - '0');
+            --exponent;
+            has_digits = true;
+            ++c;
+            if (number_of_digits > 15) {
+                break;
+            }
+        }
+    }
+    if ((c < end) && ((*c == 'e') || (*c == 'E')) && has_digits &&
+            (number_of_digits <= 15)) {
+        ++c;
+        bool negative_exponent = false;
+        if ((c < end) && ((*c == '-') || (*c == '+'))) {
+            negative_exponent = (*c == '-');
+            ++c;
+        }
+        int e = 0;
+        bool has_exponent_digits = false;
+        while ((c < end) && (*c >= '0') && (*c <= '9') && (e < 1000)) {
+            e = (e * 10) + (*c - '0');
+            has_exponent_digits = true;
+            ++c;
+        }
+        if (! has_exponent_digits) {
+            return false;
+        }
+        exponent += (negative_exponent ? -e : e);
+    }
+    if ((c == end) && has_digits && (number_of_digits <= 15) &&
+            (exponent >= -22) && (exponent <= 22)) {
+        // Both the mantissa (< 2^53) and the power of ten are exact, so the
+        // product or quotient is correctly rounded
+        double v = (double)mantissa;
+        if (exponent < 0) {
+            v /= powers_of_ten[-exponent];
+        }
+        else {
+            v *= powers_of_ten[exponent];
+        }
+        value = (negative ? -v : v);
+        return true;
+    }
+    char * parse_end;
+    errno = 0;
+    double v = std::strtod(begin, &parse_end);
+    if ((parse_end != end) || (errno == ERANGE && std::abs(v) > 1.0)) {
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+/**
+ * Parses the integer in [begin, end). Returns false if the characters are
+ * not an integer of type T.
+ */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+parse_number(const char * begin, const char * end, T & value) {
+    if (begin == end) {
+        return false;
+    }
+    const char * c = begin;
+    bool negative = false;
+    if ((*c == '-') || (*c == '+')) {
+        negative = (*c == '-');
+        ++c;
+        if (negative && (! std::is_signed<T>::value)) {
+            return false;
+        }
+    }
+    if (c == end) {
+        return false;
+    }
+    typedef typename std::make_unsigned<T>::type U;
+    const U limit = negative ?
+            (U)std::numeric_limits<T>::max() + 1 :
+            (U)std::numeric_limits<T>::max();
+    U v = 0;
+    for (; c < end; ++c) {
+        if ((*c < '0') || (*c > '9')) {
+            return false;
+        }
+        U digit = (U)(*c - '0');
+        if (v > ((limit - digit) / 10)) {
+            return false;
+        }
+        v = (v * 10) + digit;
+    }
+    if (negative && (v > 0)) {
+        // Negated in T, so that the minimum of T does not overflow
+        value = -(T)(v - 1) - 1;
+    }
+    else {
+        value = (T)v;
+    }
+    return true;
+}
+
+/**
+ * Streams the rows of a delimited spreadsheet, parsing only the columns in
+ * `keys` (all, if empty) as values of type T, and passes the values of each
+ * row (in the order of the keys) to `process_row`. No strings are kept for
+ * cells.
+ *
+ * If `header` is empty, it is set to the header of the spreadsheet;
+ * otherwise, the header of the spreadsheet must match it. The first `offset`
+ * rows (e.g., burn in) are skipped without being parsed. Empty lines are
+ * ignored.
+ */
+template <typename T, class RowFunction>
+void stream_numeric_columns(
+        std::istream & in_stream,
+        std::vector<std::string> & header,
+        const std::vector<std::string> & keys,
+        RowFunction process_row,
+        unsigned int offset = 0,
+        char delimiter = '\t',
+        const std::string & path = "") {
+    std::vector<std::string> file_header;
+    parse_header(in_stream, file_header, delimiter);
+    if (file_header.size() == 0) {
+        throw EcoevolityParsingError(
+                "Could not parse header",
+                path,
+                1);
+    }
+    if (header.empty()) {
+        header = file_header;
+    }
+    else if (file_header != header) {
+        throw EcoevolityParsingError(
+                "Headers does not match",
+                path,
+                1);
+    }
+    const std::vector<std::string> & columns = (keys.empty() ? header : keys);
+    // Index of each column in 'values', or -1 for columns that are not
+    // needed
+    std::vector<int> column_targets(header.size(), -1);
+    for (unsigned int k = 0; k < columns.size(); ++k) {
+        auto h = std::find(header.begin(), header.end(), columns.at(k));
+        if (h == header.end()) {
+            throw EcoevolitySpreadsheetError(
+                    "Column \'" + columns.at(k) + "\' not found in \'" + path + "\'");
+        }
+        column_targets.at(h - header.begin()) = k;
+    }
+    std::vector<T> values(columns.size());
+
+    const unsigned int number_of_columns = header.size();
+    unsigned int line_number = 1;
+    unsigned int row_index = 0;
+    std::string line;
+    while (std::getline(in_stream, line)) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        ++row_index;
+        if (row_index <= offset) {
+            continue;
+        }
+        const char * field = line.c_str();
+        const char * line_end = field + line.size();
+        unsigned int column = 0;
+        while (true) {
+            const char * field_end = field;
+            while ((field_end < line_end) && (*field_end != delimiter)) {
+                ++field_end;
+            }
+            if (column < number_of_columns) {
+                int target = column_targets[column];
+                if (target > -1) {
+                    if (! parse_number(field, field_end, values[target])) {
+                        throw EcoevolitySpreadsheetError(
+                                "could not convert \'" +
+                                std::string(field, field_end) + "\'");
+                    }
+                }
+            }
+            ++column;
+            if (field_end >= line_end) {
+                break;
+            }
+            field = field_end + 1;
+        }
+        if (column != number_of_columns) {
+            std::ostringstream message;
+            message << "Incorrect number of columns: Expecting "
+                    << number_of_columns << ", but found "
+                    << column;
+            throw EcoevolityParsingError(
+                    message.str(),
+                    path,
+                    line_number);
+        }
+        process_row(values);
+    }
+}
+
+/**
+ * Numeric columns of one or more spreadsheets, each stored contiguously as
+ * values of type T (e.g., double or int).
+ *
+ * Only the columns given to the constructor (all, if none are given) are
+ * parsed (see stream_numeric_columns).
+ */
+template <typename T>
+class NumericSpreadsheet {
+
+    protected:
+
+        std::vector<std::string> header_;
+        std::vector<std::string> keys_;
+        std::vector< std::vector<T> > columns_;
+        char delimiter_;
+
+        void update_(
+                std::istream & in_stream,
+                unsigned int offset,
+                const std::string & path) {
+            stream_numeric_columns<T>(in_stream,
+                    this->header_,
+                    this->keys_,
+                    [this](const std::vector<T> & values) {
+                        if (this->columns_.empty()) {
+                            this->columns_.resize(values.size());
+                        }
+                        for (unsigned int k = 0; k < values.size(); ++k) {
+                            this->columns_[k].push_back(values[k]);
+                        }
+                    },
+                    offset,
+                    this->delimiter_,
+                    path);
+            if (this->keys_.empty()) {
+                this->keys_ = this->header_;
+            }
+            this->columns_.resize(this->keys_.size());
+        }
+
+    public:
+
+        NumericSpreadsheet(
+                const std::vector<std::string> & keys = std::vector<std::string>(),
+                char delimiter = '\t')
+                : keys_(keys),
+                  delimiter_(delimiter) { }
+
+        void update(
+                std::istream & in_stream,
+                unsigned int offset = 0) {
+            this->update_(in_stream, offset, "");
+        }
+
+        void update(
+                const std::string & path,
+                unsigned int offset = 0) {
+            InputFileStream in_stream;
+            in_stream.open(path);
+            if (! in_stream.is_open()) {
+                throw EcoevolityParsingError(
+                        "Could not open spreadsheet file",
+                        path);
+            }
+            this->update_(in_stream, offset, path);
+            in_stream.close();
+        }
+
+        void update(
+                const std::vector<std::string> & paths,
+                unsigned int offset = 0) {
+            for (auto const & path : paths) {
+                this->update(path, offset);
+            }
+        }
+
+        /**
+         * The columns that are parsed.
+         */
+        const std::vector<std::string> & get_keys() const {
+            return this->keys_;
+        }
+        /**
+         * All of the columns of the spreadsheets.
+         */
+        const std::vector<std::string> & get_header() const {
+            return this->header_;
+        }
+        bool has_key(const std::string & k) const {
+            return (std::find(this->keys_.begin(), this->keys_.end(), k) !=
+                    this->keys_.end());
+        }
+        std::size_t get_number_of_rows() const {
+            if (this->columns_.empty()) {
+                return 0;
+            }
+            return this->columns_.at(0).size();
+        }
+
+        const std::vector<T> & get(const std::string & column_label) const {
+            auto k = std::find(this->keys_.begin(), this->keys_.end(), column_label);
+            if ((k == this->keys_.end()) || this->columns_.empty()) {
+                throw EcoevolitySpreadsheetError(
+                        "Column \'" + column_label + "\' was not parsed");
+            }
+            return this->columns_.at(k - this->keys_.begin());
+        }
+
+        SampleSummarizer<T> summarize(const std::string & column_label) const {
+            SampleSummarizer<T> summarizer;
+            for (auto v : this->get(column_label)) {
+                summarizer.add_sample(v);
+            }
+            return summarizer;
+        }
+};
+
 } // namespace spreadsheet 
 
 #endif
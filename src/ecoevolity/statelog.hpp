@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Copyright (C) 2015-2016 Jamie R. Oaks.
+ *
+ * This file is part of Ecoevolity.
+ *
+ * Ecoevolity is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Ecoevolity is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Ecoevolity.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef ECOEVOLITY_STATELOG_HPP
+#define ECOEVOLITY_STATELOG_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * The columns of one row of a state log.
+ *
+ * Trees and collections add their columns to a row in one place, and the
+ * header writers and the text and binary state loggers all read them from
+ * the row, so that the formats cannot disagree on the columns. Counts and
+ * indices are written to text logs as integers, regardless of the stream
+ * precision.
+ */
+class StateLogRow {
+    protected:
+        std::vector<std::string> names_;
+        std::vector<double> values_;
+        std::vector<bool> is_integer_;
+
+    public:
+        void clear() {
+            this->names_.clear();
+            this->values_.clear();
+            this->is_integer_.clear();
+        }
+
+        void add(const std::string & name, double value) {
+            this->names_.push_back(name);
+            this->values_.push_back(value);
+            this->is_integer_.push_back(false);
+        }
+        void add_integer(const std::string & name, unsigned int value) {
+            this->names_.push_back(name);
+            this->values_.push_back(value);
+            this->is_integer_.push_back(true);
+        }
+
+        const std::vector<std::string> & get_names() const {
+            return this->names_;
+        }
+        const std::vector<double> & get_values() const {
+            return this->values_;
+        }
+        unsigned int size() const {
+            return this->names_.size();
+        }
+
+        void write_names(std::ostream & out,
+                const std::string & delimiter) const {
+            for (unsigned int i = 0; i < this->names_.size(); ++i) {
+                if (i > 0) {
+                    out << delimiter;
+                }
+                out << this->names_.at(i);
+            }
+        }
+        void write_values(std::ostream & out,
+                const std::string & delimiter) const {
+            for (unsigned int i = 0; i < this->values_.size(); ++i) {
+                if (i > 0) {
+                    out << delimiter;
+                }
+                if (this->is_integer_.at(i)) {
+                    out << static_cast<unsigned int>(this->values_.at(i));
+                }
+                else {
+                    out << this->values_.at(i);
+                }
+            }
+        }
+};
+
+#endif
@@ -21,9 +21,16 @@
 #define ECOEVOLITY_STATS_UTIL_HPP
 
 #include <vector>
+#include <string>
+#include <ostream>
 #include <limits>
 #include <cmath>
 #include <numeric>
+#include <algorithm>
+
+#ifdef BUILD_WITH_THREADS
+#include <future>
+#endif
 
 #include "assert.hpp"
 #include "error.hpp"
@@ -268,6 +275,514 @@ inline double potential_scale_reduction_factor(
 }
 
 
+/**
+ * Cumulative sums of one or more chains of MCMC samples.
+ *
+ * Summary statistics of the samples that remain after removing any number of
+ * samples from the beginning of each chain (as burn in) are calculated from
+ * the sums, without revisiting the samples. This allows statistics for many
+ * different burn-in values to be calculated from a single pass over the
+ * samples. Up to rounding error, the effective sample size and potential
+ * scale reduction factor are the same as those returned by
+ * effective_sample_size and potential_scale_reduction_factor for the
+ * remaining samples.
+ */
+template <typename T>
+class BurninSampleSums {
+    protected:
+        std::vector< std::vector<double> > sums_;
+        std::vector< std::vector<double> > squared_sums_;
+        // Samples are centered on this value to limit rounding error
+        double shift_ = 0.0;
+
+        unsigned int get_remaining_(
+                const unsigned int chain_index,
+                const unsigned int burnin) const {
+            unsigned int n = this->get_chain_size(chain_index);
+            if (burnin >= n) {
+                return 0;
+            }
+            return n - burnin;
+        }
+
+        /**
+         * Sum of the (centered) samples in the range [begin, end) of the
+         * concatenation of the chains after burn in.
+         */
+        double get_concatenated_sum_(
+                const unsigned int burnin,
+                const unsigned int begin,
+                const unsigned int end) const {
+            double s = 0.0;
+            unsigned int offset = 0;
+            for (unsigned int i = 0; i < this->sums_.size(); ++i) {
+                if (offset >= end) {
+                    break;
+                }
+                unsigned int n = this->get_remaining_(i, burnin);
+                unsigned int b = std::max(begin, offset);
+                unsigned int e = std::min(end, offset + n);
+                if (b < e) {
+                    s += this->sums_[i][burnin + (e - offset)] -
+                            this->sums_[i][burnin + (b - offset)];
+                }
+                offset += n;
+            }
+            return s;
+        }
+
+        double get_centered_sum_(
+                const unsigned int chain_index,
+                const unsigned int burnin) const {
+            const std::vector<double> & s = this->sums_.at(chain_index);
+            return s.back() - s.at(std::min(burnin, this->get_chain_size(chain_index)));
+        }
+
+        double get_centered_squared_sum_(
+                const unsigned int chain_index,
+                const unsigned int burnin) const {
+            const std::vector<double> & s = this->squared_sums_.at(chain_index);
+            return s.back() - s.at(std::min(burnin, this->get_chain_size(chain_index)));
+        }
+
+        static double get_variance_(double sum, double squared_sum, double n) {
+            if (n < 2.0) {
+                return std::numeric_limits<double>::infinity();
+            }
+            double ss = squared_sum - ((sum * sum) / n);
+            if (ss < 0.0) {
+                ss = 0.0;
+            }
+            return ss / (n - 1.0);
+        }
+
+    public:
+        BurninSampleSums() { }
+        BurninSampleSums(const std::vector<T> & samples)
+            : BurninSampleSums(std::vector< std::vector<T> >(1, samples)) { }
+        BurninSampleSums(const std::vector< std::vector<T> > & chains) {
+            for (auto const & chain : chains) {
+                if (! chain.empty()) {
+                    this->shift_ = (double)chain.back();
+                    break;
+                }
+            }
+            this->sums_.resize(chains.size());
+            this->squared_sums_.resize(chains.size());
+            for (unsigned int i = 0; i < chains.size(); ++i) {
+                const std::vector<T> & chain = chains.at(i);
+                std::vector<double> & sums = this->sums_.at(i);
+                std::vector<double> & squared_sums = this->squared_sums_.at(i);
+                sums.resize(chain.size() + 1, 0.0);
+                squared_sums.resize(chain.size() + 1, 0.0);
+                for (unsigned int j = 0; j < chain.size(); ++j) {
+                    double x = (double)chain[j] - this->shift_;
+                    sums[j + 1] = sums[j] + x;
+                    squared_sums[j + 1] = squared_sums[j] + (x * x);
+                }
+            }
+        }
+
+        unsigned int get_number_of_chains() const {
+            return this->sums_.size();
+        }
+        unsigned int get_chain_size(const unsigned int chain_index) const {
+            return this->sums_.at(chain_index).size() - 1;
+        }
+
+        /**
+         * Number of samples that remain in all chains after removing
+         * 'burnin' samples from the beginning of each chain.
+         */
+        unsigned int get_sample_size(const unsigned int burnin) const {
+            unsigned int n = 0;
+            for (unsigned int i = 0; i < this->sums_.size(); ++i) {
+                n += this->get_remaining_(i, burnin);
+            }
+            return n;
+        }
+
+        double mean(const unsigned int burnin) const {
+            double s = 0.0;
+            for (unsigned int i = 0; i < this->sums_.size(); ++i) {
+                s += this->get_centered_sum_(i, burnin);
+            }
+            return (s / this->get_sample_size(burnin)) + this->shift_;
+        }
+        double mean(
+                const unsigned int chain_index,
+                const unsigned int burnin) const {
+            return (this->get_centered_sum_(chain_index, burnin) /
+                    this->get_remaining_(chain_index, burnin)) + this->shift_;
+        }
+
+        double variance(const unsigned int burnin) const {
+            double s = 0.0;
+            double ss = 0.0;
+            for (unsigned int i = 0; i < this->sums_.size(); ++i) {
+                s += this->get_centered_sum_(i, burnin);
+                ss += this->get_centered_squared_sum_(i, burnin);
+            }
+            return get_variance_(s, ss, this->get_sample_size(burnin));
+        }
+        double variance(
+                const unsigned int chain_index,
+                const unsigned int burnin) const {
+            return get_variance_(
+                    this->get_centered_sum_(chain_index, burnin),
+                    this->get_centered_squared_sum_(chain_index, burnin),
+                    this->get_remaining_(chain_index, burnin));
+        }
+
+        /**
+         * Monte Carlo standard error of the samples of all chains after burn
+         * in, with the chains concatenated (see monte_carlo_standard_error).
+         */
+        std::pair<double, double> monte_carlo_standard_error(
+                const unsigned int burnin) const {
+            unsigned int n = this->get_sample_size(burnin);
+            unsigned int b = (unsigned int)std::floor(std::sqrt(n));
+            unsigned int a = (unsigned int)std::floor((double)n / b);
+            double mu_hat = this->get_concatenated_sum_(burnin, 0, n) / (double)n;
+            double sum_sq_diffs = 0.0;
+            for (unsigned int k = 1; k < a + 1; ++k) {
+                double y = this->get_concatenated_sum_(burnin,
+                        (k - 1) * b, k * b) / (double)b;
+                sum_sq_diffs += (y - mu_hat) * (y - mu_hat);
+            }
+            double var_hat = (double)b * sum_sq_diffs / ((double)a - 1.0);
+            double se = std::sqrt(var_hat / (double)n);
+            return std::make_pair(mu_hat + this->shift_, se);
+        }
+
+        /**
+         * Effective sample size of the samples of all chains after burn in,
+         * with the chains concatenated (see effective_sample_size).
+         */
+        double effective_sample_size(
+                const unsigned int burnin,
+                const bool limit_to_number_of_samples = true) const {
+            unsigned int n = this->get_sample_size(burnin);
+            if (n < 1) {
+                return 0.0;
+            }
+            double sigma = this->monte_carlo_standard_error(burnin).second;
+            if (sigma == 0.0) {
+                return 0.0;
+            }
+            double ess = this->variance(burnin) / (sigma * sigma);
+            if ((ess > n) and (limit_to_number_of_samples)) {
+                return n;
+            }
+            return ess;
+        }
+
+        /**
+         * Potential scale reduction factor of the chains after burn in (see
+         * potential_scale_reduction_factor).
+         */
+        double potential_scale_reduction_factor(
+                const unsigned int burnin) const {
+            unsigned int nchains = this->get_number_of_chains();
+            ECOEVOLITY_ASSERT(nchains > 1);
+            unsigned int nsamples = this->get_remaining_(0, burnin);
+            SampleSummarizer<double> summary_of_variances;
+            SampleSummarizer<double> summary_of_means;
+            for (unsigned int i = 0; i < nchains; ++i) {
+                ECOEVOLITY_ASSERT(this->get_remaining_(i, burnin) == nsamples);
+                summary_of_variances.add_sample(this->variance(i, burnin));
+                summary_of_means.add_sample(this->mean(i, burnin));
+            }
+            double within_chain_var = summary_of_variances.mean();
+            double between_chain_var = summary_of_means.variance();
+            double pooled_var_term1 = (1.0 - (1.0 / (double)nsamples)) * within_chain_var;
+            double pooled_var = pooled_var_term1 + between_chain_var;
+            double pooled_posterior_var = pooled_var + (between_chain_var / nchains);
+            if (within_chain_var == 0.0) {
+                return std::numeric_limits<double>::infinity();
+            }
+            return std::sqrt(pooled_posterior_var / within_chain_var);
+        }
+};
+
+/**
+ * Estimate the number of samples to discard from the beginning of an MCMC
+ * chain as burn in with the MSER truncation rule.
+ *
+ * The samples are grouped into consecutive batches of size 'batch_size'
+ * (MSER-5 by default), and the number of batches discarded is the one that
+ * minimizes the squared standard error of the mean of the remaining batch
+ * means. Only truncation points in the first half of the chain are
+ * considered. Samples that do not fill the last batch are ignored.
+ *
+ * White, K. Preston, Jr. 1997. An effective truncation heuristic for bias
+ * reduction in simulation output. Simulation, 69:323--334.
+ */
+template <typename T>
+inline unsigned int mser_burnin(
+        const std::vector<T> & samples,
+        const unsigned int batch_size = 5) {
+    ECOEVOLITY_ASSERT(batch_size > 0);
+    unsigned int nbatches = samples.size() / batch_size;
+    if (nbatches < 2) {
+        return 0;
+    }
+    std::vector<double> batch_means(nbatches, 0.0);
+    for (unsigned int k = 0; k < nbatches; ++k) {
+        double s = 0.0;
+        for (unsigned int i = k * batch_size; i < ((k + 1) * batch_size); ++i) {
+            s += (double)samples[i];
+        }
+        batch_means[k] = s / batch_size;
+    }
+    // Center on the last batch mean to limit rounding error
+    const double shift = batch_means.back();
+    double sum = 0.0;
+    double squared_sum = 0.0;
+    std::vector<double> mser(nbatches, 0.0);
+    for (unsigned int k = nbatches; k > 0; --k) {
+        double z = batch_means[k - 1] - shift;
+        sum += z;
+        squared_sum += z * z;
+        double m = (double)(nbatches - k + 1);
+        double ss = squared_sum - ((sum * sum) / m);
+        if (ss < 0.0) {
+            ss = 0.0;
+        }
+        mser[k - 1] = ss / (m * m);
+    }
+    unsigned int best = 0;
+    for (unsigned int d = 1; d <= (nbatches / 2); ++d) {
+        if (mser[d] < mser[best]) {
+            best = d;
+        }
+    }
+    return best * batch_size;
+}
+
+/**
+ * Calculate Geweke's convergence diagnostic.
+ *
+ * Returns the z-score of the difference between the means of the first
+ * 'first_proportion' and the last 'last_proportion' of the samples. The
+ * standard errors of the means are estimated by batch means (see
+ * monte_carlo_standard_error) rather than from spectral densities. Returns
+ * NaN if there are too few samples to estimate the standard errors, or if
+ * both portions of the chain are constant and equal.
+ *
+ * Geweke, John. 1992. Evaluating the accuracy of sampling-based approaches
+ * to the calculation of posterior moments. In Bayesian Statistics 4,
+ * pages 169--193.
+ */
+template <typename T>
+inline double geweke_z_score(
+        const std::vector<T> & samples,
+        const double first_proportion = 0.1,
+        const double last_proportion = 0.5) {
+    if ((first_proportion <= 0.0) || (last_proportion <= 0.0) ||
+            ((first_proportion + last_proportion) > 1.0)) {
+        throw EcoevolityError(
+                "stats_util::geweke_z_score: proportions must be positive "
+                "and sum to 1 or less");
+    }
+    unsigned int n = samples.size();
+    unsigned int n_first = (unsigned int)std::floor(first_proportion * n);
+    unsigned int n_last = (unsigned int)std::floor(last_proportion * n);
+    if ((n_first < 2) || (n_last < 2)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::pair<double, double> first = monte_carlo_standard_error(
+            std::vector<T>(samples.begin(), samples.begin() + n_first));
+    std::pair<double, double> last = monte_carlo_standard_error(
+            std::vector<T>(samples.end() - n_last, samples.end()));
+    double se = std::sqrt((first.second * first.second) +
+            (last.second * last.second));
+    return (first.first - last.first) / se;
+}
+
+
+/**
+ * The thinning interval that leaves about 'min_ess' of 'number_of_samples'
+ * samples; 1 (no thinning) if 'min_ess' is less than 1.
+ */
+inline unsigned int get_thinning_interval(
+        const unsigned int number_of_samples,
+        const double min_ess) {
+    if (min_ess < 1.0) {
+        return 1;
+    }
+    return std::max(1u,
+            (unsigned int)std::floor(number_of_samples / min_ess));
+}
+
+/**
+ * The thinning interval that leaves about as many samples as the smallest
+ * effective sample size among the parameters, so that the remaining samples
+ * are approximately independent (Talts et al. 2018). Parameters that are
+ * constant are ignored.
+ *
+ * Talts, S., M. Betancourt, D. Simpson, A. Vehtari, and A. Gelman. 2018.
+ * Validating Bayesian inference algorithms with simulation-based calibration.
+ * arXiv:1804.06788 [stat.ME].
+ */
+template <typename T>
+inline unsigned int get_effective_thinning_interval(
+        const std::vector< std::vector<T> > & parameter_samples) {
+    if (parameter_samples.empty()) {
+        return 1;
+    }
+    const unsigned int n = parameter_samples.at(0).size();
+    if (n < 2) {
+        return 1;
+    }
+    double min_ess = n;
+    for (auto const & samples : parameter_samples) {
+        ECOEVOLITY_ASSERT(samples.size() == n);
+        double ess = effective_sample_size(samples, true);
+        if (ess <= 0.0) {
+            continue;
+        }
+        min_ess = std::min(min_ess, ess);
+    }
+    return get_thinning_interval(n, min_ess);
+}
+
+/**
+ * Recommended burn in and thinning for an MCMC chain.
+ */
+struct BurninAdvice {
+    // Number of samples in the chain
+    unsigned int number_of_samples = 0;
+    // Number of samples to discard from the beginning of the chain
+    unsigned int burnin = 0;
+    // Keep every 'thin'-th sample after burn in
+    unsigned int thin = 1;
+    // Smallest effective sample size among the parameters after burn in
+    double min_ess = 0.0;
+    // Largest absolute Geweke z-score among the parameters after burn in
+    double max_abs_geweke_z = 0.0;
+
+    unsigned int get_sample_size() const {
+        return this->number_of_samples - this->burnin;
+    }
+};
+
+/**
+ * Recommend burn in and thinning for an MCMC chain from the samples of one
+ * or more of its parameters (e.g., the log likelihood and key parameters).
+ *
+ * The burn in is the largest MSER truncation point among the parameters
+ * (see mser_burnin). The thinning interval is the number of samples after
+ * burn in per effective sample of the parameter with the smallest effective
+ * sample size. Parameters that are constant after burn in are ignored.
+ */
+template <typename T>
+inline BurninAdvice get_burnin_advice(
+        const std::vector< std::vector<T> > & parameter_samples,
+        const unsigned int batch_size = 5) {
+    BurninAdvice advice;
+    if (parameter_samples.empty()) {
+        return advice;
+    }
+    advice.number_of_samples = parameter_samples.at(0).size();
+    for (auto const & samples : parameter_samples) {
+        ECOEVOLITY_ASSERT(samples.size() == advice.number_of_samples);
+        advice.burnin = std::max(advice.burnin,
+                mser_burnin(samples, batch_size));
+    }
+    const unsigned int n = advice.get_sample_size();
+    advice.min_ess = n;
+    for (auto const & samples : parameter_samples) {
+        std::vector<T> remaining(samples.begin() + advice.burnin,
+                samples.end());
+        double ess = 0.0;
+        if (n > 1) {
+            ess = effective_sample_size(remaining, true);
+        }
+        if (ess <= 0.0) {
+            continue;
+        }
+        advice.min_ess = std::min(advice.min_ess, ess);
+        double z = geweke_z_score(remaining);
+        if (! std::isnan(z)) {
+            advice.max_abs_geweke_z = std::max(advice.max_abs_geweke_z,
+                    std::abs(z));
+        }
+    }
+    advice.thin = get_thinning_interval(n, advice.min_ess);
+    return advice;
+}
+
+/**
+ * Recommend burn in and thinning for 'number_of_chains' MCMC chains, where
+ * 'get_chain_samples(i)' returns the samples of the parameters of the i-th
+ * chain (see get_burnin_advice). With multiple threads, chains are read and
+ * assessed in parallel.
+ */
+template <typename T, class ChainFunction>
+inline std::vector<BurninAdvice> get_burnin_advice_for_chains(
+        const unsigned int number_of_chains,
+        ChainFunction get_chain_samples,
+        unsigned int nthreads = 1,
+        const unsigned int batch_size = 5) {
+    std::vector<BurninAdvice> advice(number_of_chains);
+    auto assess_chain = [&](unsigned int chain_index) {
+        std::vector< std::vector<T> > samples = get_chain_samples(chain_index);
+        return get_burnin_advice<T>(samples, batch_size);
+    };
+#ifdef BUILD_WITH_THREADS
+    if (nthreads > number_of_chains) {
+        nthreads = number_of_chains;
+    }
+    if (nthreads > 1) {
+        for (unsigned int first = 0; first < number_of_chains; first += nthreads) {
+            unsigned int last = std::min(number_of_chains, first + nthreads);
+            std::vector< std::future<BurninAdvice> > threads;
+            threads.reserve(last - first - 1);
+            for (unsigned int i = first; i < (last - 1); ++i) {
+                threads.push_back(std::async(
+                        std::launch::async,
+                        assess_chain,
+                        i));
+            }
+            // Use the main thread for the last chain
+            advice.at(last - 1) = assess_chain(last - 1);
+            for (unsigned int i = first; i < (last - 1); ++i) {
+                advice.at(i) = threads.at(i - first).get();
+            }
+        }
+        return advice;
+    }
+#endif
+    for (unsigned int i = 0; i < number_of_chains; ++i) {
+        advice.at(i) = assess_chain(i);
+    }
+    return advice;
+}
+
+/**
+ * Write a tab-delimited table of recommended burn in and thinning, with one
+ * row per chain.
+ */
+inline void write_burnin_advice(
+        std::ostream & out,
+        const std::vector<std::string> & paths,
+        const std::vector<BurninAdvice> & advice) {
+    ECOEVOLITY_ASSERT(paths.size() == advice.size());
+    out << "path\tnumber_of_samples\tburnin\tthin\tsample_size\tmin_ess\tmax_abs_geweke_z\n";
+    for (unsigned int i = 0; i < advice.size(); ++i) {
+        out << paths.at(i)
+            << "\t" << advice.at(i).number_of_samples
+            << "\t" << advice.at(i).burnin
+            << "\t" << advice.at(i).thin
+            << "\t" << advice.at(i).get_sample_size()
+            << "\t" << advice.at(i).min_ess
+            << "\t" << advice.at(i).max_abs_geweke_z
+            << "\n";
+    }
+}
+
+
 /**
  * Return the median value from a list of samples.
  */
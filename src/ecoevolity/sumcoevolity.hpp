@@ -33,13 +33,45 @@
 #include "probability.hpp"
 #include "string_util.hpp"
 #include "settings.hpp"
+#include "stats_util.hpp"
 #include "spreadsheet.hpp"
+#include "binlog.hpp"
+#include "partitionsum.hpp"
 
 
 void write_sumcoevolity_splash(std::ostream& out);
 
 void check_sumcoevolity_output_path(const std::string& path);
 
+/**
+ * Return the samples of the requested columns of a (binary or tab-delimited)
+ * state log, for assessing burn in.
+ */
+inline std::vector< std::vector<double> > get_state_log_burnin_samples(
+        const std::string & path,
+        const std::vector<std::string> & column_labels) {
+    std::vector< std::vector<double> > samples;
+    samples.reserve(column_labels.size());
+    if (binlog::is_binary_state_log(path)) {
+        binlog::StateLogReader reader(path);
+        for (auto const & label : column_labels) {
+            unsigned int column_index = reader.get_column_index(label);
+            samples.push_back(std::vector<double>());
+            samples.back().reserve(reader.get_number_of_rows());
+            for (std::size_t row = 0; row < reader.get_number_of_rows(); ++row) {
+                samples.back().push_back(reader.get_value(row, column_index));
+            }
+        }
+        return samples;
+    }
+    spreadsheet::NumericSpreadsheet<double> log(column_labels);
+    log.update(path);
+    for (auto const & label : column_labels) {
+        samples.push_back(log.get(label));
+    }
+    return samples;
+}
+
 template <class SettingsType>
 int sumcoevolity_main(int argc, char * argv[]) {
 
@@ -72,6 +104,20 @@ int sumcoevolity_main(int argc, char * argv[]) {
             .help("Number of samples from the beginning of each log file to "
                   "ignore as burn in. "
                   "Default: 0.");
+    parser.add_option("--auto-burnin")
+            .action("store_true")
+            .dest("auto_burnin")
+            .help("Detect the burn in of each log file from the log "
+                  "likelihood, log prior, number of events, and root heights, "
+                  "and ignore these samples. The recommended burn in and "
+                  "thinning for each file are reported. This cannot be used "
+                  "with '--burnin'.");
+    parser.add_option("--burnin-advice")
+            .action("store_true")
+            .dest("burnin_advice")
+            .help("Write a table of the recommended burn in and thinning "
+                  "for each log file (see '--auto-burnin') to standard "
+                  "output and exit.");
     parser.add_option("-p", "--prefix")
             .action("store")
             .dest("prefix")
@@ -112,6 +158,16 @@ int sumcoevolity_main(int argc, char * argv[]) {
             .action("store_true")
             .dest("force")
             .help("Force overwriting of existing output files, if they exist.");
+#ifdef BUILD_WITH_THREADS
+    parser.add_option("--nthreads")
+            .action("store")
+            .type("unsigned int")
+            .dest("nthreads")
+            .set_default("1")
+            .help("Number of threads to use for assessing the burn in of "
+                  "log files. "
+                  "Default: 1 (no multithreading).");
+#endif
 
     optparse::Values& options = parser.parse_args(argc, argv);
     std::vector<std::string> log_paths = parser.args();
@@ -157,6 +213,19 @@ int sumcoevolity_main(int argc, char * argv[]) {
     //     throw EcoevolityError(
     //             "Burn in must be 0 or greater");
     // }
+    const bool auto_burnin = options.get("auto_burnin");
+    const bool writing_burnin_advice = options.get("burnin_advice");
+    if ((auto_burnin || writing_burnin_advice) &&
+            options.is_set_by_user("burnin")) {
+        throw EcoevolityError("\'--burnin\' cannot be used with "
+                "\'--auto-burnin\' or \'--burnin-advice\'");
+    }
+
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = options.get("nthreads");
+#else
+    unsigned int nthreads = 1;
+#endif
 
     std::string config_path = options.get("config").get_str();
     bool running_sims = false;
@@ -211,119 +280,133 @@ int sumcoevolity_main(int argc, char * argv[]) {
     time_t finish;
     time(&start);
 
-    std::cerr << "Parsing log files...\n";
-    spreadsheet::Spreadsheet posterior_sample;
-    posterior_sample.update(log_paths, burnin);
-    std::vector<int> nevents = posterior_sample.get<int>("number_of_events");
-
-    unsigned int number_of_posterior_samples = nevents.size();
-    if (number_of_posterior_samples < 1) {
+    std::vector<std::string> keys = partitionsum::get_state_log_header(
+            log_paths.at(0));
+    const std::string index_prefix = "root_height_index_";
+    std::vector<std::string> index_keys;
+    std::vector<std::string> labels;
+    for (auto const & k: keys) { 
+        if (string_util::startswith(k, index_prefix)) {
+            index_keys.push_back(k);
+            labels.push_back(k.substr(index_prefix.size()));
+        }
+    }
+    unsigned int number_of_comparisons = index_keys.size();
+    if (number_of_comparisons < 1) {
         throw EcoevolityError(
-                "No samples were parsed from the log files. "
-                "Perhaps you specified a burn in value larger than the number "
-                "of samples in each log file?"
-                );
+                "No event-index columns found in the log files");
     }
 
-    std::cerr << "Parsed " << number_of_posterior_samples
-              << " total samples from "
-              << log_paths.size() << " log files.\n";
+    std::vector<unsigned int> burnins(log_paths.size(), burnin);
+    if (auto_burnin || writing_burnin_advice) {
+        std::cerr << "Assessing burn in...\n";
+        std::vector<std::string> burnin_keys;
+        for (auto const & k : {"ln_likelihood", "ln_prior", "number_of_events"}) {
+            if (std::find(keys.begin(), keys.end(), k) != keys.end()) {
+                burnin_keys.push_back(k);
+            }
+        }
+        for (auto const & l : labels) {
+            if (std::find(keys.begin(), keys.end(), "root_height_" + l) != keys.end()) {
+                burnin_keys.push_back("root_height_" + l);
+            }
+        }
+        std::vector<BurninAdvice> advice = get_burnin_advice_for_chains<double>(
+                log_paths.size(),
+                [&](unsigned int path_idx) {
+                    return get_state_log_burnin_samples(
+                            log_paths.at(path_idx),
+                            burnin_keys);
+                },
+                nthreads);
+        if (writing_burnin_advice) {
+            write_burnin_advice(std::cout, log_paths, advice);
+            return 0;
+        }
+        std::cerr << "Recommended burn in and thinning:\n";
+        write_burnin_advice(std::cerr, log_paths, advice);
+        for (unsigned int i = 0; i < advice.size(); ++i) {
+            burnins.at(i) = advice.at(i).burnin;
+        }
+    }
 
-    std::vector<std::string> keys = posterior_sample.get_keys();
+    std::cerr << "Parsing log files...\n";
+    // The logs are streamed and only the event-index columns are parsed;
+    // each sample is tallied as it is read
 
     // Vet user specified comparison labels
+    std::vector<unsigned int> comparison_indices;
     if (user_specified_comparisons) {
         for (unsigned int i = 0; i < comparison_labels.size(); ++i) {
-            if (! posterior_sample.has_key("root_height_index_" + comparison_labels.at(i))) {
+            auto l = std::find(labels.begin(), labels.end(), comparison_labels.at(i));
+            if (l == labels.end()) {
                 std::ostringstream message;
                 message << "ERROR: comparison label \'"
                         << comparison_labels.at(i)
                         << "\' not found in log files.\n";
                 throw EcoevolityError(message.str());
             }
+            comparison_indices.push_back(l - labels.begin());
         }
+        // Keep comparisons in log order
+        std::sort(comparison_indices.begin(), comparison_indices.end());
     }
 
-    std::vector<std::vector<unsigned int> > indices;
-    std::vector<unsigned int> comparison_indices;
-    unsigned int comparison_index = 0;
-    for (auto const & k: keys) { 
-        if (string_util::startswith(k, "root_height_index_")) {
-            indices.push_back(posterior_sample.get<unsigned int>(k));
-            if (user_specified_comparisons) {
-                for (auto const & l: comparison_labels) {
-                    if (k == ("root_height_index_" + l)) {
-                        comparison_indices.push_back(comparison_index);
-                    }
-                }
+    auto comparisons_are_shared = [&](const std::vector<unsigned int> & model) {
+        unsigned int ref_index = model.at(comparison_indices.at(0));
+        for (unsigned int comp_idx = 1; comp_idx < comparison_indices.size(); ++comp_idx) {
+            if (model.at(comparison_indices.at(comp_idx)) != ref_index) {
+                return false;
             }
-            ++comparison_index;
         }
-    }
-    unsigned int number_of_comparisons = indices.size();
-
+        return true;
+    };
 
-    std::map<unsigned int, unsigned int> nevents_counts;
-    std::map<unsigned int, unsigned int> prior_nevents_counts;
-    for (unsigned int i = 1; i <= number_of_comparisons; ++i) {
-        nevents_counts[i] = 0;
-        prior_nevents_counts[i] = 0;
-    }
     unsigned int comparisons_shared_count = 0;
     unsigned int prior_comparisons_shared_count = 0;
-
-    std::map<std::vector<unsigned int>, unsigned int> model_counts;
-    std::map<std::vector<unsigned int>, unsigned int> prior_model_counts;
-
-    for (unsigned int i = 0; i < nevents.size(); ++i) {
-        std::vector<unsigned int> model;
-        model.reserve(number_of_comparisons);
-        for (unsigned int j = 0; j < number_of_comparisons; ++j) {
-            model.push_back(indices.at(j).at(i));
-        }
-        if (model_counts.count(model) < 1) {
-            model_counts[model] = 1;
-            prior_model_counts[model] = 0;
-        }
-        else {
-            ++model_counts[model];
-        }
-        ++nevents_counts[nevents.at(i)];
-        if (user_specified_comparisons) {
-            unsigned int ref_index = model.at(comparison_indices.at(0));
-            bool comps_shared = true;
-            for (unsigned int comp_idx = 1; comp_idx < comparison_indices.size(); ++comp_idx) {
-                if (model.at(comparison_indices.at(comp_idx)) != ref_index) {
-                    comps_shared = false;
-                    break;
+    partitionsum::PartitionSummarizer posterior_summary(number_of_comparisons);
+    partitionsum::PartitionSummarizer prior_summary(number_of_comparisons);
+
+    partitionsum::stream_state_log_columns(log_paths, index_keys, burnins,
+            [&](const std::vector<unsigned int> & model) {
+                posterior_summary.add_sample(model);
+                if (user_specified_comparisons && comparisons_are_shared(model)) {
+                    ++comparisons_shared_count;
                 }
-            }
-            if (comps_shared) {
-                ++comparisons_shared_count;
-            }
-        }
+            });
+
+    unsigned int number_of_posterior_samples = posterior_summary.get_number_of_samples();
+    if (number_of_posterior_samples < 1) {
+        throw EcoevolityError(
+                "No samples were parsed from the log files. "
+                "Perhaps you specified a burn in value larger than the number "
+                "of samples in each log file?"
+                );
     }
+
+    std::cerr << "Parsed " << number_of_posterior_samples
+              << " total samples from "
+              << log_paths.size() << " log files.\n";
+
     unsigned int tally = 0;
-    for (auto const & kv: nevents_counts) {
-        tally += kv.second;
-    }
-    ECOEVOLITY_ASSERT(tally == number_of_posterior_samples);
-    tally = 0;
-    for (auto const & kv: model_counts) {
+    for (auto const & kv: posterior_summary.get_number_of_subsets_counts()) {
         tally += kv.second;
     }
     ECOEVOLITY_ASSERT(tally == number_of_posterior_samples);
 
     // Sort descending by counts
     std::vector< std::pair<unsigned int, unsigned int> > nevents_count_pairs;
-    for (auto const & kv: nevents_counts) {
+    for (auto const & kv: posterior_summary.get_number_of_subsets_counts()) {
         nevents_count_pairs.push_back(kv);
     }
     sort_pairs(nevents_count_pairs, false, true);
-    std::vector< std::pair<std::vector<unsigned int>, unsigned int> > model_count_pairs;
-    for (auto const & kv: model_counts) {
-        model_count_pairs.push_back(kv);
+    std::vector< std::pair<std::vector<unsigned int>, unsigned int> > model_count_pairs =
+            posterior_summary.get_partition_counts();
+    tally = 0;
+    for (auto const & kv: model_count_pairs) {
+        tally += kv.second;
     }
+    ECOEVOLITY_ASSERT(tally == number_of_posterior_samples);
     sort_pairs(model_count_pairs, false, true);
 
     // Run simulations
@@ -429,37 +512,13 @@ int sumcoevolity_main(int argc, char * argv[]) {
                         << "\'\n";
                 throw EcoevolityError(message.str());
             }
-            ++prior_nevents_counts[number_of_categories];
-            if (prior_model_counts.count(model) < 1) {
-                prior_model_counts[model] = 1;
-            }
-            else {
-                ++prior_model_counts[model];
-            }
-            if (user_specified_comparisons) {
-                unsigned int ref_index = model.at(comparison_indices.at(0));
-                bool comps_shared = true;
-                for (unsigned int comp_idx = 1; comp_idx < comparison_indices.size(); ++comp_idx) {
-                    if (model.at(comparison_indices.at(comp_idx)) != ref_index) {
-                        comps_shared = false;
-                        break;
-                    }
-                }
-                if (comps_shared) {
-                    ++prior_comparisons_shared_count;
-                }
+            unsigned int number_of_subsets = prior_summary.add_sample(model);
+            ECOEVOLITY_ASSERT(number_of_subsets == number_of_categories);
+            if (user_specified_comparisons && comparisons_are_shared(model)) {
+                ++prior_comparisons_shared_count;
             }
         }
-        tally = 0;
-        for (auto const & kv: prior_nevents_counts) {
-            tally += kv.second;
-        }
-        ECOEVOLITY_ASSERT(tally == nreps);
-        tally = 0;
-        for (auto const & kv: prior_model_counts) {
-            tally += kv.second;
-        }
-        ECOEVOLITY_ASSERT(tally == nreps);
+        ECOEVOLITY_ASSERT(prior_summary.get_number_of_samples() == nreps);
     }
 
     double min_prior_prob = 1.0 / (double)nreps;
@@ -575,13 +634,14 @@ int sumcoevolity_main(int argc, char * argv[]) {
             }
             nevents_stream << cumulative_post_prob << "\t";
             if (running_sims) {
-                double prior_prob = prior_nevents_counts[nc.first] / (double)nreps;
-                if (prior_nevents_counts[nc.first] < 1) {
+                unsigned int prior_count = prior_summary.get_number_of_subsets_count(nc.first);
+                double prior_prob = prior_count / (double)nreps;
+                if (prior_count < 1) {
                     prior_prob = min_prior_prob;
                     nevents_stream << "<" << prior_prob << "\t";
                     min_prior = true;
                 }
-                else if (prior_nevents_counts[nc.first] == nreps) {
+                else if (prior_count == nreps) {
                     prior_prob = max_prior_prob;
                     nevents_stream << ">" << prior_prob << "\t";
                     max_prior = true;
@@ -668,13 +728,14 @@ int sumcoevolity_main(int argc, char * argv[]) {
             }
             model_stream << cumulative_post_prob << "\t";
             if (running_sims) {
-                double prior_prob = prior_model_counts[mc.first] / (double)nreps;
-                if (prior_model_counts[mc.first] < 1) {
+                unsigned int prior_count = prior_summary.get_count(mc.first);
+                double prior_prob = prior_count / (double)nreps;
+                if (prior_count < 1) {
                     prior_prob = min_prior_prob;
                     model_stream << "<" << prior_prob << "\t";
                     min_prior = true;
                 }
-                else if (prior_model_counts[mc.first] == nreps) {
+                else if (prior_count == nreps) {
                     prior_prob = max_prior_prob;
                     model_stream << ">" << prior_prob << "\t";
                     max_prior = true;
@@ -712,6 +773,33 @@ int sumcoevolity_main(int argc, char * argv[]) {
     }
     std::cerr << "Summary written to \'" << model_path << "\'\n";
 
+
+    // output pairwise co-divergence probabilities
+    std::string pairwise_path = prefix + "sumcoevolity-results-pairwise.txt";
+    if (prevent_overwrite) {
+        check_sumcoevolity_output_path(pairwise_path);
+    }
+
+    std::cerr << "Writing posterior probabilities of pairs of comparisons sharing events...\n";
+    std::ofstream pairwise_stream;
+    pairwise_stream.open(pairwise_path);
+    if (! pairwise_stream.is_open()) {
+        std::ostringstream message;
+        message << "ERROR: Could not output file \'"
+                << pairwise_path
+                << "\'\n";
+        throw EcoevolityError(message.str());
+    }
+    try {
+        posterior_summary.write_pair_probabilities(pairwise_stream, labels);
+        pairwise_stream.close();
+    }
+    catch (...) {
+        pairwise_stream.close();
+        throw;
+    }
+    std::cerr << "Summary written to \'" << pairwise_path << "\'\n";
+
     time(&finish);
     double duration = difftime(finish, start);
     std::cerr << "Runtime: " << duration << " seconds." << std::endl;
@@ -30,12 +30,179 @@
 #include "path.hpp"
 #include "node.hpp"
 #include "treesum.hpp"
+#include "treecomp.hpp"
+#include "newick.hpp"
+#include "binlog.hpp"
+#include "compressed_stream.hpp"
 
 
 void write_sum_phy_splash(std::ostream& out);
 
 void check_sumphy_output_path(const std::string& path);
 
+/**
+ * Return the tree lengths, root heights and root population sizes of all of
+ * the trees in a tree log. The splits of the trees are not tallied, so this
+ * is a quick pass over the log for assessing burn in.
+ */
+template <class NodeType>
+std::vector< std::vector<double> > get_tree_log_burnin_samples(
+        const std::string & log_path,
+        const double ultrametricity_tolerance,
+        const double multiplier) {
+    std::vector< std::vector<double> > samples(3);
+    std::map<std::string, double> root_parameters;
+    auto add_tree = [&](const BaseTree<NodeType> & tree) {
+        samples.at(0).push_back(tree.get_tree_length());
+        samples.at(1).push_back(tree.get_root_height());
+        root_parameters.clear();
+        tree.get_root().get_parameter_map(root_parameters);
+        auto pop_size = root_parameters.find("pop_size");
+        if (pop_size != root_parameters.end()) {
+            samples.at(2).push_back(pop_size->second);
+        }
+    };
+    if (binlog::is_binary_tree_log(log_path)) {
+        binlog::TreeLogReader<NodeType> reader(log_path);
+        for (unsigned int i = 0; i < reader.get_number_of_trees(); ++i) {
+            add_tree(reader.get_tree(i, multiplier));
+        }
+    }
+    else {
+        InputFileStream in_stream;
+        in_stream.open(log_path);
+        if (! in_stream.is_open()) {
+            throw EcoevolityParsingError(
+                    "Could not open tree file",
+                    log_path);
+        }
+        newick::NexusTreeReader reader(in_stream, log_path);
+        newick::ParsedTree parsed_tree;
+        while (reader.next_tree(parsed_tree)) {
+            add_tree(BaseTree<NodeType>(parsed_tree,
+                    ultrametricity_tolerance,
+                    multiplier));
+        }
+    }
+    if (samples.at(2).size() != samples.at(0).size()) {
+        ECOEVOLITY_ASSERT(samples.at(2).empty());
+        samples.pop_back();
+    }
+    return samples;
+}
+
+/**
+ * Read every 'thin'-th tree after burn in from each log file into the
+ * distance calculator, recording the source and tree index of each tree.
+ */
+template <class NodeType>
+void add_trees_to_distance_calculator(
+        treecomp::DistanceMatrixCalculator & calculator,
+        std::vector< std::pair<unsigned int, unsigned int> > & tree_sources,
+        const std::vector<std::string> & log_paths,
+        const std::vector<unsigned int> & burnins,
+        const unsigned int thin,
+        const double ultrametricity_tolerance,
+        const double multiplier) {
+    ECOEVOLITY_ASSERT(thin > 0);
+    ECOEVOLITY_ASSERT(burnins.size() == log_paths.size());
+    for (unsigned int source_idx = 0; source_idx < log_paths.size(); ++source_idx) {
+        const std::string & log_path = log_paths.at(source_idx);
+        const unsigned int burnin = burnins.at(source_idx);
+        if (binlog::is_binary_tree_log(log_path)) {
+            binlog::TreeLogReader<NodeType> reader(log_path);
+            for (unsigned int i = burnin; i < reader.get_number_of_trees(); i += thin) {
+                BaseTree<NodeType> tree = reader.get_tree(i, multiplier);
+                calculator.add_tree(tree);
+                tree_sources.push_back(std::make_pair(source_idx, i));
+            }
+            continue;
+        }
+        InputFileStream in_stream;
+        in_stream.open(log_path);
+        if (! in_stream.is_open()) {
+            throw EcoevolityParsingError(
+                    "Could not open tree file",
+                    log_path);
+        }
+        newick::NexusTreeReader reader(in_stream, log_path);
+        newick::ParsedTree parsed_tree;
+        unsigned int tree_idx = 0;
+        while (tree_idx < burnin) {
+            if (! reader.skip_tree()) {
+                break;
+            }
+            ++tree_idx;
+        }
+        while (reader.next_tree(parsed_tree)) {
+            if (((tree_idx - burnin) % thin) == 0) {
+                BaseTree<NodeType> tree(parsed_tree,
+                        ultrametricity_tolerance,
+                        multiplier);
+                calculator.add_tree(tree);
+                tree_sources.push_back(std::make_pair(source_idx, tree_idx));
+            }
+            ++tree_idx;
+        }
+    }
+}
+
+/**
+ * Write a tab-delimited table of the Robinson-Foulds and Euclidean
+ * distances between all pairs of trees, and a YAML-formatted summary of
+ * the mean distances within and between sources (chains). The distances
+ * are written as they are calculated, rather than stored.
+ */
+inline void write_tree_distances(
+        std::ostream & table_out,
+        std::ostream & summary_out,
+        const treecomp::DistanceMatrixCalculator & distance_calculator,
+        const std::vector< std::pair<unsigned int, unsigned int> > & tree_sources,
+        const unsigned int nthreads = 1,
+        const unsigned int precision = 18) {
+    ECOEVOLITY_ASSERT(distance_calculator.get_number_of_trees() == tree_sources.size());
+    SampleSummarizer<double> within_rf;
+    SampleSummarizer<double> within_euclidean;
+    SampleSummarizer<double> between_rf;
+    SampleSummarizer<double> between_euclidean;
+    table_out.precision(precision);
+    table_out << "source_1\ttree_1\tsource_2\ttree_2\trobinson_foulds\teuclidean\n";
+    distance_calculator.for_each_pair(
+            [&](unsigned int i, unsigned int j, double rf, double euclidean) {
+                table_out << tree_sources.at(i).first << "\t"
+                          << tree_sources.at(i).second << "\t"
+                          << tree_sources.at(j).first << "\t"
+                          << tree_sources.at(j).second << "\t"
+                          << rf << "\t"
+                          << euclidean << "\n";
+                if (tree_sources.at(i).first == tree_sources.at(j).first) {
+                    within_rf.add_sample(rf);
+                    within_euclidean.add_sample(euclidean);
+                }
+                else {
+                    between_rf.add_sample(rf);
+                    between_euclidean.add_sample(euclidean);
+                }
+            },
+            nthreads);
+    std::string indent = string_util::get_indent(1);
+    auto write_means = [&](const std::string & label,
+            const SampleSummarizer<double> & rf,
+            const SampleSummarizer<double> & euclidean) {
+        summary_out << indent << label << ":\n"
+                    << indent << indent << "number_of_pairs: " << rf.sample_size() << "\n";
+        if (rf.sample_size() > 0) {
+            summary_out << indent << indent << "mean_robinson_foulds: " << rf.mean() << "\n"
+                        << indent << indent << "mean_euclidean: " << euclidean.mean() << "\n";
+        }
+    };
+    summary_out.precision(precision);
+    summary_out << "summary_of_tree_distances:\n"
+                << indent << "number_of_trees: " << tree_sources.size() << "\n";
+    write_means("within_sources", within_rf, within_euclidean);
+    write_means("between_sources", between_rf, between_euclidean);
+}
+
 template <class NodeType>
 int sumphycoeval_main(int argc, char * argv[]) {
 
@@ -125,6 +292,21 @@ int sumphycoeval_main(int argc, char * argv[]) {
                   "Tree summaries are not reported. "
                   "Default: 0 (summarize trees; do not create convergence "
                   "table).");
+    parser.add_option("--auto-burnin")
+            .action("store_true")
+            .dest("auto_burnin")
+            .help("Detect the burn in of each tree log file from the tree "
+                  "lengths, root heights, and root population sizes of the "
+                  "sampled trees, and ignore these samples. The recommended "
+                  "burn in and thinning for each file are reported. This "
+                  "cannot be used with '--burnin'.");
+    parser.add_option("--burnin-advice")
+            .action("store_true")
+            .dest("burnin_advice")
+            .help("This tells sumphycoeval to ignore all other settings and "
+                  "write a table of the recommended burn in and thinning for "
+                  "each tree log file (see '--auto-burnin'). "
+                  "Tree summaries are not reported.");
     parser.add_option("--include-merged-target-heights")
             .action("store_true")
             .dest("include_merged_target_heights")
@@ -134,6 +316,31 @@ int sumphycoeval_main(int argc, char * argv[]) {
             .action("store_true")
             .dest("force")
             .help("Force overwriting of existing output files.");
+    parser.add_option("--distance-out")
+            .action("store")
+            .dest("distance_out_path")
+            .set_default("")
+            .help("Path to a file where a tab-delimited table of the "
+                  "Robinson-Foulds and Euclidean distances between all pairs "
+                  "of sampled trees (after burn in) will be written. The mean "
+                  "distances within and between tree log files are added to "
+                  "the summary. Default: Do not calculate tree distances.");
+    parser.add_option("--distance-thin")
+            .action("store")
+            .type("unsigned int")
+            .dest("distance_thin")
+            .set_default("1")
+            .help("Only use every nth sampled tree when calculating tree "
+                  "distances. Default: 1 (use all sampled trees).");
+#ifdef BUILD_WITH_THREADS
+    parser.add_option("--nthreads")
+            .action("store")
+            .type("unsigned int")
+            .dest("nthreads")
+            .set_default("1")
+            .help("Number of threads to use for parsing trees. "
+                  "Default: 1 (no multithreading).");
+#endif
 
     optparse::Values& options = parser.parse_args(argc, argv);
     std::vector<std::string> log_paths = parser.args();
@@ -161,11 +368,24 @@ int sumphycoeval_main(int argc, char * argv[]) {
     time_t finish;
     treesum::TreeSample<PopulationNode> tree_sample;
 
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = options.get("nthreads");
+#else
+    unsigned int nthreads = 1;
+#endif
+
     unsigned int burnin = options.get("burnin");
     const double min_split_freq = options.get("min_split_freq");
     if ((min_split_freq < 0.0) || (min_split_freq >=1.0)) {
         throw EcoevolityError("\'--min-split-freq\' must be between 0 and 1\n");
     }
+    const bool auto_burnin = options.get("auto_burnin");
+    const bool writing_burnin_advice = options.get("burnin_advice");
+    if ((auto_burnin || writing_burnin_advice) &&
+            options.is_set_by_user("burnin")) {
+        throw EcoevolityError("\'--burnin\' cannot be used with "
+                "\'--auto-burnin\' or \'--burnin-advice\'");
+    }
     const int conv_sum_interval = options.get("convergence_sum_interval");
     if (conv_sum_interval > 0) {
         std::cerr << "Writing tab-delimited table of convergence statistics..."
@@ -178,7 +398,9 @@ int sumphycoeval_main(int argc, char * argv[]) {
                 log_paths,
                 "nexus",
                 burnin,
-                ultrametricity_tolerance);
+                ultrametricity_tolerance,
+                -1.0,
+                nthreads);
 
         unsigned int min_sample_size = tree_sample.get_source_sample_size(0);
         for (unsigned int source_idx = 1;
@@ -192,6 +414,17 @@ int sumphycoeval_main(int argc, char * argv[]) {
         bool use_inter_chain_stats = ((tree_sample.get_number_of_sources() > 1)
                 && tree_sample.equal_source_sample_sizes());
 
+        // The statistics for every burn-in value are calculated from this
+        // one sample of trees, rather than re-reading the trees for each
+        const unsigned int skipped = burnin;
+        std::vector< std::vector<double> > tree_lens = tree_sample.get_tree_lengths_by_source();
+        std::vector< std::vector<double> > root_heights = tree_sample.get_root_parameter_values_by_source("height");
+        std::vector< std::vector<double> > root_sizes = tree_sample.get_root_parameter_values_by_source("pop_size");
+        BurninSampleSums<double> tree_len_sums(tree_lens);
+        BurninSampleSums<double> root_height_sums(root_heights);
+        BurninSampleSums<double> root_size_sums(root_sizes);
+        treesum::BurninSplitFrequencies split_freqs(tree_sample);
+
         std::cout << "burnin\tsample_size";
         if (use_inter_chain_stats) {
             std::cout << "\tasdsf\tpsrf_tree_length\tpsrf_root_height\tpsrf_root_pop_size";
@@ -199,59 +432,44 @@ int sumphycoeval_main(int argc, char * argv[]) {
         std::cout << "\tess_tree_length\tess_root_height\tess_root_pop_size\n";
 
         while (true) {
-            ECOEVOLITY_ASSERT(burnin == tree_sample.get_source_burnin(0));
+            const unsigned int b = burnin - skipped;
             std::cout << burnin
-                      << "\t" << tree_sample.get_sample_size();
+                      << "\t" << tree_len_sums.get_sample_size(b);
             if (use_inter_chain_stats) {
-                double asdsf = tree_sample.get_average_std_dev_of_split_freqs(min_split_freq);
-
-                std::vector< std::vector<double> > tree_lens = tree_sample.get_tree_lengths_by_source();
-                double psrf_tree_len = potential_scale_reduction_factor<double>(tree_lens);
-                double ess_tree_len = effective_sample_size<double>(tree_lens, true);
-
-                std::vector< std::vector<double> > root_sizes = tree_sample.get_root_parameter_values_by_source("pop_size");
-                double psrf_root_pop_size = potential_scale_reduction_factor<double>(root_sizes);
-                double ess_root_pop_size = effective_sample_size<double>(root_sizes, true);
-
-                std::vector< std::vector<double> > root_heights = tree_sample.get_root_parameter_values_by_source("height");
-                double psrf_root_height = potential_scale_reduction_factor<double>(root_heights);
-                double ess_root_height = effective_sample_size<double>(root_heights, true);
-
+                double asdsf = split_freqs.get_average_std_dev_of_split_freqs(
+                        min_split_freq, burnin);
                 std::cout << "\t" << asdsf
-                          << "\t" << psrf_tree_len
-                          << "\t" << psrf_root_height
-                          << "\t" << psrf_root_pop_size
-                          << "\t" << ess_tree_len
-                          << "\t" << ess_root_height
-                          << "\t" << ess_root_pop_size
-                          << "\n";
-            }
-            else {
-                std::vector<double> tree_lens = tree_sample.get_tree_lengths();
-                double ess_tree_len = effective_sample_size<double>(tree_lens, true);
-
-                std::vector<double> root_sizes = tree_sample.get_root_parameter_values("pop_size");
-                double ess_root_pop_size = effective_sample_size<double>(root_sizes, true);
-
-                std::vector<double> root_heights = tree_sample.get_root_parameter_values("height");
-                double ess_root_height = effective_sample_size<double>(root_heights, true);
-
-                std::cout << "\t" << ess_tree_len
-                          << "\t" << ess_root_height
-                          << "\t" << ess_root_pop_size
-                          << "\n";
+                          << "\t" << tree_len_sums.potential_scale_reduction_factor(b)
+                          << "\t" << root_height_sums.potential_scale_reduction_factor(b)
+                          << "\t" << root_size_sums.potential_scale_reduction_factor(b);
             }
+            std::cout << "\t" << tree_len_sums.effective_sample_size(b, true)
+                      << "\t" << root_height_sums.effective_sample_size(b, true)
+                      << "\t" << root_size_sums.effective_sample_size(b, true)
+                      << "\n";
             burnin += conv_sum_interval;
             if ((burnin + 1) >= min_sample_size) {
                 break;
             }
-            tree_sample = treesum::TreeSample<PopulationNode>(
-                    log_paths,
-                    "nexus",
-                    burnin,
-                    ultrametricity_tolerance);
         }
 
+        // Burn-in advice from the same samples
+        std::vector<BurninAdvice> advice = get_burnin_advice_for_chains<double>(
+                tree_sample.get_number_of_sources(),
+                [&](unsigned int source_idx) {
+                    return std::vector< std::vector<double> >({
+                            tree_lens.at(source_idx),
+                            root_heights.at(source_idx),
+                            root_sizes.at(source_idx)});
+                },
+                nthreads);
+        for (auto & a : advice) {
+            a.number_of_samples += skipped;
+            a.burnin += skipped;
+        }
+        std::cerr << "Recommended burn in and thinning:\n";
+        write_burnin_advice(std::cerr, log_paths, advice);
+
         time(&finish);
         double duration = difftime(finish, start);
         std::cerr << "Runtime: " << duration << " seconds." << std::endl;
@@ -259,6 +477,30 @@ int sumphycoeval_main(int argc, char * argv[]) {
         return 0;
     }
 
+    const double multiplier = options.get("multiplier");
+    std::vector<unsigned int> burnins(log_paths.size(), burnin);
+    if (auto_burnin || writing_burnin_advice) {
+        std::cerr << "Assessing burn in..." << std::endl;
+        std::vector<BurninAdvice> advice = get_burnin_advice_for_chains<double>(
+                log_paths.size(),
+                [&](unsigned int source_idx) {
+                    return get_tree_log_burnin_samples<NodeType>(
+                            log_paths.at(source_idx),
+                            ultrametricity_tolerance,
+                            multiplier);
+                },
+                nthreads);
+        if (writing_burnin_advice) {
+            write_burnin_advice(std::cout, log_paths, advice);
+            return 0;
+        }
+        std::cerr << "Recommended burn in and thinning:\n";
+        write_burnin_advice(std::cerr, log_paths, advice);
+        for (unsigned int i = 0; i < advice.size(); ++i) {
+            burnins.at(i) = advice.at(i).burnin;
+        }
+    }
+
     // Parse options
     const bool prevent_overwrite = (! options.get("force"));
 
@@ -309,13 +551,29 @@ int sumphycoeval_main(int argc, char * argv[]) {
         }
     }
 
+    std::string distance_out_path;
+    bool writing_distances = false;
+    if (options.is_set_by_user("distance_out_path")) {
+        distance_out_path = options.get("distance_out_path").get_str();
+        writing_distances = true;
+        if (prevent_overwrite && path::exists(distance_out_path)) {
+            throw EcoevolityError("Distance output path \'" +
+                    distance_out_path +
+                    "\' already exists. Please specify a different path or use "
+                    "the \'--force\' option to overwrite the file.");
+        }
+    }
+    const unsigned int distance_thin = options.get("distance_thin");
+    if (distance_thin < 1) {
+        throw EcoevolityError("\'--distance-thin\' must be a positive integer");
+    }
+
     std::string target_tree_format = "nexus";
     if (options.get("newick_target_tree")) {
         target_tree_format = "relaxedphyliptree";
     }
 
     const bool use_median_heights = options.get("use_median_heights");
-    const double multiplier = options.get("multiplier");
     const bool include_merged_target_heights = (
             options.get("include_merged_target_heights") && target_tree_provided);
 
@@ -346,21 +604,14 @@ int sumphycoeval_main(int argc, char * argv[]) {
     time(&start);
 
     std::cerr << "Parsing trees from files..." << std::endl;
+    tree_sample.set_number_of_threads(nthreads);
     if (target_tree_provided) {
-        tree_sample = treesum::TreeSample<PopulationNode>(
-                target_tree_path,
-                log_paths,
-                target_tree_format,
-                "nexus",
-                burnin,
-                ultrametricity_tolerance,
-                multiplier);
+        tree_sample.set_target_tree(target_tree_path, target_tree_format);
     }
-    else {
-        tree_sample = treesum::TreeSample<PopulationNode>(
-                log_paths,
+    for (unsigned int i = 0; i < log_paths.size(); ++i) {
+        tree_sample.add_trees(log_paths.at(i),
                 "nexus",
-                burnin,
+                burnins.at(i),
                 ultrametricity_tolerance,
                 multiplier);
     }
@@ -393,6 +644,38 @@ int sumphycoeval_main(int argc, char * argv[]) {
         tree_sample.write_summary_of_merged_target_heights(std::cout, "", precision);
     }
 
+    if (writing_distances) {
+        std::cerr << "Calculating distances between trees..." << std::endl;
+        treecomp::DistanceMatrixCalculator distance_calculator;
+        std::vector< std::pair<unsigned int, unsigned int> > tree_sources;
+        add_trees_to_distance_calculator<NodeType>(
+                distance_calculator,
+                tree_sources,
+                log_paths,
+                burnins,
+                distance_thin,
+                ultrametricity_tolerance,
+                multiplier);
+        std::ofstream distance_out_stream;
+        distance_out_stream.open(distance_out_path);
+        if (! distance_out_stream.is_open()) {
+            std::ostringstream message;
+            message << "ERROR: Could not open distance output file \'"
+                    << distance_out_path
+                    << "\'\n";
+            throw EcoevolityError(message.str());
+        }
+        std::cerr << "Writing tree distances to:\n"
+                  << "  " << distance_out_path << std::endl;
+        write_tree_distances(distance_out_stream,
+                std::cout,
+                distance_calculator,
+                tree_sources,
+                nthreads,
+                precision);
+        distance_out_stream.close();
+    }
+
     time(&finish);
     double duration = difftime(finish, start);
     std::cerr << "Runtime: " << duration << " seconds." << std::endl;
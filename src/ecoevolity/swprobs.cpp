@@ -66,9 +66,31 @@ int swprobs_main(int argc, char * argv[]) {
             .dest("number_of_samples")
             .set_default("100000")
             .help("Number of simulation samples. Default: 100000. "
-                  "Simulations are only used if a prior distribution on the "
-                  "split weight is specified (i.e., using "
-                  "\'--shape\'/\'--scale\' options.");
+                  "Simulations are only used if the \'--monte-carlo\' option "
+                  "is used.");
+    parser.add_option("--integration-points")
+            .action("store")
+            .type("unsigned int")
+            .dest("integration_points")
+            .set_default("1000")
+            .help("Number of equal-probability bins of the gamma prior on "
+                  "the split weight used to integrate over it. "
+                  "Default: 1000.");
+    parser.add_option("--monte-carlo")
+            .action("store_true")
+            .dest("monte_carlo")
+            .help("Approximate the probabilities by averaging over split "
+                  "weights drawn from the gamma prior, rather than "
+                  "integrating over the prior numerically.");
+#ifdef BUILD_WITH_THREADS
+    parser.add_option("--nthreads")
+            .action("store")
+            .type("unsigned int")
+            .dest("nthreads")
+            .set_default("1")
+            .help("Number of threads to use for calculations or "
+                  "simulations. Default: 1 (no multithreading).");
+#endif
     parser.add_option("--shape")
             .action("store")
             .type("double")
@@ -80,11 +102,10 @@ int swprobs_main(int argc, char * argv[]) {
                   "corresponding scale parameter for the gamma distribution "
                   "such that the mean of the gamma prior is equal to the "
                   "specified value of the split-weight parameter. Also, "
-                  "simulations will be performed to approximate the prior "
-                  "probabilities for numbers of events. If not provided, the "
+                  "the prior probabilities for numbers of events will be "
+                  "integrated over the gamma prior. If not provided, the "
                   "split-weight parameter is simply fixed to the specifed "
-                  "value, and the prior probabilities are calculated "
-                  "exactly.");
+                  "value.");
     parser.add_option("--scale")
             .action("store")
             .type("double")
@@ -149,6 +170,20 @@ int swprobs_main(int argc, char * argv[]) {
                 "Number of samples must be 1 or greater");
     }
 
+    unsigned int npoints = options.get("integration_points");
+    if (npoints < 1) {
+        throw EcoevolityError(
+                "Number of integration points must be 1 or greater");
+    }
+
+    bool use_simulations = options.get("monte_carlo");
+
+#ifdef BUILD_WITH_THREADS
+    unsigned int nthreads = options.get("nthreads");
+#else
+    unsigned int nthreads = 1;
+#endif
+
     bool split_weight_is_fixed = true; 
     if (options.is_set_by_user("shape")) {
         split_weight_is_fixed = false; 
@@ -181,8 +216,13 @@ int swprobs_main(int argc, char * argv[]) {
     else {
         std::cerr << "Split weight ~ "
                   << gamma_split_weight.to_string() << std::endl;
-        std::cerr << "Seed = " << seed << std::endl;
-        std::cerr << "Number of samples = " << nreps << std::endl;
+        if (use_simulations) {
+            std::cerr << "Seed = " << seed << std::endl;
+            std::cerr << "Number of samples = " << nreps << std::endl;
+        }
+        else {
+            std::cerr << "Number of integration points = " << npoints << std::endl;
+        }
     }
     std::string number_of_elements_str = std::to_string(number_of_elements);
     unsigned int ncats_padding = number_of_elements_str.size();
@@ -192,68 +232,59 @@ int swprobs_main(int argc, char * argv[]) {
     time_t finish;
     time(&start);
 
-    std::vector<long double> number_of_cat_probs(number_of_elements, 0.0);
+    std::vector<long double> number_of_cat_probs;
     if (split_weight_is_fixed) {
-        get_number_of_subset_probs(number_of_cat_probs, split_weight);
-        std::vector<double> number_of_cats(number_of_elements, 0.0);
-        for (unsigned int i = 0; i < number_of_elements; ++i) {
-            number_of_cats.at(i) = i + 1.0;
-        }
-        double sample_mean_ncats = weighted_mean<double>(number_of_cats, number_of_cat_probs);
-        std::cerr << "Mean number of categories = " << sample_mean_ncats << std::endl;
-
+        number_of_cat_probs = partition_probs::get_split_weight_number_of_subset_probs(
+                number_of_elements,
+                split_weight);
     }
-    // else {
-    //     unsigned int total = 0;
-    //     std::vector<unsigned int> number_of_categories_counts(number_of_elements, 0);
-    //     unsigned int number_of_categories;
-    //     for (unsigned int i = 0; i < nreps; ++i) {
-    //         split_weight = rng.gamma(shape, scale);
-    //         number_of_categories = rng.random_number_of_subsets(number_of_elements, split_weight);
-    //         ++number_of_categories_counts.at(number_of_categories - 1);
-    //         total += number_of_categories;
-    //     }
-    //     double sample_mean_ncats = (double)total / (double)nreps;
-    //     std::cerr << "Sample mean number of categories = " << sample_mean_ncats << std::endl;
-    //     unsigned int tally = 0;
-    //     double double_nreps = (double)nreps;
-    //     for (unsigned int i = 0; i < number_of_elements; ++i) {
-    //         tally += number_of_categories_counts.at(i);
-    //         number_of_cat_probs.at(i) = number_of_categories_counts.at(i) / double_nreps; 
-    //     }
-    //     ECOEVOLITY_ASSERT(tally == nreps);
-    // }
-    //
     // It is much more efficient to only simulate split_weight and then average
-    // the probabilities of the number of subsets (below) than it is to
-    // simulate both split_weight and the number of subsets and then summarize
-    // counts of the latter (commented out above).
-    else {
-        std::vector<long double> number_of_cat_probs_sum(number_of_elements, 0.0);
-        for (unsigned int i = 0; i < nreps; ++i) {
-            split_weight = rng.gamma(shape, scale);
-            get_number_of_subset_probs(number_of_cat_probs, split_weight);
+    // the probabilities of the number of subsets than it is to simulate both
+    // split_weight and the number of subsets and then summarize counts of the
+    // latter.
+    else if (use_simulations) {
+        auto simulate = [number_of_elements, shape, scale](
+                RandomNumberGenerator & r,
+                std::vector<long double> & prob_sums) {
+            std::vector<long double> probs = get_number_of_subset_probs(
+                    number_of_elements,
+                    r.gamma(shape, scale));
             for (unsigned int j = 0; j < number_of_elements; ++j) {
-                number_of_cat_probs_sum.at(j) += number_of_cat_probs.at(j);
+                prob_sums.at(j) += probs.at(j);
             }
-        }
+        };
+        number_of_cat_probs = partition_probs::simulate_sums(
+                rng,
+                number_of_elements,
+                nreps,
+                simulate,
+                nthreads);
         for (unsigned int j = 0; j < number_of_elements; ++j) {
-            number_of_cat_probs.at(j) = number_of_cat_probs_sum.at(j) / nreps;
-        }
-        std::vector<double> number_of_cats(number_of_elements, 0.0);
-        for (unsigned int i = 0; i < number_of_elements; ++i) {
-            number_of_cats.at(i) = i + 1.0;
+            number_of_cat_probs.at(j) /= nreps;
         }
-        double sample_mean_ncats = weighted_mean<double>(number_of_cats, number_of_cat_probs);
-        std::cerr << "Mean number of categories = " << sample_mean_ncats << std::endl;
     }
+    else {
+        number_of_cat_probs = partition_probs::get_split_weight_number_of_subset_probs(
+                number_of_elements,
+                split_weight,
+                shape,
+                scale,
+                npoints,
+                nthreads);
+    }
+    std::vector<double> number_of_cats(number_of_elements, 0.0);
+    for (unsigned int i = 0; i < number_of_elements; ++i) {
+        number_of_cats.at(i) = i + 1.0;
+    }
+    double sample_mean_ncats = weighted_mean<double>(number_of_cats, number_of_cat_probs);
+    std::cerr << "Mean number of categories = " << sample_mean_ncats << std::endl;
 
 
-    if (split_weight_is_fixed) {
-        std::cerr << "\nProbabilities of the number of categories:\n";
+    if (use_simulations && (! split_weight_is_fixed)) {
+        std::cerr << "\nApproximated probabilities of the number of categories:\n";
     }
     else {
-        std::cerr << "\nApproximated probabilities of the number of categories:\n";
+        std::cerr << "\nProbabilities of the number of categories:\n";
     }
     std::cerr << string_util::banner('-') << "\n";
     for (unsigned int i = 0; i < number_of_elements; ++i) {
@@ -32,6 +32,7 @@
 #include "probability.hpp"
 #include "string_util.hpp"
 #include "options.hpp"
+#include "partition_probs.hpp"
 
 
 void write_swprobs_splash(std::ostream& out);
@@ -158,6 +158,10 @@ void BasePopulationTree::establish_branch_and_mu_parameters(
     if (settings.population_size_settings.is_fixed()) {
         this->fix_population_sizes();
     }
+    if (settings.population_size_settings.population_sizes_are_integrated()) {
+        this->integrate_population_sizes(
+                settings.population_size_settings.get_number_of_categories());
+    }
     
     this->set_freq_1_prior(settings.freq_1_settings.get_prior_settings().get_instance());
     if (settings.constrain_state_frequencies()) {
@@ -199,27 +203,39 @@ void BasePopulationTree::draw_from_prior(RandomNumberGenerator& rng) {
     }
 }
 
-void BasePopulationTree::write_state_log_header(std::ostream& out,
-        const std::string& delimiter,
+void BasePopulationTree::get_state_log_row(StateLogRow & row,
+        const unsigned int generation_index,
         const bool short_summary) const {
-    out << "generation" << delimiter
-        << "ln_likelihood" << delimiter
-        << "ln_prior" << delimiter
-        << "alpha_of_height_beta_prior" << delimiter
-        << "beta_of_height_beta_prior" << delimiter
-        << "number_of_heights" << delimiter
-        << "root_height" << delimiter
-        << "mutation_rate" << delimiter
-        << "freq_1" << delimiter
-        << "pop_size_root";
+    row.clear();
+    row.add_integer("generation", generation_index);
+    row.add("ln_likelihood", this->log_likelihood_.get_value());
+    row.add("ln_prior", this->log_prior_density_.get_value());
+    row.add("alpha_of_height_beta_prior", this->get_alpha_of_node_height_beta_prior());
+    row.add("beta_of_height_beta_prior", this->get_beta_of_node_height_beta_prior());
+    row.add_integer("number_of_heights", this->get_number_of_node_heights());
+    row.add("root_height", this->get_root_height());
+    row.add("mutation_rate", this->get_mutation_rate());
+    row.add("freq_1", this->get_freq_1());
+    if (this->population_sizes_are_integrated()) {
+        // Population sizes are not parameters of the model
+        return;
+    }
+    row.add("pop_size_root", this->get_root_population_size());
     if (short_summary) {
-        out << std::endl;
         return;
     }
     // Only output leaf pop sizes
     for (auto label : this->data_.get_population_labels()) {
-        out << delimiter << "pop_size_" << label;
+        row.add("pop_size_" + label, this->get_node(label)->get_population_size());
     }
+}
+
+void BasePopulationTree::write_state_log_header(std::ostream& out,
+        const std::string& delimiter,
+        const bool short_summary) const {
+    StateLogRow row;
+    this->get_state_log_row(row, 0, short_summary);
+    row.write_names(out, delimiter);
     out << std::endl;
 }
 
@@ -227,27 +243,19 @@ void BasePopulationTree::log_state(std::ostream& out,
         const unsigned int generation_index,
         const std::string& delimiter,
         const bool short_summary) const {
-    out << generation_index << delimiter
-        << this->log_likelihood_.get_value() << delimiter
-        << this->log_prior_density_.get_value() << delimiter
-        << this->get_alpha_of_node_height_beta_prior() << delimiter
-        << this->get_beta_of_node_height_beta_prior() << delimiter
-        << this->get_number_of_node_heights() << delimiter
-        << this->get_root_height() << delimiter
-        << this->get_mutation_rate() << delimiter
-        << this->get_freq_1() << delimiter
-        << this->get_root_population_size();
-    if (short_summary) {
-        out << std::endl;
-        return;
-    }
-    // Only output leaf pop sizes
-    for (auto label : this->data_.get_population_labels()) {
-        out << delimiter << this->get_node(label)->get_population_size();
-    }
+    StateLogRow row;
+    this->get_state_log_row(row, generation_index, short_summary);
+    row.write_values(out, delimiter);
     out << std::endl;
 }
 
+void BasePopulationTree::get_state_log_values(std::vector<double> & values,
+        const unsigned int generation_index) const {
+    StateLogRow row;
+    this->get_state_log_row(row, generation_index);
+    values = row.get_values();
+}
+
 double BasePopulationTree::get_ln_prob_of_drawing_node_state(
                 std::shared_ptr<PopulationNode> node) const {
     if (this->population_sizes_are_constrained()) {
@@ -785,6 +793,7 @@ void BasePopulationTree::set_data(const BiallelicData & data, bool constant_site
 }
 
 void BasePopulationTree::update_unique_allele_counts() {
+    this->constant_pattern_cache_.clear();
     this->unique_allele_counts_.clear();
     this->unique_allele_count_weights_.clear();
     std::map<std::vector<unsigned int>, unsigned int> unique_allele_count_map = this->data_.get_unique_allele_counts();
@@ -792,6 +801,9 @@ void BasePopulationTree::update_unique_allele_counts() {
         this->unique_allele_counts_.push_back(kv.first);
         this->unique_allele_count_weights_.push_back(kv.second);
     }
+    this->pattern_order_.update(
+            this->data_.get_red_allele_count_matrix(),
+            this->data_.get_allele_count_matrix());
 }
 
 void BasePopulationTree::calculate_likelihood_correction() {
@@ -849,6 +861,9 @@ void BasePopulationTree::fold_patterns() {
         std::cerr << "WARNING: Site patterns are being folded when u/v rates are not constrained." << std::endl;
     }
     this->data_.fold_patterns();
+    this->pattern_order_.update(
+            this->data_.get_red_allele_count_matrix(),
+            this->data_.get_allele_count_matrix());
     this->make_dirty();
 }
 
@@ -1069,6 +1084,32 @@ void BasePopulationTree::set_population_size_prior(std::shared_ptr<ContinuousPro
     this->root_->set_all_population_size_priors(prior);
 }
 
+void BasePopulationTree::integrate_population_sizes(
+        unsigned int number_of_categories) {
+    std::shared_ptr<OffsetGammaDistribution> prior =
+            std::dynamic_pointer_cast<OffsetGammaDistribution>(
+                    this->population_size_prior_);
+    if ((! prior) || (prior->get_offset() != 0.0)) {
+        throw EcoevolityError(
+                "Population sizes can only be integrated over a gamma or "
+                "exponential prior without an offset; found prior: " +
+                this->population_size_prior_->to_string());
+    }
+    if (number_of_categories < 1) {
+        throw EcoevolityError(
+                "The number of population-size categories must be positive");
+    }
+    DiscretizedGamma relative_sizes(
+            prior->get_shape(),
+            1.0 / prior->get_shape(),
+            number_of_categories);
+    this->population_size_multipliers_ = relative_sizes.get_quantiles();
+    this->estimate_population_sizes();
+    this->set_all_population_sizes(prior->get_mean());
+    this->fix_population_sizes();
+    this->make_dirty();
+}
+
 void BasePopulationTree::set_freq_1_prior(std::shared_ptr<ContinuousProbabilityDistribution> prior) {
     this->freq_1_->set_prior(prior);
     this->make_dirty();
@@ -1711,27 +1752,140 @@ BasePopulationTree::simulate_biallelic_site_sans_missing(
 
 double BasePopulationTree::compute_log_likelihood(
         const unsigned int nthreads) {
+    return this->compute_log_likelihood_with_minimum(
+            -std::numeric_limits<double>::infinity(),
+            nthreads);
+}
+
+double BasePopulationTree::compute_log_likelihood_with_minimum(
+        const double minimum_log_likelihood,
+        const unsigned int nthreads) {
     if (this->ignoring_data()) {
         this->log_likelihood_.set_value(0.0);
         return 0.0;
     }
+    this->update_flat_tree();
+    double log_likelihood = this->compute_log_likelihood(
+            this->get_flat_tree(),
+            *this->root_,
+            this->get_u(),
+            this->get_v(),
+            this->get_mutation_rate(),
+            this->get_likelihood_correction(),
+            nthreads,
+            minimum_log_likelihood,
+            &this->constant_pattern_cache_);
+    this->log_likelihood_.set_value(log_likelihood);
+    return log_likelihood;
+}
+
+PopulationTreeLikelihoodState BasePopulationTree::get_likelihood_state() {
+    PopulationTreeLikelihoodState state;
+    state.root = this->root_->get_deep_copy();
+    state.flat_tree.compile(*state.root);
+    state.u = this->get_u();
+    state.v = this->get_v();
+    state.mutation_rate = this->get_mutation_rate();
+    if (! this->ignoring_data()) {
+        state.likelihood_correction = this->get_likelihood_correction();
+    }
+    return state;
+}
+
+double BasePopulationTree::compute_log_likelihood(
+        const PopulationTreeLikelihoodState & state,
+        const unsigned int nthreads) const {
+    if (this->ignoring_data()) {
+        return 0.0;
+    }
+    return this->compute_log_likelihood(
+            state.flat_tree,
+            *state.root,
+            state.u,
+            state.v,
+            state.mutation_rate,
+            state.likelihood_correction,
+            nthreads);
+}
+
+void BasePopulationTree::compute_log_likelihoods(
+        const std::vector<PopulationTreeLikelihoodState> & states,
+        std::vector<double> & log_likelihoods,
+        const unsigned int nthreads) const {
+    log_likelihoods.assign(states.size(), 0.0);
+    if (states.size() < 2) {
+        for (unsigned int i = 0; i < states.size(); ++i) {
+            log_likelihoods.at(i) = this->compute_log_likelihood(
+                    states.at(i), nthreads);
+        }
+        return;
+    }
+#ifdef BUILD_WITH_THREADS
+    const unsigned int nbatches = std::min(nthreads,
+            (unsigned int)states.size());
+    if (nbatches > 1) {
+        // Each batch is every nbatches-th state; launch nbatches - 1 threads
+        // and compute the last batch in this one
+        std::vector< std::future<void> > threads(nbatches - 1);
+        for (unsigned int b = 0; b < (nbatches - 1); ++b) {
+            threads.at(b) = std::async(
+                    std::launch::async,
+                    [this, &states, &log_likelihoods, b, nbatches]() {
+                        for (unsigned int i = b; i < states.size(); i += nbatches) {
+                            log_likelihoods.at(i) = this->compute_log_likelihood(
+                                    states.at(i), 1);
+                        }
+                    });
+        }
+        for (unsigned int i = nbatches - 1; i < states.size(); i += nbatches) {
+            log_likelihoods.at(i) = this->compute_log_likelihood(
+                    states.at(i), 1);
+        }
+        for (auto &t : threads) {
+            t.get();
+        }
+        return;
+    }
+#endif
+    for (unsigned int i = 0; i < states.size(); ++i) {
+        log_likelihoods.at(i) = this->compute_log_likelihood(
+                states.at(i), 1);
+    }
+}
+
+double BasePopulationTree::compute_log_likelihood(
+        const FlatTree<PopulationNode> & flat_tree,
+        const PopulationNode & root,
+        double u,
+        double v,
+        double mutation_rate,
+        double likelihood_correction,
+        const unsigned int nthreads,
+        const double minimum_log_likelihood,
+        ConstantPatternLikelihoodCache * constant_pattern_cache) const {
+    this->cost_counters_.record_likelihood_call(
+            this->data_.get_pattern_weights().size());
     double constant_pattern_lnl_correction = 0.0;
     double log_likelihood = get_log_likelihood(
-            this->get_mutable_root(),
+            flat_tree,
             this->data_.get_red_allele_count_matrix(),
             this->data_.get_allele_count_matrix(),
             this->data_.get_pattern_weights(),
             this->unique_allele_counts_,
             this->unique_allele_count_weights_,
-            this->get_u(),
-            this->get_v(),
-            this->get_mutation_rate(),
+            u,
+            v,
+            mutation_rate,
             this->get_ploidy(),
             this->data_.markers_are_dominant(),
             this->state_frequencies_are_constrained(),
             this->constant_sites_removed(),
             constant_pattern_lnl_correction,
-            nthreads);
+            nthreads,
+            this->population_size_multipliers_,
+            minimum_log_likelihood - likelihood_correction,
+            constant_pattern_cache,
+            &this->pattern_order_);
 
     if (this->constant_sites_removed()) {
         //////////////////////////////////////////////////////////////////////
@@ -1760,8 +1914,8 @@ double BasePopulationTree::compute_log_likelihood(
             // TODO: Is there a better way to handle this? Technically, the log likelihood
             // would be inf or NAN (not -inf)
             log_likelihood = -std::numeric_limits<double>::infinity();
-            double root_height = this->get_node_height_in_subs_per_site(this->get_root());
-            std::vector< std::shared_ptr<PositiveRealParameter> > pop_sizes = this->get_pointers_to_population_sizes();
+            double root_height = root.get_height();
+            std::vector< std::shared_ptr<PositiveRealParameter> > pop_sizes = root.get_all_population_size_parameters();
             std::ostringstream message;
             message << "\n"
                     << "\n#######################################################################\n"
@@ -1774,11 +1928,11 @@ double BasePopulationTree::compute_log_likelihood(
                     <<   "This is likely due to the event time and population sizes being very\n"
                     <<   "small. The current height of the root node in expected subsitutions\n"
                     <<   "per site is:\n    "
-                    <<   root_height * this->get_mutation_rate() << "\n"
+                    <<   root_height * mutation_rate << "\n"
                     <<   "The current population sizes (scaled by the mutation rate) are:\n    "
-                    <<   pop_sizes.at(0)->get_value() * this->get_mutation_rate();
+                    <<   pop_sizes.at(0)->get_value() * mutation_rate;
             for (unsigned int i = 1; i < pop_sizes.size(); ++i) {
-                message << " " << pop_sizes.at(i)->get_value() * this->get_mutation_rate();
+                message << " " << pop_sizes.at(i)->get_value() * mutation_rate;
             }
             message << "\n"
                     << "This state will be rejected by the Metropolis-Hastings algorithm,\n"
@@ -1795,7 +1949,7 @@ double BasePopulationTree::compute_log_likelihood(
         // }
     }
 
-    log_likelihood += this->get_likelihood_correction();
+    log_likelihood += likelihood_correction;
 
     // ECOEVOLITY_DEBUG(
     //     std::cerr << "compute_log_likelihood(): " << log_likelihood << std::endl;
@@ -1803,8 +1957,6 @@ double BasePopulationTree::compute_log_likelihood(
     if (std::isnan(log_likelihood)) {
         throw EcoevolityError("BasePopulationTree::compute_log_likelihood resulted in a NAN likelihood");
     }
-
-    this->log_likelihood_.set_value(log_likelihood);
     return log_likelihood;
 }
 
@@ -2062,41 +2214,22 @@ void ComparisonPopulationTree::restore_parameters() {
     // this->restore_all_heights();
 }
 
-void ComparisonPopulationTree::write_comparison_state_log_header(
-        std::ostream& out,
-        bool include_event_index,
-        const std::string& delimiter) const {
+void ComparisonPopulationTree::add_comparison_state_columns(
+        StateLogRow & row,
+        unsigned int event_index) const {
     std::string suffix = "_" + this->root_->get_child(0)->get_label();
-    if (include_event_index) {
-        out << "root_height_index" << suffix << delimiter;
-    }
-    out << "ln_likelihood" << suffix << delimiter
-        << "ln_prior" << suffix << delimiter
-        << "root_height" << suffix << delimiter
-        << "mutation_rate" << suffix << delimiter
-        << "freq_1" << suffix << delimiter
-        << "pop_size" << suffix << delimiter;
+    row.add_integer("root_height_index" + suffix, event_index);
+    row.add("ln_likelihood" + suffix, this->log_likelihood_.get_value());
+    row.add("ln_prior" + suffix, this->log_prior_density_.get_value());
+    row.add("root_height" + suffix, this->get_root_height());
+    row.add("mutation_rate" + suffix, this->get_mutation_rate());
+    row.add("freq_1" + suffix, this->get_freq_1());
+    row.add("pop_size" + suffix, this->get_child_population_size(0));
     if (this->root_->get_number_of_children() > 1) {
-        out << "pop_size" << "_" << this->root_->get_child(1)->get_label() << delimiter;
-    }
-    out << "pop_size_root" << suffix;
-}
-
-void ComparisonPopulationTree::log_comparison_state(
-        std::ostream& out,
-        unsigned int event_index,
-        const std::string& delimiter) const {
-    out << event_index << delimiter
-        << this->log_likelihood_.get_value() << delimiter
-        << this->log_prior_density_.get_value() << delimiter
-        << this->get_root_height() << delimiter
-        << this->get_mutation_rate() << delimiter
-        << this->get_freq_1() << delimiter
-        << this->get_child_population_size(0) << delimiter;
-    if (this->root_->get_number_of_children() > 1) {
-        out << this->get_child_population_size(1) << delimiter;
+        row.add("pop_size_" + this->root_->get_child(1)->get_label(),
+                this->get_child_population_size(1));
     }
-    out << this->get_root_population_size();
+    row.add("pop_size_root" + suffix, this->get_root_population_size());
 }
 
 void ComparisonPopulationTree::draw_from_prior(RandomNumberGenerator& rng) {
@@ -2315,46 +2448,26 @@ ComparisonDirichletPopulationTree::ComparisonDirichletPopulationTree(
     }
 }
 
-void ComparisonDirichletPopulationTree::write_comparison_state_log_header(
-        std::ostream& out,
-        bool include_event_index,
-        const std::string& delimiter) const {
+void ComparisonDirichletPopulationTree::add_comparison_state_columns(
+        StateLogRow & row,
+        unsigned int event_index) const {
     std::string suffix = "_" + this->root_->get_child(0)->get_label();
-    if (include_event_index) {
-        out << "root_height_index" << suffix << delimiter;
-    }
-    out << "ln_likelihood" << suffix << delimiter
-        << "ln_prior" << suffix << delimiter
-        << "root_height" << suffix << delimiter
-        << "mutation_rate" << suffix << delimiter
-        << "freq_1" << suffix << delimiter
-        << "pop_size" << suffix << delimiter
-        << "pop_size_multiplier" << suffix << delimiter;
-    if (this->root_->get_number_of_children() > 1) {
-        out << "pop_size_multiplier" << "_" << this->root_->get_child(1)->get_label() << delimiter;
-    }
-    out << "pop_size_multiplier_root" << suffix;
-}
-
-void ComparisonDirichletPopulationTree::log_comparison_state(
-        std::ostream& out,
-        unsigned int event_index,
-        const std::string& delimiter) const {
-    out << event_index << delimiter;
     std::vector<double> multipliers = this->get_population_sizes_as_multipliers();
-    out << this->log_likelihood_.get_value() << delimiter
-        << this->log_prior_density_.get_value() << delimiter
-        << this->get_root_height() << delimiter
-        << this->get_mutation_rate() << delimiter
-        << this->get_freq_1() << delimiter
-        << this->get_mean_population_size() << delimiter
-        << multipliers.at(0) << delimiter;
+    row.add_integer("root_height_index" + suffix, event_index);
+    row.add("ln_likelihood" + suffix, this->log_likelihood_.get_value());
+    row.add("ln_prior" + suffix, this->log_prior_density_.get_value());
+    row.add("root_height" + suffix, this->get_root_height());
+    row.add("mutation_rate" + suffix, this->get_mutation_rate());
+    row.add("freq_1" + suffix, this->get_freq_1());
+    row.add("pop_size" + suffix, this->get_mean_population_size());
+    row.add("pop_size_multiplier" + suffix, multipliers.at(0));
     unsigned int root_index = 1;
     if (this->root_->get_number_of_children() > 1) {
-        out << multipliers.at(1) << delimiter;
+        row.add("pop_size_multiplier_" + this->root_->get_child(1)->get_label(),
+                multipliers.at(1));
         ++root_index;
     }
-    out << multipliers.at(root_index);
+    row.add("pop_size_multiplier_root" + suffix, multipliers.at(root_index));
 }
 
 void ComparisonDirichletPopulationTree::draw_from_prior(RandomNumberGenerator& rng) {
@@ -2745,41 +2858,22 @@ void ComparisonRelativeRootPopulationTree::restore_parameters() {
     // this->restore_all_heights();
 }
 
-void ComparisonRelativeRootPopulationTree::write_comparison_state_log_header(
-        std::ostream& out,
-        bool include_event_index,
-        const std::string& delimiter) const {
+void ComparisonRelativeRootPopulationTree::add_comparison_state_columns(
+        StateLogRow & row,
+        unsigned int event_index) const {
     std::string suffix = "_" + this->root_->get_child(0)->get_label();
-    if (include_event_index) {
-        out << "root_height_index" << suffix << delimiter;
-    }
-    out << "ln_likelihood" << suffix << delimiter
-        << "ln_prior" << suffix << delimiter
-        << "root_height" << suffix << delimiter
-        << "mutation_rate" << suffix << delimiter
-        << "freq_1" << suffix << delimiter
-        << "pop_size" << suffix << delimiter;
-    if (this->root_->get_number_of_children() > 1) {
-        out << "pop_size" << "_" << this->root_->get_child(1)->get_label() << delimiter;
-    }
-    out << "pop_size_root" << suffix;
-}
-
-void ComparisonRelativeRootPopulationTree::log_comparison_state(
-        std::ostream& out,
-        unsigned int event_index,
-        const std::string& delimiter) const {
-    out << event_index << delimiter
-        << this->log_likelihood_.get_value() << delimiter
-        << this->log_prior_density_.get_value() << delimiter
-        << this->get_root_height() << delimiter
-        << this->get_mutation_rate() << delimiter
-        << this->get_freq_1() << delimiter
-        << this->get_child_population_size(0) << delimiter;
+    row.add_integer("root_height_index" + suffix, event_index);
+    row.add("ln_likelihood" + suffix, this->log_likelihood_.get_value());
+    row.add("ln_prior" + suffix, this->log_prior_density_.get_value());
+    row.add("root_height" + suffix, this->get_root_height());
+    row.add("mutation_rate" + suffix, this->get_mutation_rate());
+    row.add("freq_1" + suffix, this->get_freq_1());
+    row.add("pop_size" + suffix, this->get_child_population_size(0));
     if (this->root_->get_number_of_children() > 1) {
-        out << this->get_child_population_size(1) << delimiter;
+        row.add("pop_size_" + this->root_->get_child(1)->get_label(),
+                this->get_child_population_size(1));
     }
-    out << this->get_root_population_size();
+    row.add("pop_size_root" + suffix, this->get_root_population_size());
 }
 
 void ComparisonRelativeRootPopulationTree::draw_from_prior(RandomNumberGenerator& rng) {
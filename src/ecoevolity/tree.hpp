@@ -26,10 +26,29 @@
 #include "likelihood.hpp"
 #include "parameter.hpp"
 #include "probability.hpp"
+#include "discretized_gamma.hpp"
 #include "error.hpp"
 #include "debug.hpp"
 #include "assert.hpp"
 #include "general_tree_settings.hpp"
+#include "statelog.hpp"
+
+
+/**
+ * Copy of the parts of the state of a BasePopulationTree that its likelihood
+ * depends on. The likelihood of the copy can be computed (with
+ * BasePopulationTree::compute_log_likelihood) after the tree has moved on to
+ * other states, e.g., to evaluate MCMC proposals in parallel.
+ */
+class PopulationTreeLikelihoodState {
+    public:
+        std::shared_ptr<PopulationNode> root;
+        FlatTree<PopulationNode> flat_tree;
+        double u = 0.5;
+        double v = 0.5;
+        double mutation_rate = 1.0;
+        double likelihood_correction = 0.0;
+};
 
 
 class BasePopulationTree : public BaseTree<PopulationNode> {
@@ -52,6 +71,11 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
         bool population_sizes_are_constrained_ = false;
         bool state_frequencies_are_constrained_ = false;
 
+        // Category means of the discretized population-size prior, relative
+        // to its mean. If not empty, the population size of each branch is
+        // integrated out of the likelihood over these categories.
+        std::vector<double> population_size_multipliers_;
+
         // Vectors for storing unique allele counts and associated weights.
         // These are used for calculating the likelihood correction term for
         // constant site patterns. It is a bit weird to store data here, but
@@ -61,6 +85,17 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
         std::vector< std::vector<unsigned int> > unique_allele_counts_;
         std::vector<unsigned int> unique_allele_count_weights_;
 
+        // Partials of the constant patterns, so that only those below
+        // changed branches are recomputed for the constant-site correction.
+        // Only the likelihood of the tree itself uses it, because likelihoods
+        // of states from get_likelihood_state can be computed concurrently.
+        ConstantPatternLikelihoodCache constant_pattern_cache_;
+
+        // Order in which to compute the likelihoods of the patterns, so that
+        // partials are shared between consecutive patterns. It is only read
+        // during likelihood calculations, so all of them use it.
+        PatternOrder pattern_order_;
+
         // methods
         void process_and_vet_initialized_data(
                 bool strict_on_constant_sites = false,
@@ -86,6 +121,18 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
         // bool constant_site_counts_were_provided();
         void calculate_likelihood_correction();
 
+        double compute_log_likelihood(
+                const FlatTree<PopulationNode> & flat_tree,
+                const PopulationNode & root,
+                double u,
+                double v,
+                double mutation_rate,
+                double likelihood_correction,
+                const unsigned int nthreads,
+                const double minimum_log_likelihood =
+                        -std::numeric_limits<double>::infinity(),
+                ConstantPatternLikelihoodCache * constant_pattern_cache = nullptr) const;
+
         double calculate_log_binomial(
                 unsigned int red_allele_count,
                 unsigned int allele_count) const;
@@ -277,6 +324,38 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
         double get_likelihood_correction(bool force = false);
 
         double compute_log_likelihood(const unsigned int nthreads = 1);
+        double compute_log_likelihood_with_minimum(
+                const double minimum_log_likelihood,
+                const unsigned int nthreads = 1);
+
+        typedef PopulationTreeLikelihoodState LikelihoodState;
+
+        /**
+         * Get a copy of the current state that the likelihood can be
+         * computed from, independently of later changes to the tree.
+         */
+        PopulationTreeLikelihoodState get_likelihood_state();
+
+        /**
+         * Compute the log likelihood of a state from get_likelihood_state.
+         * This does not change the tree (the log likelihood value of the tree
+         * is not updated), so the likelihoods of several states can be
+         * computed concurrently.
+         */
+        double compute_log_likelihood(
+                const PopulationTreeLikelihoodState & state,
+                const unsigned int nthreads = 1) const;
+
+        /**
+         * Compute the log likelihoods of several states from
+         * get_likelihood_state, using up to `nthreads` threads. If there are
+         * at least as many states as threads, each state is computed by a
+         * single thread.
+         */
+        void compute_log_likelihoods(
+                const std::vector<PopulationTreeLikelihoodState> & states,
+                std::vector<double> & log_likelihoods,
+                const unsigned int nthreads = 1) const;
 
         double get_derived_class_component_of_log_prior_density() const;
         double compute_log_prior_density_of_state_frequencies() const;
@@ -325,6 +404,21 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
             return this->population_sizes_are_constrained_;
         }
 
+        /**
+         * Integrate the population size of each branch out of the likelihood
+         * of each site pattern, over `number_of_categories` categories of equal
+         * probability of the (gamma) population-size prior. The population
+         * sizes are fixed to the mean of the prior, and are no longer
+         * parameters of the model.
+         */
+        void integrate_population_sizes(unsigned int number_of_categories);
+        bool population_sizes_are_integrated() const {
+            return (! this->population_size_multipliers_.empty());
+        }
+        const std::vector<double> & get_population_size_multipliers() const {
+            return this->population_size_multipliers_;
+        }
+
         void fix_state_frequencies() {
             this->freq_1_->fix();
         }
@@ -444,6 +538,11 @@ class BasePopulationTree : public BaseTree<PopulationNode> {
                 const unsigned int generation_index,
                 const std::string& delimiter = "\t",
                 const bool short_summary = false) const;
+        void get_state_log_values(std::vector<double> & values,
+                const unsigned int generation_index) const;
+        void get_state_log_row(StateLogRow & row,
+                const unsigned int generation_index,
+                const bool short_summary = false) const;
 };
 
 
@@ -629,15 +728,13 @@ class PopulationTree : public BasePopulationTree {
             throw EcoevolityError("get_child_population_size_parameter called from PopulationTree");
         }
 
-        virtual void write_comparison_state_log_header(std::ostream& out,
-                bool include_event_index,
-                const std::string& delimiter = "\t") const {
-            throw EcoevolityError("write_comparison_state_log_header called from base PopulationTree class");
-        }
-        virtual void log_comparison_state(std::ostream& out,
-                unsigned int event_index,
-                const std::string& delimiter = "\t") const {
-            throw EcoevolityError("log_comparison_state called from base PopulationTree class");
+        /**
+         * Add the columns of this comparison to a row of the state log of a
+         * collection.
+         */
+        virtual void add_comparison_state_columns(StateLogRow & row,
+                unsigned int event_index) const {
+            throw EcoevolityError("add_comparison_state_columns called from base PopulationTree class");
         }
 };
 
@@ -830,12 +927,8 @@ class ComparisonPopulationTree: public PopulationTree {
 
         double compute_log_prior_density();
 
-        virtual void write_comparison_state_log_header(std::ostream& out,
-                bool include_event_index,
-                const std::string& delimiter = "\t") const;
-        virtual void log_comparison_state(std::ostream& out,
-                unsigned int event_index,
-                const std::string& delimiter = "\t") const;
+        virtual void add_comparison_state_columns(StateLogRow & row,
+                unsigned int event_index) const;
 
         void draw_from_prior(RandomNumberGenerator& rng);
 
@@ -898,12 +991,8 @@ class ComparisonRelativeRootPopulationTree: public RelativeRootPopulationTree {
 
         double compute_log_prior_density();
 
-        void write_comparison_state_log_header(std::ostream& out,
-                bool include_event_index,
-                const std::string& delimiter = "\t") const;
-        void log_comparison_state(std::ostream& out,
-                unsigned int event_index,
-                const std::string& delimiter = "\t") const;
+        void add_comparison_state_columns(StateLogRow & row,
+                unsigned int event_index) const;
 
         void draw_from_prior(RandomNumberGenerator& rng);
 
@@ -963,12 +1052,8 @@ class ComparisonDirichletPopulationTree: public ComparisonPopulationTree {
 
         double compute_log_prior_density_of_population_sizes() const;
 
-        void write_comparison_state_log_header(std::ostream& out,
-                bool include_event_index,
-                const std::string& delimiter = "\t") const;
-        void log_comparison_state(std::ostream& out,
-                unsigned int event_index,
-                const std::string& delimiter = "\t") const;
+        void add_comparison_state_columns(StateLogRow & row,
+                unsigned int event_index) const;
 
         void draw_from_prior(RandomNumberGenerator& rng);
 };
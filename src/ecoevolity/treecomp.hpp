@@ -23,21 +23,26 @@
 #include <iostream>
 #include <cmath>
 #include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <future>
+#endif
+
+#include "assert.hpp"
 
 #include "split.hpp"
 
 
 namespace treecomp {
 
-template<class TreeType>
 inline double euclidean_distance(
-        const TreeType & tree1,
-        const TreeType & tree2,
-        const bool resize_splits = false) {
-    std::map<Split, double> split_length_map1 = tree1.get_split_length_map(
-            resize_splits);
-    std::map<Split, double> split_length_map2 = tree2.get_split_length_map(
-            resize_splits);
+        const std::map<Split, double> & split_length_map1,
+        const std::map<Split, double> & split_length_map2) {
     std::set<Split> all_splits;
     for (auto split_len : split_length_map1) {
         all_splits.insert(split_len.first);
@@ -60,6 +65,342 @@ inline double euclidean_distance(
     return std::sqrt(sum_squared_diffs);
 }
 
+template<class TreeType>
+inline double euclidean_distance(
+        const TreeType & tree1,
+        const TreeType & tree2,
+        const bool resize_splits = false) {
+    std::map<Split, double> split_length_map1 = tree1.get_split_length_map(
+            resize_splits);
+    std::map<Split, double> split_length_map2 = tree2.get_split_length_map(
+            resize_splits);
+    return euclidean_distance(split_length_map1, split_length_map2);
+}
+
+
+/**
+ * Pairwise Robinson-Foulds and Euclidean distances among trees.
+ *
+ * The RF distance is the number of splits found in only one of the two
+ * trees; the Euclidean distance is that of the vectors of branch lengths
+ * indexed by split (branch-score distance). The distances are symmetric and
+ * zero between a tree and itself, so only the upper triangle of each matrix
+ * is stored.
+ */
+class TreeDistances {
+    protected:
+        unsigned int number_of_trees_ = 0;
+        std::vector<double> robinson_foulds_;
+        std::vector<double> euclidean_;
+
+        std::size_t get_pair_index_(unsigned int i, unsigned int j) const {
+            ECOEVOLITY_ASSERT(i != j);
+            ECOEVOLITY_ASSERT(i < this->number_of_trees_);
+            ECOEVOLITY_ASSERT(j < this->number_of_trees_);
+            if (i > j) {
+                std::swap(i, j);
+            }
+            // Row i of the upper triangle follows rows 0 to i-1, which have
+            // n-1, n-2, ..., n-i entries
+            const std::size_t n = this->number_of_trees_;
+            return ((i * ((2 * n) - i - 1)) / 2) + (j - i - 1);
+        }
+
+    public:
+        TreeDistances() { }
+        TreeDistances(const unsigned int number_of_trees) {
+            this->resize(number_of_trees);
+        }
+
+        void resize(const unsigned int number_of_trees) {
+            this->number_of_trees_ = number_of_trees;
+            std::size_t npairs = 0;
+            if (number_of_trees > 1) {
+                npairs = ((std::size_t)number_of_trees * (number_of_trees - 1)) / 2;
+            }
+            this->robinson_foulds_.assign(npairs, 0.0);
+            this->euclidean_.assign(npairs, 0.0);
+        }
+
+        unsigned int get_number_of_trees() const {
+            return this->number_of_trees_;
+        }
+
+        void set(const unsigned int i,
+                const unsigned int j,
+                const double robinson_foulds,
+                const double euclidean) {
+            std::size_t index = this->get_pair_index_(i, j);
+            this->robinson_foulds_[index] = robinson_foulds;
+            this->euclidean_[index] = euclidean;
+        }
+
+        double get_robinson_foulds(const unsigned int i,
+                const unsigned int j) const {
+            if (i == j) {
+                ECOEVOLITY_ASSERT(i < this->number_of_trees_);
+                return 0.0;
+            }
+            return this->robinson_foulds_[this->get_pair_index_(i, j)];
+        }
+        double get_euclidean(const unsigned int i,
+                const unsigned int j) const {
+            if (i == j) {
+                ECOEVOLITY_ASSERT(i < this->number_of_trees_);
+                return 0.0;
+            }
+            return this->euclidean_[this->get_pair_index_(i, j)];
+        }
+};
+
+/**
+ * Batch calculator of distances among many trees.
+ *
+ * Each tree is converted once into an array of split IDs (sorted) and the
+ * corresponding branch lengths; distinct splits are given dense IDs via a
+ * hashed index. Distances between pairs of trees are then calculated with
+ * a merge join of the arrays, which requires no comparisons of splits.
+ * The distances are calculated one block of rows of the matrix at a time;
+ * each block is calculated in square tiles, which are divided among
+ * threads.
+ */
+class DistanceMatrixCalculator {
+    protected:
+        std::unordered_map<Split, unsigned int, SplitHash> split_ids_;
+        std::vector< std::vector<unsigned int> > tree_split_ids_;
+        std::vector< std::vector<double> > tree_split_lengths_;
+
+        // Distances from the trees in rows [row_start, row_end) of the
+        // matrix to all of the trees, stored by row
+        struct RowBlock {
+            unsigned int row_start = 0;
+            unsigned int row_end = 0;
+            std::vector<double> robinson_foulds;
+            std::vector<double> euclidean;
+        };
+
+        void calculate_tile_(
+                const unsigned int column_start,
+                const unsigned int tile_size,
+                RowBlock & block) const {
+            const unsigned int ntrees = this->tree_split_ids_.size();
+            const unsigned int column_end = std::min(column_start + tile_size, ntrees);
+            for (unsigned int i = block.row_start; i < block.row_end; ++i) {
+                unsigned int j = column_start;
+                if (block.row_start == column_start) {
+                    j = i + 1;
+                }
+                std::size_t row_offset = (std::size_t)(i - block.row_start) * ntrees;
+                for (; j < column_end; ++j) {
+                    this->calculate_distances(i, j,
+                            block.robinson_foulds[row_offset + j],
+                            block.euclidean[row_offset + j]);
+                }
+            }
+        }
+
+        void calculate_tiles_(
+                const std::vector<unsigned int> & column_starts,
+                const unsigned int start,
+                const unsigned int step,
+                const unsigned int tile_size,
+                RowBlock & block) const {
+            for (unsigned int t = start; t < column_starts.size(); t += step) {
+                this->calculate_tile_(column_starts.at(t),
+                        tile_size,
+                        block);
+            }
+        }
+
+        void calculate_row_block_(
+                RowBlock & block,
+                const std::vector<unsigned int> & column_starts,
+                const unsigned int nthreads,
+                const unsigned int tile_size) const {
+#ifdef BUILD_WITH_THREADS
+            // Tiles are disjoint parts of the block, so threads can write
+            // to the block without locking
+            if ((nthreads > 1) && (column_starts.size() > 1)) {
+                unsigned int nworkers = std::min(nthreads, (unsigned int)column_starts.size());
+                std::vector< std::future<void> > threads;
+                threads.reserve(nworkers - 1);
+                for (unsigned int t = 0; t < (nworkers - 1); ++t) {
+                    threads.push_back(std::async(
+                            std::launch::async,
+                            &DistanceMatrixCalculator::calculate_tiles_,
+                            this,
+                            std::cref(column_starts),
+                            t,
+                            nworkers,
+                            tile_size,
+                            std::ref(block)));
+                }
+                // Use the main thread for the last set of tiles
+                this->calculate_tiles_(column_starts, nworkers - 1, nworkers,
+                        tile_size, block);
+                for (auto & t : threads) {
+                    t.get();
+                }
+                return;
+            }
+#endif
+            this->calculate_tiles_(column_starts, 0, 1, tile_size, block);
+        }
+
+    public:
+        DistanceMatrixCalculator() { }
+
+        /**
+         * Add a tree from its map of split lengths (see
+         * BaseTree::get_split_length_map). Returns the index of the tree.
+         */
+        unsigned int add_split_lengths(
+                const std::map<Split, double> & split_length_map) {
+            std::vector< std::pair<unsigned int, double> > id_lengths;
+            id_lengths.reserve(split_length_map.size());
+            for (auto const & split_length : split_length_map) {
+                auto id = this->split_ids_.find(split_length.first);
+                unsigned int split_id = this->split_ids_.size();
+                if (id == this->split_ids_.end()) {
+                    this->split_ids_[split_length.first] = split_id;
+                }
+                else {
+                    split_id = id->second;
+                }
+                id_lengths.push_back(std::make_pair(split_id, split_length.second));
+            }
+            std::sort(id_lengths.begin(), id_lengths.end());
+            std::vector<unsigned int> ids;
+            std::vector<double> lengths;
+            ids.reserve(id_lengths.size());
+            lengths.reserve(id_lengths.size());
+            for (auto const & id_length : id_lengths) {
+                ids.push_back(id_length.first);
+                lengths.push_back(id_length.second);
+            }
+            this->tree_split_ids_.push_back(ids);
+            this->tree_split_lengths_.push_back(lengths);
+            return this->tree_split_ids_.size() - 1;
+        }
+
+        template<class TreeType>
+        unsigned int add_tree(
+                const TreeType & tree,
+                const bool resize_splits = false) {
+            return this->add_split_lengths(
+                    tree.get_split_length_map(resize_splits));
+        }
+
+        unsigned int get_number_of_trees() const {
+            return this->tree_split_ids_.size();
+        }
+        unsigned int get_number_of_splits() const {
+            return this->split_ids_.size();
+        }
+
+        void calculate_distances(
+                const unsigned int tree_index1,
+                const unsigned int tree_index2,
+                double & robinson_foulds,
+                double & euclidean) const {
+            const std::vector<unsigned int> & ids1 = this->tree_split_ids_.at(tree_index1);
+            const std::vector<unsigned int> & ids2 = this->tree_split_ids_.at(tree_index2);
+            const std::vector<double> & lengths1 = this->tree_split_lengths_.at(tree_index1);
+            const std::vector<double> & lengths2 = this->tree_split_lengths_.at(tree_index2);
+            unsigned int n_unshared = 0;
+            double sum_squared_diffs = 0.0;
+            std::size_t i = 0;
+            std::size_t j = 0;
+            while ((i < ids1.size()) && (j < ids2.size())) {
+                if (ids1[i] == ids2[j]) {
+                    double d = lengths1[i] - lengths2[j];
+                    sum_squared_diffs += d * d;
+                    ++i;
+                    ++j;
+                }
+                else if (ids1[i] < ids2[j]) {
+                    sum_squared_diffs += lengths1[i] * lengths1[i];
+                    ++n_unshared;
+                    ++i;
+                }
+                else {
+                    sum_squared_diffs += lengths2[j] * lengths2[j];
+                    ++n_unshared;
+                    ++j;
+                }
+            }
+            for (; i < ids1.size(); ++i) {
+                sum_squared_diffs += lengths1[i] * lengths1[i];
+                ++n_unshared;
+            }
+            for (; j < ids2.size(); ++j) {
+                sum_squared_diffs += lengths2[j] * lengths2[j];
+                ++n_unshared;
+            }
+            robinson_foulds = n_unshared;
+            euclidean = std::sqrt(sum_squared_diffs);
+        }
+
+        /**
+         * Calculate the distances between all pairs of trees, and pass them
+         * to 'process_pair(i, j, robinson_foulds, euclidean)' in order of i
+         * and then j, for i < j. Only 'tile_size' rows of the matrix are
+         * held in memory at once, so this scales to more trees than fit in
+         * a TreeDistances matrix.
+         */
+        template<class PairFunction>
+        void for_each_pair(PairFunction process_pair,
+                const unsigned int nthreads = 1,
+                const unsigned int tile_size = 64) const {
+            ECOEVOLITY_ASSERT(tile_size > 0);
+            const unsigned int ntrees = this->get_number_of_trees();
+            RowBlock block;
+            for (unsigned int r = 0; r < ntrees; r += tile_size) {
+                block.row_start = r;
+                block.row_end = std::min(r + tile_size, ntrees);
+                const std::size_t block_size =
+                        (std::size_t)(block.row_end - block.row_start) * ntrees;
+                block.robinson_foulds.resize(block_size);
+                block.euclidean.resize(block_size);
+                std::vector<unsigned int> column_starts;
+                for (unsigned int c = r; c < ntrees; c += tile_size) {
+                    column_starts.push_back(c);
+                }
+                this->calculate_row_block_(block, column_starts, nthreads,
+                        tile_size);
+                for (unsigned int i = block.row_start; i < block.row_end; ++i) {
+                    std::size_t row_offset = (std::size_t)(i - block.row_start) * ntrees;
+                    for (unsigned int j = i + 1; j < ntrees; ++j) {
+                        process_pair(i, j,
+                                block.robinson_foulds[row_offset + j],
+                                block.euclidean[row_offset + j]);
+                    }
+                }
+            }
+        }
+
+        void calculate(TreeDistances & distances,
+                const unsigned int nthreads = 1,
+                const unsigned int tile_size = 64) const {
+            distances.resize(this->get_number_of_trees());
+            this->for_each_pair(
+                    [&distances](unsigned int i, unsigned int j,
+                            double robinson_foulds, double euclidean) {
+                        distances.set(i, j, robinson_foulds, euclidean);
+                    },
+                    nthreads,
+                    tile_size);
+        }
+
+        TreeDistances calculate(
+                const unsigned int nthreads = 1,
+                const unsigned int tile_size = 64) const {
+            TreeDistances distances;
+            this->calculate(distances, nthreads, tile_size);
+            return distances;
+        }
+};
+
 } // treecomp
 
 #endif
@@ -23,12 +23,21 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <unordered_map>
+
+#ifdef BUILD_WITH_THREADS
+#include <thread>
+#include <future>
+#endif
 
 #include "assert.hpp"
 #include "stats_util.hpp"
 #include "basetree.hpp"
 #include "node.hpp"
 #include "treecomp.hpp"
+#include "binlog.hpp"
+#include "compressed_stream.hpp"
+#include "newick.hpp"
 
 
 namespace treesum {
@@ -47,6 +56,16 @@ class BaseSamples {
             ++this->n_;
         }
 
+        void merge_tallies_(const BaseSamples & other) {
+            this->tree_indices_.insert(this->tree_indices_.end(),
+                    other.tree_indices_.begin(),
+                    other.tree_indices_.end());
+            this->source_indices_.insert(this->source_indices_.end(),
+                    other.source_indices_.begin(),
+                    other.source_indices_.end());
+            this->n_ += other.n_;
+        }
+
     public:
         bool operator< (const BaseSamples & other) const {
             return this->n_ < other.n_;
@@ -96,6 +115,20 @@ class NumberOfHeightsSamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        /**
+         * Append the samples of 'other' (e.g., from another thread) to
+         * these samples.
+         */
+        void merge(const NumberOfHeightsSamples & other) {
+            if (this->n_ == 0) {
+                this->number_of_heights_ = other.number_of_heights_;
+            }
+            else {
+                ECOEVOLITY_ASSERT(other.number_of_heights_ == this->number_of_heights_);
+            }
+            this->merge_tallies_(other);
+        }
+
         unsigned int get_number_of_heights() const {
             return this->number_of_heights_;
         }
@@ -140,6 +173,29 @@ class TopologySamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        void merge(const TopologySamples & other) {
+            if (other.n_ == 0) {
+                return;
+            }
+            if (this->n_ == 0) {
+                this->split_set_ = other.split_set_;
+                this->split_to_node_map_ = other.split_to_node_map_;
+                this->node_to_split_map_ = other.node_to_split_map_;
+                this->split_to_height_split_set_map_ = other.split_to_height_split_set_map_;
+            }
+            else {
+                ECOEVOLITY_ASSERT(other.split_set_ == this->split_set_);
+                ECOEVOLITY_ASSERT(other.split_to_node_map_ == this->split_to_node_map_);
+            }
+            for (auto const & splits_heights : other.heights_) {
+                std::vector<double> & h = this->heights_[splits_heights.first];
+                h.insert(h.end(),
+                        splits_heights.second.begin(),
+                        splits_heights.second.end());
+            }
+            this->merge_tallies_(other);
+        }
+
         const std::set< std::set<Split> > & get_split_set() const {
             return this->split_set_;
         }
@@ -206,6 +262,14 @@ class HeightSamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        void merge(const HeightSamples & other) {
+            this->set_split_set(other.split_set_);
+            this->heights_.insert(this->heights_.end(),
+                    other.heights_.begin(),
+                    other.heights_.end());
+            this->merge_tallies_(other);
+        }
+
         const std::set<Split> & get_split_set() const {
             return this->split_set_;
         }
@@ -245,6 +309,14 @@ class NodeHeightSamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        void merge(const NodeHeightSamples & other) {
+            this->set_node_set(other.node_set_);
+            this->heights_.insert(this->heights_.end(),
+                    other.heights_.begin(),
+                    other.heights_.end());
+            this->merge_tallies_(other);
+        }
+
         const std::set< std::set<Split> > & get_node_set() const {
             return this->node_set_;
         }
@@ -286,6 +358,25 @@ class SplitSamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        void merge(const SplitSamples & other) {
+            if (other.n_ == 0) {
+                return;
+            }
+            if (this->n_ == 0) {
+                this->split_ = other.split_;
+            }
+            else {
+                ECOEVOLITY_ASSERT(other.split_ == this->split_);
+            }
+            for (auto const & pname_values : other.parameters_) {
+                std::vector<double> & v = this->parameters_[pname_values.first];
+                v.insert(v.end(),
+                        pname_values.second.begin(),
+                        pname_values.second.end());
+            }
+            this->merge_tallies_(other);
+        }
+
         const Split & get_split() const {
             return this->split_;
         }
@@ -325,6 +416,17 @@ class NodeSamples : public BaseSamples {
             this->tally_sample_(tree_index, source_index);
         }
 
+        void merge(const NodeSamples & other) {
+            this->set_split_set(other.split_set_);
+            for (auto const & pname_values : other.parameters_) {
+                std::vector<double> & v = this->parameters_[pname_values.first];
+                v.insert(v.end(),
+                        pname_values.second.begin(),
+                        pname_values.second.end());
+            }
+            this->merge_tallies_(other);
+        }
+
         const std::set<Split> & get_split_set() const {
             return this->split_set_;
         }
@@ -376,12 +478,14 @@ class TreeSample {
         std::vector< std::shared_ptr<NodeSamples> > nodes_;
         std::vector< std::shared_ptr<SplitSamples> > non_trivial_splits_;
         std::vector< std::shared_ptr<NumberOfHeightsSamples> > num_heights_;
-        std::map< std::set< std::set<Split> >, std::shared_ptr<TopologySamples> > topologies_map_;
-        std::map< std::set<Split>,             std::shared_ptr<HeightSamples>   > heights_map_;
-        std::map< std::set< std::set<Split> >, std::shared_ptr<NodeHeightSamples> > node_heights_map_;
-        std::map< Split,                       std::shared_ptr<SplitSamples>    > splits_map_;
-        std::map< std::set<Split>,             std::shared_ptr<NodeSamples>    > nodes_map_;
-        std::map< unsigned int,                std::shared_ptr<NumberOfHeightsSamples> > num_heights_map_;
+        // Indexes into the vectors of samples above; keys are hashed, so
+        // full comparisons of split sets are only needed on hash collisions
+        std::unordered_map< std::set< std::set<Split> >, std::shared_ptr<TopologySamples>, SplitSetSetHash > topologies_map_;
+        std::unordered_map< std::set<Split>,             std::shared_ptr<HeightSamples>, SplitSetHash > heights_map_;
+        std::unordered_map< std::set< std::set<Split> >, std::shared_ptr<NodeHeightSamples>, SplitSetSetHash > node_heights_map_;
+        std::unordered_map< Split,                       std::shared_ptr<SplitSamples>, SplitHash > splits_map_;
+        std::unordered_map< std::set<Split>,             std::shared_ptr<NodeSamples>, SplitSetHash > nodes_map_;
+        std::map< unsigned int,                          std::shared_ptr<NumberOfHeightsSamples> > num_heights_map_;
         std::vector<double> tree_lengths_;
         std::vector<std::string> source_paths_;
         std::vector<unsigned int> source_sample_sizes_;
@@ -399,8 +503,10 @@ class TreeSample {
         std::map<std::set< std::set<Split> >, double> target_node_heights_;
         std::map<Split, std::map<std::string, double> > target_split_parameters_;
         std::map<std::set<Split>, std::map<std::string, double> > target_node_parameters_;
+        std::map<Split, double> target_split_lengths_;
         std::vector<double> target_euclidean_distances_;
         std::set<std::string> constrained_node_parameters_;
+        unsigned int number_of_threads_ = 1;
 
         void reverse_sort_samples_by_freq_() {
             std::sort(this->topologies_.begin(), this->topologies_.end(),
@@ -498,6 +604,7 @@ class TreeSample {
                     this->target_split_parameters_,
                     this->target_node_parameters_,
                     false);
+            this->target_split_lengths_ = this->target_tree_.get_split_length_map(false);
             this->target_tree_provided_ = true;
             this->check_target_tree_();
             this->target_topology_sample_ = TopologySamples();
@@ -675,8 +782,9 @@ class TreeSample {
                     node_parameters,
                     false);
             unsigned int nheights = heights.size();
-            if (this->num_heights_map_.count(nheights) > 0) {
-                this->num_heights_map_[nheights]->add_sample(
+            auto nheights_sample = this->num_heights_map_.find(nheights);
+            if (nheights_sample != this->num_heights_map_.end()) {
+                nheights_sample->second->add_sample(
                         nheights,
                         tree_index,
                         source_index);
@@ -687,8 +795,9 @@ class TreeSample {
                 this->num_heights_.push_back(nhs);
                 this->num_heights_map_[nheights] = nhs;
             }
-            if (this->topologies_map_.count(split_set) > 0) {
-                this->topologies_map_[split_set]->add_sample(
+            auto topology_sample = this->topologies_map_.find(split_set);
+            if (topology_sample != this->topologies_map_.end()) {
+                topology_sample->second->add_sample(
                         heights,
                         node_map,
                         tree_index,
@@ -700,9 +809,10 @@ class TreeSample {
                 this->topologies_.push_back(ts);
                 this->topologies_map_[split_set] = ts;
             }
-            for (auto splits_height : heights) {
-                if (this->heights_map_.count(splits_height.first) > 0) {
-                    this->heights_map_[splits_height.first]->add_sample(
+            for (auto const & splits_height : heights) {
+                auto height_sample = this->heights_map_.find(splits_height.first);
+                if (height_sample != this->heights_map_.end()) {
+                    height_sample->second->add_sample(
                             splits_height.first,
                             splits_height.second,
                             tree_index,
@@ -719,9 +829,10 @@ class TreeSample {
                     this->heights_map_[splits_height.first] = hs;
                 }
             }
-            for (auto node_height : node_heights) {
-                if (this->node_heights_map_.count(node_height.first) > 0) {
-                    this->node_heights_map_[node_height.first]->add_sample(
+            for (auto const & node_height : node_heights) {
+                auto node_height_sample = this->node_heights_map_.find(node_height.first);
+                if (node_height_sample != this->node_heights_map_.end()) {
+                    node_height_sample->second->add_sample(
                             node_height.first,
                             node_height.second,
                             tree_index,
@@ -738,9 +849,10 @@ class TreeSample {
                     this->node_heights_map_[node_height.first] = nhs;
                 }
             }
-            for (auto split_pmap : split_parameters) {
-                if (this->splits_map_.count(split_pmap.first) > 0) {
-                    this->splits_map_[split_pmap.first]->add_sample(
+            for (auto const & split_pmap : split_parameters) {
+                auto split_sample = this->splits_map_.find(split_pmap.first);
+                if (split_sample != this->splits_map_.end()) {
+                    split_sample->second->add_sample(
                             split_pmap.first,
                             split_pmap.second,
                             tree_index,
@@ -760,9 +872,10 @@ class TreeSample {
                     }
                 }
             }
-            for (auto split_set_pmap : node_parameters) {
-                if (this->nodes_map_.count(split_set_pmap.first) > 0) {
-                    this->nodes_map_[split_set_pmap.first]->add_sample(
+            for (auto const & split_set_pmap : node_parameters) {
+                auto node_sample = this->nodes_map_.find(split_set_pmap.first);
+                if (node_sample != this->nodes_map_.end()) {
+                    node_sample->second->add_sample(
                             split_set_pmap.first,
                             split_set_pmap.second,
                             tree_index,
@@ -781,10 +894,9 @@ class TreeSample {
             }
             if (this->target_tree_provided_) {
                 this->target_euclidean_distances_.push_back(
-                        treecomp::euclidean_distance<tree_type>(
-                            this->target_tree_,
-                            tree,
-                            false)
+                        treecomp::euclidean_distance(
+                            this->target_split_lengths_,
+                            tree.get_split_length_map(false))
                         );
             }
             this->tree_lengths_.push_back(tree.get_tree_length());
@@ -792,6 +904,198 @@ class TreeSample {
             ++this->source_sample_sizes_.back();
         }
 
+        template <class SampleType, class MapType, class KeyFunction>
+        static void merge_sample_vector_(
+                const std::vector< std::shared_ptr<SampleType> > & other_samples,
+                std::vector< std::shared_ptr<SampleType> > & samples,
+                MapType & sample_map,
+                KeyFunction get_key) {
+            for (auto const & other_sample : other_samples) {
+                typename MapType::key_type key = get_key(*other_sample);
+                auto s = sample_map.find(key);
+                if (s != sample_map.end()) {
+                    s->second->merge(*other_sample);
+                }
+                else {
+                    std::shared_ptr<SampleType> new_sample = std::make_shared<SampleType>(*other_sample);
+                    samples.push_back(new_sample);
+                    sample_map[key] = new_sample;
+                }
+            }
+        }
+
+        /**
+         * Append the samples of 'other' to this sample. If both samples were
+         * collected from consecutive trees of the same source, the result is
+         * the same as if all of the trees were added to this sample. The
+         * samples of 'other' should not be sorted.
+         */
+        void merge_samples_(const TreeSample<NodeType> & other) {
+            merge_sample_vector_(other.num_heights_,
+                    this->num_heights_,
+                    this->num_heights_map_,
+                    [](const NumberOfHeightsSamples & x) { return x.get_number_of_heights(); });
+            merge_sample_vector_(other.topologies_,
+                    this->topologies_,
+                    this->topologies_map_,
+                    [](const TopologySamples & x) { return x.get_split_set(); });
+            merge_sample_vector_(other.heights_,
+                    this->heights_,
+                    this->heights_map_,
+                    [](const HeightSamples & x) { return x.get_split_set(); });
+            merge_sample_vector_(other.node_heights_,
+                    this->node_heights_,
+                    this->node_heights_map_,
+                    [](const NodeHeightSamples & x) { return x.get_node_set(); });
+            unsigned int number_of_splits = this->splits_.size();
+            merge_sample_vector_(other.splits_,
+                    this->splits_,
+                    this->splits_map_,
+                    [](const SplitSamples & x) { return x.get_split(); });
+            for (unsigned int i = number_of_splits; i < this->splits_.size(); ++i) {
+                if (this->trivial_splits_.count(this->splits_.at(i)->get_split()) < 1) {
+                    this->non_trivial_splits_.push_back(this->splits_.at(i));
+                }
+            }
+            merge_sample_vector_(other.nodes_,
+                    this->nodes_,
+                    this->nodes_map_,
+                    [](const NodeSamples & x) { return x.get_split_set(); });
+            this->target_euclidean_distances_.insert(
+                    this->target_euclidean_distances_.end(),
+                    other.target_euclidean_distances_.begin(),
+                    other.target_euclidean_distances_.end());
+            this->tree_lengths_.insert(
+                    this->tree_lengths_.end(),
+                    other.tree_lengths_.begin(),
+                    other.tree_lengths_.end());
+            this->sample_size_ += other.sample_size_;
+            this->source_sample_sizes_.back() += other.sample_size_;
+        }
+
+        /**
+         * Prepare an empty sample to collect trees on behalf of this sample
+         * (e.g., in another thread) so that it can be merged back in with
+         * merge_samples_.
+         */
+        void init_partial_sample_(TreeSample<NodeType> & partial) const {
+            partial.leaf_labels_ = this->leaf_labels_;
+            partial.root_split_ = this->root_split_;
+            partial.leaf_splits_ = this->leaf_splits_;
+            partial.trivial_splits_ = this->trivial_splits_;
+            partial.target_tree_provided_ = this->target_tree_provided_;
+            partial.target_split_lengths_ = this->target_split_lengths_;
+            partial.source_sample_sizes_.assign(1, 0);
+        }
+
+        void add_tree_descriptions_(
+                const newick::NexusTreeReader & reader,
+                const std::vector<std::string> & tree_descriptions,
+                const unsigned int start,
+                const unsigned int end,
+                const unsigned int first_tree_index,
+                const unsigned int source_index,
+                const double ultrametricity_tolerance,
+                const double multiplier) {
+            newick::ParsedTree parsed_tree;
+            for (unsigned int i = start; i < end; ++i) {
+                reader.parse_tree_description(tree_descriptions.at(i), parsed_tree);
+                tree_type t(parsed_tree, ultrametricity_tolerance, multiplier);
+                this->_add_tree(t, first_tree_index + i, source_index);
+            }
+        }
+
+        /**
+         * Add the trees remaining in 'reader'. The trees are read in batches;
+         * with multiple threads, each thread parses a contiguous chunk of
+         * the batch into its own partial sample, and the partial samples are
+         * merged in order.
+         */
+        void add_trees_from_reader_(
+                newick::NexusTreeReader & reader,
+                unsigned int tree_index,
+                const unsigned int source_index,
+                const double ultrametricity_tolerance,
+                const double multiplier) {
+            const unsigned int nthreads = std::max(this->number_of_threads_, 1u);
+            const unsigned int batch_size = 500 * nthreads;
+            std::vector<std::string> batch;
+            batch.reserve(batch_size);
+            while (true) {
+                batch.clear();
+                std::string tree_description;
+                while ((batch.size() < batch_size) &&
+                        reader.next_tree(tree_description)) {
+                    batch.push_back(tree_description);
+                }
+                if (batch.empty()) {
+                    return;
+                }
+                unsigned int start = 0;
+                // Labels and splits are set from the first tree
+                if (this->leaf_labels_.size() < 1) {
+                    this->add_tree_descriptions_(reader, batch, 0, 1,
+                            tree_index, source_index,
+                            ultrametricity_tolerance, multiplier);
+                    start = 1;
+                }
+#ifdef BUILD_WITH_THREADS
+                if ((nthreads > 1) && ((batch.size() - start) >= nthreads)) {
+                    unsigned int chunk_size = (batch.size() - start) / nthreads;
+                    std::vector< TreeSample<NodeType> > partials(nthreads);
+                    std::vector< std::future<void> > threads;
+                    threads.reserve(nthreads - 1);
+                    for (unsigned int i = 0; i < nthreads; ++i) {
+                        this->init_partial_sample_(partials.at(i));
+                        unsigned int chunk_start = start + (i * chunk_size);
+                        unsigned int chunk_end = chunk_start + chunk_size;
+                        if (i == (nthreads - 1)) {
+                            // Main thread does the last chunk
+                            chunk_end = batch.size();
+                            partials.at(i).add_tree_descriptions_(
+                                    reader, batch,
+                                    chunk_start, chunk_end,
+                                    tree_index, source_index,
+                                    ultrametricity_tolerance, multiplier);
+                        }
+                        else {
+                            threads.push_back(std::async(
+                                    std::launch::async,
+                                    &TreeSample<NodeType>::add_tree_descriptions_,
+                                    &partials.at(i),
+                                    std::cref(reader),
+                                    std::cref(batch),
+                                    chunk_start,
+                                    chunk_end,
+                                    tree_index,
+                                    source_index,
+                                    ultrametricity_tolerance,
+                                    multiplier));
+                        }
+                    }
+                    for (auto & t : threads) {
+                        t.get();
+                    }
+                    for (auto const & partial : partials) {
+                        this->merge_samples_(partial);
+                    }
+                }
+                else {
+                    this->add_tree_descriptions_(reader, batch,
+                            start, batch.size(),
+                            tree_index, source_index,
+                            ultrametricity_tolerance, multiplier);
+                }
+#else
+                this->add_tree_descriptions_(reader, batch,
+                        start, batch.size(),
+                        tree_index, source_index,
+                        ultrametricity_tolerance, multiplier);
+#endif
+                tree_index += batch.size();
+            }
+        }
+
         void _annotate_nodes(
                 const TopologySamples & topo_sample,
                 std::shared_ptr<NodeType> root_node,
@@ -1020,6 +1324,44 @@ class TreeSample {
         }
 
 
+        /**
+         * Add trees from a binary tree log (see binlog.hpp). The trees are
+         * built directly from the stored topologies and heights, so no
+         * newick parsing is needed.
+         */
+        void add_binary_trees_(
+                const std::string & path,
+                const unsigned int skip = 0,
+                const double multiplier = -1.0) {
+            binlog::TreeLogReader<NodeType> reader(path);
+            unsigned int num_trees = reader.get_number_of_trees();
+            if (num_trees < 1) {
+                throw EcoevolityParsingError(
+                        "No trees found in binary tree log",
+                        path);
+            }
+
+            this->source_num_skipped_.push_back(skip);
+            unsigned int source_index = this->source_sample_sizes_.size();
+            this->source_sample_sizes_.push_back(0);
+
+            for (unsigned int i = skip; i < num_trees; ++i) {
+                tree_type t = reader.get_tree(i, multiplier);
+                this->_add_tree(t, i, source_index);
+            }
+            this->finish_adding_trees_();
+        }
+
+        void finish_adding_trees_() {
+            unsigned int source_total = 0;
+            for (unsigned int n : this->source_sample_sizes_) {
+                source_total += n;
+            }
+            ECOEVOLITY_ASSERT(source_total == this->sample_size_);
+            this->reverse_sort_samples_by_freq_();
+            this->update_constrained_node_parameters_();
+        }
+
     public:
 
         TreeSample() { }
@@ -1028,7 +1370,9 @@ class TreeSample {
                 const std::string & ncl_file_format,
                 const unsigned int skip = 0,
                 const double ultrametricity_tolerance = 1e-6,
-                const double multiplier = -1.0) {
+                const double multiplier = -1.0,
+                const unsigned int nthreads = 1) {
+            this->set_number_of_threads(nthreads);
             for (auto path : paths) {
                 this->add_trees(path, ncl_file_format, skip,
                         ultrametricity_tolerance,
@@ -1042,7 +1386,9 @@ class TreeSample {
                 const std::string & ncl_file_format,
                 const unsigned int skip = 0,
                 const double ultrametricity_tolerance = 1e-6,
-                const double multiplier = -1.0) {
+                const double multiplier = -1.0,
+                const unsigned int nthreads = 1) {
+            this->set_number_of_threads(nthreads);
             this->set_target_tree(target_tree_path, target_ncl_file_format);
             for (auto path : paths) {
                 this->add_trees(path, ncl_file_format, skip,
@@ -1058,7 +1404,18 @@ class TreeSample {
                 const double ultrametricity_tolerance = 1e-6,
                 const double multiplier = -1.0) {
             this->source_paths_.push_back(path);
-            std::ifstream in_stream;
+            if (binlog::is_binary_tree_log(path)) {
+                try {
+                    this->add_binary_trees_(path, skip, multiplier);
+                }
+                catch(...) {
+                    std::cerr << "ERROR: Problem parsing binary tree log path: "
+                            << path << "\n";
+                    throw;
+                }
+                return;
+            }
+            InputFileStream in_stream;
             in_stream.open(path);
             if (! in_stream.is_open()) {
                 throw EcoevolityParsingError(
@@ -1070,7 +1427,8 @@ class TreeSample {
                         ncl_file_format,
                         skip,
                         ultrametricity_tolerance,
-                        multiplier);
+                        multiplier,
+                        path);
             }
             catch(...) {
                 std::cerr << "ERROR: Problem parsing tree file path: "
@@ -1084,11 +1442,33 @@ class TreeSample {
                 const std::string & ncl_file_format,
                 const unsigned int skip = 0,
                 const double ultrametricity_tolerance = 1e-6,
-                const double multiplier = -1.0) {
+                const double multiplier = -1.0,
+                const std::string & path = "") {
             this->source_num_skipped_.push_back(skip);
             unsigned int source_index = this->source_sample_sizes_.size();
             this->source_sample_sizes_.push_back(0);
 
+            if (ncl_file_format == "nexus") {
+                // Stream trees from the file rather than reading the whole
+                // file into NCL
+                newick::NexusTreeReader reader(tree_stream, path);
+                unsigned int tree_index = 0;
+                // Skip burn in without parsing the trees
+                while ((tree_index < skip) && reader.skip_tree()) {
+                    ++tree_index;
+                }
+                this->add_trees_from_reader_(reader,
+                        tree_index,
+                        source_index,
+                        ultrametricity_tolerance,
+                        multiplier);
+                if (reader.get_number_of_trees_read() < 1) {
+                    throw EcoevolityError("No trees found in tree file");
+                }
+                this->finish_adding_trees_();
+                return;
+            }
+
             MultiFormatReader nexus_reader(-1, NxsReader::WARNINGS_TO_STDERR);
             try {
                 nexus_reader.ReadStream(tree_stream, ncl_file_format.c_str());
@@ -1117,14 +1497,14 @@ class TreeSample {
                 this->_add_tree(t, i, source_index);
             }
             nexus_reader.DeleteBlocksFromFactories();
+            this->finish_adding_trees_();
+        }
 
-            unsigned int source_total = 0;
-            for (unsigned int n : this->source_sample_sizes_) {
-                source_total += n;
-            }
-            ECOEVOLITY_ASSERT(source_total == this->sample_size_);
-            this->reverse_sort_samples_by_freq_();
-            this->update_constrained_node_parameters_();
+        void set_number_of_threads(unsigned int n) {
+            this->number_of_threads_ = n;
+        }
+        unsigned int get_number_of_threads() const {
+            return this->number_of_threads_;
         }
 
         void set_target_tree(
@@ -1190,6 +1570,11 @@ class TreeSample {
             ECOEVOLITY_ASSERT(root_sample->get_sample_size() == this->get_sample_size());
             return root_sample->get_source_indices();
         }
+        const std::vector<unsigned int> & get_tree_indices() const {
+            std::shared_ptr<SplitSamples> root_sample = this->get_split(this->root_split_);
+            ECOEVOLITY_ASSERT(root_sample->get_sample_size() == this->get_sample_size());
+            return root_sample->get_tree_indices();
+        }
 
         const std::vector<double> & get_tree_lengths() const {
             return this->tree_lengths_;
@@ -2328,6 +2713,124 @@ class TreeSample {
         }
 };
 
+
+/**
+ * The trees of each source (chain) of a TreeSample in which each non-trivial
+ * split occurs.
+ *
+ * This allows the average standard deviation of split frequencies (ASDSF) to
+ * be calculated after removing any number of trees from the beginning of
+ * each source as burn in, without re-reading the trees. Burn in is given as
+ * the index of the first tree in each source to include, so it must be no
+ * less than the burn in used to create the TreeSample.
+ */
+class BurninSplitFrequencies {
+    protected:
+        // Sorted indices of the trees in which each split occurs, by source
+        std::vector< std::vector< std::vector<unsigned int> > > split_tree_indices_;
+        // Sorted indices of all of the trees, by source
+        std::vector< std::vector<unsigned int> > tree_indices_;
+
+        static unsigned int count_(
+                const std::vector<unsigned int> & sorted_tree_indices,
+                const unsigned int burnin) {
+            return sorted_tree_indices.end() - std::lower_bound(
+                    sorted_tree_indices.begin(),
+                    sorted_tree_indices.end(),
+                    burnin);
+        }
+
+        static void sort_by_source_(
+                const std::vector<unsigned int> & source_indices,
+                const std::vector<unsigned int> & tree_indices,
+                std::vector< std::vector<unsigned int> > & tree_indices_by_source) {
+            ECOEVOLITY_ASSERT(source_indices.size() == tree_indices.size());
+            for (unsigned int i = 0; i < source_indices.size(); ++i) {
+                tree_indices_by_source.at(source_indices.at(i)).push_back(
+                        tree_indices.at(i));
+            }
+            for (auto & indices : tree_indices_by_source) {
+                std::sort(indices.begin(), indices.end());
+            }
+        }
+
+    public:
+        template <class NodeType>
+        BurninSplitFrequencies(const TreeSample<NodeType> & tree_sample) {
+            const unsigned int nsources = tree_sample.get_number_of_sources();
+            this->tree_indices_.resize(nsources);
+            sort_by_source_(tree_sample.get_source_indices(),
+                    tree_sample.get_tree_indices(),
+                    this->tree_indices_);
+            const std::vector< std::shared_ptr<SplitSamples> > & splits =
+                    tree_sample.get_non_trivial_splits();
+            this->split_tree_indices_.resize(splits.size(),
+                    std::vector< std::vector<unsigned int> >(nsources));
+            for (unsigned int i = 0; i < splits.size(); ++i) {
+                sort_by_source_(splits.at(i)->get_source_indices(),
+                        splits.at(i)->get_tree_indices(),
+                        this->split_tree_indices_.at(i));
+            }
+        }
+
+        unsigned int get_number_of_sources() const {
+            return this->tree_indices_.size();
+        }
+
+        unsigned int get_source_sample_size(
+                const unsigned int source_index,
+                const unsigned int burnin) const {
+            return count_(this->tree_indices_.at(source_index), burnin);
+        }
+
+        unsigned int get_sample_size(const unsigned int burnin) const {
+            unsigned int n = 0;
+            for (auto const & indices : this->tree_indices_) {
+                n += count_(indices, burnin);
+            }
+            return n;
+        }
+
+        SampleSummarizer<double> get_summary_of_split_freq_std_devs(
+                const double min_frequency,
+                const unsigned int burnin) const {
+            const unsigned int nsources = this->get_number_of_sources();
+            if (nsources < 2) {
+                throw EcoevolityError("Calculating the ASDSF requires multiple chains");
+            }
+            const double sample_size = this->get_sample_size(burnin);
+            SampleSummarizer<double> std_devs_of_split_freqs;
+            std::vector<unsigned int> split_counts(nsources, 0);
+            for (auto const & split_indices : this->split_tree_indices_) {
+                unsigned int total = 0;
+                for (unsigned int source_idx = 0; source_idx < nsources; ++source_idx) {
+                    split_counts.at(source_idx) = count_(
+                            split_indices.at(source_idx), burnin);
+                    total += split_counts.at(source_idx);
+                }
+                // Splits that only occur during burn in are not sampled
+                if ((total < 1) || ((total / sample_size) < min_frequency)) {
+                    continue;
+                }
+                SampleSummarizer<double> split_freqs;
+                for (unsigned int source_idx = 0; source_idx < nsources; ++source_idx) {
+                    split_freqs.add_sample(
+                            split_counts.at(source_idx) /
+                            (double)this->get_source_sample_size(source_idx, burnin));
+                }
+                std_devs_of_split_freqs.add_sample(split_freqs.std_dev());
+            }
+            return std_devs_of_split_freqs;
+        }
+
+        double get_average_std_dev_of_split_freqs(
+                const double min_frequency,
+                const unsigned int burnin) const {
+            return this->get_summary_of_split_freq_std_devs(
+                    min_frequency, burnin).mean();
+        }
+};
+
 } // treesum
 
 #endif
@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "ecoevolity/async_log_writer.hpp"
+
+#include <sstream>
+
+
+TEST_CASE("Testing AsyncLogStream writes everything in order",
+        "[AsyncLogStream]") {
+    SECTION("Testing with small buffers") {
+        std::ostringstream out;
+        std::ostringstream expected;
+        AsyncLogStream log(out, 7, 2);
+        for (unsigned int i = 0; i < 10000; ++i) {
+            log << i << "\t" << (i * 0.5) << std::endl;
+            expected << i << "\t" << (i * 0.5) << std::endl;
+        }
+        log << "END;";
+        expected << "END;";
+        log.close();
+        REQUIRE(out.str() == expected.str());
+
+        // Closing again does nothing
+        log.close();
+        REQUIRE(out.str() == expected.str());
+    }
+
+    SECTION("Testing with nothing logged") {
+        std::ostringstream out;
+        {
+            AsyncLogStream log(out);
+        }
+        REQUIRE(out.str() == "");
+    }
+
+    SECTION("Testing destructor writes the rest") {
+        std::ostringstream out;
+        {
+            AsyncLogStream log(out);
+            log << "a\nb\n";
+        }
+        REQUIRE(out.str() == "a\nb\n");
+    }
+}
+
+TEST_CASE("Testing AsyncLogStream copies formatting",
+        "[AsyncLogStream]") {
+    std::ostringstream out;
+    std::ostringstream expected;
+    out.precision(18);
+    expected.precision(18);
+    AsyncLogStream log(out);
+    REQUIRE(log.precision() == 18);
+    log << 0.1 << "\n";
+    expected << 0.1 << "\n";
+    log.close();
+    REQUIRE(out.str() == expected.str());
+}
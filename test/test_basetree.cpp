@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "ecoevolity/node.hpp"
 #include "ecoevolity/basetree.hpp"
+#include "ecoevolity/math_util.hpp"
 
 
 // NOTE: most tests of basetree.hpp are in test_tree.cpp. Starting this file
@@ -95,3 +96,87 @@ TEST_CASE("Testing BaseTree::get_min_height_diff", "[BaseTree]") {
         REQUIRE(tree.get_min_height_diff() == Approx(0.02));
     }
 }
+
+TEST_CASE("Testing BaseTree::draw_generalized_topology_from_prior", "[BaseTree]") {
+    SECTION("Testing 5 leaves") {
+        RandomNumberGenerator rng = RandomNumberGenerator(4829);
+
+        std::shared_ptr<ContinuousProbabilityDistribution> root_height_prior = std::make_shared<GammaDistribution>(
+                10.0,
+                0.1);
+
+        std::shared_ptr<Node> root = std::make_shared<Node>("root", 1.0);
+        for (unsigned int i = 0; i < 5; ++i) {
+            root->add_child(std::make_shared<Node>(i, "leaf" + std::to_string(i), 0.0));
+        }
+        BaseTree<Node> tree(root);
+        tree.set_root_node_height_prior(root_height_prior);
+        tree.estimate_root_height();
+
+        GeneralizedTreeCounts tree_counts(5);
+        unsigned int nsamples = 30000;
+        std::map< std::set< std::set<Split> >, unsigned int> split_counts;
+        for (unsigned int i = 0; i < nsamples; ++i) {
+            tree.draw_generalized_topology_from_prior(rng, tree_counts);
+            tree.draw_from_prior(rng);
+
+            REQUIRE(tree.get_leaf_node_count() == 5);
+            REQUIRE(tree.get_root_ptr() == root);
+            REQUIRE(tree.get_root_height() > 0.0);
+            for (unsigned int j = 1; j < tree.get_number_of_node_heights(); ++j) {
+                REQUIRE(tree.get_height(j) > tree.get_height(j - 1));
+            }
+            unsigned int number_of_internal_nodes = 0;
+            for (unsigned int j = 0; j < tree.get_number_of_node_heights(); ++j) {
+                for (auto node : tree.get_mapped_nodes(j)) {
+                    ++number_of_internal_nodes;
+                    REQUIRE(node->get_number_of_children() > 1);
+                    if (node->has_parent()) {
+                        REQUIRE(node->get_height() < node->get_parent()->get_height());
+                    }
+                }
+            }
+            REQUIRE(number_of_internal_nodes < 5);
+            ++split_counts[tree.get_splits(true)];
+        }
+
+        REQUIRE(split_counts.size() == 336);
+        double exp_count = nsamples / 336.0;
+        double chi_sq_test_statistic = 0.0;
+        for (auto s_c : split_counts) {
+            double count_diff = s_c.second - exp_count;
+            chi_sq_test_statistic += (count_diff * count_diff) / exp_count;
+        }
+        REQUIRE(chi_sq_test_statistic < chi_square_quantile(0.999, 335));
+    }
+}
+
+TEST_CASE("Testing BaseTree::draw_bifurcating_topology_from_prior", "[BaseTree]") {
+    SECTION("Testing 4 leaves") {
+        RandomNumberGenerator rng = RandomNumberGenerator(4830);
+
+        std::shared_ptr<Node> root = std::make_shared<Node>("root", 1.0);
+        for (unsigned int i = 0; i < 4; ++i) {
+            root->add_child(std::make_shared<Node>(i, "leaf" + std::to_string(i), 0.0));
+        }
+        BaseTree<Node> tree(root);
+
+        unsigned int nsamples = 15000;
+        std::map< std::set<Split>, unsigned int> split_counts;
+        for (unsigned int i = 0; i < nsamples; ++i) {
+            tree.draw_bifurcating_topology_from_prior(rng);
+            REQUIRE(tree.get_number_of_node_heights() == 3);
+            std::set<Split> splits;
+            for (auto height_splits : tree.get_splits(true)) {
+                REQUIRE(height_splits.size() == 1);
+                splits.insert(height_splits.begin(), height_splits.end());
+            }
+            ++split_counts[splits];
+        }
+
+        REQUIRE(split_counts.size() == 15);
+        for (auto s_c : split_counts) {
+            REQUIRE(std::abs((s_c.second / (double)nsamples) - (1.0 / 15.0)) < 0.01);
+        }
+    }
+}
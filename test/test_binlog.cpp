@@ -0,0 +1,160 @@
+#include "catch.hpp"
+#include "ecoevolity/binlog.hpp"
+
+#include "ecoevolity/rng.hpp"
+#include "ecoevolity/path.hpp"
+#include "ecoevolity/node.hpp"
+#include "ecoevolity/treesum.hpp"
+
+RandomNumberGenerator _TEST_BINLOG_RNG = RandomNumberGenerator();
+
+TEST_CASE("Testing binary state log round trip", "[binlog]") {
+    SECTION("Testing binary state log round trip") {
+        std::string test_path = "data/tmp-" + _TEST_BINLOG_RNG.random_string(10) + ".log";
+        std::vector<std::string> header {"generation", "ln_likelihood", "number_of_events"};
+        std::ofstream out;
+        out.open(test_path, std::ios::out | std::ios::binary);
+        binlog::StateLogWriter writer(out);
+        writer.write_header(header);
+        for (unsigned int i = 0; i < 5; ++i) {
+            std::vector<double> row {(double)(i * 10), -1.0 / (i + 3.0), (double)(i % 3 + 1)};
+            writer.write_row(row);
+        }
+        std::vector<double> bad_row {1.0, 2.0};
+        REQUIRE_THROWS_AS(writer.write_row(bad_row), EcoevolityError &);
+        // Simulate an interrupted write
+        out.write("abc", 3);
+        out.close();
+
+        REQUIRE(binlog::is_binary_state_log(test_path));
+        REQUIRE(! binlog::is_binary_tree_log(test_path));
+        REQUIRE(! binlog::is_binary_state_log("data/4-tip-trees-12.nex"));
+
+        binlog::StateLogReader reader(test_path);
+        REQUIRE(reader.get_header() == header);
+        REQUIRE(reader.get_number_of_rows() == 5);
+        REQUIRE(reader.has_column("ln_likelihood"));
+        REQUIRE(! reader.has_column("ln_prior"));
+        REQUIRE_THROWS_AS(reader.get_column<double>("ln_prior"), EcoevolitySpreadsheetError &);
+
+        std::vector<double> lnl = reader.get_column<double>("ln_likelihood");
+        REQUIRE(lnl.size() == 5);
+        for (unsigned int i = 0; i < 5; ++i) {
+            REQUIRE(lnl.at(i) == -1.0 / (i + 3.0));
+        }
+        std::vector<int> nevents = reader.get_column<int>("number_of_events", 2);
+        std::vector<int> expected_nevents {3, 1, 2};
+        REQUIRE(nevents == expected_nevents);
+        REQUIRE(reader.get_value(4, 0) == 40.0);
+
+        std::remove(test_path.c_str());
+    }
+}
+
+TEST_CASE("Testing binary tree log round trip", "[binlog]") {
+    SECTION("Testing binary tree log round trip") {
+        typedef BaseTree<PopulationNode> TreeType;
+        std::string nex_path = "data/4-tip-trees-14-23-shared.nex";
+        std::string test_path = "data/tmp-" + _TEST_BINLOG_RNG.random_string(10) + ".log";
+        std::vector<TreeType> trees = get_trees<TreeType>(nex_path, "nexus");
+        REQUIRE(trees.size() == 6);
+
+        std::ofstream out;
+        out.open(test_path, std::ios::out | std::ios::binary);
+        binlog::TreeLogWriter<TreeType> writer(out);
+        writer.write_header(trees.at(0));
+        for (unsigned int i = 0; i < trees.size(); ++i) {
+            writer.log_tree(trees.at(i), i * 100);
+        }
+        out.close();
+        // The first three and last three trees share (ordered) topologies
+        REQUIRE(writer.get_number_of_topologies() == 2);
+
+        REQUIRE(binlog::is_binary_tree_log(test_path));
+        binlog::TreeLogReader<PopulationNode> reader(test_path);
+        REQUIRE(reader.get_number_of_trees() == 6);
+        REQUIRE(reader.get_number_of_topologies() == 2);
+        std::vector<std::string> expected_params {"pop_size"};
+        REQUIRE(reader.get_parameter_names() == expected_params);
+
+        for (unsigned int i = 0; i < trees.size(); ++i) {
+            REQUIRE(reader.get_generation(i) == i * 100);
+            TreeType t = reader.get_tree(i);
+            REQUIRE(t.get_node_heights() == trees.at(i).get_node_heights());
+            REQUIRE(t.get_splits_by_height_index(false) ==
+                    trees.at(i).get_splits_by_height_index(false));
+            REQUIRE(t.to_parentheses() == trees.at(i).to_parentheses());
+        }
+
+        TreeType scaled = reader.get_tree(0, 10.0);
+        REQUIRE(scaled.get_root_height() == Approx(4.0));
+
+        // Summaries of binary and nexus logs should match
+        treesum::TreeSample<PopulationNode> nex_sample;
+        nex_sample.add_trees(nex_path, "nexus", 1);
+        treesum::TreeSample<PopulationNode> bin_sample;
+        bin_sample.add_trees(test_path, "nexus", 1);
+        REQUIRE(bin_sample.get_sample_size() == 5);
+        REQUIRE(bin_sample.get_sample_size() == nex_sample.get_sample_size());
+        std::ostringstream nex_summary;
+        std::ostringstream bin_summary;
+        nex_sample.write_summary_of_topologies(nex_summary);
+        bin_sample.write_summary_of_topologies(bin_summary);
+        REQUIRE(bin_summary.str() == nex_summary.str());
+
+        std::remove(test_path.c_str());
+    }
+}
+
+TEST_CASE("Testing truncated binary tree log", "[binlog]") {
+    SECTION("Testing truncated binary tree log") {
+        typedef BaseTree<PopulationNode> TreeType;
+        std::string nex_path = "data/4-tip-trees-14-23-shared.nex";
+        std::string test_path = "data/tmp-" + _TEST_BINLOG_RNG.random_string(10) + ".log";
+        std::vector<TreeType> trees = get_trees<TreeType>(nex_path, "nexus");
+        REQUIRE(trees.size() == 6);
+
+        std::ostringstream out;
+        binlog::TreeLogWriter<TreeType> writer(out);
+        writer.write_header(trees.at(0));
+        std::size_t header_size = out.str().size();
+        std::vector<std::size_t> sample_ends;
+        for (unsigned int i = 0; i < trees.size(); ++i) {
+            writer.log_tree(trees.at(i), i * 100);
+            sample_ends.push_back(out.str().size());
+        }
+        std::string bytes = out.str();
+
+        // Cut the log at every byte after the header; only complete
+        // samples should be indexed
+        for (std::size_t len = header_size; len <= bytes.size(); ++len) {
+            std::ofstream trunc_out;
+            trunc_out.open(test_path, std::ios::out | std::ios::binary);
+            trunc_out.write(bytes.data(), len);
+            trunc_out.close();
+            binlog::TreeLogReader<PopulationNode> reader(test_path);
+            unsigned int expected_ntrees = 0;
+            for (auto const & end : sample_ends) {
+                if (end <= len) {
+                    ++expected_ntrees;
+                }
+            }
+            REQUIRE(reader.get_number_of_trees() == expected_ntrees);
+            for (unsigned int i = 0; i < expected_ntrees; ++i) {
+                REQUIRE(reader.get_generation(i) == i * 100);
+                REQUIRE(reader.get_tree(i).get_node_heights() ==
+                        trees.at(i).get_node_heights());
+            }
+        }
+
+        // A truncated header is still an error
+        std::ofstream trunc_out;
+        trunc_out.open(test_path, std::ios::out | std::ios::binary);
+        trunc_out.write(bytes.data(), header_size - 1);
+        trunc_out.close();
+        REQUIRE_THROWS_AS(binlog::TreeLogReader<PopulationNode> reader(test_path),
+                EcoevolityParsingError &);
+
+        std::remove(test_path.c_str());
+    }
+}
@@ -0,0 +1,200 @@
+#include "catch.hpp"
+#include "ecoevolity/compressed_stream.hpp"
+
+#include <sstream>
+
+#include "ecoevolity/rng.hpp"
+#include "ecoevolity/path.hpp"
+#include "ecoevolity/data.hpp"
+#include "ecoevolity/spreadsheet.hpp"
+
+RandomNumberGenerator _TEST_COMPRESSED_STREAM_RNG = RandomNumberGenerator();
+
+
+TEST_CASE("Testing compression by extension", "[compressed_stream]") {
+    REQUIRE(compressed_stream::get_compression("dir/log.txt") ==
+            compressed_stream::Compression::none);
+    REQUIRE(compressed_stream::get_compression("dir/log") ==
+            compressed_stream::Compression::none);
+    REQUIRE(compressed_stream::get_compression("dir/log.txt.gz") ==
+            compressed_stream::Compression::gzip);
+    REQUIRE(compressed_stream::get_compression("dir/log.txt.zst") ==
+            compressed_stream::Compression::zstd);
+
+    std::pair<std::string, std::string> p =
+            compressed_stream::split_compression_extension("dir/log-run-1.log.gz");
+    REQUIRE(p.first == "dir/log-run-1.log");
+    REQUIRE(p.second == ".gz");
+    p = compressed_stream::split_compression_extension("dir/log-run-1.log");
+    REQUIRE(p.first == "dir/log-run-1.log");
+    REQUIRE(p.second == "");
+
+    REQUIRE(compressed_stream::is_supported(compressed_stream::Compression::none));
+    REQUIRE(! compressed_stream::is_supported(compressed_stream::Compression::zstd));
+    OutputFileStream out;
+    REQUIRE_THROWS_AS(out.open("data/tmp.txt.zst"), EcoevolityError &);
+    REQUIRE(! path::exists("data/tmp.txt.zst"));
+}
+
+TEST_CASE("Testing uncompressed file streams", "[compressed_stream]") {
+    std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+    std::string test_path = "data/tmp-" + tag + "-plain.txt";
+    OutputFileStream out(test_path);
+    REQUIRE(out.is_open());
+    out << "a\tb\n1\t2\n";
+    out.close();
+    REQUIRE(out);
+
+    std::ifstream plain_in(test_path);
+    std::stringstream plain_text;
+    plain_text << plain_in.rdbuf();
+    REQUIRE(plain_text.str() == "a\tb\n1\t2\n");
+
+    InputFileStream in(test_path);
+    REQUIRE(in.is_open());
+    std::stringstream text;
+    text << in.rdbuf();
+    REQUIRE(text.str() == "a\tb\n1\t2\n");
+
+    InputFileStream missing("data/tmp-" + tag + "-missing.txt");
+    REQUIRE(! missing.is_open());
+    REQUIRE(! missing);
+}
+
+#ifdef BUILD_WITH_ZLIB
+TEST_CASE("Testing gzip file streams", "[compressed_stream]") {
+
+    SECTION("Testing round trip") {
+        std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+        std::string test_path = "data/tmp-" + tag + "-log.txt.gz";
+        std::ostringstream expected;
+        OutputFileStream out(test_path);
+        REQUIRE(out.is_open());
+        out.precision(18);
+        expected.precision(18);
+        for (unsigned int i = 0; i < 100000; ++i) {
+            out << i << "\t" << (i * 0.1) << std::endl;
+            expected << i << "\t" << (i * 0.1) << std::endl;
+        }
+        out.close();
+        REQUIRE(out);
+
+        // The file is compressed
+        std::ifstream raw(test_path, std::ios::binary);
+        std::stringstream raw_text;
+        raw_text << raw.rdbuf();
+        REQUIRE(raw_text.str().size() < (expected.str().size() / 2));
+        REQUIRE((unsigned char)raw_text.str().at(0) == 0x1f);
+        REQUIRE((unsigned char)raw_text.str().at(1) == 0x8b);
+
+        InputFileStream in(test_path);
+        REQUIRE(in.is_open());
+        std::stringstream text;
+        text << in.rdbuf();
+        REQUIRE(text.str() == expected.str());
+
+        // Reopening reads from the start
+        in.open(test_path);
+        std::string line;
+        std::getline(in, line);
+        REQUIRE(line == "0\t0");
+    }
+
+    SECTION("Testing empty file") {
+        std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+        std::string test_path = "data/tmp-" + tag + "-empty.txt.gz";
+        {
+            OutputFileStream out(test_path);
+            REQUIRE(out.is_open());
+        }
+        REQUIRE(path::exists(test_path));
+        InputFileStream in(test_path);
+        REQUIRE(in.is_open());
+        std::stringstream text;
+        text << in.rdbuf();
+        REQUIRE(text.str() == "");
+    }
+
+    SECTION("Testing blocks and threads") {
+        std::stringstream expected;
+        for (unsigned int i = 0; i < 20000; ++i) {
+            expected << "line " << i << "\n";
+        }
+        std::vector<std::string> outputs;
+        for (unsigned int nthreads : {1, 3}) {
+            std::stringbuf compressed;
+            compressed_stream::GzipOutputBuffer buffer(compressed, nthreads,
+                    Z_DEFAULT_COMPRESSION, 1000);
+            std::ostream out(&buffer);
+            out << expected.str();
+            out.flush();
+            buffer.close();
+            outputs.push_back(compressed.str());
+        }
+        // The output does not depend on the number of threads
+        REQUIRE(outputs.at(0) == outputs.at(1));
+
+        // Concatenated gzip members are read as one file
+        std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+        std::string test_path = "data/tmp-" + tag + "-blocks.txt.gz";
+        std::ofstream raw(test_path, std::ios::binary);
+        raw << outputs.at(0);
+        raw.close();
+        InputFileStream in(test_path);
+        std::stringstream text;
+        text << in.rdbuf();
+        REQUIRE(text.str() == expected.str());
+    }
+
+    SECTION("Testing spreadsheet") {
+        std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+        std::string test_path = "data/tmp-" + tag + "-state.log.gz";
+        OutputFileStream out(test_path);
+        out << "generation\tvalue\n0\t1.5\n10\t2.5\n";
+        out.close();
+
+        spreadsheet::Spreadsheet s;
+        s.update(test_path);
+        REQUIRE(s.get<unsigned int>("generation") == std::vector<unsigned int>({0, 10}));
+        REQUIRE(s.get<double>("value") == std::vector<double>({1.5, 2.5}));
+    }
+
+    SECTION("Testing biallelic data") {
+        BiallelicData data("data/diploid-dna-constant-missing.nex");
+        std::string tag = _TEST_COMPRESSED_STREAM_RNG.random_string(10);
+        for (bool nexus : {true, false}) {
+            std::string ext = nexus ? ".nex" : ".yml";
+            std::string plain_path = "data/tmp-" + tag + "-data" + ext;
+            std::string gzip_path = plain_path + ".gz";
+            OutputFileStream plain_out(plain_path);
+            OutputFileStream gzip_out(gzip_path);
+            if (nexus) {
+                data.write_nexus(plain_out, ' ');
+                data.write_nexus(gzip_out, ' ');
+            }
+            else {
+                data.write_yaml(plain_out);
+                data.write_yaml(gzip_out);
+            }
+            plain_out.close();
+            gzip_out.close();
+
+            BiallelicData plain_data;
+            BiallelicData gzip_data;
+            if (nexus) {
+                plain_data.init(plain_path, ' ', true, false);
+                gzip_data.init(gzip_path, ' ', true, false);
+            }
+            else {
+                plain_data.init_from_yaml_path(plain_path);
+                gzip_data.init_from_yaml_path(gzip_path);
+            }
+            REQUIRE(gzip_data.get_number_of_patterns() > 0);
+            REQUIRE(gzip_data.get_number_of_patterns() == plain_data.get_number_of_patterns());
+            REQUIRE(gzip_data.get_allele_count_matrix() == plain_data.get_allele_count_matrix());
+            REQUIRE(gzip_data.get_red_allele_count_matrix() == plain_data.get_red_allele_count_matrix());
+            REQUIRE(gzip_data.get_pattern_weights() == plain_data.get_pattern_weights());
+        }
+    }
+}
+#endif
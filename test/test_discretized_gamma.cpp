@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "ecoevolity/discretized_gamma.hpp"
+
+TEST_CASE("Testing DiscretizedGamma", "[DiscretizedGamma]") {
+
+    SECTION("Testing category means") {
+        for (double shape : {0.5, 1.0, 4.0, 20.0}) {
+            for (unsigned int ncats : {1, 2, 4, 8}) {
+                DiscretizedGamma g(shape, 0.01 / shape, ncats);
+                REQUIRE(g.get_num_categories() == ncats);
+                REQUIRE(g.get_mean() == Approx(0.01));
+                const std::vector<double> & q = g.get_quantiles();
+                REQUIRE(q.size() == ncats);
+                double sum = 0.0;
+                for (unsigned int i = 0; i < q.size(); ++i) {
+                    REQUIRE(q.at(i) > 0.0);
+                    if (i > 0) {
+                        REQUIRE(q.at(i) > q.at(i - 1));
+                    }
+                    sum += q.at(i);
+                }
+                REQUIRE(sum / ncats == Approx(0.01));
+            }
+        }
+    }
+
+    SECTION("Testing known values") {
+        // Category means of a gamma(shape = 0.5, mean = 1) with 4
+        // categories, as used for rate variation among sites (Yang 1994)
+        DiscretizedGamma g(0.5, 2.0, 4);
+        REQUIRE(g.get_quantile(0) == Approx(0.0334).epsilon(0.001));
+        REQUIRE(g.get_quantile(1) == Approx(0.2519).epsilon(0.001));
+        REQUIRE(g.get_quantile(2) == Approx(0.8203).epsilon(0.001));
+        REQUIRE(g.get_quantile(3) == Approx(2.8944).epsilon(0.001));
+    }
+
+    SECTION("Testing changing parameters") {
+        DiscretizedGamma g(2.0, 0.5, 4);
+        std::vector<double> q = g.get_quantiles();
+        g.store();
+        g.set_shape_preserve_mean(8.0);
+        REQUIRE(g.get_mean() == Approx(1.0));
+        REQUIRE(g.get_quantile(0) > q.at(0));
+        REQUIRE(g.get_quantile(3) < q.at(3));
+        g.restore();
+        REQUIRE(g.get_shape() == 2.0);
+        REQUIRE(g.get_quantiles() == q);
+    }
+}
@@ -4148,6 +4148,232 @@ TEST_CASE("Testing PopSizeScaler with 3 leaves, unconstrained sizes, and optimiz
     }
 }
 
+TEST_CASE("Testing PopSizeMultipleTryScaler with 3 leaves, unconstrained sizes, and optimizing",
+        "[PopSizeMultipleTryScaler]") {
+
+    SECTION("Testing 3 leaves, unconstrained sizes, and optimizing") {
+        RandomNumberGenerator rng = RandomNumberGenerator(4);
+
+        double pop_size_shape = 10.0;
+        double pop_size_scale = 0.05;
+        std::shared_ptr<ContinuousProbabilityDistribution> pop_size_prior = std::make_shared<GammaDistribution>(
+                pop_size_shape,
+                pop_size_scale);
+
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(4, "root", 0.5);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(3, "internal0", 0.25);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf0", 0.0);
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf1", 0.0);
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf2", 0.0);
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        root->add_child(internal0);
+        root->add_child(leaf2);
+
+        BasePopulationTree tree(root);
+
+        tree.ignore_data();
+        tree.fix_root_height();
+
+        tree.set_population_size_prior(pop_size_prior);
+
+        PopSizeMultipleTryScaler op;
+        op.set_number_of_tries(3);
+        op.turn_on_auto_optimize();
+        op.set_auto_optimize_delay(100);
+
+        REQUIRE(op.get_number_of_tries() == 3);
+        REQUIRE(op.auto_optimizing());
+        REQUIRE(op.get_auto_optimize_delay() == 100);
+
+        // Initialize prior probs
+        tree.compute_log_likelihood_and_prior(true);
+
+        std::vector< std::shared_ptr<PositiveRealParameter> > pop_sizes = tree.get_pointers_to_population_sizes();
+        REQUIRE(pop_sizes.size() == 5);
+        std::vector<SampleSummarizer<double> > pop_size_summaries(pop_sizes.size());
+
+
+        unsigned int niterations = 100000;
+        unsigned int sample_freq = 5;
+        unsigned int nsamples = niterations / sample_freq;
+        for (unsigned int i = 0; i < niterations; ++i) {
+            op.operate(rng, &tree, 1, 5);
+            if ((i + 1) % sample_freq == 0) {
+                pop_sizes = tree.get_pointers_to_population_sizes();
+                REQUIRE(pop_sizes.size() == 5);
+                for (unsigned int i = 0; i < pop_sizes.size(); ++i) {
+                    pop_size_summaries.at(i).add_sample(pop_sizes.at(i)->get_value());
+                }
+            }
+        }
+        std::cout << op.header_string();
+        std::cout << op.to_string();
+
+        REQUIRE(op.get_number_of_attempts() == (niterations * 5));
+        REQUIRE(op.get_number_of_attempts_for_correction() == ((niterations * 5) - 100));
+
+        double eps = 0.01;
+        for (unsigned int i = 0; i < pop_size_summaries.size(); ++i) {
+            REQUIRE(pop_size_summaries.at(i).sample_size() == nsamples);
+            REQUIRE(pop_size_summaries.at(i).mean() == Approx(pop_size_prior->get_mean()).epsilon(eps));
+            REQUIRE(pop_size_summaries.at(i).variance() == Approx(pop_size_prior->get_variance()).epsilon(eps * 2.0));
+        }
+    }
+}
+
+TEST_CASE("Testing NodeHeightMultipleTryScaler with 5 leaf ladder and optimizing",
+        "[NodeHeightMultipleTryScaler]") {
+
+    SECTION("Testing 5 leaf ladder optimizing") {
+        RandomNumberGenerator rng = RandomNumberGenerator(164651453);
+
+        double root_height_shape = 10.0;
+        double root_height_scale = 0.05;
+        std::shared_ptr<ContinuousProbabilityDistribution> root_height_prior = std::make_shared<GammaDistribution>(
+                root_height_shape,
+                root_height_scale);
+
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(8, "root", 0.5);
+        std::shared_ptr<PopulationNode> internal2 = std::make_shared<PopulationNode>(7, "internal2", 0.4);
+        std::shared_ptr<PopulationNode> internal1 = std::make_shared<PopulationNode>(6, "internal1", 0.3);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(5, "internal0", 0.2);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf0", 0.0);
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf1", 0.0);
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf2", 0.0);
+        std::shared_ptr<PopulationNode> leaf3 = std::make_shared<PopulationNode>(3, "leaf3", 0.0);
+        std::shared_ptr<PopulationNode> leaf4 = std::make_shared<PopulationNode>(4, "leaf4", 0.0);
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        internal1->add_child(internal0);
+        internal1->add_child(leaf2);
+        internal2->add_child(internal1);
+        internal2->add_child(leaf3);
+        root->add_child(internal2);
+        root->add_child(leaf4);
+
+        BasePopulationTree tree(root);
+        tree.set_root_node_height_prior(root_height_prior);
+
+        tree.estimate_alpha_of_node_height_beta_prior();
+        tree.estimate_beta_of_node_height_beta_prior();
+        tree.set_alpha_of_node_height_beta_prior(4.0);
+        tree.set_beta_of_node_height_beta_prior(3.0);
+        tree.fix_alpha_of_node_height_beta_prior();
+        tree.fix_beta_of_node_height_beta_prior();
+
+        tree.ignore_data();
+        tree.estimate_root_height();
+        tree.fix_population_sizes();
+
+        NodeHeightMultipleTryScaler op;
+        op.set_number_of_tries(4);
+        op.turn_on_auto_optimize();
+        op.set_auto_optimize_delay(100);
+
+        REQUIRE(op.auto_optimizing());
+        REQUIRE(op.get_auto_optimize_delay() == 100);
+
+        // Initialize prior probs
+        tree.compute_log_likelihood_and_prior(true);
+
+        SampleSummarizer<double> internal_0_height_summary;
+        SampleSummarizer<double> internal_1_height_summary;
+        SampleSummarizer<double> internal_2_height_summary;
+
+        // burnin
+        unsigned int burnin = 1000;
+        for (unsigned int i = 0; i < burnin; ++i) {
+            op.operate(rng, &tree, 1, 1);
+        }
+
+        unsigned int niterations = 300000;
+        unsigned int sample_freq = 10;
+        unsigned int nsamples = niterations / sample_freq;
+        for (unsigned int i = 0; i < niterations; ++i) {
+            op.operate(rng, &tree, 1, 1);
+            if ((i + 1) % sample_freq == 0) {
+                internal_0_height_summary.add_sample(tree.get_height(0) / tree.get_height(1));
+                internal_1_height_summary.add_sample(tree.get_height(1) / tree.get_height(2));
+                internal_2_height_summary.add_sample(tree.get_height(2) / tree.get_height(3));
+                REQUIRE(tree.get_root_height() == 0.5);
+            }
+        }
+        std::cout << op.header_string();
+        std::cout << op.to_string();
+
+        BetaDistribution prior(4.0, 3.0);
+
+        REQUIRE(op.get_number_of_attempts() == niterations + burnin);
+        REQUIRE(op.get_number_of_attempts_for_correction() == (niterations + burnin - 100));
+
+        REQUIRE(internal_0_height_summary.sample_size() == nsamples);
+        REQUIRE(internal_1_height_summary.sample_size() == nsamples);
+        REQUIRE(internal_2_height_summary.sample_size() == nsamples);
+
+        double eps = 0.01;
+        REQUIRE(internal_0_height_summary.mean() == Approx(prior.get_mean()).epsilon(eps));
+        REQUIRE(internal_0_height_summary.variance() == Approx(prior.get_variance()).epsilon(eps * 2.0));
+        REQUIRE(internal_1_height_summary.mean() == Approx(prior.get_mean()).epsilon(eps));
+        REQUIRE(internal_1_height_summary.variance() == Approx(prior.get_variance()).epsilon(eps * 2.0));
+        REQUIRE(internal_2_height_summary.mean() == Approx(prior.get_mean()).epsilon(eps));
+        REQUIRE(internal_2_height_summary.variance() == Approx(prior.get_variance()).epsilon(eps * 2.0));
+    }
+}
+
+TEST_CASE("Testing NodeHeightMultipleTryScaler moves the tree to the selected value",
+        "[NodeHeightMultipleTryScaler]") {
+
+    SECTION("Testing accepted moves") {
+        RandomNumberGenerator rng = RandomNumberGenerator(2849);
+
+        std::shared_ptr<ContinuousProbabilityDistribution> root_height_prior = std::make_shared<GammaDistribution>(
+                10.0,
+                0.05);
+
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(4, "root", 0.5);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(3, "internal0", 0.2);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf0", 0.0);
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf1", 0.0);
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf2", 0.0);
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        root->add_child(internal0);
+        root->add_child(leaf2);
+
+        BasePopulationTree tree(root);
+        tree.set_root_node_height_prior(root_height_prior);
+        tree.ignore_data();
+        tree.fix_population_sizes();
+
+        NodeHeightMultipleTryScaler op;
+        op.set_number_of_tries(4);
+
+        tree.compute_log_likelihood_and_prior(true);
+
+        unsigned int number_of_moves = 0;
+        for (unsigned int i = 0; i < 200; ++i) {
+            double height = tree.get_height(0);
+            unsigned int number_accepted = op.get_number_accepted();
+            op.operate(rng, &tree, 1, 1);
+            if (op.get_number_accepted() > number_accepted) {
+                ++number_of_moves;
+                REQUIRE(tree.get_height(0) != height);
+            }
+            else {
+                REQUIRE(tree.get_height(0) == height);
+            }
+            // The stored prior belongs to the current state of the tree
+            double log_prior = tree.get_log_prior_density_value();
+            REQUIRE(tree.compute_log_prior_density() == Approx(log_prior));
+        }
+        REQUIRE(number_of_moves > 50);
+    }
+}
+
 TEST_CASE("Testing GlobalPopSizeScaler with 3 leaves, unconstrained sizes, and optimizing",
         "[GlobalPopSizeScaler]") {
 
@@ -529,3 +529,553 @@ TEST_CASE("Testing fixed tree BasePopulationTree config",
         REQUIRE(ops.size() == 0);
     }
 }
+
+TEST_CASE("Testing multiple-try operator config",
+        "[GeneralTreeOperatorSchedule]") {
+    SECTION("Testing multiple-try operators are only added if weighted") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        gamma_distribution:\n";
+        cfg_stream << "                            shape: 10.0\n";
+        cfg_stream << "                            mean: 0.1\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+
+        std::stringstream mtm_cfg_stream;
+        mtm_cfg_stream << cfg_stream.str();
+        mtm_cfg_stream << "mcmc_settings:\n";
+        mtm_cfg_stream << "    chain_length: 1000\n";
+        mtm_cfg_stream << "    sample_frequency: 10\n";
+        mtm_cfg_stream << "    operators:\n";
+        mtm_cfg_stream << "        NodeHeightMultipleTryScaler:\n";
+        mtm_cfg_stream << "            weight: 2.0\n";
+        mtm_cfg_stream << "            number_of_tries: 5\n";
+        mtm_cfg_stream << "        PopSizeMultipleTryScaler:\n";
+        mtm_cfg_stream << "            weight: 1.0\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings,
+                3); // number of leaves
+        REQUIRE(op_schedule.get_operators("NodeHeightMultipleTryScaler").empty());
+        REQUIRE(op_schedule.get_operators("PopSizeMultipleTryScaler").empty());
+
+        PopulationTreeSettings mtm_settings = PopulationTreeSettings(mtm_cfg_stream, cfg_path);
+        GeneralTreeOperatorSchedule<BasePopulationTree> mtm_op_schedule(
+                mtm_settings.operator_settings,
+                3); // number of leaves
+        std::vector< std::shared_ptr< GeneralTreeOperatorTemplate<BasePopulationTree> > > ops;
+        ops = mtm_op_schedule.get_operators("NodeHeightMultipleTryScaler");
+        REQUIRE(ops.size() == 1);
+        REQUIRE(ops.at(0)->get_weight() == 2.0);
+        REQUIRE(ops.at(0)->get_number_of_tries() == 5);
+        ops = mtm_op_schedule.get_operators("PopSizeMultipleTryScaler");
+        REQUIRE(ops.size() == 1);
+        REQUIRE(ops.at(0)->get_weight() == 1.0);
+        REQUIRE(ops.at(0)->get_number_of_tries() == 4);
+        ops = mtm_op_schedule.get_operators("NodeHeightScaler");
+        REQUIRE(ops.size() == 1);
+        REQUIRE(ops.at(0)->get_number_of_tries() == 1);
+
+        // Multiple-try moves keep the chain in sync with its likelihood
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BasePopulationTree tree(mtm_settings, rng);
+        tree.compute_log_likelihood_and_prior(1);
+        for (unsigned int i = 0; i < 200; ++i) {
+            mtm_op_schedule.draw_operator(rng)->operate_with_helpers(rng, &tree, 1, 1, 1);
+        }
+        double lnl = tree.get_log_likelihood_value();
+        tree.make_dirty();
+        tree.compute_log_likelihood_and_prior(1);
+        REQUIRE(tree.get_log_likelihood_value() == Approx(lnl));
+    }
+
+    SECTION("Testing number_of_tries of single-try operator") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+        cfg_stream << "mcmc_settings:\n";
+        cfg_stream << "    operators:\n";
+        cfg_stream << "        NodeHeightScaler:\n";
+        cfg_stream << "            number_of_tries: 3\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+        REQUIRE_THROWS_AS(
+                GeneralTreeOperatorSchedule<BasePopulationTree>(
+                        settings.operator_settings,
+                        3),
+                EcoevolityError &);
+    }
+}
+
+TEST_CASE("Testing operator costs", "[GeneralTreeOperatorSchedule]") {
+    SECTION("Testing operator costs and trace") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        gamma_distribution:\n";
+        cfg_stream << "                            shape: 10.0\n";
+        cfg_stream << "                            mean: 0.1\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BasePopulationTree tree(settings, rng);
+
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings,
+                tree.get_leaf_node_count());
+
+        std::string trace_path = "data/tmp-operator-trace-" + rng.random_string(10) + ".json";
+        std::shared_ptr<OperatorTraceWriter> trace = std::make_shared<OperatorTraceWriter>(trace_path);
+        op_schedule.set_operator_trace(trace);
+
+        tree.compute_log_likelihood_and_prior(1);
+        unsigned long long likelihood_calls_before = tree.get_model_cost().likelihood_calls;
+        // Work on another chain is not counted by this one
+        BasePopulationTree other_tree = tree;
+
+        unsigned int number_of_moves = 200;
+        for (unsigned int i = 0; i < number_of_moves; ++i) {
+            op_schedule.draw_operator(rng)->operate_with_helpers(rng, &tree, 1, 1, 1);
+            other_tree.make_dirty();
+            other_tree.compute_log_likelihood_and_prior(1);
+        }
+        unsigned long long likelihood_calls = tree.get_model_cost().likelihood_calls -
+                likelihood_calls_before;
+        REQUIRE(likelihood_calls > 0);
+
+        unsigned long long number_of_calls = 0;
+        unsigned long long op_likelihood_calls = 0;
+        unsigned long long op_patterns_evaluated = 0;
+        double wall_time = 0.0;
+        for (unsigned int i = 0; i < op_schedule.get_number_of_operators(); ++i) {
+            const OperatorStats & stats = op_schedule.get_operator(i)->get_stats();
+            number_of_calls += stats.get_number_of_calls();
+            op_likelihood_calls += stats.get_number_of_likelihood_calls();
+            op_patterns_evaluated += stats.get_number_of_patterns_evaluated();
+            wall_time += stats.get_wall_time();
+            REQUIRE(stats.get_store_restore_time() <= stats.get_wall_time());
+        }
+        // Each move and helper call is counted by exactly one operator
+        REQUIRE(number_of_calls >= number_of_moves);
+        REQUIRE(op_likelihood_calls == likelihood_calls);
+        REQUIRE(op_patterns_evaluated == likelihood_calls * tree.get_data().get_number_of_patterns());
+        REQUIRE(wall_time > 0.0);
+        REQUIRE(trace->get_number_of_events() == number_of_calls);
+
+        std::stringstream costs;
+        op_schedule.write_operator_costs(costs);
+        std::string line;
+        std::getline(costs, line);
+        REQUIRE(line == "name\tnumber_of_calls\twall_time\tcpu_time\tprop_wall_time\tmean_wall_time\tlikelihood_calls\tpatterns_evaluated\tstore_restore_time");
+        unsigned int number_of_lines = 0;
+        while (std::getline(costs, line)) {
+            ++number_of_lines;
+        }
+        REQUIRE(number_of_lines == op_schedule.get_number_of_operators());
+
+        trace->close();
+        std::ifstream trace_stream(trace_path);
+        std::stringstream trace_contents;
+        trace_contents << trace_stream.rdbuf();
+        std::string trace_str = trace_contents.str();
+        REQUIRE(trace_str.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [") == 0);
+        REQUIRE(trace_str.substr(trace_str.size() - 4) == "\n]}\n");
+        REQUIRE(trace_str.find("\"ph\": \"X\"") != std::string::npos);
+        std::remove(trace_path.c_str());
+    }
+}
+
+TEST_CASE("Testing operator weight adaptation", "[GeneralTreeOperatorSchedule]") {
+    SECTION("Testing operator weight adaptation") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        gamma_distribution:\n";
+        cfg_stream << "                            shape: 10.0\n";
+        cfg_stream << "                            mean: 0.1\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+        cfg_stream << "mcmc_settings:\n";
+        cfg_stream << "    chain_length: 1000\n";
+        cfg_stream << "    sample_frequency: 10\n";
+        cfg_stream << "    operator_weight_adaptation_generations: 100\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+        REQUIRE(settings.get_operator_weight_adaptation_generations() == 100);
+        REQUIRE(settings.to_string().find("operator_weight_adaptation_generations: 100\n") != std::string::npos);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(4321);
+        BasePopulationTree tree(settings, rng);
+
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings,
+                tree.get_leaf_node_count());
+        op_schedule.set_weight_adaptation_floor(0.1);
+
+        std::map<BaseGeneralTreeOperatorTemplate::OperatorScopeEnum, double> scope_weights;
+        std::vector<double> weights_before;
+        for (unsigned int i = 0; i < op_schedule.get_number_of_operators(); ++i) {
+            auto op = op_schedule.get_operator(i);
+            weights_before.push_back(op->get_weight());
+            scope_weights[op->get_scope()] += op->get_weight();
+        }
+        double total_weight = op_schedule.get_total_weight();
+
+        tree.compute_log_likelihood_and_prior(1);
+        REQUIRE(! op_schedule.adapting_weights());
+        op_schedule.start_weight_adaptation();
+        REQUIRE(op_schedule.adapting_weights());
+        for (unsigned int i = 0; i < 2000; ++i) {
+            op_schedule.perform_weight_adaptation_move(rng, &tree, 1);
+        }
+        op_schedule.stop_weight_adaptation();
+        REQUIRE(! op_schedule.adapting_weights());
+
+        bool changed = false;
+        std::map<BaseGeneralTreeOperatorTemplate::OperatorScopeEnum, double> adapted_scope_weights;
+        for (unsigned int i = 0; i < op_schedule.get_number_of_operators(); ++i) {
+            auto op = op_schedule.get_operator(i);
+            adapted_scope_weights[op->get_scope()] += op->get_weight();
+            REQUIRE(op->get_weight() >= 0.1 * weights_before.at(i) - 1e-12);
+            if (fabs(op->get_weight() - weights_before.at(i)) > 1e-9) {
+                changed = true;
+            }
+        }
+        REQUIRE(changed);
+        for (auto const & scope : scope_weights) {
+            REQUIRE(adapted_scope_weights[scope.first] == Approx(scope.second));
+        }
+        REQUIRE(op_schedule.get_total_weight() == Approx(total_weight));
+
+        std::stringstream summary;
+        op_schedule.write_weight_adaptation_summary(summary);
+        std::string line;
+        std::getline(summary, line);
+        REQUIRE(line == "name\tnumber_of_calls\tmean_wall_time\tefficiency\tweight_before\tweight_after");
+
+        std::stringstream bad_cfg_stream;
+        bad_cfg_stream << "---\n";
+        bad_cfg_stream << "mcmc_settings:\n";
+        bad_cfg_stream << "    chain_length: 1000\n";
+        bad_cfg_stream << "    operator_weight_adaptation_generations: 1000\n";
+        REQUIRE_THROWS_AS(PopulationTreeSettings(bad_cfg_stream, cfg_path),
+                EcoevolityYamlConfigError &);
+    }
+}
+
+TEST_CASE("Testing speculative moves", "[GeneralTreeOperatorSchedule]") {
+    SECTION("Testing speculative moves match serial moves") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        gamma_distribution:\n";
+        cfg_stream << "                            shape: 10.0\n";
+        cfg_stream << "                            mean: 0.1\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BasePopulationTree tree(settings, rng);
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings,
+                tree.get_leaf_node_count());
+
+        RandomNumberGenerator spec_rng = RandomNumberGenerator(1234);
+        BasePopulationTree spec_tree(settings, spec_rng);
+        GeneralTreeOperatorSchedule<BasePopulationTree> spec_op_schedule(
+                settings.operator_settings,
+                spec_tree.get_leaf_node_count());
+
+        tree.compute_log_likelihood_and_prior(1);
+        spec_tree.compute_log_likelihood_and_prior(1);
+        const ModelCost cost_before = tree.get_model_cost();
+        const ModelCost spec_cost_before = spec_tree.get_model_cost();
+
+        const unsigned int nmoves = 2000;
+        for (unsigned int i = 0; i < nmoves; ++i) {
+            op_schedule.draw_operator(rng)->operate_with_helpers(rng, &tree, 1, 1, 1);
+        }
+
+        unsigned int nbatches = 0;
+        unsigned int move_count = 0;
+        while (move_count < nmoves) {
+            unsigned int n = spec_op_schedule.perform_speculative_moves(spec_rng,
+                    &spec_tree,
+                    std::min(4u, nmoves - move_count));
+            REQUIRE(n > 0);
+            REQUIRE(n <= 4);
+            move_count += n;
+            ++nbatches;
+        }
+        REQUIRE(move_count == nmoves);
+        REQUIRE(nbatches < nmoves);
+
+        REQUIRE(spec_tree.get_log_likelihood_value() == tree.get_log_likelihood_value());
+        REQUIRE(spec_tree.get_log_prior_density_value() == tree.get_log_prior_density_value());
+        REQUIRE(spec_tree.to_parentheses(false) == tree.to_parentheses(false));
+        std::stringstream state;
+        std::stringstream spec_state;
+        tree.log_state(state, 0);
+        spec_tree.log_state(spec_state, 0);
+        REQUIRE(spec_state.str() == state.str());
+        std::stringstream rates;
+        std::stringstream spec_rates;
+        op_schedule.write_operator_rates(rates);
+        spec_op_schedule.write_operator_rates(spec_rates);
+        REQUIRE(spec_rates.str() == rates.str());
+        REQUIRE(spec_rng.uniform_real() == rng.uniform_real());
+
+        // The cost of every speculative proposal, including the evaluation
+        // of its likelihood, is counted by its operator, and each chain only
+        // counts its own work
+        ModelCost cost = tree.get_model_cost();
+        cost -= cost_before;
+        ModelCost spec_cost = spec_tree.get_model_cost();
+        spec_cost -= spec_cost_before;
+        unsigned long long op_likelihood_calls = 0;
+        unsigned long long spec_op_likelihood_calls = 0;
+        unsigned long long spec_op_patterns_evaluated = 0;
+        for (unsigned int i = 0; i < op_schedule.get_number_of_operators(); ++i) {
+            op_likelihood_calls += op_schedule.get_operator(
+                    i)->get_stats().get_number_of_likelihood_calls();
+            const OperatorStats & spec_stats = spec_op_schedule.get_operator(i)->get_stats();
+            spec_op_likelihood_calls += spec_stats.get_number_of_likelihood_calls();
+            spec_op_patterns_evaluated += spec_stats.get_number_of_patterns_evaluated();
+        }
+        REQUIRE(op_likelihood_calls == cost.likelihood_calls);
+        REQUIRE(spec_op_likelihood_calls == spec_cost.likelihood_calls);
+        REQUIRE(spec_op_patterns_evaluated == spec_cost.patterns_evaluated);
+        REQUIRE(spec_op_likelihood_calls >= op_likelihood_calls);
+
+        // The likelihood of a copy of the state does not depend on later
+        // changes to the tree
+        BasePopulationTree::LikelihoodState likelihood_state = tree.get_likelihood_state();
+        double lnl = tree.get_log_likelihood_value();
+        tree.set_root_height(tree.get_root_height() * 2.0);
+        tree.make_dirty();
+        tree.compute_log_likelihood_and_prior(1);
+        REQUIRE(tree.get_log_likelihood_value() != lnl);
+        REQUIRE(tree.compute_log_likelihood(likelihood_state, 1) == lnl);
+    }
+}
+
+TEST_CASE("Testing early rejection", "[GeneralTreeOperatorSchedule]") {
+    SECTION("Testing early rejection matches the usual moves") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        gamma_distribution:\n";
+        cfg_stream << "                            shape: 10.0\n";
+        cfg_stream << "                            mean: 0.1\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    alignment:\n";
+        cfg_stream << "        path: \"diploid-dna-constant-missing.nex\"\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BasePopulationTree tree(settings, rng);
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings,
+                tree.get_leaf_node_count());
+
+        RandomNumberGenerator early_rng = RandomNumberGenerator(1234);
+        BasePopulationTree early_tree(settings, early_rng);
+        GeneralTreeOperatorSchedule<BasePopulationTree> early_op_schedule(
+                settings.operator_settings,
+                early_tree.get_leaf_node_count());
+        early_op_schedule.set_early_rejection(true);
+
+        // Early rejection tunes operators differently, so the chains only
+        // match without tuning
+        std::vector<BaseGeneralTreeOperatorTemplate::OperatorScopeEnum> scopes = {
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::topology,
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::global,
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::node_height,
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::root_height,
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::branch,
+                BaseGeneralTreeOperatorTemplate::OperatorScopeEnum::hyper};
+        for (auto scope : scopes) {
+            for (auto op : op_schedule.get_operators(scope)) {
+                op->turn_off_auto_optimize();
+            }
+            for (auto op : early_op_schedule.get_operators(scope)) {
+                REQUIRE(op->rejecting_early());
+                op->turn_off_auto_optimize();
+            }
+        }
+
+        tree.compute_log_likelihood_and_prior(1);
+        early_tree.compute_log_likelihood_and_prior(1);
+
+        const unsigned int nmoves = 2000;
+        for (unsigned int i = 0; i < nmoves; ++i) {
+            op_schedule.draw_operator(rng)->operate_with_helpers(rng, &tree, 1, 1, 1);
+            early_op_schedule.draw_operator(early_rng)->operate_with_helpers(early_rng, &early_tree, 1, 1, 1);
+        }
+
+        REQUIRE(early_tree.get_log_likelihood_value() == tree.get_log_likelihood_value());
+        REQUIRE(early_tree.get_log_prior_density_value() == tree.get_log_prior_density_value());
+        REQUIRE(early_tree.to_parentheses(false) == tree.to_parentheses(false));
+        std::stringstream state;
+        std::stringstream early_state;
+        tree.log_state(state, 0);
+        early_tree.log_state(early_state, 0);
+        REQUIRE(early_state.str() == state.str());
+        std::stringstream rates;
+        std::stringstream early_rates;
+        op_schedule.write_operator_rates(rates);
+        early_op_schedule.write_operator_rates(early_rates);
+        REQUIRE(early_rates.str() == rates.str());
+        REQUIRE(early_rng.uniform_real() == rng.uniform_real());
+
+        // With a minimum above the log likelihood, the calculation stops
+        // early with an upper bound that is less than the minimum
+        double lnl = tree.get_log_likelihood_value();
+        tree.make_dirty();
+        REQUIRE(tree.compute_log_likelihood_with_minimum(lnl - 1.0, 1) == lnl);
+        double bound = tree.compute_log_likelihood_with_minimum(lnl + 1.0, 1);
+        REQUIRE(bound < lnl + 1.0);
+        REQUIRE(bound >= lnl);
+        REQUIRE(tree.get_log_likelihood_value() == bound);
+        double high_bound = tree.compute_log_likelihood_with_minimum(-1.0, 1);
+        REQUIRE(high_bound < -1.0);
+        REQUIRE(high_bound > lnl);
+    }
+
+    SECTION("Testing early rejection with a prior of zero") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "tree_model:\n";
+        cfg_stream << "    tree_space: \"generalized\"\n";
+        cfg_stream << "    starting_tree: \"random\"\n";
+        cfg_stream << "    tree_prior:\n";
+        cfg_stream << "        uniform_root_and_betas:\n";
+        cfg_stream << "            parameters:\n";
+        cfg_stream << "                root_height:\n";
+        cfg_stream << "                    value: 0.1\n";
+        cfg_stream << "                    estimate: true\n";
+        cfg_stream << "                    prior:\n";
+        cfg_stream << "                        uniform_distribution:\n";
+        cfg_stream << "                            min: 0.0\n";
+        cfg_stream << "                            max: 0.2\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    alignment:\n";
+        cfg_stream << "        path: \"diploid-dna-constant-missing.nex\"\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BasePopulationTree tree(settings, rng);
+        RootHeightScaler<BasePopulationTree> op(2.0);
+        op.set_early_rejection(true);
+
+        tree.compute_log_likelihood_and_prior(1);
+        double lnl = tree.get_log_likelihood_value();
+        tree.store_state();
+
+        // A state outside the support of the root height prior is rejected
+        // without computing its likelihood
+        tree.set_root_height(0.3);
+        REQUIRE(tree.is_dirty());
+        const ModelCost cost_before = tree.get_model_cost();
+        op.compute_log_likelihood_and_prior_for_early_rejection(&tree, std::log(0.5), 0.0, 1);
+        REQUIRE(tree.get_model_cost().likelihood_calls == cost_before.likelihood_calls);
+        REQUIRE(tree.get_log_prior_density_value() == -std::numeric_limits<double>::infinity());
+        REQUIRE(tree.get_log_likelihood_value() == lnl);
+        REQUIRE(! tree.is_dirty());
+
+        // A state within the support still has its likelihood computed
+        tree.set_root_height(0.15);
+        tree.make_dirty();
+        op.compute_log_likelihood_and_prior_for_early_rejection(&tree, std::log(0.5), 0.0, 1);
+        REQUIRE(tree.get_model_cost().likelihood_calls == cost_before.likelihood_calls + 1);
+        REQUIRE(std::isfinite(tree.get_log_prior_density_value()));
+    }
+}
@@ -121,6 +121,89 @@ TEST_CASE("Testing unconstrained", "[PopSizeSettings]") {
     }
 }
 
+TEST_CASE("Testing integrated pop sizes", "[PopSizeSettings]") {
+    SECTION("Testing integrated pop sizes") {
+        std::stringstream ss;
+        ss << "integrate: true\n";
+        ss << "number_of_categories: 6\n";
+        ss << "prior:\n";
+        ss << "    gamma_distribution:\n";
+        ss << "        shape: 2.0\n";
+        ss << "        mean: 0.1\n";
+
+        YAML::Node n;
+        n = YAML::Load(ss);
+        PopSizeSettings settings(n);
+
+        REQUIRE(settings.population_sizes_are_integrated());
+        REQUIRE(settings.get_number_of_categories() == 6);
+        std::string s = settings.to_string();
+        std::string e = (
+                "equal_population_sizes: true\n"
+                "integrate: true\n"
+                "number_of_categories: 6\n"
+                "prior:\n"
+                "    gamma_distribution:\n"
+                "        shape: 2\n"
+                "        scale: 0.05\n"
+                );
+        REQUIRE(s == e);
+
+        YAML::Node n2;
+        n2 = YAML::Load(s);
+        PopSizeSettings settings2(n2);
+        REQUIRE(settings2.to_string() == e);
+    }
+
+    SECTION("Testing integrated pop sizes with uniform prior") {
+        std::stringstream ss;
+        ss << "integrate: true\n";
+        ss << "prior:\n";
+        ss << "    uniform_distribution:\n";
+        ss << "        min: 0.0\n";
+        ss << "        max: 0.1\n";
+
+        YAML::Node n;
+        n = YAML::Load(ss);
+        REQUIRE_THROWS_AS(PopSizeSettings{n}, EcoevolityYamlConfigError &);
+    }
+
+    SECTION("Testing integrated pop sizes in tree") {
+        std::string cfg_path = "data/dummy.yml";
+
+        std::stringstream cfg_stream;
+        cfg_stream << "---\n";
+        cfg_stream << "data:\n";
+        cfg_stream << "    ploidy: 2\n";
+        cfg_stream << "    constant_sites_removed: false\n";
+        cfg_stream << "    yaml_allele_counts:\n";
+        cfg_stream << "        path: \"species-3-genomes-4-chars-1000.yml\"\n";
+        cfg_stream << "branch_parameters:\n";
+        cfg_stream << "    population_size:\n";
+        cfg_stream << "        equal_population_sizes: false\n";
+        cfg_stream << "        integrate: true\n";
+        cfg_stream << "        number_of_categories: 3\n";
+        cfg_stream << "        prior:\n";
+        cfg_stream << "            gamma_distribution:\n";
+        cfg_stream << "                shape: 5.0\n";
+        cfg_stream << "                mean: 0.002\n";
+
+        PopulationTreeSettings settings = PopulationTreeSettings(cfg_stream, cfg_path);
+        RandomNumberGenerator rng = RandomNumberGenerator(123);
+        BasePopulationTree tree(settings, rng);
+        REQUIRE(tree.population_sizes_are_integrated());
+        REQUIRE(tree.population_sizes_are_fixed());
+        REQUIRE(tree.get_population_size_multipliers().size() == 3);
+        REQUIRE(tree.get_root_population_size() == Approx(0.002));
+
+        GeneralTreeOperatorSchedule<BasePopulationTree> op_schedule(
+                settings.operator_settings, 3);
+        REQUIRE(op_schedule.get_operators("PopSizeScaler").empty());
+        REQUIRE(op_schedule.get_operators("GlobalPopSizeScaler").empty());
+        REQUIRE(op_schedule.get_operators("HeightSizeMixer").empty());
+    }
+}
+
 TEST_CASE("Testing PopulationTreeSettings with uniform_root_and_betas tree prior",
         "[PopulationTreeSettings]") {
     SECTION("Testing with uniform_root_and_betas tree prior") {
@@ -0,0 +1,138 @@
+#include "catch.hpp"
+#include "ecoevolity/generalized_tree_counts.hpp"
+#include "ecoevolity/math_util.hpp"
+
+#include <set>
+#include <map>
+
+
+/**
+ * The clades of a tree, grouped by the event (shared height) that created
+ * them, after checking that every lineage is used once and that the tree ends
+ * with a single root.
+ */
+inline std::set< std::set< std::set<unsigned int> > > get_clades_by_event(
+        const TreeEventSequence & tree_events,
+        unsigned int number_of_leaves) {
+    std::vector< std::set<unsigned int> > lineages;
+    for (unsigned int i = 0; i < number_of_leaves; ++i) {
+        lineages.push_back({i});
+    }
+    std::vector<bool> used(number_of_leaves, false);
+    std::set< std::set< std::set<unsigned int> > > clades_by_event;
+    for (auto event : tree_events) {
+        REQUIRE(event.size() > 0);
+        std::set< std::set<unsigned int> > event_clades;
+        for (auto group : event) {
+            REQUIRE(group.size() > 1);
+            std::set<unsigned int> clade;
+            for (auto lineage_index : group) {
+                REQUIRE(lineage_index < lineages.size());
+                REQUIRE(! used.at(lineage_index));
+                used.at(lineage_index) = true;
+                clade.insert(lineages.at(lineage_index).begin(),
+                        lineages.at(lineage_index).end());
+            }
+            event_clades.insert(clade);
+        }
+        for (auto clade : event_clades) {
+            lineages.push_back(clade);
+            used.push_back(false);
+        }
+        clades_by_event.insert(event_clades);
+    }
+    REQUIRE(lineages.back().size() == number_of_leaves);
+    REQUIRE(tree_events.back().size() == 1);
+    for (unsigned int i = 0; i < (used.size() - 1); ++i) {
+        REQUIRE(used.at(i));
+    }
+    REQUIRE(! used.back());
+    return clades_by_event;
+}
+
+TEST_CASE("Testing GeneralizedTreeCounts::get_number_of_trees",
+        "[GeneralizedTreeCounts]") {
+    // Checked by enumerating all sequences of events and removing duplicates
+    GeneralizedTreeCounts counts(8);
+    REQUIRE(counts.get_number_of_leaves() == 8);
+    REQUIRE(counts.get_number_of_trees(1) == 1.0);
+    REQUIRE(counts.get_number_of_trees(2) == 1.0);
+    REQUIRE(counts.get_number_of_trees(3) == 4.0);
+    REQUIRE(counts.get_number_of_trees(4) == 29.0);
+    REQUIRE(counts.get_number_of_trees(5) == 336.0);
+    REQUIRE(counts.get_number_of_trees(6) == 5627.0);
+    REQUIRE(counts.get_number_of_trees(7) == 127569.0);
+    REQUIRE(counts.get_number_of_trees(8) == 3741824.0);
+    REQUIRE(counts.get_number_of_trees() == 3741824.0);
+
+    GeneralizedTreeCounts large_counts(100);
+    REQUIRE(std::isfinite(large_counts.get_number_of_trees()));
+    REQUIRE(large_counts.get_number_of_trees(8) == 3741824.0);
+}
+
+TEST_CASE("Testing GeneralizedTreeCounts::draw_tree is uniform",
+        "[GeneralizedTreeCounts]") {
+    SECTION("Testing 5 leaves") {
+        RandomNumberGenerator rng = RandomNumberGenerator(111);
+        GeneralizedTreeCounts counts(5);
+        unsigned int nsamples = 50000;
+        std::map< std::set< std::set< std::set<unsigned int> > >, unsigned int> tree_counts;
+        for (unsigned int i = 0; i < nsamples; ++i) {
+            ++tree_counts[get_clades_by_event(counts.draw_tree(rng), 5)];
+        }
+        REQUIRE(tree_counts.size() == 336);
+        double exp_count = nsamples / 336.0;
+        double chi_sq_test_statistic = 0.0;
+        for (auto t_c : tree_counts) {
+            double count_diff = t_c.second - exp_count;
+            chi_sq_test_statistic += (count_diff * count_diff) / exp_count;
+        }
+        REQUIRE(chi_sq_test_statistic < chi_square_quantile(0.999, 335));
+    }
+
+    SECTION("Testing 2 and 40 leaves") {
+        RandomNumberGenerator rng = RandomNumberGenerator(112);
+        GeneralizedTreeCounts counts(2);
+        TreeEventSequence tree_events = counts.draw_tree(rng);
+        REQUIRE(tree_events.size() == 1);
+        REQUIRE(tree_events.at(0).size() == 1);
+        REQUIRE(tree_events.at(0).at(0) == std::vector<unsigned int>({0, 1}));
+
+        GeneralizedTreeCounts large_counts(40);
+        for (unsigned int i = 0; i < 100; ++i) {
+            get_clades_by_event(large_counts.draw_tree(rng), 40);
+        }
+    }
+}
+
+TEST_CASE("Testing draw_random_bifurcating_tree is uniform",
+        "[GeneralizedTreeCounts]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(113);
+    unsigned int nsamples = 30000;
+    std::map< std::set< std::set< std::set<unsigned int> > >, unsigned int> tree_counts;
+    for (unsigned int i = 0; i < nsamples; ++i) {
+        TreeEventSequence tree_events = draw_random_bifurcating_tree(rng, 5);
+        REQUIRE(tree_events.size() == 4);
+        for (auto event : tree_events) {
+            REQUIRE(event.size() == 1);
+            REQUIRE(event.at(0).size() == 2);
+        }
+        // Orders of unshared node heights are not part of the topology
+        std::set< std::set< std::set<unsigned int> > > clades_by_event =
+                get_clades_by_event(tree_events, 5);
+        std::set< std::set<unsigned int> > clades;
+        for (auto event_clades : clades_by_event) {
+            clades.insert(event_clades.begin(), event_clades.end());
+        }
+        ++tree_counts[{clades}];
+    }
+    // (2n - 3)!! rooted bifurcating trees
+    REQUIRE(tree_counts.size() == 105);
+    double exp_count = nsamples / 105.0;
+    double chi_sq_test_statistic = 0.0;
+    for (auto t_c : tree_counts) {
+        double count_diff = t_c.second - exp_count;
+        chi_sq_test_statistic += (count_diff * count_diff) / exp_count;
+    }
+    REQUIRE(chi_sq_test_statistic < chi_square_quantile(0.999, 104));
+}
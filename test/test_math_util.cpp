@@ -3,6 +3,10 @@
 #include "ecoevolity/math_util.hpp"
 #include "ecoevolity/stats_util.hpp"
 
+#ifdef BUILD_WITH_THREADS
+#include <future>
+#endif
+
 TEST_CASE("Testing n_choose_k_base overflow", "[math_util]") {
     SECTION("Testing overflow error") {
         // std::cout << "max int: " << std::numeric_limits<int>::max() << "\n";
@@ -1208,6 +1212,73 @@ TEST_CASE("Testing bell number functions", "[math_util]") {
     }
 }
 
+TEST_CASE("Testing log Stirling and Bell number tables", "[math_util]") {
+    SECTION("Testing against exact values") {
+        for (unsigned int n = 1; n <= 25; ++n) {
+            REQUIRE(ln_stirling2(n, 0) == -std::numeric_limits<double>::infinity());
+            for (unsigned int k = 1; k <= n; ++k) {
+                REQUIRE(ln_stirling2(n, k) == Approx(
+                        std::log((double)stirling2(n, k))).epsilon(1e-12));
+            }
+            REQUIRE(ln_bell_number(n) == Approx(
+                    std::log((double)bell_number(n))).epsilon(1e-12));
+        }
+        REQUIRE(ln_stirling2(0, 0) == 0.0);
+        REQUIRE(ln_bell_number(0) == 0.0);
+    }
+    SECTION("Testing beyond overflow limits") {
+        // S(n, 2) = 2^(n-1) - 1 and S(n, n-1) = n choose 2
+        for (unsigned int n : {100, 500, 3000}) {
+            REQUIRE(ln_stirling2(n, 2) == Approx((n - 1) * std::log(2.0)).epsilon(1e-12));
+            REQUIRE(ln_stirling2(n, n - 1) == Approx(ln_n_choose_k(n, 2)).epsilon(1e-12));
+            REQUIRE(std::abs(ln_stirling2(n, n)) < 1e-12);
+            REQUIRE(! std::isinf(ln_bell_number(n)));
+            REQUIRE(ln_bell_number(n) > ln_bell_number(n - 1));
+        }
+        REQUIRE(ln_bell_number(2229) > std::log(std::numeric_limits<long double>::max()));
+    }
+#ifdef BUILD_WITH_THREADS
+    SECTION("Testing tables of other threads") {
+        auto lookup = [](unsigned int n) {
+            std::vector<double> values;
+            for (unsigned int k = 1; k <= n; ++k) {
+                values.push_back(ln_stirling2(n, k));
+            }
+            values.push_back(ln_bell_number(n));
+            return values;
+        };
+        std::vector< std::future< std::vector<double> > > threads;
+        for (unsigned int t = 0; t < 4; ++t) {
+            threads.push_back(std::async(std::launch::async, lookup, 200 + t));
+        }
+        for (unsigned int t = 0; t < 4; ++t) {
+            REQUIRE(threads.at(t).get() == lookup(200 + t));
+        }
+    }
+#endif
+}
+
+TEST_CASE("Testing split-weighted priors with many elements", "[math_util]") {
+    unsigned int n = 400;
+    double w = 0.5;
+    std::vector<long double> probs = get_number_of_subset_probs(n, w);
+    long double total = 0.0;
+    for (unsigned int k = 1; k <= n; ++k) {
+        REQUIRE(probs.at(k - 1) >= 0.0);
+        total += probs.at(k - 1);
+        // Probability of a partition with k subsets times the number of
+        // such partitions
+        REQUIRE(std::log(probs.at(k - 1)) == Approx(ln_stirling2(n, k) +
+                get_uniform_model_log_prior_probability(n, k, w)).epsilon(1e-9));
+    }
+    REQUIRE(total == Approx(1.0).epsilon(1e-12));
+
+    // Ratios of the model prior only depend on the split weight
+    REQUIRE((get_uniform_model_log_prior_probability(n, 10, w) -
+            get_uniform_model_log_prior_probability(n, 9, w)) ==
+            Approx(std::log(w)));
+}
+
 TEST_CASE("Testing get_integer_partitions(2, 2)", "[math_util]") {
     SECTION("Testing get_integer_partitions") {
         std::vector< std::vector<unsigned int> > expected_partitions;
@@ -2221,6 +2292,104 @@ TEST_CASE("Testing get_pyp_log_prior_probability exchangeability with 6 elements
     }
 }
 
+inline void add_restricted_growth_strings(
+        std::vector<unsigned int> & partition,
+        unsigned int max_category,
+        std::vector< std::vector<unsigned int> > & partitions) {
+    if (partition.size() == partition.capacity()) {
+        partitions.push_back(partition);
+        return;
+    }
+    for (unsigned int i = 0; i <= (max_category + 1); ++i) {
+        partition.push_back(i);
+        add_restricted_growth_strings(partition, std::max(i, max_category),
+                partitions);
+        partition.pop_back();
+    }
+}
+
+// Brute-force probabilities of the number of categories by summing over all
+// set partitions
+inline std::vector<double> get_pyp_number_of_category_probs_by_enumeration(
+        unsigned int number_of_elements,
+        double concentration,
+        double discount) {
+    std::vector< std::vector<unsigned int> > partitions;
+    std::vector<unsigned int> partition;
+    partition.reserve(number_of_elements);
+    partition.push_back(0);
+    add_restricted_growth_strings(partition, 0, partitions);
+    REQUIRE(partitions.size() == bell_number(number_of_elements));
+    std::vector<double> probs(number_of_elements, 0.0);
+    for (auto const & p : partitions) {
+        unsigned int ncats = *std::max_element(p.begin(), p.end()) + 1;
+        probs.at(ncats - 1) += std::exp(get_pyp_log_prior_probability<unsigned int>(
+                p, concentration, discount));
+    }
+    return probs;
+}
+
+TEST_CASE("Testing get_dpp_log_number_of_category_probs against enumeration",
+        "[math_util]") {
+    for (double concentration : {0.3, 1.0, 7.5}) {
+        for (unsigned int n = 1; n < 8; ++n) {
+            std::vector<double> expected = get_pyp_number_of_category_probs_by_enumeration(
+                    n, concentration, 0.0);
+            std::vector<double> log_probs = get_dpp_log_number_of_category_probs(
+                    n, concentration);
+            REQUIRE(log_probs.size() == n);
+            double mean_ncats = 0.0;
+            for (unsigned int k = 0; k < n; ++k) {
+                REQUIRE(std::exp(log_probs.at(k)) == Approx(expected.at(k)).epsilon(1e-10));
+                mean_ncats += (k + 1) * std::exp(log_probs.at(k));
+            }
+            REQUIRE(mean_ncats == Approx(get_dpp_expected_number_of_categories(
+                    concentration, n)).epsilon(1e-10));
+        }
+    }
+}
+
+TEST_CASE("Testing get_pyp_log_number_of_category_probs against enumeration",
+        "[math_util]") {
+    for (double discount : {0.1, 0.5, 0.9}) {
+        for (double concentration : {0.2, 1.0, 7.5}) {
+            for (unsigned int n = 1; n < 8; ++n) {
+                std::vector<double> expected = get_pyp_number_of_category_probs_by_enumeration(
+                        n, concentration, discount);
+                std::vector<double> log_probs = get_pyp_log_number_of_category_probs(
+                        n, concentration, discount);
+                REQUIRE(log_probs.size() == n);
+                for (unsigned int k = 0; k < n; ++k) {
+                    REQUIRE(std::exp(log_probs.at(k)) == Approx(expected.at(k)).epsilon(1e-10));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Testing get_pyp_log_number_of_category_probs with many elements",
+        "[math_util]") {
+    unsigned int n = 2000;
+    double concentration = 3.0;
+    double discount = 0.25;
+    std::vector<double> log_probs = get_pyp_log_number_of_category_probs(
+            n, concentration, discount);
+    double total = 0.0;
+    double mean_ncats = 0.0;
+    for (unsigned int k = 0; k < n; ++k) {
+        REQUIRE(! std::isnan(log_probs.at(k)));
+        total += std::exp(log_probs.at(k));
+        mean_ncats += (k + 1) * std::exp(log_probs.at(k));
+    }
+    REQUIRE(total == Approx(1.0).epsilon(1e-9));
+    REQUIRE(mean_ncats == Approx(get_pyp_expected_number_of_categories(
+            concentration, discount, n)).epsilon(1e-8));
+    // All elements in one category
+    REQUIRE(log_probs.at(0) == Approx(
+            ln_pochhammer(1.0 - discount, n - 1) -
+            ln_pochhammer(concentration + 1.0, n - 1)).epsilon(1e-9));
+}
+
 // This test confirms that the elements of the weighted-discount process are
 // not exchangeable, so the Gibbs sampler will not work.
 // TEST_CASE("Testing get_wdp_log_prior_probability exchangeability with 6 elements sets of size 1, 2, 3",
@@ -0,0 +1,129 @@
+#include "catch.hpp"
+#include "ecoevolity/newick.hpp"
+
+#include "ecoevolity/node.hpp"
+#include "ecoevolity/basetree.hpp"
+#include "ecoevolity/treesum.hpp"
+
+TEST_CASE("Testing newick parsing", "[newick]") {
+    SECTION("Testing newick parsing") {
+        newick::ParsedTree tree;
+        newick::parse_tree(
+                "[&R] ((A:1.0,'b c'[&height=0]:1.0)[&height_index=0]:2.0,C_d:3.0);",
+                tree);
+        REQUIRE(tree.nodes.size() == 5);
+        REQUIRE(tree.get_number_of_leaves() == 3);
+        REQUIRE(tree.nodes.at(0).parent == -1);
+        REQUIRE(tree.nodes.at(0).children.size() == 2);
+        REQUIRE(tree.nodes.at(1).children.size() == 2);
+        REQUIRE(tree.nodes.at(1).length == 2.0);
+        REQUIRE(tree.nodes.at(1).comment_map.at("height_index") == "0");
+        REQUIRE(tree.nodes.at(2).label == "A");
+        REQUIRE(tree.nodes.at(3).label == "b c");
+        REQUIRE(tree.nodes.at(3).comment_map.at("height") == "0");
+        REQUIRE(tree.nodes.at(4).label == "C d");
+        REQUIRE(tree.nodes.at(4).parent == 0);
+
+        REQUIRE_THROWS_AS(newick::parse_tree("((A:1.0,B:1.0):1.0,C:2.0;", tree),
+                EcoevolityError &);
+    }
+}
+
+TEST_CASE("Testing nexus tree reader", "[newick]") {
+    SECTION("Testing nexus tree reader") {
+        std::stringstream nex;
+        nex << "#NEXUS\n"
+            << "[comment; with (punctuation)]\n"
+            << "BEGIN DATA;\n"
+            << "    MATRIX a 0 b 1;\n"
+            << "END;\n"
+            << "BEGIN TAXA;\n"
+            << "    DIMENSIONS NTAX=3;\n"
+            << "    TAXLABELS sp1 sp2 'sp 3';\n"
+            << "END;\n"
+            << "BEGIN TREES;\n"
+            << "    TRANSLATE 1 sp1, 2 sp2, 3 'sp 3';\n"
+            << "    TREE t0 = ((1:1,2:1):1,3:2);\n"
+            << "    TREE t1 = ((1:1,3:1):1,2:2);\n"
+            << "    tree t2 = ((sp1:1,sp2:1):1,x:2);\n"
+            << "END;\n";
+        newick::NexusTreeReader reader(nex);
+        REQUIRE(reader.skip_tree());
+        newick::ParsedTree tree;
+        REQUIRE(reader.next_tree(tree));
+        REQUIRE(reader.get_number_of_trees_read() == 2);
+        REQUIRE(tree.nodes.at(2).label == "sp1");
+        REQUIRE(tree.nodes.at(3).label == "sp 3");
+        REQUIRE(tree.nodes.at(4).label == "sp2");
+        std::vector<std::string> expected_labels {"sp1", "sp2", "sp 3"};
+        REQUIRE(reader.get_taxon_labels() == expected_labels);
+        REQUIRE_THROWS_AS(reader.next_tree(tree), EcoevolityParsingError &);
+        REQUIRE(! reader.next_tree(tree));
+    }
+}
+
+TEST_CASE("Testing streamed trees match NCL trees", "[newick]") {
+    SECTION("Testing streamed trees match NCL trees") {
+        typedef BaseTree<PopulationNode> TreeType;
+        std::vector<std::string> paths {
+                "data/4-tip-trees-14-23-shared.nex",
+                "data/9-tip-gen-trees.nex",
+                "data/5-tip-trees-comb.nex"};
+        for (auto const & path : paths) {
+            std::vector<TreeType> ncl_trees = get_trees<TreeType>(path, "nexus");
+            std::ifstream in_stream;
+            in_stream.open(path);
+            newick::NexusTreeReader reader(in_stream, path);
+            newick::ParsedTree parsed_tree;
+            unsigned int i = 0;
+            while (reader.next_tree(parsed_tree)) {
+                TreeType t(parsed_tree);
+                REQUIRE(t.get_leaf_labels() == ncl_trees.at(i).get_leaf_labels());
+                REQUIRE(t.get_node_heights() == ncl_trees.at(i).get_node_heights());
+                REQUIRE(t.get_splits_by_height_index(false) ==
+                        ncl_trees.at(i).get_splits_by_height_index(false));
+                REQUIRE(t.to_parentheses() == ncl_trees.at(i).to_parentheses());
+                ++i;
+            }
+            REQUIRE(i == ncl_trees.size());
+        }
+    }
+}
+
+TEST_CASE("Testing tree sample with multiple threads", "[newick]") {
+    SECTION("Testing tree sample with multiple threads") {
+        std::vector<std::string> paths {
+                "data/4-tip-trees-14-23-shared.nex",
+                "data/4-tip-trees-12-34.nex",
+                "data/4-tip-trees-comb.nex"};
+        treesum::TreeSample<PopulationNode> serial(
+                "data/4-tip-target-tree-14-23-shared.nex",
+                paths,
+                "nexus",
+                "nexus",
+                1);
+        treesum::TreeSample<PopulationNode> threaded(
+                "data/4-tip-target-tree-14-23-shared.nex",
+                paths,
+                "nexus",
+                "nexus",
+                1,
+                1e-6,
+                -1.0,
+                3);
+        REQUIRE(threaded.get_number_of_threads() == 3);
+        REQUIRE(threaded.get_sample_size() == serial.get_sample_size());
+        REQUIRE(threaded.get_source_sample_sizes() == serial.get_source_sample_sizes());
+        std::ostringstream serial_summary;
+        std::ostringstream threaded_summary;
+        serial.write_summary_of_topologies(serial_summary);
+        serial.write_summary_of_heights(serial_summary);
+        serial.write_summary_of_splits(serial_summary);
+        serial.write_summary_of_target_tree(serial_summary);
+        threaded.write_summary_of_topologies(threaded_summary);
+        threaded.write_summary_of_heights(threaded_summary);
+        threaded.write_summary_of_splits(threaded_summary);
+        threaded.write_summary_of_target_tree(threaded_summary);
+        REQUIRE(threaded_summary.str() == serial_summary.str());
+    }
+}
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+#include "ecoevolity/partition_probs.hpp"
+
+
+TEST_CASE("Testing integrate_over_gamma of 1/(1+x) with exponential",
+        "[partition_probs]") {
+    // E[1 / (1 + x)] for x ~ Exp(1) is e * E_1(1)
+    double expected = 0.596347362323194;
+    auto get_probs = [](double x) {
+        return std::vector<long double>(1, 1.0 / (1.0 + x));
+    };
+    std::vector<long double> p = partition_probs::integrate_over_gamma(
+            1, 1.0, 1.0, get_probs, 1000, 1);
+    REQUIRE(p.size() == 1);
+    REQUIRE(p.at(0) == Approx(expected).epsilon(1e-4));
+
+    std::vector<long double> p4 = partition_probs::integrate_over_gamma(
+            1, 1.0, 1.0, get_probs, 1000, 4);
+    REQUIRE(p4.at(0) == Approx(p.at(0)).epsilon(1e-12));
+
+    // The bins are summed in the same order for any number of threads
+    for (unsigned int nthreads : {2, 3, 7}) {
+        std::vector<long double> pt = partition_probs::integrate_over_gamma(
+                1, 1.0, 1.0, get_probs, 1000, nthreads);
+        REQUIRE(pt.at(0) == p.at(0));
+    }
+}
+
+TEST_CASE("Testing get_pyp_number_of_category_probs with gamma concentration",
+        "[partition_probs]") {
+    SECTION("Testing two elements against the exact integral") {
+        // p(ncats = 1) = 1 / (1 + concentration)
+        std::vector<long double> p = partition_probs::get_pyp_number_of_category_probs(
+                2, 1.0, 0.0, 1.0, 1.0, 1000, 2);
+        REQUIRE(p.size() == 2);
+        REQUIRE(p.at(0) == Approx(0.596347362323194).epsilon(1e-4));
+        REQUIRE(p.at(0) + p.at(1) == Approx(1.0).epsilon(1e-12));
+    }
+
+    SECTION("Testing fixed concentration") {
+        std::vector<long double> p = partition_probs::get_pyp_number_of_category_probs(
+                10, 2.0, 0.3);
+        std::vector<double> log_p = get_pyp_log_number_of_category_probs(
+                10, 2.0, 0.3);
+        for (unsigned int i = 0; i < 10; ++i) {
+            REQUIRE(p.at(i) == Approx(std::exp(log_p.at(i))));
+        }
+    }
+
+    SECTION("Testing against simulations") {
+        unsigned int n = 8;
+        double shape = 2.0;
+        double scale = 1.5;
+        double discount = 0.2;
+        std::vector<long double> p = partition_probs::get_pyp_number_of_category_probs(
+                n, 1.0, discount, shape, scale, 1000, 1);
+
+        RandomNumberGenerator rng(123);
+        unsigned int nreps = 200000;
+        auto simulate = [n, shape, scale, discount](
+                RandomNumberGenerator & r,
+                std::vector<long double> & counts) {
+            std::vector<unsigned int> elements(n, 0);
+            unsigned int ncats = r.pitman_yor_process(elements,
+                    r.gamma(shape, scale), discount);
+            counts.at(ncats - 1) += 1.0;
+        };
+        std::vector<long double> counts = partition_probs::simulate_sums(
+                rng, n, nreps, simulate, 3);
+        long double total = 0.0;
+        for (unsigned int i = 0; i < n; ++i) {
+            total += counts.at(i);
+            REQUIRE(std::abs(counts.at(i) / nreps - p.at(i)) < 0.005);
+        }
+        REQUIRE(total == nreps);
+    }
+}
+
+TEST_CASE("Testing get_split_weight_number_of_subset_probs with gamma split weight",
+        "[partition_probs]") {
+    // With two elements, p(nsubsets = 1) = 1 / (1 + split_weight)
+    std::vector<long double> p = partition_probs::get_split_weight_number_of_subset_probs(
+            2, 1.0, 1.0, 1.0, 1000, 3);
+    REQUIRE(p.size() == 2);
+    REQUIRE(p.at(0) == Approx(0.596347362323194).epsilon(1e-4));
+    REQUIRE(p.at(0) + p.at(1) == Approx(1.0).epsilon(1e-12));
+
+    std::vector<long double> p_fixed = partition_probs::get_split_weight_number_of_subset_probs(
+            5, 2.0);
+    std::vector<long double> expected = get_number_of_subset_probs(5, 2.0);
+    for (unsigned int i = 0; i < 5; ++i) {
+        REQUIRE(p_fixed.at(i) == expected.at(i));
+    }
+}
+
+TEST_CASE("Testing simulate_sums with one thread uses rng directly",
+        "[partition_probs]") {
+    RandomNumberGenerator rng1(7);
+    RandomNumberGenerator rng2(7);
+    auto simulate = [](RandomNumberGenerator & r,
+            std::vector<long double> & sums) {
+        sums.at(0) += r.uniform_real();
+    };
+    std::vector<long double> sums = partition_probs::simulate_sums(
+            rng1, 1, 100, simulate, 1);
+    long double expected = 0.0;
+    for (unsigned int i = 0; i < 100; ++i) {
+        expected += rng2.uniform_real();
+    }
+    REQUIRE(sums.at(0) == expected);
+    REQUIRE(rng1.uniform_real() == rng2.uniform_real());
+}
@@ -0,0 +1,131 @@
+#include "catch.hpp"
+#include "ecoevolity/partitionsum.hpp"
+
+#include "ecoevolity/rng.hpp"
+
+RandomNumberGenerator _TEST_PARTITIONSUM_RNG = RandomNumberGenerator();
+
+TEST_CASE("Testing PartitionEncoder", "[partitionsum]") {
+    SECTION("Testing PartitionEncoder") {
+        partitionsum::PartitionEncoder encoder(20);
+        REQUIRE(encoder.get_number_of_elements() == 20);
+        REQUIRE(encoder.get_number_of_words() == 2);
+
+        partitionsum::PartitionEncoder::key_type key;
+        partitionsum::PartitionEncoder::key_type other_key;
+        std::vector<unsigned int> relabel;
+        std::vector<unsigned int> decoded;
+
+        std::vector<unsigned int> rgs(20);
+        for (unsigned int i = 0; i < 20; ++i) {
+            rgs.at(i) = i;
+        }
+        REQUIRE(encoder.encode(rgs, key, relabel) == 20);
+        encoder.decode(key, decoded);
+        REQUIRE(decoded == rgs);
+
+        std::vector<unsigned int> model {0, 1, 1, 2, 0, 3, 3, 1, 0, 4, 5, 5, 2, 6, 0, 7, 8, 1, 9, 0};
+        REQUIRE(encoder.encode(model, key, relabel) == 10);
+        encoder.decode(key, decoded);
+        REQUIRE(decoded == model);
+
+        // Relabeled subsets encode to the same key
+        std::vector<unsigned int> relabeled {4, 0, 0, 7, 4, 2, 2, 0, 4, 11, 5, 5, 7, 6, 4, 8, 9, 0, 1, 4};
+        REQUIRE(encoder.encode(relabeled, other_key, relabel) == 10);
+        REQUIRE(other_key == key);
+
+        model.at(19) = 9;
+        encoder.encode(model, other_key, relabel);
+        REQUIRE(other_key != key);
+    }
+}
+
+TEST_CASE("Testing PartitionSummarizer", "[partitionsum]") {
+    SECTION("Testing PartitionSummarizer") {
+        partitionsum::PartitionSummarizer summary(3);
+        REQUIRE(summary.add_sample(std::vector<unsigned int>({0, 0, 0})) == 1);
+        REQUIRE(summary.add_sample(std::vector<unsigned int>({0, 1, 1})) == 2);
+        REQUIRE(summary.add_sample(std::vector<int>({1, 0, 0})) == 2);
+        REQUIRE(summary.add_sample(std::vector<unsigned int>({0, 1, 2})) == 3);
+
+        REQUIRE(summary.get_number_of_samples() == 4);
+        REQUIRE(summary.get_number_of_partitions() == 3);
+        REQUIRE(summary.get_count({0, 1, 1}) == 2);
+        REQUIRE(summary.get_count({0, 0, 1}) == 0);
+        REQUIRE(summary.get_number_of_subsets_count(1) == 1);
+        REQUIRE(summary.get_number_of_subsets_count(2) == 2);
+        REQUIRE(summary.get_number_of_subsets_count(3) == 1);
+
+        std::vector< std::pair<std::vector<unsigned int>, unsigned int> > expected_counts {
+                {{0, 0, 0}, 1},
+                {{0, 1, 1}, 2},
+                {{0, 1, 2}, 1}};
+        REQUIRE(summary.get_partition_counts() == expected_counts);
+
+        REQUIRE(summary.get_pair_probability(0, 0) == 1.0);
+        REQUIRE(summary.get_pair_probability(0, 1) == 0.25);
+        REQUIRE(summary.get_pair_probability(2, 1) == 0.75);
+        REQUIRE(summary.get_pair_probability(0, 2) == 0.25);
+
+        std::ostringstream out;
+        summary.write_pair_probabilities(out, {"a", "b", "c"});
+        std::ostringstream expected;
+        expected << "comparison\ta\tb\tc\n"
+                 << "a\t1\t0.25\t0.25\n"
+                 << "b\t0.25\t1\t0.75\n"
+                 << "c\t0.25\t0.75\t1\n";
+        REQUIRE(out.str() == expected.str());
+    }
+}
+
+TEST_CASE("Testing stream_state_log_columns", "[partitionsum]") {
+    SECTION("Testing stream_state_log_columns") {
+        std::string test_path = "data/tmp-" + _TEST_PARTITIONSUM_RNG.random_string(10) + ".log";
+        std::ofstream out;
+        out.open(test_path);
+        out << "generation\tln_likelihood\troot_height_index_a\troot_height_index_b\n"
+            << "0\t-10.5\t0\t0\n"
+            << "10\t-9.5\t0\t1\n"
+            << "20\t-8.5\t0\t0\n";
+        out.close();
+
+        std::vector<std::vector<unsigned int> > rows;
+        std::vector<std::string> header = partitionsum::stream_state_log_columns(
+                {test_path, test_path},
+                {"root_height_index_b", "generation"},
+                1,
+                [&](const std::vector<unsigned int> & values) {
+                    rows.push_back(values);
+                });
+        REQUIRE(header.size() == 4);
+        REQUIRE(header == partitionsum::get_state_log_header(test_path));
+        std::vector<std::vector<unsigned int> > expected_rows {
+                {1, 10}, {0, 20}, {1, 10}, {0, 20}};
+        REQUIRE(rows == expected_rows);
+
+        REQUIRE_THROWS_AS(partitionsum::stream_state_log_columns(
+                    {test_path},
+                    {"root_height_index_c"},
+                    0,
+                    [&](const std::vector<unsigned int> & values) { }),
+                EcoevolitySpreadsheetError &);
+        REQUIRE_THROWS_AS(partitionsum::stream_state_log_columns(
+                    {test_path},
+                    {"ln_likelihood"},
+                    0,
+                    [&](const std::vector<unsigned int> & values) { }),
+                EcoevolitySpreadsheetError &);
+
+        out.open(test_path, std::ios::app);
+        out << "30\t-7.5\t0\n";
+        out.close();
+        REQUIRE_THROWS_AS(partitionsum::stream_state_log_columns(
+                    {test_path},
+                    {"root_height_index_a"},
+                    0,
+                    [&](const std::vector<unsigned int> & values) { }),
+                EcoevolityParsingError &);
+
+        std::remove(test_path.c_str());
+    }
+}
@@ -4,6 +4,9 @@
 #include "ecoevolity/rng.hpp"
 #include "ecoevolity/path.hpp"
 #include "ecoevolity/spreadsheet.hpp"
+#include "ecoevolity/prior_sampling.hpp"
+
+#include <sstream>
 
 RandomNumberGenerator _PRIOR_SAMPLING_RNG = RandomNumberGenerator();
 
@@ -6886,6 +6889,353 @@ TEST_CASE("Testing DPP with 3 pairs, fully parameterized, and 2 threads",
 }
 #endif
 
+TEST_CASE("Testing DPP with 3 pairs, fully parameterized, and sampling prior directly",
+        "[SamplingPrior]") {
+
+    SECTION("Testing --sample-prior-directly") {
+        double height_shape = 10.0;
+        double height_scale = 0.001;
+        double size1_shape = 10.0;
+        double size1_scale = 0.0001;
+        double size2_shape = 2.0;
+        double size2_scale = 0.001;
+        double size3_shape = 5.0;
+        double size3_scale = 0.0005;
+        double f1_a = 2.0;
+        double f1_b = 1.1;
+        double f2_a = 1.0;
+        double f2_b = 0.5;
+        double f3_a = 1.5;
+        double f3_b = 1.8;
+        double expected_f1_mean = f1_a / (f1_a + f1_b);
+        double expected_f1_variance = (f1_a * f1_b) / ((f1_a + f1_b) * (f1_a + f1_b) * (f1_a + f1_b + 1.0));
+        double expected_f2_mean = f2_a / (f2_a + f2_b);
+        double expected_f2_variance = (f2_a * f2_b) / ((f2_a + f2_b) * (f2_a + f2_b) * (f2_a + f2_b + 1.0));
+        double expected_f3_mean = f3_a / (f3_a + f3_b);
+        double expected_f3_variance = (f3_a * f3_b) / ((f3_a + f3_b) * (f3_a + f3_b) * (f3_a + f3_b + 1.0));
+        double mult2_shape = 100.0;
+        double mult2_scale = 0.005;
+        double mult3_shape = 100.0;
+        double mult3_scale = 0.02;
+        double concentration_shape = 5.0;
+        double concentration_scale = 0.2;
+        std::string auto_optimize = "true";
+        std::string tag = _PRIOR_SAMPLING_RNG.random_string(10);
+        std::string test_path = "data/tmp-config-" + tag + "-t508.cfg";
+        std::string log_path = "data/tmp-config-" + tag + "-t508-state-run-1.log";
+        std::ofstream os;
+        os.open(test_path);
+        os << "event_time_prior:\n";
+        os << "    gamma_distribution:\n";
+        os << "        shape: " << height_shape << "\n";
+        os << "        scale: " << height_scale << "\n";
+        os << "event_model_prior:\n";
+        os << "    dirichlet_process:\n";
+        os << "        parameters:\n";
+        os << "            concentration:\n";
+        os << "                estimate: true\n";
+        os << "                prior:\n";
+        os << "                    gamma_distribution:\n";
+        os << "                        shape: " << concentration_shape << "\n";
+        os << "                        scale: " << concentration_scale << "\n";
+        os << "mcmc_settings:\n";
+        os << "    chain_length: 500000\n";
+        os << "    sample_frequency: 10\n";
+        os << "operator_settings:\n";
+        os << "    auto_optimize: " << auto_optimize << "\n";
+        os << "    auto_optimize_delay: 10000\n";
+        os << "    operators:\n";
+        os << "        TimeRootSizeMixer:\n";
+        os << "            scale: 0.2\n";
+        os << "            weight: 0.0\n";
+        os << "        ModelOperator:\n";
+        os << "            number_of_auxiliary_categories: 5\n";
+        os << "            weight: 1.0\n";
+        os << "        ConcentrationScaler:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 1.0\n";
+        os << "        TimeSizeRateMixer:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 0.0\n";
+        os << "        EventTimeScaler:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 1.0\n";
+        os << "global_comparison_settings:\n";
+        os << "    operators:\n";
+        os << "        TimeRootSizeMixer:\n";
+        os << "            scale: 0.2\n";
+        os << "            weight: 0.0\n";
+        os << "        MutationRateScaler:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 1.0\n";
+        os << "        RootPopulationSizeScaler:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 1.0\n";
+        os << "        LeafPopulationSizeScaler:\n";
+        os << "            scale: 0.5\n";
+        os << "            weight: 1.0\n";
+        os << "        FreqMover:\n";
+        os << "            window: 0.1\n";
+        os << "            weight: 1.0\n";
+        os << "    genotypes_are_diploid: true\n";
+        os << "    markers_are_dominant: false\n";
+        os << "    population_name_delimiter: \" \"\n";
+        os << "    population_name_is_prefix: true\n";
+        os << "    constant_sites_removed: true\n";
+        os << "    equal_population_sizes: false\n";
+        os << "comparisons:\n";
+        os << "- comparison:\n";
+        os << "    path: hemi129.nex\n";
+        os << "    parameters:\n";
+        os << "        population_size:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                gamma_distribution:\n";
+        os << "                    shape: " << size1_shape << "\n";
+        os << "                    scale: " << size1_scale << "\n";
+        os << "        freq_1:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                beta_distribution:\n";
+        os << "                    alpha: " << f1_a << "\n";
+        os << "                    beta: " << f1_b << "\n";
+        os << "        mutation_rate:\n";
+        os << "            value: 1.0\n";
+        os << "            estimate: false\n";
+        os << "- comparison:\n";
+        os << "    path: hemi129-altname1.nex\n";
+        os << "    parameters:\n";
+        os << "        population_size:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                gamma_distribution:\n";
+        os << "                    shape: " << size2_shape << "\n";
+        os << "                    scale: " << size2_scale << "\n";
+        os << "        freq_1:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                beta_distribution:\n";
+        os << "                    alpha: " << f2_a << "\n";
+        os << "                    beta: " << f2_b << "\n";
+        os << "        mutation_rate:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                gamma_distribution:\n";
+        os << "                    shape: " << mult2_shape << "\n";
+        os << "                    scale: " << mult2_scale << "\n";
+        os << "- comparison:\n";
+        os << "    path: hemi129-altname2.nex\n";
+        os << "    parameters:\n";
+        os << "        population_size:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                gamma_distribution:\n";
+        os << "                    shape: " << size3_shape << "\n";
+        os << "                    scale: " << size3_scale << "\n";
+        os << "        freq_1:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                beta_distribution:\n";
+        os << "                    alpha: " << f3_a << "\n";
+        os << "                    beta: " << f3_b << "\n";
+        os << "        mutation_rate:\n";
+        os << "            estimate: true\n";
+        os << "            prior:\n";
+        os << "                gamma_distribution:\n";
+        os << "                    shape: " << mult3_shape << "\n";
+        os << "                    scale: " << mult3_scale << "\n";
+        os.close();
+        REQUIRE(path::exists(test_path));
+
+        char arg0[] = "ecoevolity";
+        char arg1[] = "--seed";
+        char arg2[] = "72349827";
+        char arg3[] = "--sample-prior-directly";
+        char * cfg_path = new char[test_path.size() + 1];
+        std::copy(test_path.begin(), test_path.end(), cfg_path);
+        cfg_path[test_path.size()] = '\0';
+        char * argv[] = {
+            &arg0[0],
+            &arg1[0],
+            &arg2[0],
+            &arg3[0],
+            cfg_path,
+            NULL
+        };
+        int argc = (int)(sizeof(argv) / sizeof(argv[0])) - 1;
+        int ret;
+        ret = ecoevolity_main<CollectionSettings, ComparisonPopulationTreeCollection>(argc, argv);
+        REQUIRE(ret == 0);
+        REQUIRE(path::exists(log_path));
+
+        spreadsheet::Spreadsheet prior_sample;
+        prior_sample.update(log_path);
+
+        unsigned int expected_sample_size = 50001;
+
+        SampleSummarizer<double> height_summary1 = prior_sample.summarize<double>("root_height_kya");
+        SampleSummarizer<double> height_summary2 = prior_sample.summarize<double>("root_height_pop1");
+        SampleSummarizer<double> height_summary3 = prior_sample.summarize<double>("root_height_pop1b");
+        REQUIRE(height_summary1.sample_size() == expected_sample_size);
+        REQUIRE(height_summary1.mean() == Approx(height_shape * height_scale).epsilon(0.01));
+        REQUIRE(height_summary1.variance() == Approx(height_shape * height_scale * height_scale).epsilon(0.01));
+        REQUIRE(height_summary2.sample_size() == expected_sample_size);
+        REQUIRE(height_summary2.mean() == Approx(height_shape * height_scale).epsilon(0.01));
+        REQUIRE(height_summary2.variance() == Approx(height_shape * height_scale * height_scale).epsilon(0.01));
+        REQUIRE(height_summary3.sample_size() == expected_sample_size);
+        REQUIRE(height_summary3.mean() == Approx(height_shape * height_scale).epsilon(0.01));
+        REQUIRE(height_summary3.variance() == Approx(height_shape * height_scale * height_scale).epsilon(0.01));
+
+        SampleSummarizer<double> size1_summary_a = prior_sample.summarize<double>("pop_size_kya");
+        SampleSummarizer<double> size1_summary_b = prior_sample.summarize<double>("pop_size_fas");
+        SampleSummarizer<double> size1_summary_c = prior_sample.summarize<double>("pop_size_root_kya");
+        SampleSummarizer<double> size2_summary_a = prior_sample.summarize<double>("pop_size_pop1");
+        SampleSummarizer<double> size2_summary_b = prior_sample.summarize<double>("pop_size_pop2");
+        SampleSummarizer<double> size2_summary_c = prior_sample.summarize<double>("pop_size_root_pop1");
+        SampleSummarizer<double> size3_summary_a = prior_sample.summarize<double>("pop_size_pop1b");
+        SampleSummarizer<double> size3_summary_b = prior_sample.summarize<double>("pop_size_pop2b");
+        SampleSummarizer<double> size3_summary_c = prior_sample.summarize<double>("pop_size_root_pop1b");
+
+        REQUIRE(size1_summary_a.sample_size() == expected_sample_size);
+        REQUIRE(size1_summary_b.sample_size() == expected_sample_size);
+        REQUIRE(size1_summary_c.sample_size() == expected_sample_size);
+        REQUIRE(size1_summary_a.mean() == Approx(size1_shape * size1_scale).epsilon(0.01));
+        REQUIRE(size1_summary_a.variance() == Approx(size1_shape * size1_scale * size1_scale).epsilon(0.01));
+        REQUIRE(size1_summary_b.mean() == Approx(size1_shape * size1_scale).epsilon(0.01));
+        REQUIRE(size1_summary_b.variance() == Approx(size1_shape * size1_scale * size1_scale).epsilon(0.01));
+        REQUIRE(size1_summary_c.mean() == Approx(size1_shape * size1_scale).epsilon(0.01));
+        REQUIRE(size1_summary_c.variance() == Approx(size1_shape * size1_scale * size1_scale).epsilon(0.01));
+
+        REQUIRE(size2_summary_a.sample_size() == expected_sample_size);
+        REQUIRE(size2_summary_b.sample_size() == expected_sample_size);
+        REQUIRE(size2_summary_c.sample_size() == expected_sample_size);
+        REQUIRE(size2_summary_a.mean() == Approx(size2_shape * size2_scale).epsilon(0.01));
+        REQUIRE(size2_summary_a.variance() == Approx(size2_shape * size2_scale * size2_scale).epsilon(0.01));
+        REQUIRE(size2_summary_b.mean() == Approx(size2_shape * size2_scale).epsilon(0.01));
+        REQUIRE(size2_summary_b.variance() == Approx(size2_shape * size2_scale * size2_scale).epsilon(0.01));
+        REQUIRE(size2_summary_c.mean() == Approx(size2_shape * size2_scale).epsilon(0.01));
+        REQUIRE(size2_summary_c.variance() == Approx(size2_shape * size2_scale * size2_scale).epsilon(0.01));
+
+        REQUIRE(size3_summary_a.sample_size() == expected_sample_size);
+        REQUIRE(size3_summary_b.sample_size() == expected_sample_size);
+        REQUIRE(size3_summary_c.sample_size() == expected_sample_size);
+        REQUIRE(size3_summary_a.mean() == Approx(size3_shape * size3_scale).epsilon(0.01));
+        REQUIRE(size3_summary_a.variance() == Approx(size3_shape * size3_scale * size3_scale).epsilon(0.01));
+        REQUIRE(size3_summary_b.mean() == Approx(size3_shape * size3_scale).epsilon(0.01));
+        REQUIRE(size3_summary_b.variance() == Approx(size3_shape * size3_scale * size3_scale).epsilon(0.01));
+        REQUIRE(size3_summary_c.mean() == Approx(size3_shape * size3_scale).epsilon(0.01));
+        REQUIRE(size3_summary_c.variance() == Approx(size3_shape * size3_scale * size3_scale).epsilon(0.01));
+
+        SampleSummarizer<double> f1_summary = prior_sample.summarize<double>("freq_1_kya");
+        SampleSummarizer<double> f2_summary = prior_sample.summarize<double>("freq_1_pop1");
+        SampleSummarizer<double> f3_summary = prior_sample.summarize<double>("freq_1_pop1b");
+        REQUIRE(f1_summary.sample_size() == expected_sample_size);
+        REQUIRE(f2_summary.sample_size() == expected_sample_size);
+        REQUIRE(f3_summary.sample_size() == expected_sample_size);
+        REQUIRE(f1_summary.mean() ==     Approx(expected_f1_mean).epsilon(0.01));
+        REQUIRE(f2_summary.mean() ==     Approx(expected_f2_mean).epsilon(0.01));
+        REQUIRE(f3_summary.mean() ==     Approx(expected_f3_mean).epsilon(0.01));
+        REQUIRE(f1_summary.variance() == Approx(expected_f1_variance).epsilon(0.01));
+        REQUIRE(f2_summary.variance() == Approx(expected_f2_variance).epsilon(0.01));
+        REQUIRE(f3_summary.variance() == Approx(expected_f3_variance).epsilon(0.01));
+
+        SampleSummarizer<double> mult1_summary = prior_sample.summarize<double>("mutation_rate_kya");
+        SampleSummarizer<double> mult2_summary = prior_sample.summarize<double>("mutation_rate_pop1");
+        SampleSummarizer<double> mult3_summary = prior_sample.summarize<double>("mutation_rate_pop1b");
+        REQUIRE(mult1_summary.sample_size() == expected_sample_size);
+        REQUIRE(mult2_summary.sample_size() == expected_sample_size);
+        REQUIRE(mult3_summary.sample_size() == expected_sample_size);
+        REQUIRE(mult1_summary.mean() == 1.0);
+        REQUIRE(mult1_summary.variance() == 0.0);
+        REQUIRE(mult2_summary.mean() == Approx(mult2_shape * mult2_scale).epsilon(0.01));
+        REQUIRE(mult2_summary.variance() == Approx(mult2_shape * mult2_scale * mult2_scale).epsilon(0.01));
+        REQUIRE(mult3_summary.mean() == Approx(mult3_shape * mult3_scale).epsilon(0.01));
+        REQUIRE(mult3_summary.variance() == Approx(mult3_shape * mult3_scale * mult3_scale).epsilon(0.01));
+
+        SampleSummarizer<double> conc_summary = prior_sample.summarize<double>("concentration");
+        REQUIRE(conc_summary.sample_size() == expected_sample_size);
+        REQUIRE(conc_summary.mean() == Approx(concentration_shape * concentration_scale).epsilon(0.01));
+        REQUIRE(conc_summary.variance() == Approx(concentration_shape * concentration_scale * concentration_scale).epsilon(0.01));
+
+        std::vector<int> nevents = prior_sample.get<int>("number_of_events");
+        std::vector<int> event_indices1 = prior_sample.get<int>("root_height_index_kya");
+        std::vector<int> event_indices2 = prior_sample.get<int>("root_height_index_pop1");
+        std::vector<int> event_indices3 = prior_sample.get<int>("root_height_index_pop1b");
+        std::vector<double> heights1 = prior_sample.get<double>("root_height_kya");
+        std::vector<double> heights2 = prior_sample.get<double>("root_height_pop1");
+        std::vector<double> heights3 = prior_sample.get<double>("root_height_pop1b");
+
+        std::map<std::string, int> model_counts = {
+                {"000", 0},
+                {"001", 0},
+                {"010", 0},
+                {"011", 0},
+                {"012", 0}
+        };
+        std::map<int, int> nevent_counts = {
+                {1, 0},
+                {2, 0},
+                {3, 0}
+        };
+        for (size_t i = 0; i < nevents.size(); ++i) {
+            std::ostringstream stream;
+            stream << event_indices1.at(i);
+            stream << event_indices2.at(i);
+            stream << event_indices3.at(i);
+            std::string model_str = stream.str();
+            REQUIRE(model_counts.count(model_str) == 1);
+            REQUIRE(nevent_counts.count(nevents.at(i)) == 1);
+            ++model_counts[model_str];
+            ++nevent_counts[nevents.at(i)];
+            if (nevents.at(i) == 1) {
+                REQUIRE(event_indices1.at(i) == event_indices2.at(i));
+                REQUIRE(event_indices1.at(i) == event_indices3.at(i));
+                REQUIRE(heights1.at(i) == heights2.at(i));
+                REQUIRE(heights1.at(i) == heights3.at(i));
+            }
+            else if (nevents.at(i) == 3) {
+                REQUIRE(event_indices1.at(i) != event_indices2.at(i));
+                REQUIRE(event_indices1.at(i) != event_indices3.at(i));
+                REQUIRE(event_indices2.at(i) != event_indices3.at(i));
+                REQUIRE(heights1.at(i) != heights2.at(i));
+                REQUIRE(heights1.at(i) != heights3.at(i));
+                REQUIRE(heights2.at(i) != heights3.at(i));
+            }
+        }
+        int total = 0;
+        for (auto const &kv: model_counts) {
+            total += kv.second;
+        }
+        REQUIRE(total == expected_sample_size);
+        total = 0;
+        for (auto const &kv: nevent_counts) {
+            total += kv.second;
+        }
+        REQUIRE(total == expected_sample_size);
+
+        REQUIRE(model_counts.at("000") == nevent_counts.at(1));
+        REQUIRE(model_counts.at("012") == nevent_counts.at(3));
+        REQUIRE((model_counts.at("001") + model_counts.at("010") + model_counts.at("011")) == nevent_counts.at(2));
+
+        REQUIRE((model_counts.at("000") / (double)expected_sample_size) == Approx(0.367).epsilon(0.01));
+        REQUIRE((model_counts.at("012") / (double)expected_sample_size) == Approx(0.163).epsilon(0.01));
+
+        // Make sure the rest of the prior sample is as expected
+        SampleSummarizer<double> lnl_summary = prior_sample.summarize<double>("ln_likelihood");
+        REQUIRE(lnl_summary.mean() == 0.0);
+        REQUIRE(lnl_summary.variance() == 0.0);
+
+        // Samples are logged for the same generations as MCMC samples
+        std::vector<unsigned int> generations = prior_sample.get<unsigned int>("generation");
+        REQUIRE(generations.size() == expected_sample_size);
+        for (unsigned int i = 0; i < generations.size(); ++i) {
+            REQUIRE(generations.at(i) == i * 10);
+        }
+
+        delete[] cfg_path;
+    }
+}
+
 TEST_CASE("Testing ReversibleJumpSampler with 2 pairs", "[SamplingPrior]") {
 
     SECTION("Testing rjMCMC with 2 pairs") {
@@ -16025,3 +16375,105 @@ TEST_CASE("Testing PYP with 2 singletons and 1 pair, fully parameterized",
         delete[] cfg_path;
     }
 }
+
+
+class PriorSamplingTestModel {
+    public:
+        unsigned int number_of_draws = 0;
+        double value = 0.0;
+};
+
+inline std::vector<std::string> draw_prior_sampling_test_samples(
+        RandomNumberGenerator & rng,
+        std::vector<PriorSamplingTestModel> & models,
+        unsigned int number_of_samples,
+        unsigned int block_size,
+        unsigned int & number_of_writes) {
+    std::vector<PriorSamplingTestModel *> model_ptrs;
+    for (auto & model : models) {
+        model_ptrs.push_back(&model);
+    }
+    std::ostringstream out;
+    number_of_writes = 0;
+    auto draw_sample = [](RandomNumberGenerator & sample_rng,
+            PriorSamplingTestModel & model,
+            unsigned int sample_index,
+            PriorSampleBuffer & buffer) {
+        model.value = sample_rng.uniform_real();
+        ++model.number_of_draws;
+        buffer.state_log << sample_index << "\t" << model.value << "\n";
+    };
+    auto write_buffer = [&out, &number_of_writes](PriorSampleBuffer & buffer) {
+        out << buffer.state_log.str();
+        buffer.clear();
+        ++number_of_writes;
+    };
+    draw_prior_samples(rng,
+            model_ptrs,
+            number_of_samples,
+            draw_sample,
+            write_buffer,
+            block_size);
+    std::vector<std::string> lines;
+    std::istringstream in(out.str());
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST_CASE("Testing draw_prior_samples with one model", "[PriorSampling]") {
+    SECTION("Testing order and number of samples") {
+        RandomNumberGenerator rng = RandomNumberGenerator(123);
+        std::vector<PriorSamplingTestModel> models(1);
+        unsigned int number_of_writes;
+        std::vector<std::string> lines = draw_prior_sampling_test_samples(
+                rng, models, 25, 10, number_of_writes);
+        REQUIRE(lines.size() == 25);
+        REQUIRE(models.at(0).number_of_draws == 25);
+        REQUIRE(number_of_writes == 3);
+
+        // With one model, the draws are made with rng
+        RandomNumberGenerator rng2 = RandomNumberGenerator(123);
+        for (unsigned int i = 0; i < lines.size(); ++i) {
+            std::ostringstream expected;
+            expected << i << "\t" << rng2.uniform_real();
+            REQUIRE(lines.at(i) == expected.str());
+        }
+    }
+}
+
+TEST_CASE("Testing draw_prior_samples with multiple models", "[PriorSampling]") {
+    SECTION("Testing order and number of samples") {
+        RandomNumberGenerator rng = RandomNumberGenerator(123);
+        std::vector<PriorSamplingTestModel> models(3);
+        unsigned int number_of_writes;
+        std::vector<std::string> lines = draw_prior_sampling_test_samples(
+                rng, models, 1001, 7, number_of_writes);
+        REQUIRE(lines.size() == 1001);
+        unsigned int number_of_draws = 0;
+        for (auto & model : models) {
+            number_of_draws += model.number_of_draws;
+        }
+        REQUIRE(number_of_draws == 1001);
+        for (unsigned int i = 0; i < lines.size(); ++i) {
+            REQUIRE(lines.at(i).substr(0, lines.at(i).find('\t')) ==
+                    std::to_string(i));
+        }
+#ifdef BUILD_WITH_THREADS
+        REQUIRE(models.at(0).number_of_draws == 336);
+        REQUIRE(models.at(1).number_of_draws == 336);
+        REQUIRE(models.at(2).number_of_draws == 329);
+
+        // The samples only depend on the seed and the number of models
+        RandomNumberGenerator rng2 = RandomNumberGenerator(123);
+        std::vector<PriorSamplingTestModel> models2(3);
+        std::vector<std::string> lines2 = draw_prior_sampling_test_samples(
+                rng2, models2, 1001, 7, number_of_writes);
+        REQUIRE(lines2 == lines);
+#else
+        REQUIRE(models.at(0).number_of_draws == 1001);
+#endif
+    }
+}
@@ -0,0 +1,249 @@
+#include "catch.hpp"
+#include "ecoevolity/sbcoevolity.hpp"
+
+#include "ecoevolity/rng.hpp"
+#include "ecoevolity/path.hpp"
+#include "ecoevolity/spreadsheet.hpp"
+
+RandomNumberGenerator _SBCOEVOLITY_CLI_RNG = RandomNumberGenerator();
+
+TEST_CASE("Testing get_sbc_rank", "[SbcoevolityCLI]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(11);
+    std::vector<double> samples = {0.3, 0.1, 0.5, 0.2, 0.4};
+    REQUIRE(get_sbc_rank(samples, 0.0, rng) == 0);
+    REQUIRE(get_sbc_rank(samples, 0.25, rng) == 2);
+    REQUIRE(get_sbc_rank(samples, 0.6, rng) == 5);
+
+    // Ties are broken at random
+    std::vector<unsigned int> discrete_samples = {1, 2, 2, 2, 3};
+    std::vector<unsigned int> rank_counts(6, 0);
+    for (unsigned int i = 0; i < 4000; ++i) {
+        ++rank_counts.at(get_sbc_rank(discrete_samples, 2u, rng));
+    }
+    REQUIRE(rank_counts.at(0) == 0);
+    REQUIRE(rank_counts.at(5) == 0);
+    for (unsigned int r = 1; r < 5; ++r) {
+        REQUIRE(rank_counts.at(r) > 800);
+        REQUIRE(rank_counts.at(r) < 1200);
+    }
+}
+
+TEST_CASE("Testing sbcoevolity ranks and coverage", "[SbcoevolityCLI]") {
+
+    SECTION("Testing haploid standard data") {
+        std::string tag = _SBCOEVOLITY_CLI_RNG.random_string(10);
+        std::string test_path = "data/tmp-config-" + tag + "-t513.cfg";
+        std::string prefix = "data/tmp-" + tag + "-t513-";
+        std::string ranks_path = prefix + "sbcoevolity-ranks.txt";
+        std::string coverage_path = prefix + "sbcoevolity-coverage.txt";
+        std::ofstream os;
+        os.open(test_path);
+        os << "event_model_prior:\n";
+        os << "    dirichlet_process:\n";
+        os << "        parameters:\n";
+        os << "            concentration:\n";
+        os << "                value: 1.0\n";
+        os << "                estimate: false\n";
+        os << "mcmc_settings:\n";
+        os << "    chain_length: 200\n";
+        os << "    sample_frequency: 10\n";
+        os << "comparisons:\n";
+        os << "- comparison:\n";
+        os << "    path: haploid-standard.nex\n";
+        os << "    genotypes_are_diploid: false\n";
+        os << "    constant_sites_removed: false\n";
+        os.close();
+        REQUIRE(path::exists(test_path));
+
+        char arg0[] = "sbcoevolity";
+        char arg1[] = "--seed";
+        char arg2[] = "2381";
+        char arg3[] = "-n";
+        char arg4[] = "5";
+        char arg5[] = "-b";
+        char arg6[] = "1";
+        char arg7[] = "--prefix";
+        char arg10[] = "--thin";
+        char arg11[] = "1";
+        char * prefix_arg = new char[prefix.size() + 1];
+        std::copy(prefix.begin(), prefix.end(), prefix_arg);
+        prefix_arg[prefix.size()] = '\0';
+        char * cfg_path = new char[test_path.size() + 1];
+        std::copy(test_path.begin(), test_path.end(), cfg_path);
+        cfg_path[test_path.size()] = '\0';
+        char * argv[] = {
+            &arg0[0],
+            &arg1[0],
+            &arg2[0],
+            &arg3[0],
+            &arg4[0],
+            &arg5[0],
+            &arg6[0],
+            &arg10[0],
+            &arg11[0],
+            &arg7[0],
+            prefix_arg,
+            cfg_path,
+            NULL
+        };
+        int argc = (int)(sizeof(argv) / sizeof(argv[0])) - 1;
+        int ret;
+
+        ret = sbcoevolity_main<RelativeRootCollectionSettings, ComparisonRelativeRootPopulationTreeCollection>(argc, argv);
+        REQUIRE(ret == 0);
+        REQUIRE(path::exists(ranks_path));
+        REQUIRE(path::exists(coverage_path));
+
+        // Output files are not overwritten
+        REQUIRE_THROWS_AS(
+                (sbcoevolity_main<RelativeRootCollectionSettings, ComparisonRelativeRootPopulationTreeCollection>(argc, argv)),
+                EcoevolityError &);
+
+        spreadsheet::Spreadsheet ranks;
+        ranks.update(ranks_path);
+        std::vector<unsigned int> replicates = ranks.get<unsigned int>("replicate");
+        REQUIRE(replicates == std::vector<unsigned int>({1, 2, 3, 4, 5}));
+        std::vector<unsigned int> sample_sizes = ranks.get<unsigned int>("number_of_samples");
+        REQUIRE(sample_sizes == std::vector<unsigned int>(5, 20));
+        std::vector<std::string> expected_parameters = {
+                "number_of_events",
+                "root_height_pop1",
+                "freq_1_pop1",
+                "pop_size_pop1",
+                "pop_size_pop2",
+                "pop_size_root_pop1"};
+        for (auto const & parameter : expected_parameters) {
+            std::vector<unsigned int> parameter_ranks = ranks.get<unsigned int>(parameter);
+            REQUIRE(parameter_ranks.size() == 5);
+            for (auto rank : parameter_ranks) {
+                REQUIRE(rank <= 20);
+            }
+        }
+        for (auto const & key : ranks.get_keys()) {
+            REQUIRE(! string_util::startswith(key, "ln_"));
+        }
+
+        spreadsheet::Spreadsheet coverage;
+        coverage.update(coverage_path);
+        std::vector<std::string> parameters = coverage.get<std::string>("parameter");
+        for (auto const & parameter : expected_parameters) {
+            REQUIRE(std::find(parameters.begin(), parameters.end(), parameter) != parameters.end());
+        }
+        for (auto c : coverage.get<double>("coverage")) {
+            REQUIRE(c >= 0.0);
+            REQUIRE(c <= 1.0);
+        }
+
+#ifdef BUILD_WITH_THREADS
+        // Replicates are seeded independently of the number of threads
+        std::string threaded_prefix = "data/tmp-" + tag + "-t514-";
+        char arg8[] = "--nthreads";
+        char arg9[] = "3";
+        char * threaded_prefix_arg = new char[threaded_prefix.size() + 1];
+        std::copy(threaded_prefix.begin(), threaded_prefix.end(), threaded_prefix_arg);
+        threaded_prefix_arg[threaded_prefix.size()] = '\0';
+        char * threaded_argv[] = {
+            &arg0[0],
+            &arg1[0],
+            &arg2[0],
+            &arg3[0],
+            &arg4[0],
+            &arg5[0],
+            &arg6[0],
+            &arg10[0],
+            &arg11[0],
+            &arg7[0],
+            threaded_prefix_arg,
+            &arg8[0],
+            &arg9[0],
+            cfg_path,
+            NULL
+        };
+        int threaded_argc = (int)(sizeof(threaded_argv) / sizeof(threaded_argv[0])) - 1;
+        ret = sbcoevolity_main<RelativeRootCollectionSettings, ComparisonRelativeRootPopulationTreeCollection>(threaded_argc, threaded_argv);
+        REQUIRE(ret == 0);
+
+        std::ifstream ranks_stream(ranks_path);
+        std::ifstream threaded_ranks_stream(threaded_prefix + "sbcoevolity-ranks.txt");
+        std::stringstream ranks_text;
+        std::stringstream threaded_ranks_text;
+        ranks_text << ranks_stream.rdbuf();
+        threaded_ranks_text << threaded_ranks_stream.rdbuf();
+        REQUIRE(ranks_text.str() == threaded_ranks_text.str());
+        delete[] threaded_prefix_arg;
+#endif
+
+        delete[] prefix_arg;
+        delete[] cfg_path;
+    }
+    SECTION("Testing thinning") {
+        std::string tag = _SBCOEVOLITY_CLI_RNG.random_string(10);
+        std::string test_path = "data/tmp-config-" + tag + "-t515.cfg";
+        std::ofstream os;
+        os.open(test_path);
+        os << "event_model_prior:\n";
+        os << "    dirichlet_process:\n";
+        os << "        parameters:\n";
+        os << "            concentration:\n";
+        os << "                value: 1.0\n";
+        os << "                estimate: false\n";
+        os << "mcmc_settings:\n";
+        os << "    chain_length: 200\n";
+        os << "    sample_frequency: 10\n";
+        os << "comparisons:\n";
+        os << "- comparison:\n";
+        os << "    path: haploid-standard.nex\n";
+        os << "    genotypes_are_diploid: false\n";
+        os << "    constant_sites_removed: false\n";
+        os.close();
+        REQUIRE(path::exists(test_path));
+
+        // Default thinning to the effective sample size, then every 4th
+        // sample
+        std::vector<std::string> thin_settings = {"0", "4"};
+        for (unsigned int t = 0; t < thin_settings.size(); ++t) {
+            std::string prefix = "data/tmp-" + tag + "-t51" + std::to_string(6 + t) + "-";
+            std::string ranks_path = prefix + "sbcoevolity-ranks.txt";
+            std::vector<std::string> args = {
+                "sbcoevolity",
+                "--seed",
+                "2381",
+                "-n",
+                "5",
+                "-b",
+                "1",
+                "--thin",
+                thin_settings.at(t),
+                "--prefix",
+                prefix,
+                test_path};
+            std::vector<char *> argv;
+            for (auto & arg : args) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(NULL);
+            int argc = (int)argv.size() - 1;
+
+            int ret = sbcoevolity_main<RelativeRootCollectionSettings, ComparisonRelativeRootPopulationTreeCollection>(argc, argv.data());
+            REQUIRE(ret == 0);
+            REQUIRE(path::exists(ranks_path));
+
+            spreadsheet::Spreadsheet ranks;
+            ranks.update(ranks_path);
+            std::vector<unsigned int> sample_sizes = ranks.get<unsigned int>("number_of_samples");
+            REQUIRE(sample_sizes.size() == 5);
+            for (auto n : sample_sizes) {
+                REQUIRE(n >= 1);
+                REQUIRE(n <= 20);
+                if (t == 1) {
+                    REQUIRE(n == 5);
+                }
+            }
+            std::vector<unsigned int> parameter_ranks = ranks.get<unsigned int>("pop_size_pop1");
+            REQUIRE(parameter_ranks.size() == 5);
+            for (unsigned int i = 0; i < parameter_ranks.size(); ++i) {
+                REQUIRE(parameter_ranks.at(i) <= sample_sizes.at(i));
+            }
+        }
+    }
+}
@@ -1,3 +1,5 @@
+#include <unordered_map>
+
 #include "catch.hpp"
 #include "ecoevolity/split.hpp"
 #include "ecoevolity/basetree.hpp"
@@ -312,6 +314,65 @@ TEST_CASE("Testing 100000 leaves", "[split]") {
     }
 }
 
+TEST_CASE("Testing multi-unit splits and hashing", "[split]") {
+    SECTION("Testing multi-unit splits and hashing") {
+        unsigned int nleaves = 130;
+        Split a;
+        a.resize(nleaves);
+        a.set_leaf_bit(3);
+        a.set_leaf_bit(70);
+        Split b;
+        b.resize(nleaves);
+        b.set_leaf_bit(3);
+        b.set_leaf_bit(129);
+        Split c = a;
+
+        REQUIRE(c == a);
+        REQUIRE(c.hash() == a.hash());
+        REQUIRE(a != b);
+        REQUIRE(a.hash() != b.hash());
+        REQUIRE(a.get_bits(0) == b.get_bits(0));
+        REQUIRE(a.get_bits(2) == 0);
+        REQUIRE(a.get_leaf_bit(70));
+        REQUIRE(! a.get_leaf_bit(129));
+        REQUIRE(a.get_leaf_node_count() == 2);
+        REQUIRE(b.get_leaf_indices() == std::vector<unsigned int>({3, 129}));
+        // Higher units break ties in the first unit
+        REQUIRE(b < a);
+        REQUIRE(! (a < b));
+
+        Split ab = a;
+        ab.add_split(b);
+        REQUIRE(ab.is_proper_superset_of(a));
+        REQUIRE(ab.is_proper_superset_of(b));
+        REQUIRE(a.overlaps_with(b));
+
+        std::set<Split> s1 {a, b};
+        std::set<Split> s2 {b, c};
+        std::set<Split> s3 {a, ab};
+        REQUIRE(Split::hash(s1) == Split::hash(s2));
+        REQUIRE(Split::hash(s1) != Split::hash(s3));
+        std::set< std::set<Split> > t1 {s1, s3};
+        std::set< std::set<Split> > t2 {s3, s2};
+        REQUIRE(Split::hash(t1) == Split::hash(t2));
+        REQUIRE(Split::hash(t1) != Split::hash(std::set< std::set<Split> >({s1})));
+
+        std::unordered_map<std::set<Split>, unsigned int, SplitSetHash> counts;
+        counts[s1] += 1;
+        counts[s2] += 1;
+        counts[s3] += 1;
+        REQUIRE(counts.size() == 2);
+        REQUIRE(counts.at(s1) == 2);
+
+        Split empty;
+        Split resized_empty;
+        resized_empty.resize(4);
+        REQUIRE(empty.is_empty());
+        REQUIRE(resized_empty.is_empty());
+        REQUIRE(empty != resized_empty);
+    }
+}
+
 TEST_CASE("Testing is_parent_of", "[split]") {
     SECTION("Testing is_parent_of") {
         std::set<Split> splits;
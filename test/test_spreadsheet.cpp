@@ -911,3 +911,190 @@ TEST_CASE("Testing spreadsheet.summarize", "[spreadsheet]") {
         REQUIRE(summarizer4.excess_kurtosis() == Approx(-1.2167832167832167));
     }
 }
+
+TEST_CASE("Testing parse_number", "[spreadsheet]") {
+
+    SECTION("Testing doubles") {
+        auto parse = [](const std::string & s, double & v) {
+            return spreadsheet::parse_number(s.c_str(), s.c_str() + s.size(), v);
+        };
+        double v;
+        REQUIRE(parse("1.5", v));
+        REQUIRE(v == 1.5);
+        REQUIRE(parse("-0.25", v));
+        REQUIRE(v == -0.25);
+        REQUIRE(parse("3e-4", v));
+        REQUIRE(v == 3e-4);
+        REQUIRE(parse("1E+300", v));
+        REQUIRE(v == 1e300);
+        REQUIRE(parse(".5", v));
+        REQUIRE(v == 0.5);
+        REQUIRE(parse("0.000123456789012345678", v));
+        REQUIRE(v == 0.000123456789012345678);
+        REQUIRE(! parse("", v));
+        REQUIRE(! parse("-", v));
+        REQUIRE(! parse(".", v));
+        REQUIRE(! parse("1e", v));
+        REQUIRE(! parse("1.5x", v));
+        REQUIRE(! parse("abc", v));
+        REQUIRE(! parse("1e999", v));
+
+        // Values are the same as those from a stream
+        RandomNumberGenerator rng = RandomNumberGenerator(41);
+        for (unsigned int i = 0; i < 20000; ++i) {
+            double x = rng.uniform_real() * std::pow(10.0, rng.uniform_int(-30, 30));
+            if (rng.uniform_real() < 0.5) {
+                x = -x;
+            }
+            std::ostringstream out;
+            out.precision(rng.uniform_int(1, 18));
+            if (rng.uniform_real() < 0.3) {
+                out << std::scientific;
+            }
+            out << x;
+            std::istringstream in(out.str());
+            double expected;
+            in >> expected;
+            REQUIRE(parse(out.str(), v));
+            REQUIRE(v == expected);
+        }
+    }
+
+    SECTION("Testing integers") {
+        auto parse_int = [](const std::string & s, int & v) {
+            return spreadsheet::parse_number(s.c_str(), s.c_str() + s.size(), v);
+        };
+        auto parse_unsigned = [](const std::string & s, unsigned int & v) {
+            return spreadsheet::parse_number(s.c_str(), s.c_str() + s.size(), v);
+        };
+        int i;
+        unsigned int u;
+        REQUIRE(parse_int("42", i));
+        REQUIRE(i == 42);
+        REQUIRE(parse_int("-42", i));
+        REQUIRE(i == -42);
+        REQUIRE(parse_int("2147483647", i));
+        REQUIRE(i == 2147483647);
+        REQUIRE(parse_int("-2147483648", i));
+        REQUIRE(i == std::numeric_limits<int>::min());
+        REQUIRE(! parse_int("2147483648", i));
+        REQUIRE(! parse_int("1.0", i));
+        REQUIRE(! parse_int("", i));
+        REQUIRE(! parse_int("-", i));
+        REQUIRE(parse_unsigned("4294967295", u));
+        REQUIRE(u == 4294967295u);
+        REQUIRE(! parse_unsigned("4294967296", u));
+        REQUIRE(! parse_unsigned("-1", u));
+    }
+}
+
+TEST_CASE("Testing NumericSpreadsheet", "[spreadsheet]") {
+    std::vector<std::string> paths;
+    spreadsheet::Spreadsheet expected;
+    RandomNumberGenerator rng = RandomNumberGenerator(7);
+    for (unsigned int f = 0; f < 5; ++f) {
+        std::string test_path = "data/tmp-" + _TEST_SPREADSHEET_RNG.random_string(10) + ".txt";
+        std::ofstream test_file;
+        test_file.open(test_path);
+        test_file.precision(18);
+        test_file << "generation\tln_likelihood\tlabel\tvalue\n";
+        for (unsigned int row = 0; row < (20 + f); ++row) {
+            test_file << (row * 10) << "\t"
+                      << (-1000.0 * rng.uniform_real()) << "\t"
+                      << "x" << row << "\t"
+                      << rng.uniform_real() << "\n";
+        }
+        test_file.close();
+        paths.push_back(test_path);
+    }
+    expected.update(paths, 3);
+
+    SECTION("Testing projected columns") {
+        spreadsheet::NumericSpreadsheet<double> ss({"value", "ln_likelihood"});
+        ss.update(paths, 3);
+        REQUIRE(ss.get_keys() == std::vector<std::string>({"value", "ln_likelihood"}));
+        REQUIRE(ss.get_header() == expected.get_keys());
+        REQUIRE(ss.get_number_of_rows() == (17 + 18 + 19 + 20 + 21));
+        REQUIRE(ss.get("value") == expected.get<double>("value"));
+        REQUIRE(ss.get("ln_likelihood") == expected.get<double>("ln_likelihood"));
+        REQUIRE(ss.has_key("value"));
+        REQUIRE(! ss.has_key("label"));
+        REQUIRE_THROWS_AS(ss.get("generation"), EcoevolitySpreadsheetError &);
+
+        SampleSummarizer<double> summary = ss.summarize("value");
+        SampleSummarizer<double> expected_summary = expected.summarize<double>("value");
+        REQUIRE(summary.sample_size() == expected_summary.sample_size());
+        REQUIRE(summary.mean() == expected_summary.mean());
+
+        spreadsheet::NumericSpreadsheet<unsigned int> generations({"generation"});
+        generations.update(paths, 3);
+        REQUIRE(generations.get("generation") == expected.get<unsigned int>("generation"));
+    }
+
+    SECTION("Testing empty lines") {
+        std::stringstream stream;
+        stream << "a\tb\n1\t2\n\n3\t4\n\n5\t6\n\n";
+        spreadsheet::NumericSpreadsheet<int> ss;
+        ss.update(stream, 1);
+        REQUIRE(ss.get("a") == std::vector<int>({3, 5}));
+        REQUIRE(ss.get("b") == std::vector<int>({4, 6}));
+    }
+
+    SECTION("Testing streaming rows") {
+        std::vector<std::string> header;
+        std::vector< std::vector<unsigned int> > rows;
+        std::stringstream stream;
+        stream << "a\tb\tc\n1\tx\t2\n3\ty\t4\n";
+        spreadsheet::stream_numeric_columns<unsigned int>(stream,
+                header,
+                {"c", "a"},
+                [&](const std::vector<unsigned int> & values) {
+                    rows.push_back(values);
+                });
+        REQUIRE(header == std::vector<std::string>({"a", "b", "c"}));
+        REQUIRE(rows == std::vector< std::vector<unsigned int> >({{2, 1}, {4, 3}}));
+
+        std::stringstream other_stream;
+        other_stream << "a\tc\n1\t2\n";
+        REQUIRE_THROWS_AS(spreadsheet::stream_numeric_columns<unsigned int>(
+                    other_stream,
+                    header,
+                    {"a"},
+                    [&](const std::vector<unsigned int> & values) { }),
+                EcoevolityParsingError &);
+    }
+
+    SECTION("Testing offset beyond rows") {
+        spreadsheet::NumericSpreadsheet<double> ss({"value"});
+        ss.update(paths, 100);
+        REQUIRE(ss.get_number_of_rows() == 0);
+    }
+
+    SECTION("Testing errors") {
+        spreadsheet::NumericSpreadsheet<double> ss({"label"});
+        REQUIRE_THROWS_AS(ss.update(paths), EcoevolitySpreadsheetError &);
+        spreadsheet::NumericSpreadsheet<double> missing({"foo"});
+        REQUIRE_THROWS_AS(missing.update(paths), EcoevolitySpreadsheetError &);
+        spreadsheet::NumericSpreadsheet<double> all;
+        REQUIRE_THROWS_AS(all.update(paths), EcoevolitySpreadsheetError &);
+
+        std::stringstream stream;
+        stream << "a\tb\n1\t2\n3\n";
+        spreadsheet::NumericSpreadsheet<int> short_row;
+        REQUIRE_THROWS_AS(short_row.update(stream), EcoevolityParsingError &);
+    }
+
+    SECTION("Testing all columns of a stream") {
+        std::stringstream stream;
+        stream << "a\tb\n1\t2\n3\t4\n5\t6\n";
+        spreadsheet::NumericSpreadsheet<int> ss;
+        ss.update(stream, 1);
+        REQUIRE(ss.get_keys() == std::vector<std::string>({"a", "b"}));
+        REQUIRE(ss.get("a") == std::vector<int>({3, 5}));
+        REQUIRE(ss.get("b") == std::vector<int>({4, 6}));
+
+        std::stringstream other_stream;
+        other_stream << "b\ta\n1\t2\n";
+        REQUIRE_THROWS_AS(ss.update(other_stream), EcoevolityParsingError &);
+    }
+}
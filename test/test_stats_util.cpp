@@ -1,6 +1,9 @@
 #include "catch.hpp"
 #include "ecoevolity/stats_util.hpp"
 #include "ecoevolity/rng.hpp"
+#include "ecoevolity/string_util.hpp"
+
+#include <sstream>
 
 TEST_CASE("Testing double SampleSummarizer", "[stats_util]") {
 
@@ -460,3 +463,225 @@ TEST_CASE("Testing HPD interval, quantile, percentile, and summary") {
         REQUIRE(ss.qi_95().second == Approx(1.96).epsilon(eps));
     }
 }
+
+TEST_CASE("Testing BurninSampleSums", "[stats_util]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(1234);
+    std::vector< std::vector<double> > chains(3);
+    for (auto & chain : chains) {
+        double x = 0.0;
+        for (unsigned int i = 0; i < 500; ++i) {
+            // Autocorrelated samples around a large mean that start far from it
+            x = (0.8 * x) + rng.normal();
+            double drift = (i < 50) ? (100.0 - (2.0 * i)) : 0.0;
+            chain.push_back(-10000.0 + drift + x);
+        }
+    }
+    BurninSampleSums<double> sums(chains);
+    BurninSampleSums<double> chain_sums(chains.at(1));
+    REQUIRE(sums.get_number_of_chains() == 3);
+    REQUIRE(chain_sums.get_number_of_chains() == 1);
+
+    for (unsigned int burnin : {0, 1, 37, 250, 498}) {
+        std::vector< std::vector<double> > remaining;
+        std::vector<double> concatenated;
+        SampleSummarizer<double> summary;
+        for (auto const & chain : chains) {
+            remaining.push_back(std::vector<double>(chain.begin() + burnin, chain.end()));
+            concatenated.insert(concatenated.end(), chain.begin() + burnin, chain.end());
+            for (unsigned int i = burnin; i < chain.size(); ++i) {
+                summary.add_sample(chain.at(i));
+            }
+        }
+        REQUIRE(sums.get_sample_size(burnin) == concatenated.size());
+        REQUIRE(sums.mean(burnin) == Approx(summary.mean()));
+        REQUIRE(sums.variance(burnin) == Approx(summary.variance()));
+        REQUIRE(sums.monte_carlo_standard_error(burnin).first ==
+                Approx(monte_carlo_standard_error(concatenated).first));
+        REQUIRE(sums.monte_carlo_standard_error(burnin).second ==
+                Approx(monte_carlo_standard_error(concatenated).second));
+        REQUIRE(sums.effective_sample_size(burnin, false) ==
+                Approx(effective_sample_size(remaining, false)));
+        REQUIRE(sums.effective_sample_size(burnin, true) ==
+                Approx(effective_sample_size(remaining, true)));
+        REQUIRE(sums.potential_scale_reduction_factor(burnin) ==
+                Approx(potential_scale_reduction_factor(remaining)));
+        for (unsigned int i = 0; i < chains.size(); ++i) {
+            SampleSummarizer<double> chain_summary;
+            for (auto x : remaining.at(i)) {
+                chain_summary.add_sample(x);
+            }
+            REQUIRE(sums.mean(i, burnin) == Approx(chain_summary.mean()));
+            REQUIRE(sums.variance(i, burnin) == Approx(chain_summary.variance()));
+        }
+        REQUIRE(chain_sums.effective_sample_size(burnin, false) ==
+                Approx(effective_sample_size(remaining.at(1), false)));
+    }
+
+    REQUIRE(sums.get_sample_size(500) == 0);
+    REQUIRE(sums.effective_sample_size(500) == 0.0);
+    REQUIRE(sums.variance(0, 499) == std::numeric_limits<double>::infinity());
+
+    BurninSampleSums<int> constant(std::vector<int>(20, 3));
+    REQUIRE(constant.mean(5) == 3.0);
+    REQUIRE(constant.variance(5) == 0.0);
+    REQUIRE(constant.effective_sample_size(5) == 0.0);
+}
+
+TEST_CASE("Testing mser_burnin", "[stats_util]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(4321);
+
+    SECTION("Testing chain with transient") {
+        std::vector<double> samples;
+        for (unsigned int i = 0; i < 2000; ++i) {
+            double transient = (i < 300) ? (30.0 * std::exp(-(i / 60.0))) : 0.0;
+            samples.push_back(transient + rng.normal());
+        }
+        unsigned int burnin = mser_burnin(samples);
+        REQUIRE(burnin % 5 == 0);
+        REQUIRE(burnin > 150);
+        REQUIRE(burnin < 500);
+        burnin = mser_burnin(samples, 20);
+        REQUIRE(burnin % 20 == 0);
+        REQUIRE(burnin > 150);
+        REQUIRE(burnin < 500);
+    }
+
+    SECTION("Testing stationary and constant chains") {
+        std::vector<double> samples;
+        for (unsigned int i = 0; i < 2000; ++i) {
+            samples.push_back(rng.normal());
+        }
+        REQUIRE(mser_burnin(samples) <= 1000);
+        REQUIRE(mser_burnin(std::vector<double>(100, 1.5)) == 0);
+        REQUIRE(mser_burnin(std::vector<double>(9, 1.5)) == 0);
+        REQUIRE(mser_burnin(std::vector<unsigned int>()) == 0);
+    }
+}
+
+TEST_CASE("Testing geweke_z_score", "[stats_util]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(99);
+    std::vector<double> samples;
+    for (unsigned int i = 0; i < 5000; ++i) {
+        samples.push_back(rng.normal(5.0, 2.0));
+    }
+    double z = geweke_z_score(samples);
+    REQUIRE(std::abs(z) < 4.0);
+
+    // Beginning of chain is too high
+    for (unsigned int i = 0; i < 500; ++i) {
+        samples.at(i) += 3.0;
+    }
+    z = geweke_z_score(samples);
+    REQUIRE(z > 4.0);
+    z = geweke_z_score(samples, 0.2, 0.2);
+    REQUIRE(z > 4.0);
+
+    REQUIRE(std::isnan(geweke_z_score(std::vector<double>(10, 1.0))));
+    REQUIRE(std::isnan(geweke_z_score(std::vector<double>(100, 1.0))));
+    REQUIRE_THROWS_AS(geweke_z_score(samples, 0.6, 0.5), EcoevolityError &);
+    REQUIRE_THROWS_AS(geweke_z_score(samples, 0.0, 0.5), EcoevolityError &);
+}
+
+TEST_CASE("Testing get_burnin_advice", "[stats_util]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(2468);
+    std::vector< std::vector< std::vector<double> > > chains(3,
+            std::vector< std::vector<double> >(3));
+    for (auto & chain : chains) {
+        double x = 0.0;
+        double y = 0.0;
+        for (unsigned int i = 0; i < 4000; ++i) {
+            x = (0.9 * x) + rng.normal();
+            y = (0.5 * y) + rng.normal();
+            double transient = (i < 400) ? (-500.0 * std::exp(-(i / 80.0))) : 0.0;
+            // Log likelihood
+            chain.at(0).push_back(-2000.0 + transient + x);
+            // Parameter that is not autocorrelated and has no transient
+            chain.at(1).push_back(y);
+            // Fixed parameter
+            chain.at(2).push_back(1.0);
+        }
+    }
+
+    BurninAdvice advice = get_burnin_advice(chains.at(0));
+    REQUIRE(advice.number_of_samples == 4000);
+    REQUIRE(advice.burnin > 300);
+    REQUIRE(advice.burnin < 1000);
+    REQUIRE(advice.get_sample_size() == (4000 - advice.burnin));
+    // The autocorrelation time of the log likelihood is about 19
+    REQUIRE(advice.thin > 5);
+    REQUIRE(advice.thin < 60);
+    REQUIRE(advice.min_ess > 0.0);
+    REQUIRE(advice.min_ess < advice.get_sample_size());
+    REQUIRE(advice.max_abs_geweke_z < 5.0);
+
+    // The fixed parameter is ignored
+    BurninAdvice fixed_advice = get_burnin_advice(
+            std::vector< std::vector<double> >({chains.at(0).at(2)}));
+    REQUIRE(fixed_advice.burnin == 0);
+    REQUIRE(fixed_advice.thin == 1);
+    REQUIRE(fixed_advice.min_ess == 4000.0);
+    REQUIRE(fixed_advice.max_abs_geweke_z == 0.0);
+
+    std::vector<BurninAdvice> chain_advice;
+    for (unsigned int nthreads : {1, 2}) {
+        chain_advice = get_burnin_advice_for_chains<double>(3,
+                [&](unsigned int i) { return chains.at(i); },
+                nthreads);
+        REQUIRE(chain_advice.size() == 3);
+        for (unsigned int i = 0; i < 3; ++i) {
+            BurninAdvice a = get_burnin_advice(chains.at(i));
+            REQUIRE(chain_advice.at(i).burnin == a.burnin);
+            REQUIRE(chain_advice.at(i).thin == a.thin);
+            REQUIRE(chain_advice.at(i).min_ess == a.min_ess);
+        }
+    }
+    REQUIRE(chain_advice.at(0).burnin == advice.burnin);
+
+    std::ostringstream out;
+    write_burnin_advice(out, {"a.log", "b.log", "c.log"}, chain_advice);
+    std::istringstream in(out.str());
+    std::string line;
+    std::getline(in, line);
+    REQUIRE(line == "path\tnumber_of_samples\tburnin\tthin\tsample_size\tmin_ess\tmax_abs_geweke_z");
+    std::getline(in, line);
+    REQUIRE(string_util::startswith(line, "a.log\t4000\t"));
+}
+
+TEST_CASE("Testing get_effective_thinning_interval", "[stats_util]") {
+    RandomNumberGenerator rng = RandomNumberGenerator(1357);
+    std::vector<double> autocorrelated;
+    std::vector<double> independent;
+    std::vector<double> fixed(2000, 1.0);
+    double x = 0.0;
+    for (unsigned int i = 0; i < 2000; ++i) {
+        x = (0.9 * x) + rng.normal();
+        autocorrelated.push_back(x);
+        independent.push_back(rng.normal());
+    }
+
+    REQUIRE(get_thinning_interval(2000, 100.0) == 20);
+    REQUIRE(get_thinning_interval(2000, 0.0) == 1);
+    REQUIRE(get_thinning_interval(2000, 3000.0) == 1);
+
+    // The autocorrelation time is about 19
+    unsigned int thin = get_effective_thinning_interval(
+            std::vector< std::vector<double> >({independent, autocorrelated}));
+    REQUIRE(thin > 5);
+    REQUIRE(thin < 60);
+    REQUIRE(thin == get_thinning_interval(2000,
+            effective_sample_size(autocorrelated, true)));
+
+    REQUIRE(get_effective_thinning_interval(
+            std::vector< std::vector<double> >({independent})) < 3);
+
+    // Fixed parameters are ignored
+    REQUIRE(get_effective_thinning_interval(
+            std::vector< std::vector<double> >({fixed})) == 1);
+    REQUIRE(get_effective_thinning_interval(
+            std::vector< std::vector<double> >({fixed, autocorrelated})) == thin);
+
+    REQUIRE(get_effective_thinning_interval(
+            std::vector< std::vector<double> >()) == 1);
+    REQUIRE(get_effective_thinning_interval(
+            std::vector< std::vector<double> >({{1.0}})) == 1);
+}
@@ -212,3 +212,72 @@ TEST_CASE("Testing working example", "[sumphycoeval]") {
         REQUIRE(expected_map_stream.str() == map_stream.str());
     }
 }
+
+TEST_CASE("Testing auto burnin", "[sumphycoeval]") {
+
+    SECTION("Testing auto burnin") {
+        char source1[] = "data/4-tip-trees-12-34.nex";
+        char source2[] = "data/4-tip-trees-12.nex";
+        char source3[] = "data/4-tip-trees-13-24.nex";
+
+        char m_out_path[] = "data/tmp-map-tree-out-sumphyco-auto-burnin.nex";
+
+        char exe[] = "sumphycoeval";
+        char auto_flag[] = "--auto-burnin";
+        char m_out_flag[] = "--map-tree-out";
+        char force[] = "--force";
+
+        char * argv[] = {
+            &exe[0],
+            &force[0],
+            &auto_flag[0],
+            &m_out_flag[0],
+            &m_out_path[0],
+            &source1[0],
+            &source2[0],
+            &source3[0],
+            NULL
+        };
+        int argc = (int)(sizeof(argv) / sizeof(argv[0])) - 1;
+        int ret;
+
+        ret = sumphycoeval_main<PopulationNode>(argc, argv);
+        REQUIRE(ret == 0);
+        REQUIRE(path::exists(m_out_path));
+
+        // The logs are too short to detect any burn in
+        std::vector<std::string> source_tree_paths {
+                "data/4-tip-trees-12-34.nex",
+                "data/4-tip-trees-12.nex",
+                "data/4-tip-trees-13-24.nex",
+        };
+        treesum::TreeSample<PopulationNode> ts(
+                source_tree_paths,
+                "nexus",
+                0);
+        std::stringstream expected_map_stream;
+        ts.write_map_trees_to_nexus(expected_map_stream, false, 18);
+
+        std::stringstream map_stream;
+        std::ifstream map_file_in_stream(m_out_path);
+        map_stream << map_file_in_stream.rdbuf();
+        REQUIRE(map_stream.str() == expected_map_stream.str());
+
+        // Burn in cannot be specified along with auto burn in
+        char burnin_flag[] = "--burnin";
+        char burnin[] = "2";
+        char * burnin_argv[] = {
+            &exe[0],
+            &force[0],
+            &auto_flag[0],
+            &burnin_flag[0],
+            &burnin[0],
+            &source1[0],
+            NULL
+        };
+        int burnin_argc = (int)(sizeof(burnin_argv) / sizeof(burnin_argv[0])) - 1;
+        REQUIRE_THROWS_AS(
+                (sumphycoeval_main<PopulationNode>(burnin_argc, burnin_argv)),
+                EcoevolityError &);
+    }
+}
@@ -4949,6 +4949,626 @@ TEST_CASE("Testing likelihood of PopulationTree with three-way polytomy at root"
     }
 }
 
+TEST_CASE("Testing flat tree likelihood of PopulationTree", "[PopulationTree]") {
+
+    SECTION("Testing flat tree likelihood matches tree likelihood") {
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(5, "root", 0.1);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(4, "internal 0", 0.04);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf 0", 0.0, 4);
+        leaf0->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf 1", 0.0, 4);
+        leaf1->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf 2", 0.0, 4);
+        leaf2->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf3 = std::make_shared<PopulationNode>(3, "leaf 3", 0.0, 4);
+        leaf3->fix_node_height();
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        root->add_child(internal0);
+        root->add_child(leaf2);
+        root->add_child(leaf3);
+
+        PopulationTree tree(root,
+                100,   // number of loci
+                1,     // length of loci
+                true); // validate data
+        tree.set_all_population_sizes(0.005);
+        leaf0->set_population_size(0.002);
+        internal0->set_population_size(0.01);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BiallelicData bd = tree.simulate_linked_biallelic_data_set(rng,
+                1.0,    // singleton sample probability
+                false,  // max one variable site per locus
+                true);  // validate data set
+        tree.set_data(bd, false);
+
+        tree.update_flat_tree();
+        const FlatTree<PopulationNode> & flat_tree = tree.get_flat_tree();
+        REQUIRE(flat_tree.get_number_of_nodes() == 6);
+        REQUIRE(flat_tree.get_root_index() == 5);
+        REQUIRE(flat_tree.get_node(5) == root.get());
+        REQUIRE(flat_tree.get_parent_index(5) == -1);
+        REQUIRE(flat_tree.get_number_of_children(5) == 3);
+        REQUIRE(flat_tree.get_node(flat_tree.get_child_index(5, 0)) == internal0.get());
+        REQUIRE(flat_tree.get_node(flat_tree.get_child_index(5, 1)) == leaf2.get());
+        REQUIRE(flat_tree.get_node(flat_tree.get_child_index(5, 2)) == leaf3.get());
+        REQUIRE(flat_tree.get_node(0) == leaf0.get());
+        REQUIRE(flat_tree.get_node(1) == leaf1.get());
+        REQUIRE(flat_tree.get_node(2) == internal0.get());
+        REQUIRE(flat_tree.is_leaf(0));
+        REQUIRE(! flat_tree.is_leaf(2));
+        REQUIRE(flat_tree.get_length(2) == Approx(0.06));
+        REQUIRE(flat_tree.get_length(5) == 0.0);
+
+        std::vector<double> thetas;
+        std::vector<double> lengths;
+        get_flat_branch_parameters(flat_tree,
+                tree.get_mutation_rate(),
+                tree.get_ploidy(),
+                thetas,
+                lengths);
+        FlatLikelihoodWorkspace workspace;
+        const BiallelicData & data = tree.get_data();
+        REQUIRE(data.get_number_of_patterns() > 1);
+        double expected_lnl = 0.0;
+        for (unsigned int i = 0; i < data.get_number_of_patterns(); ++i) {
+            double l = compute_pattern_likelihood(flat_tree,
+                    thetas,
+                    lengths,
+                    workspace,
+                    data.get_red_allele_count_matrix().at(i),
+                    data.get_allele_count_matrix().at(i),
+                    tree.get_u(),
+                    tree.get_v(),
+                    false);
+            REQUIRE(l > 0.0);
+            REQUIRE(l < 1.0);
+            expected_lnl += data.get_pattern_weight(i) * std::log(l);
+        }
+        expected_lnl += tree.get_likelihood_correction();
+        REQUIRE(tree.compute_log_likelihood() == Approx(expected_lnl));
+
+        // Heights are refreshed without recompiling
+        FlatTree<PopulationNode> other_flat_tree(*root);
+        internal0->set_height(0.05);
+        REQUIRE(! other_flat_tree.update(*root));
+        REQUIRE(other_flat_tree.get_height(2) == 0.05);
+
+        // Topology changes trigger a recompile
+        leaf3->remove_parent();
+        internal0->add_child(leaf3);
+        REQUIRE(other_flat_tree.update(*root));
+        REQUIRE(other_flat_tree.get_number_of_children(5) == 2);
+        REQUIRE(other_flat_tree.get_number_of_children(3) == 3);
+        REQUIRE(other_flat_tree.get_node(3) == internal0.get());
+        REQUIRE(! other_flat_tree.update(*root));
+
+        // Topology changes in other trees do not
+        std::shared_ptr<PopulationNode> other_root = std::make_shared<PopulationNode>("other root", 0.1);
+        std::shared_ptr<PopulationNode> other_leaf0 = std::make_shared<PopulationNode>(0, "other leaf 0", 0.0);
+        other_root->add_child(other_leaf0);
+        other_root->add_child(std::make_shared<PopulationNode>(1, "other leaf 1", 0.0));
+        other_leaf0->set_index(5);
+        REQUIRE(! other_flat_tree.update(*root));
+
+        // Nor do changes to nodes after they are removed from the tree
+        std::shared_ptr<PopulationNode> removed = internal0->remove_child(2);
+        REQUIRE(other_flat_tree.update(*root));
+        removed->set_index(7);
+        REQUIRE(! other_flat_tree.update(*root));
+
+        // Clearing forces a recompile
+        other_flat_tree.clear();
+        REQUIRE(! other_flat_tree.is_compiled_from(*root));
+        REQUIRE(other_flat_tree.update(*root));
+        REQUIRE(other_flat_tree.is_compiled_from(*root));
+    }
+}
+
+TEST_CASE("Testing likelihood of BasePopulationTree with integrated population sizes",
+        "[BasePopulationTree]") {
+
+    SECTION("Testing integrated likelihood matches brute-force average") {
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(4, "root", 0.1);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(3, "internal 0", 0.04);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf 0", 0.0, 3);
+        leaf0->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf 1", 0.0, 3);
+        leaf1->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf 2", 0.0, 3);
+        leaf2->fix_node_height();
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        root->add_child(internal0);
+        root->add_child(leaf2);
+
+        BasePopulationTree tree(root,
+                200,    // number of loci
+                1,      // length of loci
+                false); // validate data
+        tree.set_all_population_sizes(0.005);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(1234);
+        BiallelicData bd = tree.simulate_biallelic_data_set(rng, 1.0, false);
+        tree.set_data(bd, false);
+        tree.set_population_size_prior(std::make_shared<GammaDistribution>(2.0, 0.0025));
+        tree.estimate_population_sizes();
+
+        REQUIRE(! tree.population_sizes_are_integrated());
+        tree.integrate_population_sizes(2);
+        REQUIRE(tree.population_sizes_are_integrated());
+        REQUIRE(tree.population_sizes_are_fixed());
+        const std::vector<double> & multipliers = tree.get_population_size_multipliers();
+        REQUIRE(multipliers.size() == 2);
+        REQUIRE(multipliers.at(0) < 1.0);
+        REQUIRE(multipliers.at(1) > 1.0);
+        REQUIRE((multipliers.at(0) + multipliers.at(1)) / 2.0 == Approx(1.0));
+        REQUIRE(tree.get_root_population_size() == Approx(0.005));
+
+        tree.update_flat_tree();
+        const FlatTree<PopulationNode> & flat_tree = tree.get_flat_tree();
+        const unsigned int nnodes = flat_tree.get_number_of_nodes();
+        REQUIRE(nnodes == 5);
+        std::vector<double> thetas;
+        std::vector<double> lengths;
+        get_flat_branch_parameters(flat_tree,
+                tree.get_mutation_rate(),
+                tree.get_ploidy(),
+                thetas,
+                lengths);
+        FlatLikelihoodWorkspace workspace;
+        const BiallelicData & data = tree.get_data();
+        REQUIRE(data.get_number_of_patterns() > 1);
+        double expected_lnl = 0.0;
+        for (unsigned int i = 0; i < data.get_number_of_patterns(); ++i) {
+            // Average over every combination of categories of the branches
+            double expected_l = 0.0;
+            const unsigned int ncombos = 1 << nnodes;
+            for (unsigned int combo = 0; combo < ncombos; ++combo) {
+                std::vector<double> combo_thetas = thetas;
+                for (unsigned int j = 0; j < nnodes; ++j) {
+                    combo_thetas.at(j) *= multipliers.at((combo >> j) & 1);
+                }
+                expected_l += compute_pattern_likelihood(flat_tree,
+                        combo_thetas,
+                        lengths,
+                        workspace,
+                        data.get_red_allele_count_matrix().at(i),
+                        data.get_allele_count_matrix().at(i),
+                        tree.get_u(),
+                        tree.get_v(),
+                        false);
+            }
+            expected_l /= ncombos;
+            double l = compute_pattern_likelihood(flat_tree,
+                    thetas,
+                    lengths,
+                    workspace,
+                    data.get_red_allele_count_matrix().at(i),
+                    data.get_allele_count_matrix().at(i),
+                    tree.get_u(),
+                    tree.get_v(),
+                    false,
+                    multipliers);
+            REQUIRE(l == Approx(expected_l).epsilon(1e-10));
+            expected_lnl += data.get_pattern_weights().at(i) * std::log(expected_l);
+        }
+        REQUIRE(! tree.constant_sites_removed());
+        tree.make_dirty();
+        double lnl = tree.compute_log_likelihood();
+        REQUIRE(lnl == Approx(expected_lnl + tree.get_likelihood_correction()).epsilon(1e-10));
+
+        // Population sizes are not logged
+        std::ostringstream header;
+        tree.write_state_log_header(header, "\t");
+        REQUIRE(header.str().find("pop_size") == std::string::npos);
+        std::vector<double> values;
+        tree.get_state_log_values(values, 0);
+        REQUIRE(values.size() == 9);
+    }
+}
+
+TEST_CASE("Testing rescaling of flat likelihood partials", "[likelihood]") {
+
+    SECTION("Testing rescale_pattern_probs") {
+        std::vector<double> probs = {std::ldexp(0.75, -200), std::ldexp(0.5, -210), 0.0};
+        int scale_exponent = 3;
+        REQUIRE(rescale_pattern_probs(probs, std::ldexp(1.0, -128), scale_exponent));
+        REQUIRE(scale_exponent == -197);
+        REQUIRE(probs.at(0) == 0.75);
+        REQUIRE(probs.at(1) == std::ldexp(0.5, -10));
+        REQUIRE(probs.at(2) == 0.0);
+
+        REQUIRE(! rescale_pattern_probs(probs, std::ldexp(1.0, -128), scale_exponent));
+        REQUIRE(scale_exponent == -197);
+        REQUIRE(probs.at(0) == 0.75);
+
+        std::vector<double> zeros(4, 0.0);
+        REQUIRE(! rescale_pattern_probs(zeros, 1.0, scale_exponent));
+        REQUIRE(scale_exponent == -197);
+    }
+
+    SECTION("Testing rescaled likelihoods match unscaled") {
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(5, "root", 0.1);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(4, "internal 0", 0.04);
+        std::shared_ptr<PopulationNode> leaf0 = std::make_shared<PopulationNode>(0, "leaf 0", 0.0, 10);
+        leaf0->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf1 = std::make_shared<PopulationNode>(1, "leaf 1", 0.0, 8);
+        leaf1->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf2 = std::make_shared<PopulationNode>(2, "leaf 2", 0.0, 6);
+        leaf2->fix_node_height();
+        std::shared_ptr<PopulationNode> leaf3 = std::make_shared<PopulationNode>(3, "leaf 3", 0.0, 10);
+        leaf3->fix_node_height();
+
+        internal0->add_child(leaf0);
+        internal0->add_child(leaf1);
+        root->add_child(internal0);
+        root->add_child(leaf2);
+        root->add_child(leaf3);
+
+        BasePopulationTree tree(root,
+                200,    // number of loci
+                1,      // length of loci
+                false); // validate data
+        tree.set_all_population_sizes(0.005);
+
+        RandomNumberGenerator rng = RandomNumberGenerator(4321);
+        BiallelicData bd = tree.simulate_biallelic_data_set(rng, 1.0, false);
+        tree.set_data(bd, false);
+
+        tree.update_flat_tree();
+        const FlatTree<PopulationNode> & flat_tree = tree.get_flat_tree();
+        std::vector<double> thetas;
+        std::vector<double> lengths;
+        get_flat_branch_parameters(flat_tree,
+                tree.get_mutation_rate(),
+                tree.get_ploidy(),
+                thetas,
+                lengths);
+        std::vector<double> multipliers = {0.5, 1.5};
+        FlatLikelihoodWorkspace workspace;
+        FlatLikelihoodWorkspace rescaled_workspace;
+        // Rescale every partial
+        rescaled_workspace.rescale_threshold = 1.0;
+        const BiallelicData & data = tree.get_data();
+        REQUIRE(data.get_number_of_patterns() > 1);
+        unsigned int number_of_rescaled_patterns = 0;
+        for (unsigned int i = 0; i < data.get_number_of_patterns(); ++i) {
+            for (unsigned int m = 0; m < 2; ++m) {
+                std::vector<double> theta_multipliers;
+                if (m > 0) {
+                    theta_multipliers = multipliers;
+                }
+                double l = compute_pattern_likelihood(flat_tree,
+                        thetas,
+                        lengths,
+                        workspace,
+                        data.get_red_allele_count_matrix().at(i),
+                        data.get_allele_count_matrix().at(i),
+                        tree.get_u(),
+                        tree.get_v(),
+                        false,
+                        theta_multipliers);
+                REQUIRE(workspace.scale_exponents.at(flat_tree.get_root_index()) == 0);
+                double lnl = compute_pattern_log_likelihood(flat_tree,
+                        thetas,
+                        lengths,
+                        workspace,
+                        data.get_red_allele_count_matrix().at(i),
+                        data.get_allele_count_matrix().at(i),
+                        tree.get_u(),
+                        tree.get_v(),
+                        false,
+                        theta_multipliers);
+                REQUIRE(lnl == std::log(l));
+
+                double rescaled_l = compute_pattern_likelihood(flat_tree,
+                        thetas,
+                        lengths,
+                        rescaled_workspace,
+                        data.get_red_allele_count_matrix().at(i),
+                        data.get_allele_count_matrix().at(i),
+                        tree.get_u(),
+                        tree.get_v(),
+                        false,
+                        theta_multipliers);
+                double rescaled_lnl = compute_pattern_log_likelihood(flat_tree,
+                        thetas,
+                        lengths,
+                        rescaled_workspace,
+                        data.get_red_allele_count_matrix().at(i),
+                        data.get_allele_count_matrix().at(i),
+                        tree.get_u(),
+                        tree.get_v(),
+                        false,
+                        theta_multipliers);
+                if (rescaled_workspace.scale_exponents.at(flat_tree.get_root_index()) != 0) {
+                    ++number_of_rescaled_patterns;
+                }
+                REQUIRE(rescaled_l == Approx(l).epsilon(1e-10));
+                REQUIRE(rescaled_lnl == Approx(lnl).epsilon(1e-10));
+            }
+        }
+        REQUIRE(number_of_rescaled_patterns > 0);
+    }
+}
+
+TEST_CASE("Testing cached constant-pattern likelihood correction", "[likelihood]") {
+
+    SECTION("Testing cached correction matches uncached") {
+        std::vector<unsigned int> max_allele_counts = {10, 8, 6, 10};
+        std::vector< std::shared_ptr<PopulationNode> > leaves;
+        for (unsigned int i = 0; i < 4; ++i) {
+            leaves.push_back(std::make_shared<PopulationNode>(i,
+                    "leaf " + std::to_string(i), 0.0, max_allele_counts.at(i)));
+            leaves.back()->fix_node_height();
+        }
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(5, "root", 0.1);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(4, "internal 0", 0.04);
+        internal0->add_child(leaves.at(0));
+        internal0->add_child(leaves.at(1));
+        root->add_child(internal0);
+        root->add_child(leaves.at(2));
+        root->add_child(leaves.at(3));
+        root->set_all_population_sizes(0.005);
+        FlatTree<PopulationNode> flat_tree(*root);
+
+        // A different topology with the same number of nodes
+        std::vector< std::shared_ptr<PopulationNode> > other_leaves;
+        for (unsigned int i = 0; i < 4; ++i) {
+            other_leaves.push_back(std::make_shared<PopulationNode>(i,
+                    "leaf " + std::to_string(i), 0.0, max_allele_counts.at(i)));
+            other_leaves.back()->fix_node_height();
+        }
+        std::shared_ptr<PopulationNode> other_root = std::make_shared<PopulationNode>(5, "root", 0.1);
+        std::shared_ptr<PopulationNode> other_internal = std::make_shared<PopulationNode>(4, "internal 0", 0.04);
+        other_internal->add_child(other_leaves.at(0));
+        other_internal->add_child(other_leaves.at(2));
+        other_root->add_child(other_internal);
+        other_root->add_child(other_leaves.at(1));
+        other_root->add_child(other_leaves.at(3));
+        other_root->set_all_population_sizes(0.005);
+        FlatTree<PopulationNode> other_flat_tree(*other_root);
+
+        // Allele counts with missing data
+        RandomNumberGenerator rng = RandomNumberGenerator(123);
+        std::vector< std::vector<unsigned int> > unique_allele_counts;
+        std::vector<unsigned int> weights;
+        for (unsigned int i = 0; i < 300; ++i) {
+            std::vector<unsigned int> counts;
+            for (auto max_count : max_allele_counts) {
+                counts.push_back(rng.uniform_int(1, max_count));
+            }
+            counts.at(rng.uniform_int(0, 3)) = 0;
+            unique_allele_counts.push_back(counts);
+            weights.push_back(rng.uniform_int(1, 5));
+        }
+
+        std::vector<double> thetas;
+        std::vector<double> lengths;
+        get_flat_branch_parameters(flat_tree, 1.0, 2.0, thetas, lengths);
+        std::vector<double> other_thetas;
+        std::vector<double> other_lengths;
+        get_flat_branch_parameters(other_flat_tree, 1.0, 2.0, other_thetas, other_lengths);
+
+        FlatLikelihoodWorkspace workspace;
+        ConstantPatternLikelihoodCache cache;
+        auto check = [&](const FlatTree<PopulationNode> & t,
+                const std::vector<double> & t_thetas,
+                const std::vector<double> & t_lengths,
+                double u,
+                double v,
+                bool constrained) {
+            double expected;
+            compute_constant_pattern_log_likelihood_correction(t,
+                    t_thetas, t_lengths, workspace,
+                    unique_allele_counts, weights,
+                    u, v, false, constrained, expected);
+            double cached;
+            compute_constant_pattern_log_likelihood_correction(t,
+                    t_thetas, t_lengths, workspace,
+                    unique_allele_counts, weights,
+                    u, v, false, constrained, cached,
+                    std::vector<double>(), &cache);
+            REQUIRE(cached == expected);
+            REQUIRE(cached < 0.0);
+        };
+
+        check(flat_tree, thetas, lengths, 1.0, 1.0, true);
+        unsigned int n = cache.get_number_of_partials_computed();
+        REQUIRE(n > 0);
+        // Many allele-count vectors share the counts of leaves below a node
+        REQUIRE(n < (unique_allele_counts.size() * 5));
+
+        // Nothing is recomputed if nothing changes
+        check(flat_tree, thetas, lengths, 1.0, 1.0, true);
+        REQUIRE(cache.get_number_of_partials_computed() == n);
+
+        // Changing the root population size only changes root likelihoods
+        thetas.at(flat_tree.get_root_index()) *= 2.0;
+        check(flat_tree, thetas, lengths, 1.0, 1.0, true);
+        REQUIRE(cache.get_number_of_partials_computed() == n);
+
+        // Changing a leaf branch only recomputes the leaf and its ancestors
+        unsigned int leaf_node_idx = 0;
+        REQUIRE(flat_tree.is_leaf(leaf_node_idx));
+        lengths.at(leaf_node_idx) *= 1.5;
+        check(flat_tree, thetas, lengths, 1.0, 1.0, true);
+        unsigned int n_leaf = cache.get_number_of_partials_computed() - n;
+        REQUIRE(n_leaf > 0);
+        REQUIRE(n_leaf < n);
+        n = cache.get_number_of_partials_computed();
+
+        // Changes to the whole model
+        check(flat_tree, thetas, lengths, 0.8, 1.3333333333333333, false);
+        check(other_flat_tree, other_thetas, other_lengths, 0.8, 1.3333333333333333, false);
+        check(flat_tree, thetas, lengths, 0.8, 1.3333333333333333, false);
+        REQUIRE(cache.get_number_of_partials_computed() > n);
+
+        // New allele counts require clearing the cache
+        unique_allele_counts.at(0) = {1, 0, 1, 2};
+        cache.clear();
+        check(flat_tree, thetas, lengths, 0.8, 1.3333333333333333, false);
+    }
+}
+
+TEST_CASE("Testing likelihood with patterns in PatternOrder", "[likelihood]") {
+
+    SECTION("Testing ordered likelihood matches unordered") {
+        std::vector<unsigned int> max_allele_counts = {4, 4, 2, 6};
+        std::vector< std::shared_ptr<PopulationNode> > leaves;
+        for (unsigned int i = 0; i < 4; ++i) {
+            leaves.push_back(std::make_shared<PopulationNode>(i,
+                    "leaf " + std::to_string(i), 0.0, max_allele_counts.at(i)));
+            leaves.back()->fix_node_height();
+        }
+        std::shared_ptr<PopulationNode> root = std::make_shared<PopulationNode>(5, "root", 0.1);
+        std::shared_ptr<PopulationNode> internal0 = std::make_shared<PopulationNode>(4, "internal 0", 0.04);
+        internal0->add_child(leaves.at(0));
+        internal0->add_child(leaves.at(1));
+        root->add_child(internal0);
+        root->add_child(leaves.at(2));
+        root->add_child(leaves.at(3));
+        root->set_all_population_sizes(0.005);
+        FlatTree<PopulationNode> flat_tree(*root);
+
+        // Variable patterns with missing data
+        RandomNumberGenerator rng = RandomNumberGenerator(321);
+        std::vector< std::vector<unsigned int> > red_allele_counts;
+        std::vector< std::vector<unsigned int> > allele_counts;
+        std::vector<unsigned int> weights;
+        for (unsigned int i = 0; i < 500; ++i) {
+            std::vector<unsigned int> counts;
+            std::vector<unsigned int> red_counts;
+            unsigned int total_red = 0;
+            for (auto max_count : max_allele_counts) {
+                counts.push_back(rng.uniform_int(1, max_count));
+                red_counts.push_back(rng.uniform_int(0, counts.back()));
+                total_red += red_counts.back();
+            }
+            if (total_red < 1) {
+                red_counts.at(0) = 1;
+            }
+            allele_counts.push_back(counts);
+            red_allele_counts.push_back(red_counts);
+            weights.push_back(rng.uniform_int(1, 5));
+        }
+        std::vector< std::vector<unsigned int> > unique_allele_counts = allele_counts;
+        std::vector<unsigned int> unique_weights(allele_counts.size(), 1);
+
+        PatternOrder order;
+        order.update(red_allele_counts, allele_counts);
+        REQUIRE(order.size() == allele_counts.size());
+        std::vector<unsigned int> indices = order.get_pattern_indices();
+        std::sort(indices.begin(), indices.end());
+        for (unsigned int i = 0; i < indices.size(); ++i) {
+            REQUIRE(indices.at(i) == i);
+        }
+        const std::vector<unsigned int> & ordered = order.get_pattern_indices();
+        for (unsigned int i = 1; i < ordered.size(); ++i) {
+            REQUIRE(allele_counts.at(ordered.at(i - 1)).at(0) <= allele_counts.at(ordered.at(i)).at(0));
+        }
+
+        // Batches cover all of the patterns in order
+        for (unsigned int nbatches = 1; nbatches < 6; ++nbatches) {
+            REQUIRE(order.get_batch_start(0, nbatches) == 0);
+            REQUIRE(order.get_batch_start(nbatches, nbatches) == order.size());
+            for (unsigned int b = 0; b < nbatches; ++b) {
+                REQUIRE(order.get_batch_start(b, nbatches) <= order.get_batch_start(b + 1, nbatches));
+            }
+        }
+
+        // Reused partials give the same pattern likelihoods
+        std::vector<double> thetas;
+        std::vector<double> lengths;
+        get_flat_branch_parameters(flat_tree, 1.0, 2.0, thetas, lengths);
+        FlatLikelihoodWorkspace workspace;
+        FlatLikelihoodWorkspace reuse_workspace;
+        for (unsigned int i = 0; i < ordered.size(); ++i) {
+            unsigned int pattern_idx = ordered.at(i);
+            double expected = compute_pattern_log_likelihood(flat_tree,
+                    thetas, lengths, workspace,
+                    red_allele_counts.at(pattern_idx),
+                    allele_counts.at(pattern_idx),
+                    1.0, 1.0, false);
+            double reused = compute_pattern_log_likelihood(flat_tree,
+                    thetas, lengths, reuse_workspace,
+                    red_allele_counts.at(pattern_idx),
+                    allele_counts.at(pattern_idx),
+                    1.0, 1.0, false,
+                    std::vector<double>(),
+                    (i > 0) ? &red_allele_counts.at(ordered.at(i - 1)) : nullptr,
+                    (i > 0) ? &allele_counts.at(ordered.at(i - 1)) : nullptr);
+            REQUIRE(reused == expected);
+        }
+
+        for (bool constant_sites_removed : {false, true}) {
+            double correction = 0.0;
+            double expected = get_log_likelihood(flat_tree,
+                    red_allele_counts, allele_counts, weights,
+                    unique_allele_counts, unique_weights,
+                    0.8, 1.3333333333333333, 1.0, 2.0,
+                    false, false, constant_sites_removed, correction);
+            double ordered_correction = 0.0;
+            double ordered_lnl = get_log_likelihood(flat_tree,
+                    red_allele_counts, allele_counts, weights,
+                    unique_allele_counts, unique_weights,
+                    0.8, 1.3333333333333333, 1.0, 2.0,
+                    false, false, constant_sites_removed, ordered_correction,
+                    1, std::vector<double>(),
+                    -std::numeric_limits<double>::infinity(),
+                    nullptr, &order);
+            REQUIRE(ordered_lnl == expected);
+            REQUIRE(ordered_correction == correction);
+
+            ordered_lnl = get_log_likelihood(flat_tree,
+                    red_allele_counts, allele_counts, weights,
+                    unique_allele_counts, unique_weights,
+                    0.8, 1.3333333333333333, 1.0, 2.0,
+                    false, false, constant_sites_removed, ordered_correction,
+                    3, std::vector<double>(),
+                    -std::numeric_limits<double>::infinity(),
+                    nullptr, &order);
+            REQUIRE(ordered_lnl == expected);
+
+            // Stopping early gives a bound below the minimum
+            double minimum = (expected - correction) / 2.0;
+            ordered_lnl = get_log_likelihood(flat_tree,
+                    red_allele_counts, allele_counts, weights,
+                    unique_allele_counts, unique_weights,
+                    0.8, 1.3333333333333333, 1.0, 2.0,
+                    false, false, constant_sites_removed, ordered_correction,
+                    1, std::vector<double>(),
+                    minimum, nullptr, &order);
+            REQUIRE((ordered_lnl - ordered_correction) < minimum);
+            REQUIRE(ordered_lnl >= expected);
+        }
+
+        // An order for other patterns is not used
+        PatternOrder other_order;
+        other_order.update(
+                std::vector< std::vector<unsigned int> >(red_allele_counts.begin(), red_allele_counts.begin() + 10),
+                std::vector< std::vector<unsigned int> >(allele_counts.begin(), allele_counts.begin() + 10));
+        double correction = 0.0;
+        double expected = get_log_likelihood(flat_tree,
+                red_allele_counts, allele_counts, weights,
+                unique_allele_counts, unique_weights,
+                0.8, 1.3333333333333333, 1.0, 2.0,
+                false, false, false, correction);
+        REQUIRE(get_log_likelihood(flat_tree,
+                red_allele_counts, allele_counts, weights,
+                unique_allele_counts, unique_weights,
+                0.8, 1.3333333333333333, 1.0, 2.0,
+                false, false, false, correction,
+                1, std::vector<double>(),
+                -std::numeric_limits<double>::infinity(),
+                nullptr, &other_order) == expected);
+    }
+}
+
 TEST_CASE("Testing likelihood of PopulationTree with four-way polytomy at root", "[PopulationTree]") {
 
     SECTION("Testing constructor and likelihood calc") {
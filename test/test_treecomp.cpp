@@ -51,3 +51,76 @@ TEST_CASE("Testing euclidean_distance with comb vs 1-clade", "[treecomp]") {
         REQUIRE(treecomp::euclidean_distance(tree1, tree2, true) == Approx(std::sqrt(12.0)));
     }
 }
+
+TEST_CASE("Testing DistanceMatrixCalculator", "[treecomp]") {
+    SECTION("Testing DistanceMatrixCalculator") {
+        std::string t1 = "(sp1[&height=0.0,pop_size=0.001]:4.0,sp2[&height=0.0,pop_size=0.002]:4.0,sp3[&height=0.0,pop_size=0.002]:4.0,sp4[&height=0.0,pop_size=0.002]:4.0)[&height_index=0,height=4.0,pop_size=0.003];";
+        std::string t2 = "((sp1[&height=0.0,pop_size=0.001]:2.0,sp2[&height=0.0,pop_size=0.002]:2.0)[&height_index=0,height=2.0,pop_size=0.002]:2.0,sp3[&height=0.0,pop_size=0.002]:4.0,sp4[&height=0.0,pop_size=0.002]:4.0)[&height_index=1,height=4.0,pop_size=0.003];";
+        std::string t3 = "((sp1[&height=0.0,pop_size=0.001]:1.0,sp2[&height=0.0,pop_size=0.002]:1.0)[&height_index=0,height=1.0,pop_size=0.002]:2.0,(sp3[&height=0.0,pop_size=0.002]:1.0,sp4[&height=0.0,pop_size=0.002]:1.0)[&height_index=0,height=1.0,pop_size=0.002]:2.0)[&height_index=1,height=3.0,pop_size=0.003];";
+        std::string t4 = "((sp1[&height=0.0,pop_size=0.001]:1.0,sp3[&height=0.0,pop_size=0.002]:1.0)[&height_index=0,height=1.0,pop_size=0.002]:2.0,(sp2[&height=0.0,pop_size=0.002]:1.0,sp4[&height=0.0,pop_size=0.002]:1.0)[&height_index=0,height=1.0,pop_size=0.002]:2.0)[&height_index=1,height=3.0,pop_size=0.003];";
+        std::vector< BaseTree<Node> > trees;
+        for (auto t : {t1, t2, t3, t4, t2, t1, t4}) {
+            trees.push_back(BaseTree<Node>(t));
+        }
+
+        treecomp::DistanceMatrixCalculator calculator;
+        for (auto const & tree : trees) {
+            calculator.add_tree(tree, true);
+        }
+        REQUIRE(calculator.get_number_of_trees() == 7);
+        // 4 leaf splits, the root split, and {1,2}, {3,4}, {1,3} and {2,4}
+        REQUIRE(calculator.get_number_of_splits() == 9);
+
+        // Tiles smaller than the matrix
+        treecomp::TreeDistances distances = calculator.calculate(3, 2);
+        REQUIRE(distances.get_number_of_trees() == 7);
+        for (unsigned int i = 0; i < trees.size(); ++i) {
+            REQUIRE(distances.get_robinson_foulds(i, i) == 0.0);
+            REQUIRE(distances.get_euclidean(i, i) == 0.0);
+            for (unsigned int j = 0; j < trees.size(); ++j) {
+                REQUIRE(distances.get_euclidean(i, j) == Approx(
+                        treecomp::euclidean_distance(trees.at(i), trees.at(j), true)));
+                REQUIRE(distances.get_robinson_foulds(i, j) ==
+                        distances.get_robinson_foulds(j, i));
+            }
+        }
+        REQUIRE(distances.get_euclidean(0, 1) == Approx(std::sqrt(12.0)));
+        REQUIRE(distances.get_robinson_foulds(0, 1) == 1.0);
+        REQUIRE(distances.get_robinson_foulds(1, 2) == 1.0);
+        REQUIRE(distances.get_robinson_foulds(2, 3) == 4.0);
+        REQUIRE(distances.get_robinson_foulds(1, 4) == 0.0);
+
+        treecomp::TreeDistances serial_distances = calculator.calculate(1, 64);
+        for (unsigned int i = 0; i < trees.size(); ++i) {
+            for (unsigned int j = 0; j < trees.size(); ++j) {
+                REQUIRE(serial_distances.get_euclidean(i, j) == distances.get_euclidean(i, j));
+                REQUIRE(serial_distances.get_robinson_foulds(i, j) == distances.get_robinson_foulds(i, j));
+            }
+        }
+
+        // Pairs are streamed in order without storing the matrix
+        for (unsigned int nthreads : {1, 3}) {
+            std::vector< std::pair<unsigned int, unsigned int> > pairs;
+            calculator.for_each_pair(
+                    [&](unsigned int i, unsigned int j, double rf, double euclidean) {
+                        pairs.push_back(std::make_pair(i, j));
+                        REQUIRE(rf == distances.get_robinson_foulds(i, j));
+                        REQUIRE(euclidean == distances.get_euclidean(i, j));
+                    },
+                    nthreads,
+                    2);
+            REQUIRE(pairs.size() == 21);
+            unsigned int p = 0;
+            for (unsigned int i = 0; i < trees.size(); ++i) {
+                for (unsigned int j = i + 1; j < trees.size(); ++j) {
+                    REQUIRE(pairs.at(p) == std::make_pair(i, j));
+                    ++p;
+                }
+            }
+        }
+
+        treecomp::TreeDistances one_tree(1);
+        REQUIRE(one_tree.get_robinson_foulds(0, 0) == 0.0);
+        REQUIRE(one_tree.get_euclidean(0, 0) == 0.0);
+    }
+}
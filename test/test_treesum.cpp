@@ -6,6 +6,9 @@
 
 #include "ecoevolity/tree.hpp"
 #include "ecoevolity/node.hpp"
+#include "ecoevolity/rng.hpp"
+
+RandomNumberGenerator _TEST_TREESUM_RNG = RandomNumberGenerator();
 
 TEST_CASE("Testing bare BaseSample", "[treesum]") {
     SECTION("Testing bare BaseSample") {
@@ -1719,3 +1722,72 @@ TEST_CASE("Basic merged target heights summary", "[treesum]") {
         REQUIRE(sum_w_merged["merged_target_heights"][6]["older_height"].as<double>() == 0.2);
     }
 }
+
+TEST_CASE("Testing BurninSplitFrequencies", "[treesum]") {
+    SECTION("Testing BurninSplitFrequencies") {
+        std::vector<std::string> source_tree_paths {
+                "data/4-tip-trees-12-34.nex",
+                "data/4-tip-trees-12.nex",
+                "data/4-tip-trees-13-24.nex",
+                "data/4-tip-trees-14-23-shared.nex",
+                "data/4-tip-trees-34.nex",
+                "data/4-tip-trees-comb.nex",
+                "data/4-tip-trees-ladder-1234.nex",
+                "data/4-tip-trees-ladder-4321.nex",
+        };
+        treesum::TreeSample<PopulationNode> ts(source_tree_paths, "nexus", 1);
+        treesum::BurninSplitFrequencies split_freqs(ts);
+        REQUIRE(split_freqs.get_number_of_sources() == 8);
+        REQUIRE(split_freqs.get_sample_size(1) == ts.get_sample_size());
+        REQUIRE(ts.get_tree_indices().size() == ts.get_sample_size());
+
+        for (unsigned int burnin : {1, 2, 3}) {
+            treesum::TreeSample<PopulationNode> burnin_ts(source_tree_paths, "nexus", burnin);
+            REQUIRE(split_freqs.get_sample_size(burnin) == burnin_ts.get_sample_size());
+            for (unsigned int i = 0; i < 8; ++i) {
+                REQUIRE(split_freqs.get_source_sample_size(i, burnin) ==
+                        burnin_ts.get_source_sample_size(i));
+            }
+            if (burnin > 2) {
+                // Some sources have no trees left
+                continue;
+            }
+            for (double min_freq : {0.0, 0.1, 0.25}) {
+                SampleSummarizer<double> expected = burnin_ts.get_summary_of_split_freq_std_devs(min_freq);
+                SampleSummarizer<double> summary = split_freqs.get_summary_of_split_freq_std_devs(min_freq, burnin);
+                REQUIRE(summary.sample_size() == expected.sample_size());
+                REQUIRE(split_freqs.get_average_std_dev_of_split_freqs(min_freq, burnin) ==
+                        Approx(burnin_ts.get_average_std_dev_of_split_freqs(min_freq)));
+            }
+        }
+    }
+}
+
+TEST_CASE("Parsing error in source tree reports path", "[treesum]") {
+    SECTION("Parsing error in source tree reports path") {
+        std::string test_path = "data/tmp-" + _TEST_TREESUM_RNG.random_string(10) + ".nex";
+        std::ofstream out;
+        out.open(test_path);
+        out << "#NEXUS\n"
+            << "BEGIN TAXA;\n"
+            << "    DIMENSIONS NTAX=3;\n"
+            << "    TAXLABELS sp1 sp2 sp3;\n"
+            << "END;\n"
+            << "BEGIN TREES;\n"
+            << "    TREE t0 = ((sp1:1,sp2:1):1,sp3:2);\n"
+            << "    TREE t1 = ((sp1:1,sp2:1):1,x:2);\n"
+            << "END;\n";
+        out.close();
+
+        treesum::TreeSample<PopulationNode> ts;
+        std::string message;
+        try {
+            ts.add_trees(test_path, "nexus");
+        }
+        catch (EcoevolityParsingError & e) {
+            message = e.what();
+        }
+        std::remove(test_path.c_str());
+        REQUIRE(message.find(test_path) != std::string::npos);
+    }
+}